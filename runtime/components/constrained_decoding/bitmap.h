@@ -15,6 +15,11 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_CONSTRAINED_DECODING_BITMAP_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_CONSTRAINED_DECODING_BITMAP_H_
 
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"  // from @com_google_absl
+
 namespace litert::lm {
 
 // The bitmap of vocabulary to indicate the allowed tokens.
@@ -32,6 +37,42 @@ class AllAllowedBitmap : public Bitmap {
   bool Get(int index) const override { return true; }
 };
 
+// A bitmap implementation packed in 64-bit words: the `index`th token is
+// allowed if the bit `index % 64` of the word `index / 64` is set. The bits
+// past the size are always cleared, so that the words can be processed as a
+// whole.
+class PackedBitmap final : public Bitmap {
+ public:
+  // Creates a bitmap of `size` tokens, which are all allowed or all disallowed.
+  explicit PackedBitmap(int size, bool allowed = false)
+      : size_(size), words_((size + 63) / 64, allowed ? ~uint64_t{0} : 0) {
+    if (allowed && size % 64 != 0) {
+      words_.back() = (uint64_t{1} << (size % 64)) - 1;
+    }
+  }
+
+  bool Get(int index) const override {
+    return (words_[index / 64] >> (index % 64)) & 1;
+  }
+
+  // Allows or disallows the `index`th token.
+  void Set(int index, bool allowed) {
+    const uint64_t bit = uint64_t{1} << (index % 64);
+    if (allowed) {
+      words_[index / 64] |= bit;
+    } else {
+      words_[index / 64] &= ~bit;
+    }
+  }
+
+  int size() const { return size_; }
+  absl::Span<const uint64_t> words() const { return words_; }
+
+ private:
+  int size_;
+  std::vector<uint64_t> words_;
+};
+
 }  // namespace litert::lm
 
 #endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_CONSTRAINED_DECODING_BITMAP_H_
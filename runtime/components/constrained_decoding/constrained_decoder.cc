@@ -14,19 +14,57 @@
 
 #include "runtime/components/constrained_decoding/constrained_decoder.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
+#include <utility>
 
 #include "absl/status/status.h"  // from @com_google_absl
+#include "absl/synchronization/notification.h"  // from @com_google_absl
 #include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_layout.h"  // from @litert
 #include "litert/cc/litert_macros.h"  // from @litert
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/constrained_decoding/bitmap.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/status_macros.h"  //NOLINT
 
 namespace litert::lm {
+namespace {
+
+// Sets the logits of the tokens disallowed by `bitmap` to the lowest value, one
+// word of the bitmap at a time. Words allowing all or none of their tokens are
+// handled as a whole, and the loop over the bits of the other words is
+// branchless so that it can be vectorized.
+void MaskLogitsWithPackedBitmap(const PackedBitmap& bitmap,
+                                absl::Span<float> logits) {
+  constexpr float kLowest = std::numeric_limits<float>::lowest();
+  const absl::Span<const uint64_t> words = bitmap.words();
+  for (size_t w = 0; w < words.size(); ++w) {
+    const uint64_t word = words[w];
+    if (word == ~uint64_t{0}) {
+      continue;
+    }
+    const size_t begin = w * 64;
+    const size_t end = std::min(begin + 64, logits.size());
+    if (word == 0) {
+      std::fill(logits.begin() + begin, logits.begin() + end, kLowest);
+      continue;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      logits[i] = ((word >> (i - begin)) & 1) ? logits[i] : kLowest;
+    }
+  }
+}
+
+}  // namespace
+
+ConstrainedDecoder::~ConstrainedDecoder() {
+  WaitForPendingUpdate().IgnoreError();
+}
 
 absl::Status ConstrainedDecoder::UpdateConstraintState(
     const ::litert::TensorBuffer& next_token_ids) {
@@ -37,21 +75,65 @@ absl::Status ConstrainedDecoder::UpdateConstraintState(
 
 absl::Status ConstrainedDecoder::UpdateConstraintState(
     absl::Span<int> next_token_ids) {
+  RETURN_IF_ERROR(WaitForPendingUpdate());
+  return UpdateConstraintStateInternal(next_token_ids,
+                                       /*compute_bitmaps=*/false);
+}
+
+absl::Status ConstrainedDecoder::StartUpdateConstraintState(
+    absl::Span<const int> next_token_ids) {
+  RETURN_IF_ERROR(WaitForPendingUpdate());
+  if (thread_pool_ == nullptr) {
+    return UpdateConstraintStateInternal(next_token_ids,
+                                         /*compute_bitmaps=*/false);
+  }
+  // The token ids are copied, since their buffer may be reused by the caller
+  // while the update is pending.
+  pending_token_ids_.assign(next_token_ids.begin(), next_token_ids.end());
+  auto pending_update = std::make_unique<absl::Notification>();
+  absl::Notification* done = pending_update.get();
+  RETURN_IF_ERROR(thread_pool_->Schedule([this, done]() {
+    pending_status_ = UpdateConstraintStateInternal(pending_token_ids_,
+                                                    /*compute_bitmaps=*/true);
+    done->Notify();
+  }));
+  pending_update_ = std::move(pending_update);
+  return absl::OkStatus();
+}
+
+absl::Status ConstrainedDecoder::UpdateConstraintStateInternal(
+    absl::Span<const int> next_token_ids, bool compute_bitmaps) {
   RET_CHECK_EQ(next_token_ids.size(), batch_size_)
       << "Batch size [" << next_token_ids.size()
       << "] does not match the expected batch size [" << batch_size_ << "].";
   for (int i = 0; i < batch_size_; ++i) {
     auto& constraint_state = constraint_states_[i];
+    bitmaps_[i] = nullptr;
     ASSIGN_OR_RETURN(
         constraint_state,
         constraint_->ComputeNext(*constraint_state, next_token_ids[i]));
     if (constraint_->IsEnded(*constraint_state)) {
       constraint_state = constraint_->Start();
     }
+    // The bitmaps cached by the constraint need no computation.
+    if (compute_bitmaps &&
+        constraint_->GetPackedBitmap(*constraint_state) == nullptr) {
+      ASSIGN_OR_RETURN(bitmaps_[i],
+                       constraint_->ComputeBitmap(*constraint_state));
+    }
   }
   return absl::OkStatus();
 }
 
+absl::Status ConstrainedDecoder::WaitForPendingUpdate() {
+  if (pending_update_ == nullptr) {
+    return absl::OkStatus();
+  }
+  pending_update_->WaitForNotification();
+  pending_update_ = nullptr;
+  return std::exchange(pending_status_, absl::OkStatus());
+}
+
 absl::Status ConstrainedDecoder::MaskLogits(::litert::TensorBuffer& logits) {
   // Compute the allowed tokens bitmap for the current constraint state.
   LITERT_ASSIGN_OR_RETURN(auto logits_tensor_type, logits.TensorType());
@@ -63,6 +145,7 @@ absl::Status ConstrainedDecoder::MaskLogits(::litert::TensorBuffer& logits) {
 absl::Status ConstrainedDecoder::MaskLogits(
     absl::Span<float> logits,
     absl::Span<const ::litert::Layout::Dim> logits_dims) {
+  RETURN_IF_ERROR(WaitForPendingUpdate());
   RET_CHECK_EQ(logits_dims.size(), 3)
       << "Only support logits with dimensions [batch_size, 1, vocab_size].";
   int batch_size = logits_dims[0];
@@ -78,12 +161,27 @@ absl::Status ConstrainedDecoder::MaskLogits(
       << "] does not match the expected batch size [" << batch_size_ << "].";
   for (int b = 0; b < batch_size; ++b) {
     auto& constraint_state = constraint_states_[b];
-    ASSIGN_OR_RETURN(auto bitmap,
-                     constraint_->ComputeBitmap(*constraint_state));
+    absl::Span<float> batch_logits =
+        logits.subspan(b * vocab_size, vocab_size);
+    const PackedBitmap* packed_bitmap =
+        constraint_->GetPackedBitmap(*constraint_state);
+    std::unique_ptr<Bitmap>& bitmap = bitmaps_[b];
+    if (packed_bitmap == nullptr) {
+      if (bitmap == nullptr) {
+        ASSIGN_OR_RETURN(bitmap,
+                         constraint_->ComputeBitmap(*constraint_state));
+      }
+      packed_bitmap = dynamic_cast<const PackedBitmap*>(bitmap.get());
+    }
+    if (packed_bitmap != nullptr) {
+      RET_CHECK_EQ(packed_bitmap->size(), vocab_size)
+          << "Bitmap size does not match the vocabulary size.";
+      MaskLogitsWithPackedBitmap(*packed_bitmap, batch_logits);
+      continue;
+    }
     for (int i = 0; i < vocab_size; ++i) {
       if (!bitmap->Get(i)) {
-        logits.data()[b * vocab_size + i] =
-            std::numeric_limits<float>::lowest();
+        batch_logits[i] = std::numeric_limits<float>::lowest();
       }
     }
   }
@@ -20,11 +20,15 @@
 #include <memory>
 #include <vector>
 
+#include "absl/base/nullability.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
+#include "absl/synchronization/notification.h"  // from @com_google_absl
 #include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_layout.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/constrained_decoding/bitmap.h"
 #include "runtime/components/constrained_decoding/constraint.h"
+#include "runtime/framework/threadpool.h"
 
 namespace litert::lm {
 
@@ -46,6 +50,17 @@ namespace litert::lm {
 //     TensorBuffer next_tokens = sampler.Sample(logits);
 //     RETURN_IF_ERROR(decoder.UpdateConstraintState(next_tokens));
 //   }
+//
+// With a thread pool, the constraint states and bitmaps of the next step can be
+// computed while the model computes the logits of the next step:
+//   ConstrainedDecoder decoder(constraint, batch_size, &thread_pool);
+//   ...
+//   while (!done) {
+//     RETURN_IF_ERROR(decoder.StartUpdateConstraintState(next_tokens));
+//     TensorBuffer logits = Decode(next_tokens);
+//     RETURN_IF_ERROR(decoder.MaskLogits(logits));
+//     next_tokens = sampler.Sample(logits);
+//   }
 class ConstrainedDecoder {
  public:
   // Creates a ConstrainedDecoder.
@@ -53,13 +68,22 @@ class ConstrainedDecoder {
   // @param constraint The constraint to apply during decoding. The caller
   // retains ownership and must ensure it outlives the decoder.
   // @param batch_size The number of sequences in the batch.
-  explicit ConstrainedDecoder(Constraint* constraint, int batch_size)
-      : constraint_(constraint), batch_size_(batch_size) {
+  // @param thread_pool The thread pool StartUpdateConstraintState() computes
+  // the constraint states on. If null, they are computed on the calling
+  // thread. The caller retains ownership and must ensure it outlives the
+  // decoder.
+  explicit ConstrainedDecoder(Constraint* constraint, int batch_size,
+                              ThreadPool* absl_nullable thread_pool = nullptr)
+      : constraint_(constraint),
+        batch_size_(batch_size),
+        thread_pool_(thread_pool) {
     constraint_states_.reserve(batch_size_);
     std::generate_n(std::back_inserter(constraint_states_), batch_size_,
                     [&]() { return constraint_->Start(); });
+    bitmaps_.resize(batch_size_);
   };
-  virtual ~ConstrainedDecoder() = default;
+  // Waits for the pending update of the constraint states, if any.
+  virtual ~ConstrainedDecoder();
 
   // Updates the internal constraint state for each sequence in the batch based
   // on the newly selected tokens. If a sequence reaches an end state
@@ -76,6 +100,12 @@ class ConstrainedDecoder {
   // Same as above, but takes a span of token ids instead of a tensor buffer.
   absl::Status UpdateConstraintState(absl::Span<int> next_token_ids);
 
+  // Same as above, but updates the constraint states and computes their bitmaps
+  // on the thread pool, so that it overlaps with the computation of the logits
+  // they mask. The next call to any other method waits for it to finish, and
+  // the errors of the update are returned by that call.
+  absl::Status StartUpdateConstraintState(absl::Span<const int> next_token_ids);
+
   // Masks the input logits tensor based on the current constraint state of
   // each sequence in the batch.
   // For each sequence, tokens disallowed by the constraint in the current state
@@ -93,11 +123,30 @@ class ConstrainedDecoder {
                           absl::Span<const ::litert::Layout::Dim> logits_dims);
 
  private:
+  // Updates the constraint states, and computes their bitmaps if
+  // `compute_bitmaps` is true.
+  absl::Status UpdateConstraintStateInternal(
+      absl::Span<const int> next_token_ids, bool compute_bitmaps);
+
+  // Waits for the pending update started by StartUpdateConstraintState(), if
+  // any, and returns its status.
+  absl::Status WaitForPendingUpdate();
+
   // The constraint to be applied.
   Constraint* constraint_;
   const int batch_size_;
+  ThreadPool* absl_nullable const thread_pool_;
   // The current constraint states.
   std::vector<std::unique_ptr<Constraint::State>> constraint_states_;
+  // The bitmaps of the current constraint states computed ahead of
+  // MaskLogits(), or null if they are not computed yet.
+  std::vector<std::unique_ptr<Bitmap>> bitmaps_;
+
+  // The pending update started by StartUpdateConstraintState(), notified when
+  // it is done, and its token ids and status.
+  std::unique_ptr<absl::Notification> pending_update_;
+  std::vector<int> pending_token_ids_;
+  absl::Status pending_status_;
 };
 
 }  // namespace litert::lm
@@ -27,6 +27,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/status/status.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_environment.h"  // from @litert
 #include "litert/cc/litert_expected.h"  // from @litert
 #include "litert/cc/litert_layout.h"  // from @litert
@@ -35,6 +36,7 @@
 #include "litert/test/matchers.h"  // from @litert
 #include "runtime/components/constrained_decoding/constraint_provider.h"
 #include "runtime/components/constrained_decoding/fst_constraint_provider.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "sentencepiece_processor.h"  // from @sentencepiece
 
@@ -221,6 +223,36 @@ TEST_F(ConstrainedDecoderTest, UpdateStateAndMaskLogitsBatchSize2) {
   }
 }
 
+TEST_F(ConstrainedDecoderTest, StartUpdateStateOnThreadPool) {
+  ASSERT_OK_AND_ASSIGN(auto constraint, provider_->CreateConstraint("ab"));
+  ThreadPool thread_pool(/*name_prefix=*/"constraint", /*max_num_threads=*/1);
+  ConstrainedDecoder constrained_decoder(constraint.get(), /*batch_size=*/1,
+                                         &thread_pool);
+
+  // Start updating the state with "a", and mask the logits once it is done.
+  std::vector<int> token_ids = {spm_processor_.PieceToId("a")};
+  ASSERT_OK(constrained_decoder.StartUpdateConstraintState(token_ids));
+  token_ids[0] = -1;  // The update must not read the ids after returning.
+  const std::vector<::litert::Layout::Dim> dims = {1, 1, vocab_size_};
+  std::vector<float> logits(vocab_size_, 2.0f);
+  ASSERT_OK(constrained_decoder.MaskLogits(absl::MakeSpan(logits), dims));
+
+  // Verify that only the "b" token is allowed.
+  for (int i = 0; i < vocab_size_; ++i) {
+    if (i == spm_processor_.PieceToId("b")) {
+      EXPECT_EQ(logits[i], 2.0f);
+    } else {
+      EXPECT_EQ(logits[i], std::numeric_limits<float>::lowest());
+    }
+  }
+
+  // The error of an update is returned by the next call.
+  token_ids[0] = spm_processor_.PieceToId("c");
+  ASSERT_OK(constrained_decoder.StartUpdateConstraintState(token_ids));
+  EXPECT_FALSE(
+      constrained_decoder.MaskLogits(absl::MakeSpan(logits), dims).ok());
+}
+
 TEST_F(ConstrainedDecoderTest, UpdateStateFailsWithWrongBatchSize) {
   ASSERT_OK_AND_ASSIGN(auto constraint, provider_->CreateConstraint("ab"));
   ConstrainedDecoder constrained_decoder(constraint.get(), /*batch_size=*/2);
@@ -54,6 +54,14 @@ class Constraint {
   // Computes the allowed tokens bitmap given the current state.
   virtual absl::StatusOr<std::unique_ptr<Bitmap>> ComputeBitmap(
       const State& state) const = 0;
+
+  // Returns the allowed tokens bitmap of the given state if the constraint
+  // computed it ahead of time, or null otherwise. The bitmap is owned by the
+  // constraint. Lets the callers skip ComputeBitmap() which allocates a bitmap
+  // on every call.
+  virtual const PackedBitmap* GetPackedBitmap(const State& state) const {
+    return nullptr;
+  }
 };
 
 }  // namespace litert::lm
@@ -0,0 +1,237 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/components/constrained_decoding/token_dfa_constraint.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"  // from @com_google_absl
+#include "absl/container/flat_hash_set.h"  // from @com_google_absl
+#include "absl/hash/hash.h"  // from @com_google_absl
+#include "absl/memory/memory.h"  // from @com_google_absl
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/str_cat.h"  // from @com_google_absl
+#include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+#include "runtime/components/constrained_decoding/bitmap.h"
+#include "runtime/components/constrained_decoding/constraint.h"
+#include "runtime/components/streaming_detokenizer.h"
+
+namespace litert::lm {
+namespace {
+
+// Placeholder of the end state index until all the states are compiled.
+constexpr int kEndState = -1;
+
+absl::Status ValidateDfa(const ByteDfa& dfa) {
+  if (dfa.transitions.size() != static_cast<size_t>(dfa.num_states()) * 256) {
+    return absl::InvalidArgumentError(
+        "The DFA must have 256 transitions per state.");
+  }
+  if (dfa.start_state < 0 || dfa.start_state >= dfa.num_states()) {
+    return absl::InvalidArgumentError("The DFA start state is out of range.");
+  }
+  for (int next_state : dfa.transitions) {
+    if (next_state < ByteDfa::kDeadState || next_state >= dfa.num_states()) {
+      return absl::InvalidArgumentError(
+          "The DFA transitions are out of range.");
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<TokenDfaConstraint>> TokenDfaConstraint::Create(
+    const ByteDfa& dfa, const TokenBytesTable& token_bytes,
+    const std::vector<int>& stop_token_ids, int vocabulary_size,
+    size_t max_num_bytes) {
+  if (absl::Status status = ValidateDfa(dfa); !status.ok()) {
+    return status;
+  }
+  for (int stop_token_id : stop_token_ids) {
+    if (stop_token_id < 0 || stop_token_id >= vocabulary_size) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Stop token id ", stop_token_id, " is out of the vocabulary."));
+    }
+  }
+  const absl::flat_hash_set<int> stop_tokens(stop_token_ids.begin(),
+                                             stop_token_ids.end());
+
+  // Sort the tokens by their bytes, so that the walk of a token through the DFA
+  // can resume from the prefix it shares with the previous token.
+  std::vector<int> tokens;
+  for (int token = 0; token < std::min(token_bytes.size(), vocabulary_size);
+       ++token) {
+    if (token_bytes.IsDecodable(token) && !token_bytes.Get(token).empty() &&
+        !stop_tokens.contains(token)) {
+      tokens.push_back(token);
+    }
+  }
+  std::sort(tokens.begin(), tokens.end(), [&token_bytes](int a, int b) {
+    return token_bytes.Get(a) < token_bytes.Get(b);
+  });
+  std::vector<size_t> common_prefix_lengths(tokens.size(), 0);
+  for (size_t i = 1; i < tokens.size(); ++i) {
+    const absl::string_view previous = token_bytes.Get(tokens[i - 1]);
+    const absl::string_view current = token_bytes.Get(tokens[i]);
+    const size_t length = std::min(previous.size(), current.size());
+    size_t common = 0;
+    while (common < length && previous[common] == current[common]) {
+      ++common;
+    }
+    common_prefix_lengths[i] = common;
+  }
+
+  auto constraint = absl::WrapUnique(new TokenDfaConstraint(vocabulary_size));
+  // The indices of the bitmaps in `constraint->bitmaps_` by their hash.
+  absl::flat_hash_map<size_t, std::vector<int>> bitmaps_by_hash;
+  // Returns the index of the bitmap in `constraint->bitmaps_`, adding it if no
+  // equal one was added yet.
+  auto add_bitmap = [&constraint, &bitmaps_by_hash](PackedBitmap bitmap) {
+    const absl::Span<const uint64_t> words = bitmap.words();
+    std::vector<int>& indices =
+        bitmaps_by_hash[absl::Hash<absl::Span<const uint64_t>>()(words)];
+    for (int index : indices) {
+      if (constraint->bitmaps_[index].words() == words) {
+        return index;
+      }
+    }
+    indices.push_back(constraint->bitmaps_.size());
+    constraint->bitmaps_.push_back(std::move(bitmap));
+    return indices.back();
+  };
+  const size_t num_bitmap_bytes = PackedBitmap(vocabulary_size).words().size() *
+                                  sizeof(uint64_t);
+  size_t num_bytes = num_bitmap_bytes;  // The bitmap of the end state.
+
+  // The DFA states in the order of their compiled states, and the reverse.
+  std::vector<int> dfa_states = {dfa.start_state};
+  absl::flat_hash_map<int, int> compiled_states = {{dfa.start_state, 0}};
+  // The DFA states after each prefix of the current token.
+  std::vector<int> path;
+  for (size_t index = 0; index < dfa_states.size(); ++index) {
+    CompiledState compiled;
+    PackedBitmap allowed_tokens(vocabulary_size);
+    path.assign(1, dfa_states[index]);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      const absl::string_view bytes = token_bytes.Get(tokens[i]);
+      // If the walk of the previous token died within the common prefix, the
+      // walk of this one dies again at the same byte.
+      size_t depth = std::min(common_prefix_lengths[i], path.size() - 1);
+      path.resize(depth + 1);
+      int state = path.back();
+      while (depth < bytes.size()) {
+        const uint8_t byte = bytes[depth];
+        state = dfa.transitions[state * 256 + byte];
+        if (state == ByteDfa::kDeadState) {
+          break;
+        }
+        path.push_back(state);
+        ++depth;
+      }
+      if (state == ByteDfa::kDeadState) {
+        continue;
+      }
+      auto [it, inserted] =
+          compiled_states.try_emplace(state, dfa_states.size());
+      if (inserted) {
+        dfa_states.push_back(state);
+      }
+      allowed_tokens.Set(tokens[i], true);
+      compiled.transitions.emplace_back(tokens[i], it->second);
+    }
+    if (dfa.accepting[dfa_states[index]]) {
+      for (int stop_token : stop_tokens) {
+        allowed_tokens.Set(stop_token, true);
+        compiled.transitions.emplace_back(stop_token, kEndState);
+      }
+    }
+    std::sort(compiled.transitions.begin(), compiled.transitions.end());
+    compiled.transitions.shrink_to_fit();
+    const int num_bitmaps = constraint->bitmaps_.size();
+    compiled.bitmap = add_bitmap(std::move(allowed_tokens));
+    if (compiled.bitmap == num_bitmaps) {
+      num_bytes += num_bitmap_bytes;
+    }
+    num_bytes += sizeof(CompiledState) +
+                 compiled.transitions.size() * sizeof(std::pair<int, int>);
+    if (num_bytes > max_num_bytes) {
+      return absl::ResourceExhaustedError(absl::StrCat(
+          "The compiled constraint exceeds ", max_num_bytes, " bytes after ",
+          index + 1, " of at least ", dfa_states.size(), " states."));
+    }
+    constraint->states_.push_back(std::move(compiled));
+  }
+
+  const int end_state = constraint->states_.size();
+  for (CompiledState& compiled : constraint->states_) {
+    for (auto& [unused_token, next_state] : compiled.transitions) {
+      if (next_state == kEndState) {
+        next_state = end_state;
+      }
+    }
+  }
+  CompiledState end;
+  end.bitmap = add_bitmap(PackedBitmap(vocabulary_size));
+  constraint->states_.push_back(std::move(end));
+  return constraint;
+}
+
+std::unique_ptr<Constraint::State> TokenDfaConstraint::Start() const {
+  return std::make_unique<TokenDfaState>(0);
+}
+
+bool TokenDfaConstraint::IsEnded(const State& state) const {
+  const auto& dfa_state = static_cast<const TokenDfaState&>(state);
+  return dfa_state.index() == states_.size() - 1;
+}
+
+absl::StatusOr<std::unique_ptr<Constraint::State>>
+TokenDfaConstraint::ComputeNext(const State& state, int token) const {
+  const auto& dfa_state = static_cast<const TokenDfaState&>(state);
+  if (dfa_state.index() < 0 || dfa_state.index() >= states_.size()) {
+    return absl::InvalidArgumentError("Invalid state");
+  }
+  const auto& transitions = states_[dfa_state.index()].transitions;
+  auto it = std::lower_bound(
+      transitions.begin(), transitions.end(), token,
+      [](const std::pair<int, int>& transition, int token) {
+        return transition.first < token;
+      });
+  if (it == transitions.end() || it->first != token) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Token ", token, " is not allowed in the state."));
+  }
+  return std::make_unique<TokenDfaState>(it->second);
+}
+
+absl::StatusOr<std::unique_ptr<Bitmap>> TokenDfaConstraint::ComputeBitmap(
+    const State& state) const {
+  return std::make_unique<PackedBitmap>(*GetPackedBitmap(state));
+}
+
+const PackedBitmap* TokenDfaConstraint::GetPackedBitmap(
+    const State& state) const {
+  const auto& dfa_state = static_cast<const TokenDfaState&>(state);
+  return &bitmaps_[states_[dfa_state.index()].bitmap];
+}
+
+}  // namespace litert::lm
@@ -0,0 +1,127 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_CONSTRAINED_DECODING_TOKEN_DFA_CONSTRAINT_H_
+#define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_CONSTRAINED_DECODING_TOKEN_DFA_CONSTRAINT_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"  // from @com_google_absl
+#include "runtime/components/constrained_decoding/bitmap.h"
+#include "runtime/components/constrained_decoding/constraint.h"
+#include "runtime/components/streaming_detokenizer.h"
+
+namespace litert::lm {
+
+// A deterministic finite automaton over bytes, e.g. compiled from a regular
+// expression or a JSON schema.
+struct ByteDfa {
+  // The transition to no state, i.e. the byte is not allowed.
+  static constexpr int kDeadState = -1;
+
+  // The next state of each state and byte, indexed by `state * 256 + byte`.
+  std::vector<int> transitions;
+  // Whether each state accepts the bytes read so far.
+  std::vector<bool> accepting;
+  int start_state = 0;
+
+  int num_states() const { return accepting.size(); }
+};
+
+// Constrains the model to produce a text accepted by a byte DFA.
+//
+// The DFA is compiled ahead of time into an automaton over token ids: the
+// tokens allowed in each reachable DFA state are the ones whose bytes lead to a
+// live state, and their bitmap is precomputed, so that decoding a token only
+// takes a transition lookup and masking the logits reads a cached bitmap. Only
+// the transitions of the allowed tokens are stored, and the states allowing the
+// same tokens share their bitmap, so the memory used is about
+// `vocabulary_size / 8` bytes per distinct set of allowed tokens plus 8 bytes
+// per allowed token of each reachable state.
+class TokenDfaConstraint : public Constraint {
+ public:
+  // The default limit of the memory used by the compiled states.
+  static constexpr size_t kDefaultMaxNumBytes = size_t{256} << 20;
+
+  // Represents an index into the compiled states.
+  class TokenDfaState : public Constraint::State {
+   public:
+    explicit TokenDfaState(int index) : index_(index) {}
+    int index() const { return index_; }
+
+   private:
+    const int index_;
+  };
+
+  // Compiles the constraint.
+  //
+  // @param dfa The byte DFA the decoded text must be accepted by.
+  // @param token_bytes The bytes each token id decodes to. The tokens which
+  // are not decodable on their own or decode to no bytes are never allowed,
+  // except for the stop tokens.
+  // @param stop_token_ids The tokens allowed in the accepting states, which end
+  // the constraint.
+  // @param vocabulary_size The vocabulary size of the model, which may be
+  // larger than the token bytes table.
+  // @param max_num_bytes The limit of the memory used by the compiled states.
+  // Returns ResourceExhaustedError if the compiled states would exceed it.
+  static absl::StatusOr<std::unique_ptr<TokenDfaConstraint>> Create(
+      const ByteDfa& dfa, const TokenBytesTable& token_bytes,
+      const std::vector<int>& stop_token_ids, int vocabulary_size,
+      size_t max_num_bytes = kDefaultMaxNumBytes);
+
+  std::unique_ptr<State> Start() const override;
+  bool IsEnded(const State& state) const override;
+
+  int GetVocabularySize() const override { return vocabulary_size_; }
+
+  absl::StatusOr<std::unique_ptr<State>> ComputeNext(const State& state,
+                                                     int token) const override;
+
+  absl::StatusOr<std::unique_ptr<Bitmap>> ComputeBitmap(
+      const State& state) const override;
+
+  const PackedBitmap* GetPackedBitmap(const State& state) const override;
+
+  // Returns the number of compiled states, including the end state.
+  int num_states() const { return states_.size(); }
+
+  // Returns the number of distinct bitmaps of the compiled states.
+  int num_bitmaps() const { return bitmaps_.size(); }
+
+ private:
+  struct CompiledState {
+    // The index of the bitmap of the allowed tokens in `bitmaps_`.
+    int bitmap = 0;
+    // The allowed tokens and their next states, sorted by token id.
+    std::vector<std::pair<int, int>> transitions;
+  };
+
+  explicit TokenDfaConstraint(int vocabulary_size)
+      : vocabulary_size_(vocabulary_size) {}
+
+  const int vocabulary_size_;
+  // The compiled states. The first one is the start state and the last one is
+  // the end state, which allows no tokens.
+  std::vector<CompiledState> states_;
+  // The distinct bitmaps of the allowed tokens of the compiled states.
+  std::vector<PackedBitmap> bitmaps_;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_CONSTRAINED_DECODING_TOKEN_DFA_CONSTRAINT_H_
@@ -0,0 +1,190 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/components/constrained_decoding/token_dfa_constraint.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"  // from @com_google_absl
+#include "runtime/components/constrained_decoding/bitmap.h"
+#include "runtime/components/constrained_decoding/constraint.h"
+#include "runtime/components/streaming_detokenizer.h"
+#include "runtime/util/test_utils.h"  // IWYU pragma: keep
+
+namespace litert::lm {
+namespace {
+
+using ::testing::status::StatusIs;
+
+constexpr int kEosToken = 0;
+constexpr int kVocabularySize = 8;
+
+// Returns a DFA accepting "ab+".
+ByteDfa MakeAbPlusDfa() {
+  ByteDfa dfa;
+  dfa.transitions.assign(3 * 256, ByteDfa::kDeadState);
+  dfa.transitions[0 * 256 + 'a'] = 1;
+  dfa.transitions[1 * 256 + 'b'] = 2;
+  dfa.transitions[2 * 256 + 'b'] = 2;
+  dfa.accepting = {false, false, true};
+  return dfa;
+}
+
+// Returns the tokens <eos>, "a", "ab", "b", "bb", "c" and "abc". The token 7 is
+// only in the vocabulary of the model.
+TokenBytesTable MakeTokenBytes() {
+  TokenBytesTable table;
+  table.AddUndecodable();
+  for (const char* bytes : {"a", "ab", "b", "bb", "c", "abc"}) {
+    table.Add(bytes);
+  }
+  return table;
+}
+
+std::vector<int> AllowedTokens(const TokenDfaConstraint& constraint,
+                               const Constraint::State& state) {
+  std::vector<int> tokens;
+  const PackedBitmap* bitmap = constraint.GetPackedBitmap(state);
+  for (int token = 0; token < bitmap->size(); ++token) {
+    if (bitmap->Get(token)) {
+      tokens.push_back(token);
+    }
+  }
+  return tokens;
+}
+
+TEST(TokenDfaConstraintTest, CompilesAllowedTokensOfEachState) {
+  ASSERT_OK_AND_ASSIGN(
+      auto constraint,
+      TokenDfaConstraint::Create(MakeAbPlusDfa(), MakeTokenBytes(),
+                                 {kEosToken}, kVocabularySize));
+  EXPECT_EQ(constraint->GetVocabularySize(), kVocabularySize);
+  // The start state, after "a", after "ab" and the end state.
+  EXPECT_EQ(constraint->num_states(), 4);
+
+  auto state = constraint->Start();
+  EXPECT_FALSE(constraint->IsEnded(*state));
+  EXPECT_THAT(AllowedTokens(*constraint, *state),
+              ::testing::ElementsAre(1, 2));
+
+  ASSERT_OK_AND_ASSIGN(state, constraint->ComputeNext(*state, 1));
+  EXPECT_THAT(AllowedTokens(*constraint, *state),
+              ::testing::ElementsAre(3, 4));
+
+  ASSERT_OK_AND_ASSIGN(state, constraint->ComputeNext(*state, 4));
+  EXPECT_THAT(AllowedTokens(*constraint, *state),
+              ::testing::ElementsAre(kEosToken, 3, 4));
+
+  ASSERT_OK_AND_ASSIGN(state, constraint->ComputeNext(*state, kEosToken));
+  EXPECT_TRUE(constraint->IsEnded(*state));
+  EXPECT_THAT(AllowedTokens(*constraint, *state), ::testing::IsEmpty());
+}
+
+TEST(TokenDfaConstraintTest, ComputeBitmapMatchesPackedBitmap) {
+  ASSERT_OK_AND_ASSIGN(
+      auto constraint,
+      TokenDfaConstraint::Create(MakeAbPlusDfa(), MakeTokenBytes(),
+                                 {kEosToken}, kVocabularySize));
+  auto state = constraint->Start();
+  ASSERT_OK_AND_ASSIGN(auto bitmap, constraint->ComputeBitmap(*state));
+  for (int token = 0; token < kVocabularySize; ++token) {
+    EXPECT_EQ(bitmap->Get(token),
+              constraint->GetPackedBitmap(*state)->Get(token));
+  }
+}
+
+TEST(TokenDfaConstraintTest, ComputeNextFailsForDisallowedToken) {
+  ASSERT_OK_AND_ASSIGN(
+      auto constraint,
+      TokenDfaConstraint::Create(MakeAbPlusDfa(), MakeTokenBytes(),
+                                 {kEosToken}, kVocabularySize));
+  auto state = constraint->Start();
+  EXPECT_THAT(constraint->ComputeNext(*state, 6),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(constraint->ComputeNext(*state, kEosToken),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(constraint->ComputeNext(*state, 7),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(TokenDfaConstraintTest, CreateFailsForInvalidDfa) {
+  ByteDfa dfa = MakeAbPlusDfa();
+  dfa.transitions.pop_back();
+  EXPECT_THAT(TokenDfaConstraint::Create(dfa, MakeTokenBytes(), {kEosToken},
+                                         kVocabularySize),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  dfa = MakeAbPlusDfa();
+  dfa.transitions[0] = 3;
+  EXPECT_THAT(TokenDfaConstraint::Create(dfa, MakeTokenBytes(), {kEosToken},
+                                         kVocabularySize),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  EXPECT_THAT(TokenDfaConstraint::Create(MakeAbPlusDfa(), MakeTokenBytes(),
+                                         {kVocabularySize}, kVocabularySize),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(TokenDfaConstraintTest, StatesAllowingTheSameTokensShareBitmap) {
+  // A DFA accepting "[ab]b", whose states after "a" and after "b" both only
+  // allow "b".
+  ByteDfa dfa;
+  dfa.transitions.assign(4 * 256, ByteDfa::kDeadState);
+  dfa.transitions[0 * 256 + 'a'] = 1;
+  dfa.transitions[0 * 256 + 'b'] = 2;
+  dfa.transitions[1 * 256 + 'b'] = 3;
+  dfa.transitions[2 * 256 + 'b'] = 3;
+  dfa.accepting = {false, false, false, true};
+  ASSERT_OK_AND_ASSIGN(
+      auto constraint,
+      TokenDfaConstraint::Create(dfa, MakeTokenBytes(), {kEosToken},
+                                 kVocabularySize));
+  EXPECT_EQ(constraint->num_states(), 5);
+  EXPECT_EQ(constraint->num_bitmaps(), 4);
+
+  auto state = constraint->Start();
+  ASSERT_OK_AND_ASSIGN(auto after_a, constraint->ComputeNext(*state, 1));
+  ASSERT_OK_AND_ASSIGN(auto after_b, constraint->ComputeNext(*state, 3));
+  EXPECT_EQ(constraint->GetPackedBitmap(*after_a),
+            constraint->GetPackedBitmap(*after_b));
+  EXPECT_THAT(AllowedTokens(*constraint, *after_a), ::testing::ElementsAre(3));
+}
+
+TEST(TokenDfaConstraintTest, CreateFailsIfStatesExceedMemoryLimit) {
+  EXPECT_THAT(TokenDfaConstraint::Create(MakeAbPlusDfa(), MakeTokenBytes(),
+                                         {kEosToken}, kVocabularySize,
+                                         /*max_num_bytes=*/64),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
+TEST(PackedBitmapTest, SetAndGet) {
+  PackedBitmap bitmap(70, /*allowed=*/true);
+  EXPECT_EQ(bitmap.size(), 70);
+  EXPECT_EQ(bitmap.words().size(), 2);
+  EXPECT_TRUE(bitmap.Get(69));
+  bitmap.Set(69, false);
+  bitmap.Set(3, false);
+  EXPECT_FALSE(bitmap.Get(69));
+  EXPECT_FALSE(bitmap.Get(3));
+  EXPECT_TRUE(bitmap.Get(4));
+  // The bits past the size are cleared.
+  EXPECT_EQ(bitmap.words()[1], (uint64_t{1} << 5) - 1);
+}
+
+}  // namespace
+}  // namespace litert::lm
@@ -0,0 +1,130 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/components/embedding_lookup/embedding_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+EmbeddingCache::EmbeddingCache(size_t bytes_per_row,
+                               const EmbeddingCacheOptions& options)
+    : bytes_per_row_(bytes_per_row) {
+  const size_t max_rows = options.max_bytes / bytes_per_row_;
+  is_direct_table_ = options.vocab_size > 0 &&
+                     static_cast<size_t>(options.vocab_size) <= max_rows;
+  capacity_ = is_direct_table_ ? options.vocab_size : max_rows;
+  rows_.resize(static_cast<size_t>(capacity_) * bytes_per_row_);
+  if (is_direct_table_) {
+    present_.assign(capacity_, false);
+  } else {
+    slots_.reserve(capacity_);
+    slot_tokens_.reserve(capacity_);
+    prev_.reserve(capacity_);
+    next_.reserve(capacity_);
+  }
+}
+
+absl::Span<const uint8_t> EmbeddingCache::Lookup(int token) {
+  if (is_direct_table_) {
+    if (token < 0 || token >= capacity_ || !present_[token]) {
+      ++stats_.misses;
+      return {};
+    }
+    ++stats_.hits;
+    return absl::MakeConstSpan(Row(token), bytes_per_row_);
+  }
+
+  auto it = slots_.find(token);
+  if (it == slots_.end()) {
+    ++stats_.misses;
+    return {};
+  }
+  ++stats_.hits;
+  const int slot = it->second;
+  if (slot != head_) {
+    Unlink(slot);
+    PushFront(slot);
+  }
+  return absl::MakeConstSpan(Row(slot), bytes_per_row_);
+}
+
+void EmbeddingCache::Insert(int token, absl::Span<const uint8_t> row) {
+  if (is_direct_table_) {
+    if (token < 0 || token >= capacity_) {
+      return;
+    }
+    memcpy(Row(token), row.data(), bytes_per_row_);
+    present_[token] = true;
+    return;
+  }
+  if (capacity_ == 0) {
+    return;
+  }
+
+  int slot;
+  auto it = slots_.find(token);
+  if (it != slots_.end()) {
+    slot = it->second;
+    Unlink(slot);
+  } else if (slot_tokens_.size() < capacity_) {
+    slot = slot_tokens_.size();
+    slot_tokens_.push_back(token);
+    prev_.push_back(-1);
+    next_.push_back(-1);
+    slots_[token] = slot;
+  } else {
+    // Reuses the slot of the least recently used row.
+    slot = tail_;
+    Unlink(slot);
+    slots_.erase(slot_tokens_[slot]);
+    slot_tokens_[slot] = token;
+    slots_[token] = slot;
+  }
+  memcpy(Row(slot), row.data(), bytes_per_row_);
+  PushFront(slot);
+}
+
+void EmbeddingCache::Unlink(int slot) {
+  if (prev_[slot] != -1) {
+    next_[prev_[slot]] = next_[slot];
+  } else {
+    head_ = next_[slot];
+  }
+  if (next_[slot] != -1) {
+    prev_[next_[slot]] = prev_[slot];
+  } else {
+    tail_ = prev_[slot];
+  }
+  prev_[slot] = -1;
+  next_[slot] = -1;
+}
+
+void EmbeddingCache::PushFront(int slot) {
+  prev_[slot] = -1;
+  next_[slot] = head_;
+  if (head_ != -1) {
+    prev_[head_] = slot;
+  }
+  head_ = slot;
+  if (tail_ == -1) {
+    tail_ = slot;
+  }
+}
+
+}  // namespace litert::lm
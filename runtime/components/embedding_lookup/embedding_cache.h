@@ -0,0 +1,106 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_EMBEDDING_LOOKUP_EMBEDDING_CACHE_H_
+#define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_EMBEDDING_LOOKUP_EMBEDDING_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+// Options of the embedding cache of an embedding model.
+struct EmbeddingCacheOptions {
+  // The byte budget of the cached embedding rows. If 0, the cache is disabled.
+  size_t max_bytes = 0;
+  // The number of token ids of the embedding model, if known. If the rows of
+  // all the token ids fit in the budget, the whole table is materialized.
+  int vocab_size = 0;
+};
+
+// A cache of the embedding rows of token ids, bounded by a byte budget.
+//
+// If the rows of the whole vocabulary fit in the budget, the cache is a direct
+// table indexed by token id which never evicts, and is meant to be filled
+// upfront. Otherwise, it keeps the most recently used rows.
+//
+// This class is not thread-safe.
+class EmbeddingCache {
+ public:
+  // Cumulative lookup statistics.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  // Creates a cache of rows of `bytes_per_row` bytes. `bytes_per_row` must be
+  // positive and at most `options.max_bytes`.
+  EmbeddingCache(size_t bytes_per_row, const EmbeddingCacheOptions& options);
+
+  EmbeddingCache(const EmbeddingCache&) = delete;
+  EmbeddingCache& operator=(const EmbeddingCache&) = delete;
+
+  // Returns the cached row of `token`, or an empty span if it is not cached.
+  // Marks the row as recently used. The span is valid until the next call to
+  // Insert().
+  absl::Span<const uint8_t> Lookup(int token);
+
+  // Caches the row of `token`, evicting the least recently used row if the
+  // cache is full. `row` must have `bytes_per_row` bytes.
+  void Insert(int token, absl::Span<const uint8_t> row);
+
+  // Returns true if the cache is a direct table of the whole vocabulary.
+  bool is_direct_table() const { return is_direct_table_; }
+  // Returns the maximum number of cached rows.
+  int capacity() const { return capacity_; }
+  size_t bytes_per_row() const { return bytes_per_row_; }
+  // Returns the number of bytes allocated for the rows.
+  size_t num_bytes() const { return rows_.size(); }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  uint8_t* Row(int slot) { return rows_.data() + slot * bytes_per_row_; }
+
+  // Removes `slot` from the LRU list, and adds it back as the most recently
+  // used. Not used by direct tables.
+  void Unlink(int slot);
+  void PushFront(int slot);
+
+  const size_t bytes_per_row_;
+  bool is_direct_table_ = false;
+  int capacity_ = 0;
+  // The rows, indexed by token id for direct tables or by slot otherwise.
+  std::vector<uint8_t> rows_;
+  Stats stats_;
+
+  // Direct table state: whether the row of each token id is present.
+  std::vector<bool> present_;
+
+  // LRU state: the slot of each cached token, the token of each used slot, and
+  // the doubly linked list of the used slots, the most recently used first.
+  absl::flat_hash_map<int, int> slots_;
+  std::vector<int> slot_tokens_;
+  std::vector<int> prev_;
+  std::vector<int> next_;
+  int head_ = -1;
+  int tail_ = -1;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_EMBEDDING_LOOKUP_EMBEDDING_CACHE_H_
@@ -0,0 +1,98 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/components/embedding_lookup/embedding_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+constexpr size_t kBytesPerRow = 4;
+
+EmbeddingCacheOptions Options(size_t max_bytes, int vocab_size) {
+  EmbeddingCacheOptions options;
+  options.max_bytes = max_bytes;
+  options.vocab_size = vocab_size;
+  return options;
+}
+
+// Returns a row whose bytes are all `token`.
+std::vector<uint8_t> RowOf(int token) {
+  return std::vector<uint8_t>(kBytesPerRow, static_cast<uint8_t>(token));
+}
+
+TEST(EmbeddingCacheTest, DirectTableWhenVocabFits) {
+  EmbeddingCache cache(kBytesPerRow, Options(4 * kBytesPerRow, 4));
+  EXPECT_TRUE(cache.is_direct_table());
+  EXPECT_EQ(cache.capacity(), 4);
+
+  for (int token = 0; token < 4; ++token) {
+    cache.Insert(token, RowOf(token));
+  }
+  for (int token = 0; token < 4; ++token) {
+    EXPECT_THAT(cache.Lookup(token), ElementsAre(token, token, token, token));
+  }
+  // Out of the vocabulary.
+  cache.Insert(4, RowOf(4));
+  EXPECT_THAT(cache.Lookup(4), IsEmpty());
+  EXPECT_THAT(cache.Lookup(-1), IsEmpty());
+  EXPECT_EQ(cache.stats().hits, 4);
+  EXPECT_EQ(cache.stats().misses, 2);
+}
+
+TEST(EmbeddingCacheTest, LruWhenVocabDoesNotFit) {
+  EmbeddingCache cache(kBytesPerRow, Options(2 * kBytesPerRow, 4));
+  EXPECT_FALSE(cache.is_direct_table());
+  EXPECT_EQ(cache.capacity(), 2);
+
+  cache.Insert(1, RowOf(1));
+  cache.Insert(2, RowOf(2));
+  // Token 1 becomes the most recently used, so token 2 is evicted next.
+  EXPECT_THAT(cache.Lookup(1), ElementsAre(1, 1, 1, 1));
+  cache.Insert(3, RowOf(3));
+  EXPECT_THAT(cache.Lookup(2), IsEmpty());
+  EXPECT_THAT(cache.Lookup(1), ElementsAre(1, 1, 1, 1));
+  EXPECT_THAT(cache.Lookup(3), ElementsAre(3, 3, 3, 3));
+
+  // Re-inserting a cached token updates its row in place.
+  cache.Insert(1, RowOf(5));
+  EXPECT_THAT(cache.Lookup(1), ElementsAre(5, 5, 5, 5));
+  EXPECT_THAT(cache.Lookup(3), ElementsAre(3, 3, 3, 3));
+}
+
+TEST(EmbeddingCacheTest, LruWithUnknownVocab) {
+  EmbeddingCache cache(kBytesPerRow,
+                       Options(kBytesPerRow, /*vocab_size=*/0));
+  EXPECT_FALSE(cache.is_direct_table());
+  EXPECT_EQ(cache.capacity(), 1);
+
+  cache.Insert(7, RowOf(7));
+  EXPECT_THAT(cache.Lookup(7), ElementsAre(7, 7, 7, 7));
+  cache.Insert(8, RowOf(8));
+  EXPECT_THAT(cache.Lookup(7), IsEmpty());
+  EXPECT_THAT(cache.Lookup(8), ElementsAre(8, 8, 8, 8));
+}
+
+}  // namespace
+}  // namespace litert::lm
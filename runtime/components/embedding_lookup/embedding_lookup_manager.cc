@@ -31,6 +31,7 @@
 #include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/embedding_lookup/embedding_cache.h"
 #include "runtime/components/embedding_lookup/embedding_lookup_end_of_multi_modal.h"
 #include "runtime/components/embedding_lookup/embedding_lookup_multi_modal.h"
 #include "runtime/components/embedding_lookup/embedding_lookup_text.h"
@@ -44,22 +45,24 @@ EmbeddingLookupManager::Create(
     const litert::Model* absl_nonnull text_embedding_model,
     absl::flat_hash_map<int, const litert::Model*>&
         end_of_multi_modal_embedding_models,
-    bool fully_supports_multi_modal, std::optional<std::string> signature_key) {
+    bool fully_supports_multi_modal, std::optional<std::string> signature_key,
+    const EmbeddingCacheOptions& cache_options) {
   auto embedding_lookup_manager = std::make_unique<EmbeddingLookupManager>();
   RETURN_IF_ERROR(embedding_lookup_manager->Initialize(
       text_embedding_model, end_of_multi_modal_embedding_models,
-      fully_supports_multi_modal, signature_key));
+      fully_supports_multi_modal, signature_key, cache_options));
   return std::move(embedding_lookup_manager);
 }
 
 absl::StatusOr<std::unique_ptr<EmbeddingLookupManager>>
 EmbeddingLookupManager::Create(
     const litert::Model* absl_nonnull text_embedding_model,
-    bool fully_supports_multi_modal, std::optional<std::string> signature_key) {
+    bool fully_supports_multi_modal, std::optional<std::string> signature_key,
+    const EmbeddingCacheOptions& cache_options) {
   absl::flat_hash_map<int, const litert::Model*>
       end_of_multi_modal_embedding_models;
   return Create(text_embedding_model, end_of_multi_modal_embedding_models,
-                fully_supports_multi_modal, signature_key);
+                fully_supports_multi_modal, signature_key, cache_options);
 }
 
 absl::Status EmbeddingLookupManager::UpdateMultiModalEmbeddings(
@@ -224,7 +227,8 @@ absl::Status EmbeddingLookupManager::Initialize(
     const litert::Model* absl_nonnull text_embedding_model,
     absl::flat_hash_map<int, const litert::Model*>&
         end_of_multi_modal_embedding_models,
-    bool fully_supports_multi_modal, std::optional<std::string> signature_key) {
+    bool fully_supports_multi_modal, std::optional<std::string> signature_key,
+    const EmbeddingCacheOptions& cache_options) {
   if (!fully_supports_multi_modal &&
       !end_of_multi_modal_embedding_models.empty()) {
     return absl::InvalidArgumentError(
@@ -234,7 +238,7 @@ absl::Status EmbeddingLookupManager::Initialize(
   fully_supports_multi_modal_ = fully_supports_multi_modal;
   ASSIGN_OR_RETURN(text_embedding_lookup_,
                    EmbeddingLookupText::Create(std::move(text_embedding_model),
-                                               signature_key));
+                                               signature_key, cache_options));
   default_embedding_vector_ =
       text_embedding_lookup_->GetDefaultEmbeddingVector();
   for (const auto& [special_token, embedding_model] :
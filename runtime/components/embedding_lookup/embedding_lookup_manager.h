@@ -28,6 +28,7 @@
 #include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/embedding_lookup/embedding_cache.h"
 #include "runtime/components/embedding_lookup/embedding_lookup_end_of_multi_modal.h"
 #include "runtime/components/embedding_lookup/embedding_lookup_multi_modal.h"
 #include "runtime/components/embedding_lookup/embedding_lookup_text.h"
@@ -51,17 +52,22 @@ class EmbeddingLookupManager {
   //
   // If the provide text_embedding_model has more than one signature, the
   // signature_key must be provided.
+  //
+  // cache_options configures the cache of the text embeddings, which is
+  // disabled by default.
   static absl::StatusOr<std::unique_ptr<EmbeddingLookupManager>> Create(
       const litert::Model* absl_nonnull text_embedding_model,
       absl::flat_hash_map<int, const litert::Model*>&
           end_of_multi_modal_embedding_models,
       bool fully_supports_multi_modal = true,
-      std::optional<std::string> signature_key = std::nullopt);
+      std::optional<std::string> signature_key = std::nullopt,
+      const EmbeddingCacheOptions& cache_options = {});
 
   static absl::StatusOr<std::unique_ptr<EmbeddingLookupManager>> Create(
       const litert::Model* absl_nonnull text_embedding_model,
       bool fully_supports_multi_modal = true,
-      std::optional<std::string> signature_key = std::nullopt);
+      std::optional<std::string> signature_key = std::nullopt,
+      const EmbeddingCacheOptions& cache_options = {});
 
   // Updates the multimodal embeddings for the given ExecutorInputs.
   // Intended to be called at the beginning of the prefill pass.
@@ -115,7 +121,8 @@ class EmbeddingLookupManager {
       absl::flat_hash_map<int, const litert::Model*>&
           end_of_multi_modal_embedding_models,
       bool fully_supports_multi_modal,
-      std::optional<std::string> signature_key);
+      std::optional<std::string> signature_key,
+      const EmbeddingCacheOptions& cache_options);
 
   std::unique_ptr<EmbeddingLookupText> text_embedding_lookup_;
   std::vector<std::unique_ptr<EmbeddingLookupMultiModal>>
@@ -16,9 +16,12 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <memory>
+#include <numeric>
 #include <optional>
 #include <string>
 #include <utility>
@@ -45,6 +48,14 @@ namespace litert::lm {
 
 using ::litert::TensorBuffer;
 
+namespace {
+
+// The maximum number of tokens embedded by one run of the batched embedding
+// model. Longer lookups are split into runs of this many tokens.
+constexpr int kMaxTokensPerBatchedRun = 512;
+
+}  // namespace
+
 absl::Status EmbeddingLookupText::LookupInternal(int token,
                                                  absl::Span<uint8_t> buffer) {
   if (!compiled_model_.has_value() || input_buffers_.size() != 1 ||
@@ -58,10 +69,21 @@ absl::Status EmbeddingLookupText::LookupInternal(int token,
     return absl::OkStatus();
   }
 
+  const bool use_cache =
+      cache_ != nullptr && buffer.size() == cache_->bytes_per_row();
+  if (use_cache) {
+    absl::Span<const uint8_t> cached_row = cache_->Lookup(token);
+    if (!cached_row.empty()) {
+      memcpy(buffer.data(), cached_row.data(), buffer.size());
+      return absl::OkStatus();
+    }
+  }
+
   // The input tensor size was verified when the model was loaded.
   input_buffers_[0].Write(absl::MakeSpan(const_cast<const int*>(&token), 1));
 
-  compiled_model_->Run(signature_key_.value(), input_buffers_, output_buffers_);
+  LITERT_RETURN_IF_ERROR(compiled_model_->Run(signature_key_.value(),
+                                              input_buffers_, output_buffers_));
 
   LITERT_ASSIGN_OR_RETURN(auto output_buffer_size, output_buffers_[0].Size());
 
@@ -75,6 +97,123 @@ absl::Status EmbeddingLookupText::LookupInternal(int token,
   // Copy the output buffer to the requested buffer.
   output_buffers_[0].Read(buffer);
 
+  if (use_cache) {
+    cache_->Insert(token, buffer);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status EmbeddingLookupText::PrepareBatchedModel(int num_tokens) {
+  // Grow geometrically so that prefill chunks of varying lengths do not resize
+  // the model on every lookup.
+  int batched_num_tokens = std::max(batched_num_tokens_, 2);
+  while (batched_num_tokens < num_tokens) {
+    batched_num_tokens *= 2;
+  }
+  batched_num_tokens = std::min(batched_num_tokens, kMaxTokensPerBatchedRun);
+  if (batched_num_tokens == batched_num_tokens_) {
+    return absl::OkStatus();
+  }
+
+  if (!batched_compiled_model_.has_value()) {
+    LITERT_ASSIGN_OR_RETURN(auto options, Options::Create());
+    options.SetHardwareAccelerators(litert::HwAccelerators::kCpu);
+    LITERT_ASSIGN_OR_RETURN(
+        batched_compiled_model_,
+        litert::CompiledModel::Create(env_, model_, options));
+  }
+
+  // The input was verified to hold a single token, i.e. its dimensions are all
+  // 1. The token dimension is the 1st one, as for the output.
+  LITERT_ASSIGN_OR_RETURN(const SimpleSignature& signature,
+                          model_.FindSignature(signature_key_.value()));
+  auto input_names = signature.InputNames();
+  LITERT_ASSIGN_OR_RETURN(const SimpleTensor& input_tensor,
+                          signature.InputTensor(input_names[0]));
+  LITERT_ASSIGN_OR_RETURN(const RankedTensorType input_type,
+                          input_tensor.RankedTensorType());
+  auto input_dimensions = input_type.Layout().Dimensions();
+  if (input_dimensions.size() < 2) {
+    return absl::UnimplementedError(absl::StrCat(
+        "The input tensor of the Embedding model must have at least 2 "
+        "dimensions to embed several tokens per run but got ",
+        input_dimensions.size()));
+  }
+  std::vector<int> new_shape(input_dimensions.begin(), input_dimensions.end());
+  new_shape[1] = batched_num_tokens;
+  LITERT_RETURN_IF_ERROR(batched_compiled_model_->ResizeInputTensor(
+      signature_key_.value(), input_names[0], new_shape));
+
+  LITERT_ASSIGN_OR_RETURN(
+      batched_input_buffers_,
+      batched_compiled_model_->CreateInputBuffers(signature_key_.value()));
+  LITERT_ASSIGN_OR_RETURN(
+      batched_output_buffers_,
+      batched_compiled_model_->CreateOutputBuffers(signature_key_.value()));
+  LITERT_ASSIGN_OR_RETURN(auto output_buffer_size,
+                          batched_output_buffers_[0].Size());
+  const size_t expected_output_buffer_size =
+      batched_num_tokens * floats_per_token_output_ * sizeof(float);
+  if (output_buffer_size != expected_output_buffer_size) {
+    return absl::UnimplementedError(absl::StrCat(
+        "The output tensor of the resized Embedding model must have ",
+        expected_output_buffer_size, " bytes but got ", output_buffer_size));
+  }
+
+  batched_num_tokens_ = batched_num_tokens;
+  batched_tokens_.assign(batched_num_tokens_, 0);
+  return absl::OkStatus();
+}
+
+absl::Status EmbeddingLookupText::LookupBatched(absl::Span<const int> tokens,
+                                                absl::Span<uint8_t> buffer) {
+  const size_t bytes_per_token = GetFloatsPerToken() * sizeof(float);
+  if (tokens.size() > 1 && !batched_lookup_unsupported_) {
+    absl::Status status = PrepareBatchedModel(tokens.size());
+    if (!status.ok()) {
+      ABSL_LOG(WARNING) << "Embedding one token per run, since the Embedding "
+                           "model cannot embed several tokens per run: "
+                        << status;
+      batched_lookup_unsupported_ = true;
+    }
+  }
+  if (tokens.size() <= 1 || batched_lookup_unsupported_) {
+    for (int i = 0; i < tokens.size(); ++i) {
+      RETURN_IF_ERROR(LookupInternal(
+          tokens[i], buffer.subspan(i * bytes_per_token, bytes_per_token)));
+    }
+    return absl::OkStatus();
+  }
+
+  for (size_t start = 0; start < tokens.size(); start += batched_num_tokens_) {
+    const absl::Span<const int> run_tokens =
+        tokens.subspan(start, batched_num_tokens_);
+    // Negative tokens are embedded as token 0, and then overwritten with the
+    // default embedding below.
+    for (int i = 0; i < batched_num_tokens_; ++i) {
+      batched_tokens_[i] =
+          i < run_tokens.size() ? std::max(run_tokens[i], 0) : 0;
+    }
+    LITERT_RETURN_IF_ERROR(batched_input_buffers_[0].Write(
+        absl::MakeConstSpan(batched_tokens_)));
+    LITERT_RETURN_IF_ERROR(batched_compiled_model_->Run(
+        signature_key_.value(), batched_input_buffers_,
+        batched_output_buffers_));
+
+    uint8_t* run_output = buffer.data() + start * bytes_per_token;
+    {
+      auto output_lock_and_addr = ::litert::TensorBufferScopedLock::Create(
+          batched_output_buffers_[0], TensorBuffer::LockMode::kRead);
+      memcpy(run_output, output_lock_and_addr->second,
+             run_tokens.size() * bytes_per_token);
+    }
+    for (int i = 0; i < run_tokens.size(); ++i) {
+      if (run_tokens[i] < 0) {
+        memcpy(run_output + i * bytes_per_token,
+               default_embedding_vector_.data(), bytes_per_token);
+      }
+    }
+  }
   return absl::OkStatus();
 }
 
@@ -221,11 +360,20 @@ absl::Status EmbeddingLookupText::LookupPrefill(absl::Span<const int> tokens,
       reinterpret_cast<uint8_t*>(prefill_output_lock_and_addr->second);
 
   prefill_output_ptr += byte_offset;
-  for (int token : tokens) {
-    absl::Span<uint8_t> output_buffer(
-        reinterpret_cast<uint8_t*>(prefill_output_ptr), bytes_per_token);
-    RETURN_IF_ERROR(LookupInternal(token, output_buffer));
-    prefill_output_ptr += bytes_per_token;
+  if (cache_ != nullptr && cache_->is_direct_table()) {
+    // All the embeddings are in memory, so the model does not need to run.
+    for (int token : tokens) {
+      RETURN_IF_ERROR(LookupInternal(
+          token, absl::MakeSpan(prefill_output_ptr, bytes_per_token)));
+      prefill_output_ptr += bytes_per_token;
+    }
+  } else {
+    // The prefill tokens are not cached, so that they do not evict the hot
+    // tokens of decode.
+    RETURN_IF_ERROR(LookupBatched(
+        tokens, absl::MakeSpan(prefill_output_ptr,
+                               bytes_per_token * tokens.size())));
+    prefill_output_ptr += bytes_per_token * tokens.size();
   }
 
   // If there are fewer tokens than the output tensor can hold, we need to treat
@@ -243,14 +391,77 @@ absl::Status EmbeddingLookupText::LookupPrefill(absl::Span<const int> tokens,
 
 absl::StatusOr<std::unique_ptr<EmbeddingLookupText>>
 EmbeddingLookupText::Create(const litert::Model* absl_nonnull model,
-                            std::optional<std::string> signature_key) {
+                            std::optional<std::string> signature_key,
+                            const EmbeddingCacheOptions& cache_options) {
   LITERT_ASSIGN_OR_RETURN(auto env, ::litert::Environment::Create({}));
   auto handler = std::unique_ptr<EmbeddingLookupText>(
       new EmbeddingLookupText(std::move(env), model, signature_key));
   RETURN_IF_ERROR(handler->Initialize());
+  RETURN_IF_ERROR(handler->InitializeCache(cache_options));
   return handler;
 }
 
+absl::Status EmbeddingLookupText::InitializeCache(
+    const EmbeddingCacheOptions& cache_options) {
+  const size_t bytes_per_token = GetFloatsPerToken() * sizeof(float);
+  if (cache_options.max_bytes < bytes_per_token) {
+    return absl::OkStatus();
+  }
+  cache_ = std::make_unique<EmbeddingCache>(bytes_per_token, cache_options);
+  if (!cache_->is_direct_table()) {
+    return absl::OkStatus();
+  }
+  if (absl::Status status = FillDirectTable(); !status.ok()) {
+    ABSL_LOG(WARNING) << "Failed to fill the embedding table, caching the "
+                         "most recently used embeddings instead: "
+                      << status;
+    EmbeddingCacheOptions lru_cache_options = cache_options;
+    lru_cache_options.vocab_size = 0;
+    cache_ =
+        std::make_unique<EmbeddingCache>(bytes_per_token, lru_cache_options);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status EmbeddingLookupText::FillDirectTable() {
+  const size_t bytes_per_token = cache_->bytes_per_row();
+  const int vocab_size = cache_->capacity();
+  if (vocab_size <= 0 || cache_->num_bytes() / bytes_per_token !=
+                             static_cast<size_t>(vocab_size)) {
+    return absl::InternalError(absl::StrCat(
+        "The embedding table has ", cache_->num_bytes(), " bytes instead of ",
+        vocab_size, " rows of ", bytes_per_token, " bytes."));
+  }
+
+  // A lookup out of the rows of the embedding model may not fail but return
+  // garbage, in which case filling the table would not detect a model with
+  // fewer rows than the vocabulary. So the model must reject the token id past
+  // the vocabulary, and then embed all the ones of the vocabulary.
+  std::vector<uint8_t> probe_row(bytes_per_token);
+  if (LookupInternal(vocab_size, absl::MakeSpan(probe_row)).ok()) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "The embedding model does not reject the token id ", vocab_size,
+        " past the vocabulary size."));
+  }
+
+  // Computes the embeddings of the whole vocabulary in batched runs.
+  std::vector<int> tokens(std::min(vocab_size, kMaxTokensPerBatchedRun));
+  std::vector<uint8_t> rows(tokens.size() * bytes_per_token);
+  for (int start = 0; start < vocab_size; start += tokens.size()) {
+    const int num_tokens = std::min<int>(tokens.size(), vocab_size - start);
+    std::iota(tokens.begin(), tokens.begin() + num_tokens, start);
+    RETURN_IF_ERROR(LookupBatched(
+        absl::MakeConstSpan(tokens).first(num_tokens),
+        absl::MakeSpan(rows).first(num_tokens * bytes_per_token)));
+    for (int i = 0; i < num_tokens; ++i) {
+      cache_->Insert(start + i,
+                     absl::MakeConstSpan(rows).subspan(i * bytes_per_token,
+                                                       bytes_per_token));
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::Status EmbeddingLookupText::Initialize() {
   LITERT_ASSIGN_OR_RETURN(auto options, Options::Create());
   options.SetHardwareAccelerators(litert::HwAccelerators::kCpu);
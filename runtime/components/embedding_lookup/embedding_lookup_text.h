@@ -33,6 +33,7 @@
 #include "litert/cc/litert_environment.h"  // from @litert
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/embedding_lookup/embedding_cache.h"
 #include "runtime/components/embedding_lookup/embedding_lookup.h"
 
 namespace litert::lm {
@@ -52,9 +53,12 @@ class EmbeddingLookupText : public EmbeddingLookup {
   // in the returned instance, so the caller must ensure that |model| outlives
   // the returned instance.  If the model has more than one signature, and
   // signature_key is not provided, the first signature will be used by default.
+  // If cache_options has a non-zero byte budget, the embeddings are cached in
+  // memory, see EmbeddingCache.
   static absl::StatusOr<std::unique_ptr<EmbeddingLookupText>> Create(
       const litert::Model* absl_nonnull model,
-      std::optional<std::string> signature_key = std::nullopt);
+      std::optional<std::string> signature_key = std::nullopt,
+      const EmbeddingCacheOptions& cache_options = {});
 
   // For a given token, looks up the embedding and stores it in the
   // provided vector. The caller is responsible for ensuring that the vector is
@@ -101,6 +105,9 @@ class EmbeddingLookupText : public EmbeddingLookup {
   // Returns number of floats per token in the output tensor.
   size_t GetFloatsPerToken();
 
+  // Returns the embedding cache, or null if it is disabled.
+  const EmbeddingCache* GetCache() const { return cache_.get(); }
+
   // Returns the default embedding vector to use when a token is not found in
   // the lookup table.
   std::vector<float> GetDefaultEmbeddingVector() const {
@@ -116,10 +123,30 @@ class EmbeddingLookupText : public EmbeddingLookup {
   // Loads the provided model. This must be called before Lookup.
   absl::Status Initialize();
 
+  // Creates the embedding cache, and fills it if it is a direct table of the
+  // whole vocabulary. Must be called after Initialize().
+  absl::Status InitializeCache(const EmbeddingCacheOptions& cache_options);
+
+  // Fills the direct table cache with the embeddings of the whole vocabulary.
+  // Fails if the table does not have one row per token id, or if the embedding
+  // model does not have exactly one row per token id.
+  absl::Status FillDirectTable();
+
   // Internal implementation of Lookup for both the single and multiple token
   // cases.
   absl::Status LookupInternal(int token, absl::Span<uint8_t> buffer);
 
+  // Looks up the embeddings of `tokens` with as few runs of the embedding
+  // model as possible, and stores them contiguously in `buffer`. Falls back to
+  // one run per token if the model cannot be resized to embed several tokens
+  // at once.
+  absl::Status LookupBatched(absl::Span<const int> tokens,
+                             absl::Span<uint8_t> buffer);
+
+  // Prepares the batched embedding model to embed at least `num_tokens` tokens
+  // per run, up to kMaxTokensPerBatchedRun.
+  absl::Status PrepareBatchedModel(int num_tokens);
+
   // The environment for the embedding lookup.
   litert::Environment env_;
   // The model for the embedding lookup. The actual model instance is owned by
@@ -136,9 +163,26 @@ class EmbeddingLookupText : public EmbeddingLookup {
   // The output buffer type for the embedding model.
   std::optional<litert::RankedTensorType> output_buffer_type_;
 
+  // A second instance of the embedding model whose input is resized to embed
+  // several tokens per run during prefill. Created on the first multi-token
+  // lookup. The single token instance above is kept as is for decode.
+  std::optional<litert::CompiledModel> batched_compiled_model_;
+  std::vector<litert::TensorBuffer> batched_input_buffers_;
+  std::vector<litert::TensorBuffer> batched_output_buffers_;
+  // The number of tokens the batched model embeds per run.
+  int batched_num_tokens_ = 0;
+  // Set if the embedding model cannot be resized, so that multi-token lookups
+  // run the single token instance once per token.
+  bool batched_lookup_unsupported_ = false;
+  // The tokens written to the batched model input, padded with token 0.
+  std::vector<int> batched_tokens_;
+
   // The size of the output tensor needed for a single token.
   size_t floats_per_token_output_;
 
+  // The cache of the embeddings of the tokens, or null if disabled.
+  std::unique_ptr<EmbeddingCache> cache_;
+
   // The default embedding vector to use when a token is not found in the
   // lookup table. This is set to the value of token id 0.
   std::vector<float> default_embedding_vector_;
@@ -14,6 +14,7 @@
 
 #include "runtime/components/embedding_lookup/embedding_lookup_text.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -120,6 +121,63 @@ TEST_F(EmbeddingLookupTextTest, LookupDecodeVector) {
   }
 }
 
+TEST_F(EmbeddingLookupTextTest, LookupDecodeWithDirectTableCache) {
+  ASSERT_TRUE(CreateModelFromFile().ok());
+  EmbeddingCacheOptions cache_options;
+  cache_options.max_bytes = 10 * 4 * 32 * sizeof(float);
+  cache_options.vocab_size = 10;
+  auto embedding_or =
+      EmbeddingLookupText::Create(&*model_, std::nullopt, cache_options);
+  ASSERT_TRUE(embedding_or.ok());
+  auto embedding = std::move(embedding_or.value());
+  ASSERT_NE(embedding->GetCache(), nullptr);
+  EXPECT_TRUE(embedding->GetCache()->is_direct_table());
+
+  std::vector<float> output_vector(4 * 32);
+  for (int token = 0; token < 10; ++token) {
+    EXPECT_OK(embedding->LookupDecode(token, output_vector));
+    EXPECT_NEAR(output_vector[4 * 32 - 1], 10000.0 * token + 331.0, 1e-5);
+  }
+  EXPECT_EQ(embedding->GetCache()->stats().hits, 10);
+}
+
+TEST_F(EmbeddingLookupTextTest, DirectTableCacheRequiresMatchingVocabSize) {
+  ASSERT_TRUE(CreateModelFromFile().ok());
+  // The model has 10 rows, so both a smaller and a larger vocabulary fall back
+  // to caching the most recently used embeddings.
+  for (int vocab_size : {9, 11}) {
+    EmbeddingCacheOptions cache_options;
+    cache_options.max_bytes = 11 * 4 * 32 * sizeof(float);
+    cache_options.vocab_size = vocab_size;
+    auto embedding_or =
+        EmbeddingLookupText::Create(&*model_, std::nullopt, cache_options);
+    ASSERT_TRUE(embedding_or.ok());
+    auto embedding = std::move(embedding_or.value());
+    ASSERT_NE(embedding->GetCache(), nullptr);
+    EXPECT_FALSE(embedding->GetCache()->is_direct_table());
+  }
+}
+
+TEST_F(EmbeddingLookupTextTest, LookupDecodeWithLruCache) {
+  ASSERT_TRUE(CreateModelFromFile().ok());
+  EmbeddingCacheOptions cache_options;
+  cache_options.max_bytes = 2 * 4 * 32 * sizeof(float);
+  auto embedding_or =
+      EmbeddingLookupText::Create(&*model_, std::nullopt, cache_options);
+  ASSERT_TRUE(embedding_or.ok());
+  auto embedding = std::move(embedding_or.value());
+  ASSERT_NE(embedding->GetCache(), nullptr);
+  EXPECT_FALSE(embedding->GetCache()->is_direct_table());
+
+  std::vector<float> output_vector(4 * 32);
+  for (int token : {3, 3, 4, 3}) {
+    EXPECT_OK(embedding->LookupDecode(token, output_vector));
+    EXPECT_NEAR(output_vector[4 * 32 - 1], 10000.0 * token + 331.0, 1e-5);
+  }
+  EXPECT_EQ(embedding->GetCache()->stats().hits, 2);
+  EXPECT_EQ(embedding->GetCache()->stats().misses, 2);
+}
+
 TEST_F(EmbeddingLookupTextTest, LookupDecodeVectorBadOutputVector) {
   std::unique_ptr<EmbeddingLookupText> embedding = GetEmbeddingLookupText();
   EXPECT_NE(embedding, nullptr);
@@ -321,6 +379,48 @@ TEST_F(EmbeddingLookupTextTest, LookupPrefill) {
   }
 }
 
+TEST_F(EmbeddingLookupTextTest, LookupPrefillManyTokens) {
+  std::unique_ptr<EmbeddingLookupText> embedding = GetEmbeddingLookupText();
+  EXPECT_NE(embedding, nullptr);
+
+  // More tokens than a single run of the batched embedding model handles,
+  // including a negative token.
+  std::vector<int> tokens(700);
+  for (int i = 0; i < tokens.size(); ++i) {
+    tokens[i] = i % 10;
+  }
+  tokens[600] = -1;
+  Dimensions dimensions({1, static_cast<int>(tokens.size()), 4, 32});
+  LITERT_ASSERT_OK_AND_ASSIGN(TensorBuffer output_tensor,
+                              GetTensorBuffer(dimensions));
+
+  absl::Span<const int> tokens_span(tokens);
+  EXPECT_OK(embedding->LookupPrefill(tokens_span, &output_tensor, 0));
+
+  auto output_tensor_lock_and_addr = ::litert::TensorBufferScopedLock::Create(
+      output_tensor, ::litert::TensorBuffer::LockMode::kRead);
+  auto output_tensor_ptr =
+      reinterpret_cast<float*>(output_tensor_lock_and_addr->second);
+
+  for (int idx0 = 0; idx0 < tokens.size(); ++idx0) {
+    // Negative tokens get the embedding of token 0.
+    int token = std::max(tokens[idx0], 0);
+    for (int idx2 = 0; idx2 < dimensions[2]; ++idx2) {
+      for (int idx3 = 0; idx3 < dimensions[3]; ++idx3) {
+        size_t offset =
+            idx0 * dimensions[2] * dimensions[3] + idx2 * dimensions[3] + idx3;
+        float expected_value = 10000.0 * token + 100.0 * idx2 + idx3;
+        EXPECT_NEAR(output_tensor_ptr[offset], expected_value, 1e-5);
+      }
+    }
+  }
+
+  // A single token still goes through the single token model.
+  std::vector<float> output_vector(embedding->GetFloatsPerToken());
+  EXPECT_OK(embedding->LookupPrefill(7, output_vector));
+  EXPECT_NEAR(output_vector[0], 70000.0, 1e-5);
+}
+
 TEST_F(EmbeddingLookupTextTest, LookupPrefillDecendingTokens) {
   std::unique_ptr<EmbeddingLookupText> embedding = GetEmbeddingLookupText();
   EXPECT_NE(embedding, nullptr);
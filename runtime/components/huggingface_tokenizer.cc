@@ -25,6 +25,7 @@
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "runtime/components/streaming_detokenizer.h"
 #include "runtime/util/memory_mapped_file.h"
 #include "runtime/util/status_macros.h"  // NOLINT
 #include "include/tokenizers_cpp.h"  // from @tokenizers_cpp
@@ -43,6 +44,28 @@ static bool has_bpe_suffix(const std::string& decoded) {
   return decoded.ends_with(kReplacementCharacter);
 }
 
+// Returns the texts of all the tokens, decoding each token on its own.
+static std::shared_ptr<const TokenBytesTable> BuildTokenBytesTable(
+    tokenizers::Tokenizer& tokenizer) {
+  // Disable leak check as Google's default leak checker does not properly
+  // support Rust's lazy_static initialization.
+  // TODO(b/379364190) - Remove this once the leak checker is fixed.
+  absl::LeakCheckDisabler disabler;
+  auto table = std::make_shared<TokenBytesTable>();
+  std::vector<int> token_ids(1);
+  const int vocab_size = tokenizer.GetVocabSize();
+  for (int id = 0; id < vocab_size; ++id) {
+    token_ids[0] = id;
+    std::string decoded = tokenizer.Decode(token_ids);
+    if (has_bpe_suffix(decoded)) {
+      table->AddUndecodable();
+    } else {
+      table->Add(decoded);
+    }
+  }
+  return table;
+}
+
 absl::StatusOr<std::unique_ptr<HuggingFaceTokenizer>>
 HuggingFaceTokenizer::CreateFromFile(absl::string_view json_path) {
   ASSIGN_OR_RETURN(auto memory_mapped_file,  // NOLINT
@@ -59,7 +82,9 @@ HuggingFaceTokenizer::CreateFromJson(std::string json) {
   if (!tokenizer) {
     return absl::InvalidArgumentError("Failed to create tokenizer from JSON.");
   }
-  return absl::WrapUnique(new HuggingFaceTokenizer(std::move(tokenizer)));
+  auto token_bytes = BuildTokenBytesTable(*tokenizer);
+  return absl::WrapUnique(
+      new HuggingFaceTokenizer(std::move(tokenizer), std::move(token_bytes)));
 }
 
 // Encodes the given text into a TensorBuffer of token ids.
@@ -97,4 +122,13 @@ absl::StatusOr<std::string> HuggingFaceTokenizer::TokenIdsToText(
   }
 }
 
+absl::StatusOr<std::unique_ptr<StreamingDetokenizer>>
+HuggingFaceTokenizer::CreateStreamingDetokenizer(int batch_size) {
+  return std::make_unique<StreamingDetokenizer>(
+      batch_size, token_bytes_,
+      [this](const std::vector<int>& token_ids) {
+        return TokenIdsToText(token_ids);
+      });
+}
+
 }  // namespace litert::lm
@@ -22,6 +22,7 @@
 
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "runtime/components/streaming_detokenizer.h"
 #include "runtime/components/tokenizer.h"
 #include "include/tokenizers_cpp.h"  // from @tokenizers_cpp
 
@@ -54,14 +55,26 @@ class HuggingFaceTokenizer : public Tokenizer {
   absl::StatusOr<std::string> TokenIdsToText(
       const std::vector<int>& token_ids) override;
 
+  // Creates a StreamingDetokenizer decoding the tokens from a table of their
+  // texts built when the tokenizer is created. The tokens which decode to an
+  // incomplete BPE sequence on their own are decoded with TokenIdsToText().
+  absl::StatusOr<std::unique_ptr<StreamingDetokenizer>>
+  CreateStreamingDetokenizer(int batch_size) override;
+
  private:
   // Constructor.
-  explicit HuggingFaceTokenizer(
-      std::unique_ptr<tokenizers::Tokenizer> tokenizer)
-      : tokenizer_(std::move(tokenizer)) {};
+  HuggingFaceTokenizer(std::unique_ptr<tokenizers::Tokenizer> tokenizer,
+                       std::shared_ptr<const TokenBytesTable> token_bytes)
+      : tokenizer_(std::move(tokenizer)),
+        token_bytes_(std::move(token_bytes)) {};
 
   // HuggingFace processor.
   std::unique_ptr<tokenizers::Tokenizer> tokenizer_;
+
+  // The texts of all the tokens, shared by the streaming detokenizers. Built
+  // upfront, so that the first decode step of a session does not have to
+  // decode the whole vocabulary.
+  std::shared_ptr<const TokenBytesTable> token_bytes_;
 };
 
 }  // namespace litert::lm
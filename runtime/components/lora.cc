@@ -58,7 +58,7 @@ absl::Status LoRA::Init() {
     LITERT_ASSIGN_OR_RETURN(auto tensor_buffer_size,
                                  tensor_buffer.PackedSize());
 
-    if (lora_data_->HasTensor(input_name)) {
+    if (lora_data_ != nullptr && lora_data_->HasTensor(input_name)) {
       // Read the tensor data from LoraData.
       ASSIGN_OR_RETURN(auto lora_tensor_data,
                        lora_data_->ReadTensor(input_name));
@@ -75,7 +75,10 @@ absl::Status LoRA::Init() {
     }
 
     lora_buffers_[input_name] = std::move(tensor_buffer);
+    size_bytes_ += tensor_buffer_size;
   }
+  // The weights are all copied to the tensor buffers.
+  lora_data_.reset();
   return absl::OkStatus();
 }
 
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_LORA_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_LORA_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
@@ -41,7 +42,8 @@ class LoRA {
  public:
   // Creates and initializes a LoRA object.
   //
-  // @param lora_data The LoraData object containing the LoRA weights.
+  // @param lora_data The LoraData object containing the LoRA weights. If null,
+  // all the LoRA weights are zeros, i.e. the LoRA leaves the base model as is.
   // @param model The litert::Model object, containing the model LoRA input
   // signature information. litert::Model is used as a signature Metadata for
   // creating CompiledModel, but we have no way to get litert::Model from
@@ -70,6 +72,9 @@ class LoRA {
   absl::StatusOr<absl::flat_hash_map<absl::string_view, litert::TensorBuffer>>
   GetLoRABuffers() const;
 
+  // Returns the total size of the LoRA tensor buffers in bytes.
+  size_t size_bytes() const { return size_bytes_; }
+
  private:
   LoRA(std::unique_ptr<LoraData> lora_data, const litert::Model& model,
        const litert::CompiledModel& compiled_model)
@@ -78,13 +83,14 @@ class LoRA {
         compiled_model_(compiled_model) {}
 
   // Initializes the LoRA object by creating TensorBuffers for all LoRA inputs
-  // and copying the data from LoraData.
+  // and copying the data from LoraData. LoraData is released afterwards.
   absl::Status Init();
 
   std::unique_ptr<LoraData> lora_data_;
   const litert::Model& model_;
   const litert::CompiledModel& compiled_model_;
   absl::flat_hash_map<std::string, litert::TensorBuffer> lora_buffers_;
+  size_t size_bytes_ = 0;
 };
 
 }  // namespace litert::lm
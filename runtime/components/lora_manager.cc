@@ -14,6 +14,7 @@
 
 #include "runtime/components/lora_manager.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <utility>
@@ -34,39 +35,66 @@
 namespace litert::lm {
 
 absl::StatusOr<std::unique_ptr<LoraManager>> LoraManager::Create(
-    const litert::Model& model, const litert::CompiledModel& compiled_model) {
-  return absl::WrapUnique(new LoraManager(model, compiled_model));
+    const litert::Model& model, const litert::CompiledModel& compiled_model,
+    size_t max_bytes) {
+  return absl::WrapUnique(new LoraManager(model, compiled_model, max_bytes));
 }
 
 LoraManager::LoraManager(const litert::Model& model,
-                         const litert::CompiledModel& compiled_model)
-    : model_(model), compiled_model_(compiled_model) {}
+                         const litert::CompiledModel& compiled_model,
+                         size_t max_bytes)
+    : model_(model), compiled_model_(compiled_model), max_bytes_(max_bytes) {}
 
 absl::Status LoraManager::LoadLoRA(uint32_t lora_id,
                                    const ModelAssets& model_assets) {
-  if (lora_data_.contains(lora_id)) {
+  if (lora_assets_.contains(lora_id)) {
     return absl::AlreadyExistsError("LoRA ID already exists");
   }
-  ASSIGN_OR_RETURN(auto scoped_file, model_assets.GetOrCreateScopedFile());
-  ASSIGN_OR_RETURN(auto lora_data, LoraData::CreateFromScopedFile(scoped_file));
-  lora_data_[lora_id] = std::move(lora_data);
+  lora_assets_.emplace(lora_id, model_assets);
   return absl::OkStatus();
 }
 
 absl::Status LoraManager::UseLoRA(uint32_t lora_id) {
-  if (!lora_data_.contains(lora_id) && !loras_.contains(lora_id)) {
-    return absl::NotFoundError("LoRA ID not found");
-  }
-  if (!loras_.contains(lora_id)) {
-    ASSIGN_OR_RETURN(auto lora, LoRA::Create(std::move(lora_data_[lora_id]),
-                                             model_, compiled_model_));
-    loras_[lora_id] = std::move(lora);
-    lora_data_.erase(lora_id);
+  auto it = loras_.find(lora_id);
+  if (it == loras_.end()) {
+    auto assets_it = lora_assets_.find(lora_id);
+    if (assets_it == lora_assets_.end()) {
+      return absl::NotFoundError("LoRA ID not found");
+    }
+    ASSIGN_OR_RETURN(auto scoped_file,
+                     assets_it->second.GetOrCreateScopedFile());
+    ASSIGN_OR_RETURN(auto lora_data,
+                     LoraData::CreateFromScopedFile(scoped_file));
+    ASSIGN_OR_RETURN(auto lora, LoRA::Create(std::move(lora_data), model_,
+                                             compiled_model_));
+    size_bytes_ += lora->size_bytes();
+    it = loras_.emplace(lora_id, LoadedLoRA{.lora = std::move(lora)}).first;
   }
+  it->second.last_use = ++use_count_;
   current_lora_id_ = lora_id;
+  UnloadLeastRecentlyUsed();
   return absl::OkStatus();
 }
 
+void LoraManager::UnloadLeastRecentlyUsed() {
+  while (max_bytes_ > 0 && size_bytes_ > max_bytes_) {
+    auto lru = loras_.end();
+    for (auto it = loras_.begin(); it != loras_.end(); ++it) {
+      if (it->first != current_lora_id_ &&
+          (lru == loras_.end() || it->second.last_use < lru->second.last_use)) {
+        lru = it;
+      }
+    }
+    if (lru == loras_.end()) {
+      // Only the current LoRA is left, which is kept even if it exceeds the
+      // budget on its own.
+      return;
+    }
+    size_bytes_ -= lru->second.lora->size_bytes();
+    loras_.erase(lru);
+  }
+}
+
 absl::StatusOr<absl::flat_hash_map<absl::string_view, litert::TensorBuffer>>
 LoraManager::GetLoRABuffers() const {
   if (!current_lora_id_.has_value()) {
@@ -75,7 +103,7 @@ LoraManager::GetLoRABuffers() const {
   if (!loras_.contains(*current_lora_id_)) {
     return absl::NotFoundError("LoRA ID not found");
   }
-  return loras_.at(*current_lora_id_)->GetLoRABuffers();
+  return loras_.at(*current_lora_id_).lora->GetLoRABuffers();
 }
 
 }  // namespace litert::lm
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_LORA_MANAGER_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_LORA_MANAGER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -28,15 +29,17 @@
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/lora.h"
 #include "runtime/executor/executor_settings_base.h"
-#include "runtime/util/lora_data.h"
 
 namespace litert::lm {
 
 // The class managing LoRA weights for LiteRT-LM.
 // It is responsible for loading LoRA weights, creating LoRA objects, and
 // managing the current LoRA ID to use.
-// It will create LoRA objects on the backend (e.g. GPU) lazily, only when
-// UseLoRA() is called with the corresponding LoRA ID.
+// It will read the LoRA models and create LoRA objects on the backend (e.g.
+// GPU) lazily, only when UseLoRA() is called with the corresponding LoRA ID. If
+// a byte budget is given, the least recently used LoRAs other than the current
+// one are unloaded to fit in it, and loaded again when used, so that many LoRAs
+// can be served with the memory of a few.
 class LoraManager {
  public:
   // Args:
@@ -47,21 +50,25 @@ class LoraManager {
   // to pass litert::Model in separately.
   // compiled_model: The CompiledModel object containing model and environment
   // information. It is used for creating backend resources for model buffers.
+  // max_bytes: The byte budget of the tensor buffers of the loaded LoRAs. If 0,
+  // the loaded LoRAs are never unloaded.
   static absl::StatusOr<std::unique_ptr<LoraManager>> Create(
-      const litert::Model& model, const litert::CompiledModel& compiled_model);
+      const litert::Model& model, const litert::CompiledModel& compiled_model,
+      size_t max_bytes = 0);
 
   // Returns the current LoRA ID.
   std::optional<uint32_t> GetCurrentLoRAId() const { return current_lora_id_; }
 
-  // Loads the LoRA model into tensor loader, but does not use it.
-  // To use the lora weights, call `UseLoRA()` with the lora_id.
+  // Registers the LoRA model, but neither loads nor uses it. The LoRA model is
+  // loaded by the first `UseLoRA()` call with the lora_id.
   // Args:
-  // lora_id: The unique id to assign to the loaded LoRA model.
+  // lora_id: The unique id to assign to the LoRA model.
   // model_assets: Contains the LoRA model to load.
   absl::Status LoadLoRA(uint32_t lora_id, const ModelAssets& model_assets);
 
   // Sets the current LoRA ID to use. If the LoRA object for the given ID
-  // doesn't exist, it will be created.
+  // doesn't exist, it will be created, after which the least recently used
+  // LoRA objects are unloaded to fit in the byte budget.
   absl::Status UseLoRA(uint32_t lora_id);
 
   // Returns a map of all the LoRA tensor names to their duplicated
@@ -69,16 +76,35 @@ class LoraManager {
   absl::StatusOr<absl::flat_hash_map<absl::string_view, litert::TensorBuffer>>
   GetLoRABuffers() const;
 
+  // Returns true if the LoRA object for the given ID is loaded.
+  bool IsLoRALoaded(uint32_t lora_id) const { return loras_.contains(lora_id); }
+
+  // Returns the total size of the tensor buffers of the loaded LoRAs.
+  size_t size_bytes() const { return size_bytes_; }
+
  private:
+  struct LoadedLoRA {
+    std::unique_ptr<LoRA> lora;
+    // The value of `use_count_` when the LoRA was last used.
+    uint64_t last_use = 0;
+  };
+
   LoraManager(const litert::Model& model,
-              const litert::CompiledModel& compiled_model);
+              const litert::CompiledModel& compiled_model, size_t max_bytes);
+
+  // Unloads the least recently used LoRAs other than the current one until the
+  // loaded LoRAs fit in the byte budget.
+  void UnloadLeastRecentlyUsed();
 
   const litert::Model& model_;
   const litert::CompiledModel& compiled_model_;
+  const size_t max_bytes_;
 
-  absl::flat_hash_map<uint32_t, std::unique_ptr<LoraData>> lora_data_;
-  absl::flat_hash_map<uint32_t, std::unique_ptr<LoRA>> loras_;
+  absl::flat_hash_map<uint32_t, ModelAssets> lora_assets_;
+  absl::flat_hash_map<uint32_t, LoadedLoRA> loras_;
   std::optional<uint32_t> current_lora_id_;
+  uint64_t use_count_ = 0;
+  size_t size_bytes_ = 0;
 };
 
 }  // namespace litert::lm
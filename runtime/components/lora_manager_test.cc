@@ -226,5 +226,45 @@ TEST_F(LoraManagerTest, SwitchBetweenLoRAs) {
   }
 }
 
+TEST_F(LoraManagerTest, UnloadsLeastRecentlyUsedLoRAsOverBudget) {
+  ASSERT_OK_AND_ASSIGN(ModelAssets model_assets_ones,
+                       ModelAssets::Create(GetLoraOnesFilePath()));
+  ASSERT_OK_AND_ASSIGN(ModelAssets model_assets_twos,
+                       ModelAssets::Create(GetLoraTwosFilePath()));
+  ASSERT_OK(lora_manager_->LoadLoRA(0, model_assets_ones));
+  ASSERT_OK(lora_manager_->UseLoRA(0));
+  const size_t lora_size = lora_manager_->size_bytes();
+  ASSERT_GT(lora_size, 0);
+
+  // The budget fits one LoRA only.
+  ASSERT_OK_AND_ASSIGN(auto lora_manager,
+                       LoraManager::Create(*model_, *compiled_model_,
+                                           /*max_bytes=*/lora_size));
+  ASSERT_OK(lora_manager->LoadLoRA(0, model_assets_ones));
+  ASSERT_OK(lora_manager->LoadLoRA(1, model_assets_twos));
+  EXPECT_FALSE(lora_manager->IsLoRALoaded(0));
+
+  ASSERT_OK(lora_manager->UseLoRA(0));
+  EXPECT_TRUE(lora_manager->IsLoRALoaded(0));
+  ASSERT_OK(lora_manager->UseLoRA(1));
+  EXPECT_FALSE(lora_manager->IsLoRALoaded(0));
+  EXPECT_TRUE(lora_manager->IsLoRALoaded(1));
+  EXPECT_EQ(lora_manager->size_bytes(), lora_size);
+
+  // The unloaded LoRA is loaded again when used.
+  ASSERT_OK(lora_manager->UseLoRA(0));
+  EXPECT_TRUE(lora_manager->IsLoRALoaded(0));
+  EXPECT_FALSE(lora_manager->IsLoRALoaded(1));
+  ASSERT_OK_AND_ASSIGN(auto buffers, lora_manager->GetLoRABuffers());
+  auto it = buffers.find("query_w_prime_left_10");
+  ASSERT_NE(it, buffers.end());
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto lock_and_ptr,
+      litert::TensorBufferScopedLock::Create<const uint16_t>(
+          it->second, litert::TensorBuffer::LockMode::kRead));
+  const uint16_t fp16_one = 0x3C00;
+  EXPECT_EQ(lock_and_ptr.second[0], fp16_one);
+}
+
 }  // namespace
 }  // namespace litert::lm
@@ -46,6 +46,7 @@ enum class ModelType {
   kTfLiteVisionAdapter = 7,
   kTfLiteVisionEncoder = 8,
   kArtisanTextDecoder = 11,
+  kTfLiteDraftPrefillDecode = 12,  // The draft model of speculative decoding.
 };
 
 // Utility function to convert a string to ModelType. It's case insensitive.
@@ -75,6 +76,8 @@ inline absl::StatusOr<ModelType> StringToModelType(
     return ModelType::kTfLiteVisionEncoder;
   } else if (lower_case_model_type_str == "artisan_text_decoder") {
     return ModelType::kArtisanTextDecoder;
+  } else if (lower_case_model_type_str == "tf_lite_draft_prefill_decode") {
+    return ModelType::kTfLiteDraftPrefillDecode;
   } else {
     return absl::InvalidArgumentError(
         absl::StrCat("Unknown model type: ", model_type_str));
@@ -106,6 +109,8 @@ inline std::string ModelTypeToString(ModelType model_type) {
       return "TF_LITE_VISION_ENCODER";
     case ModelType::kArtisanTextDecoder:
       return "ARTISAN_TEXT_DECODER";
+    case ModelType::kTfLiteDraftPrefillDecode:
+      return "TF_LITE_DRAFT_PREFILL_DECODE";
     case ModelType::kUnknown:
       return "UNKNOWN";
     default:
@@ -183,6 +183,10 @@ TEST(ModelTypeConversionTest, StringToModelType) {
   ASSERT_OK(result);
   EXPECT_EQ(result.value(), ModelType::kArtisanTextDecoder);
 
+  result = StringToModelType("tf_lite_draft_prefill_decode");
+  ASSERT_OK(result);
+  EXPECT_EQ(result.value(), ModelType::kTfLiteDraftPrefillDecode);
+
   result = StringToModelType("unknown");
   EXPECT_FALSE(result.ok());
 }
@@ -195,6 +199,8 @@ TEST(ModelTypeConversionTest, ModelTypeToString) {
             "TF_LITE_PER_LAYER_EMBEDDER");
   EXPECT_EQ(ModelTypeToString(ModelType::kArtisanTextDecoder),
             "ARTISAN_TEXT_DECODER");
+  EXPECT_EQ(ModelTypeToString(ModelType::kTfLiteDraftPrefillDecode),
+            "TF_LITE_DRAFT_PREFILL_DECODE");
   EXPECT_EQ(ModelTypeToString(ModelType::kUnknown), "UNKNOWN");
 }
 
@@ -17,7 +17,6 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
-#include <cstdlib>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -37,6 +36,8 @@
 #include "runtime/components/preprocessor/audio_preprocessor.h"
 #include "runtime/components/preprocessor/mel_filterbank.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/framework/parallel_for.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/util/status_macros.h"  // IWYU pragma: keep
 #include "miniaudio.h"  // from @miniaudio
 #include "kiss_fftr.h"  // from @kissfft
@@ -87,6 +88,14 @@ absl::Status AudioPreprocessorMiniAudio::DecodeAudio(
   return absl::OkStatus();
 }
 
+namespace {
+
+// The minimum number of frames computed by a thread. Smaller shards do not pay
+// for the scheduling overhead.
+constexpr int kMinFramesPerShard = 64;
+
+}  // namespace
+
 std::vector<float> GetHanningWindow(int window_length) {
   float arg = M_PI * 2.0 / window_length;
   std::vector<float> hanning_window(window_length, 0);
@@ -96,135 +105,125 @@ std::vector<float> GetHanningWindow(int window_length) {
   return hanning_window;
 }
 
-bool AudioPreprocessorMiniAudio::GetNextWindowOfSamples(
-    const std::vector<float>& pcm_frames, int& input_start) {
-  auto input_it = pcm_frames.begin() + input_start;
-  int input_remaining = pcm_frames.end() - input_it;
-  if (samples_to_next_step_ > input_remaining) {
-    // Copy in as many samples are left and return false, no full window.
-    input_queue_.insert(input_queue_.end(), input_it, pcm_frames.end());
-    input_start += input_remaining;  // Increases it to input.size().
-    samples_to_next_step_ -= input_remaining;
-    return false;  // Not enough for a full window.
-  } else {
-    // Copy just enough into queue to make a new window.
-    if (samples_to_next_step_ < config_.GetFrameLength()) {
-      input_queue_.erase(
-          input_queue_.begin(),
-          input_queue_.begin() + input_queue_.size() -
-              (config_.GetFrameLength() - samples_to_next_step_));
-      input_queue_.insert(input_queue_.end(), input_it,
-                          input_it + samples_to_next_step_);
-    } else {
-      input_queue_.assign(
-          input_it + samples_to_next_step_ - config_.GetFrameLength(),
-          input_it + samples_to_next_step_);
-    }
-    input_start += samples_to_next_step_;
-    samples_to_next_step_ = config_.GetHopLength();  // Be ready for next step.
-    return true;  // Yes, input_queue_ now contains exactly a window-full.
-  }
-}
-
-absl::Status AudioPreprocessorMiniAudio::PcmFramesToSpectrogram(
-    absl::Span<const float> pcm_frames, std::vector<float>& spectrograms) {
-  const float input_scale = config_.GetInputScale();
+absl::Status AudioPreprocessorMiniAudio::FramesToLogMelSpectrograms(
+    const float* samples, int num_frames, kiss_fftr_cfg fft_config,
+    float* log_mel_spectrograms) const {
+  const int frame_length = config_.GetFrameLength();
+  const int hop_length = config_.GetHopLength();
+  const int fft_bins = config_.GetFftBins();
+  const int num_mel_bins = config_.GetNumMelBins();
   const float pre_emphasis_factor = config_.GetPreEmphasisFactor();
-  std::vector<float> scaled_pcm_frames(pcm_frames.size(), 0);
-  std::transform(pcm_frames.begin(), pcm_frames.end(),
-                 scaled_pcm_frames.begin(),
-                 [&input_scale](float x) { return x * input_scale; });
-  std::vector<std::vector<float>> windowed_signals;
-  const int num_frames = 1 + (pcm_frames.size() - config_.GetFrameLength()) /
-                                 config_.GetHopLength();
-  windowed_signals.reserve(num_frames);
-  int input_start = 0;
-  while (GetNextWindowOfSamples(scaled_pcm_frames, input_start)) {
-    if (input_queue_.size() != config_.GetFrameLength()) {
-      return absl::InternalError(
-          absl::StrCat("Input queue size is not equal to frame length: ",
-                       input_queue_.size(), " vs ", config_.GetFrameLength()));
+  const float mel_floor = config_.GetMelFloor();
+  const float* window = hanning_window_.data();
+  // The windowed signal is zero padded to the FFT length if needed.
+  std::vector<float> windowed_signal(
+      std::max(config_.GetFftLength(), frame_length), 0);
+  std::vector<kiss_fft_cpx> fft_output(fft_bins);
+  std::vector<float> magnitude_spectrum(fft_bins);
+  for (int f = 0; f < num_frames; ++f) {
+    const float* frame = samples + f * hop_length;
+    float* windowed = windowed_signal.data();
+    // The loops below are plain element-wise loops over contiguous arrays,
+    // which the compiler vectorizes.
+    windowed[0] = frame[0] * (1 - pre_emphasis_factor) * window[0];
+    for (int i = 1; i < frame_length; ++i) {
+      windowed[i] =
+          (frame[i] - pre_emphasis_factor * frame[i - 1]) * window[i];
     }
-    windowed_signals.push_back(std::vector<float>(config_.GetFrameLength(), 0));
-    std::vector<float>& current_frame = windowed_signals.back();
-    current_frame = input_queue_;
-    current_frame[0] = input_queue_[0] * (1 - pre_emphasis_factor);
-    for (int i = 1; i < config_.GetFrameLength(); ++i) {
-      current_frame[i] =
-          input_queue_[i] - pre_emphasis_factor * input_queue_[i - 1];
+    kiss_fftr(fft_config, windowed, fft_output.data());
+    for (int i = 0; i < fft_bins; ++i) {
+      magnitude_spectrum[i] = std::sqrt(fft_output[i].r * fft_output[i].r +
+                                        fft_output[i].i * fft_output[i].i);
     }
-  }
-  if (windowed_signals.size() != num_frames) {
-    return absl::InternalError(absl::StrCat(
-        "Windowed signals size is not equal to expected number of frames: ",
-        windowed_signals.size(), " vs ", num_frames));
-  }
-  const std::vector<float> hanning_window =
-      GetHanningWindow(config_.GetFrameLength());
-  for (int i = 0; i < windowed_signals.size(); ++i) {
-    std::vector<float>& current_frame = windowed_signals[i];
-    for (int j = 0; j < current_frame.size(); ++j) {
-      current_frame[j] *= hanning_window[j];
-    }
-    if (config_.GetFftLength() > config_.GetFrameLength()) {
-      current_frame.resize(config_.GetFftLength(), 0);
-    }
-  }
-
-  kiss_fftr_cfg fft_alloc = kiss_fftr_alloc(config_.GetFftLength(),
-                                            /*inverse_fft=*/0,
-                                            /*mem=*/nullptr,
-                                            /*lenmem=*/nullptr);
-  kiss_fft_cpx* temp_out =
-      (kiss_fft_cpx*)malloc(sizeof(kiss_fft_cpx) * (config_.GetFftBins()));
-  for (int i = 0; i < windowed_signals.size(); ++i) {
-    std::vector<float>& current_frame = windowed_signals[i];
-    kiss_fftr(fft_alloc, current_frame.data(), temp_out);
-    for (int j = 0; j < config_.GetFftBins(); ++j) {
-      spectrograms.push_back(temp_out[j].r * temp_out[j].r +
-                             temp_out[j].i * temp_out[j].i);
-    }
-  }
-  free(temp_out);
-  kiss_fftr_free(fft_alloc);
-
-  return absl::OkStatus();
-}
-
-absl::Status AudioPreprocessorMiniAudio::ToLogMelSpectrogram(
-    const std::vector<float>& spectrograms,
-    std::vector<float>& log_mel_spectrograms) {
-  std::vector<double> spectrograms_double(spectrograms.size());
-  for (int i = 0; i < spectrograms.size(); ++i) {
-    spectrograms_double[i] = spectrograms[i];
-  }
-  int fft_bins = config_.GetFftBins();
-  const int frames = spectrograms.size() / fft_bins;
-  log_mel_spectrograms.reserve(frames * config_.GetNumMelBins());
-  std::vector<double> tmp_log_mel(config_.GetNumMelBins(), 0);
-  for (int i = 0; i < frames; ++i) {
-    RETURN_IF_ERROR(mel_filterbank_->ToMelSpectrum(
-        absl::MakeSpan(spectrograms_double.data() + i * fft_bins, fft_bins),
-        &tmp_log_mel));
-    for (int j = 0; j < tmp_log_mel.size(); ++j) {
-      float log_mel =
-          std::max(logf(tmp_log_mel[j]), config_.GetMelFloor());
-      log_mel = (log_mel - AudioPreprocessorConfig::kUsmMelMean[j]) /
-                AudioPreprocessorConfig::kUsmMelStdDev[j];
-      log_mel_spectrograms.push_back(log_mel);
+    float* log_mel = log_mel_spectrograms + f * num_mel_bins;
+    RETURN_IF_ERROR(mel_filterbank_->MagnitudeToMelSpectrum(
+        magnitude_spectrum, absl::MakeSpan(log_mel, num_mel_bins)));
+    for (int j = 0; j < num_mel_bins; ++j) {
+      log_mel[j] = (std::max(std::log(log_mel[j]), mel_floor) -
+                    AudioPreprocessorConfig::kUsmMelMean[j]) /
+                   AudioPreprocessorConfig::kUsmMelStdDev[j];
     }
   }
   return absl::OkStatus();
 }
 
 absl::StatusOr<std::unique_ptr<AudioPreprocessorMiniAudio>>
-AudioPreprocessorMiniAudio::Create(const AudioPreprocessorConfig& config) {
+AudioPreprocessorMiniAudio::Create(const AudioPreprocessorConfig& config,
+                                   ThreadPool* thread_pool) {
   auto mel_filterbank = std::make_unique<MelFilterbank>();
   RETURN_IF_ERROR(mel_filterbank->Initialize(
       config.GetFftBins(), config.GetSampleRateHz(), config.GetNumMelBins(),
       config.GetMelLowHz(), config.GetMelHighHz()));
-  return absl::WrapUnique(
-      new AudioPreprocessorMiniAudio(config, std::move(mel_filterbank)));
+  auto preprocessor = absl::WrapUnique(new AudioPreprocessorMiniAudio(
+      config, std::move(mel_filterbank), thread_pool));
+  preprocessor->hanning_window_ = GetHanningWindow(config.GetFrameLength());
+  // The calling thread computes frames too.
+  const int num_fft_configs =
+      thread_pool == nullptr ? 1 : thread_pool->max_num_threads() + 1;
+  for (int i = 0; i < num_fft_configs; ++i) {
+    preprocessor->fft_configs_.push_back(
+        kiss_fftr_alloc(config.GetFftLength(), /*inverse_fft=*/0,
+                        /*mem=*/nullptr, /*lenmem=*/nullptr));
+  }
+  return preprocessor;
+}
+
+absl::Status AudioPreprocessorMiniAudio::PushPcmFrames(
+    absl::Span<const float> pcm_frames,
+    std::vector<float>& log_mel_spectrograms) {
+  const int frame_length = config_.GetFrameLength();
+  const int hop_length = config_.GetHopLength();
+  const int num_mel_bins = config_.GetNumMelBins();
+  const float input_scale = config_.GetInputScale();
+  const int num_old_samples = pending_samples_.size();
+  pending_samples_.resize(num_old_samples + pcm_frames.size());
+  std::transform(pcm_frames.begin(), pcm_frames.end(),
+                 pending_samples_.begin() + num_old_samples,
+                 [input_scale](float x) { return x * input_scale; });
+
+  const int num_samples = pending_samples_.size();
+  const int num_frames =
+      next_frame_start_ + frame_length > num_samples
+          ? 0
+          : 1 + (num_samples - next_frame_start_ - frame_length) / hop_length;
+  const int output_start = log_mel_spectrograms.size();
+  log_mel_spectrograms.resize(output_start + num_frames * num_mel_bins);
+  const float* samples = pending_samples_.data() + next_frame_start_;
+  float* output = log_mel_spectrograms.data() + output_start;
+
+  // Splits the frames into contiguous shards, one per FFT configuration.
+  const int num_shards =
+      std::clamp((num_frames + kMinFramesPerShard - 1) / kMinFramesPerShard,
+                 1, static_cast<int>(fft_configs_.size()));
+  const int frames_per_shard = (num_frames + num_shards - 1) / num_shards;
+  std::vector<absl::Status> statuses(num_shards);
+  auto compute_shard = [&](int shard) {
+    const int first_frame = shard * frames_per_shard;
+    const int shard_frames =
+        std::min(frames_per_shard, num_frames - first_frame);
+    if (shard_frames <= 0) {
+      return;
+    }
+    statuses[shard] = FramesToLogMelSpectrograms(
+        samples + first_frame * hop_length, shard_frames, fft_configs_[shard],
+        output + first_frame * num_mel_bins);
+  };
+  if (num_shards == 1) {  // Also the case if there is no thread pool.
+    compute_shard(0);
+  } else {
+    ParallelFor(*thread_pool_, num_shards, compute_shard);
+  }
+  for (const absl::Status& status : statuses) {
+    RETURN_IF_ERROR(status);
+  }
+
+  // Drops the samples which no later frame uses.
+  next_frame_start_ += num_frames * hop_length;
+  const int num_used_samples = std::min(next_frame_start_, num_samples);
+  pending_samples_.erase(pending_samples_.begin(),
+                         pending_samples_.begin() + num_used_samples);
+  next_frame_start_ -= num_used_samples;
+  return absl::OkStatus();
 }
 
 // The preprocessing steps are:
@@ -247,13 +246,17 @@ absl::StatusOr<InputAudio> AudioPreprocessorMiniAudio::Preprocess(
   std::vector<float> pcm_frames;
   RETURN_IF_ERROR(DecodeAudio(raw_audio_bytes, config_.GetNumChannels(),
                               config_.GetSampleRateHz(), pcm_frames));
-  std::vector<float> spectrograms;
-  RETURN_IF_ERROR(PcmFramesToSpectrogram(pcm_frames, spectrograms));
-
   std::vector<float> log_mel_spectrograms;
-  RETURN_IF_ERROR(ToLogMelSpectrogram(spectrograms, log_mel_spectrograms));
+  RETURN_IF_ERROR(PushPcmFrames(pcm_frames, log_mel_spectrograms));
 
-  const int num_frames = log_mel_spectrograms.size() / config_.GetNumMelBins();
+  const int num_frames = 1 + (pcm_frames.size() - config_.GetFrameLength()) /
+                                 config_.GetHopLength();
+  if (log_mel_spectrograms.size() / config_.GetNumMelBins() != num_frames) {
+    return absl::InternalError(absl::StrCat(
+        "Windowed signals size is not equal to expected number of frames: ",
+        log_mel_spectrograms.size() / config_.GetNumMelBins(), " vs ",
+        num_frames));
+  }
   RankedTensorType mel_tensor_type(
       GetElementType<float>(),
       Layout(Dimensions({1, num_frames, config_.GetNumMelBins()})));
@@ -26,6 +26,8 @@
 #include "runtime/components/preprocessor/audio_preprocessor.h"
 #include "runtime/components/preprocessor/mel_filterbank.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/framework/threadpool.h"
+#include "kiss_fftr.h"  // from @kissfft
 
 namespace litert::lm {
 
@@ -36,10 +38,18 @@ class AudioPreprocessorMiniAudio : public AudioPreprocessor {
   // Creates an AudioPreprocessorMiniAudio instance.
   // Args:
   //   - config: The configuration of the audio preprocessor.
+  //   - thread_pool: Optional. If set, the frames of long audio are split
+  //     across the pool. The pool must outlive the preprocessor.
   // Returns:
   //   A unique pointer to the AudioPreprocessorMiniAudio instance.
   static absl::StatusOr<std::unique_ptr<AudioPreprocessorMiniAudio>> Create(
-      const AudioPreprocessorConfig& config);
+      const AudioPreprocessorConfig& config, ThreadPool* thread_pool = nullptr);
+
+  ~AudioPreprocessorMiniAudio() override {
+    for (kiss_fftr_cfg fft_config : fft_configs_) {
+      kiss_fftr_free(fft_config);
+    }
+  }
 
   // Decodes the raw audio bytes to PCM frames using MiniAudio library.
   // Args:
@@ -65,35 +75,55 @@ class AudioPreprocessorMiniAudio : public AudioPreprocessor {
   //   with shape (1, num_frames, num_mel_bins).
   absl::StatusOr<InputAudio> Preprocess(const InputAudio& input_audio) override;
 
+  // Pushes the next PCM frames of an audio stream, e.g. as they are captured,
+  // and appends the log mel spectrograms of the frames completed by them.
+  // The samples which don't complete a frame yet are kept until the next
+  // call, so the spectrograms are the same as if the whole stream was
+  // preprocessed at once. Call Reset() to start a new stream.
+  // Args:
+  //   - pcm_frames: The decoded PCM frames, at the configured sample rate.
+  //   - log_mel_spectrograms: The log mel spectrograms to append to, with
+  //     `num_mel_bins` values per frame.
+  absl::Status PushPcmFrames(absl::Span<const float> pcm_frames,
+                             std::vector<float>& log_mel_spectrograms);
+
   // Resets the preprocessor to its initial state.
   void Reset() override {
-    input_queue_.clear();
-    samples_to_next_step_ = config_.GetFrameLength();
+    pending_samples_.clear();
+    next_frame_start_ = 0;
   }
 
  private:
   explicit AudioPreprocessorMiniAudio(
       const AudioPreprocessorConfig& config,
-      std::unique_ptr<MelFilterbank> mel_filterbank)
+      std::unique_ptr<MelFilterbank> mel_filterbank, ThreadPool* thread_pool)
       : config_(config),
         mel_filterbank_(std::move(mel_filterbank)),
-        input_queue_(std::vector<float>()) {
-    samples_to_next_step_ = config_.GetFrameLength();
-  }
-
-  absl::Status PcmFramesToSpectrogram(absl::Span<const float> pcm_frames,
-                                      std::vector<float>& spectrograms);
-
-  absl::Status ToLogMelSpectrogram(const std::vector<float>& spectrograms,
-                                   std::vector<float>& log_mel_spectrograms);
+        thread_pool_(thread_pool) {}
 
-  bool GetNextWindowOfSamples(const std::vector<float>& pcm_frames,
-                              int& input_start);
+  // Computes the log mel spectrograms of `num_frames` frames, the first of
+  // which starts at `samples`, each `hop_length` samples after the previous
+  // one, into `num_frames * num_mel_bins` values at `log_mel_spectrograms`.
+  // `fft_config` must not be used by another thread at the same time.
+  absl::Status FramesToLogMelSpectrograms(const float* samples,
+                                          int num_frames,
+                                          kiss_fftr_cfg fft_config,
+                                          float* log_mel_spectrograms) const;
 
   AudioPreprocessorConfig config_;
   std::unique_ptr<MelFilterbank> mel_filterbank_;
-  std::vector<float> input_queue_;
-  int samples_to_next_step_;
+  ThreadPool* const thread_pool_;
+  // The scaled samples from the start of the next frame onwards, or the
+  // samples not yet used by any frame.
+  std::vector<float> pending_samples_;
+  // The offset of the next frame in pending_samples_, which may be past its
+  // end if the hop is longer than the frame.
+  int next_frame_start_ = 0;
+  // The Hanning window and the FFT configurations, which are created once and
+  // reused for every frame. There is one FFT configuration per thread which
+  // may compute frames, since kissfft keeps its scratch buffer in it.
+  std::vector<float> hanning_window_;
+  std::vector<kiss_fftr_cfg> fft_configs_;
 };
 
 }  // namespace litert::lm
@@ -39,6 +39,7 @@
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/preprocessor/audio_preprocessor.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/util/status_macros.h"
 #include "runtime/util/test_utils.h"  // NOLINT
 
@@ -315,6 +316,71 @@ TEST(AudioPreprocessorMiniAudioTest, UsmPreprocessingTwice) {
   }
 }
 
+TEST(AudioPreprocessorMiniAudioTest, PushPcmFramesMatchesPreprocess) {
+  AudioPreprocessorConfig config =
+      AudioPreprocessorConfig::CreateDefaultUsmConfig();
+  ASSERT_OK_AND_ASSIGN(auto raw_audio_data, GetRawAudioData());
+  std::vector<float> pcm_frames;
+  ASSERT_OK(AudioPreprocessorMiniAudio::DecodeAudio(
+      raw_audio_data, config.GetNumChannels(), config.GetSampleRateHz(),
+      pcm_frames));
+
+  ASSERT_OK_AND_ASSIGN(auto preprocessor,
+                       AudioPreprocessorMiniAudio::Create(config));
+  ASSERT_OK_AND_ASSIGN(auto preprocessed_audio,
+                       preprocessor->Preprocess(InputAudio(raw_audio_data)));
+  ASSERT_OK_AND_ASSIGN(auto preprocessed_mel_spectrogram_tensor,
+                       preprocessed_audio.GetPreprocessedAudioTensor());
+  ASSERT_OK_AND_ASSIGN(
+      auto preprocessed_mel_spectrogram,
+      GetDataAsVector<float>(*preprocessed_mel_spectrogram_tensor));
+
+  // Push the PCM frames in chunks of 10ms, which are smaller than a frame.
+  preprocessor->Reset();
+  const int chunk_size = config.GetSampleRateHz() / 100;
+  std::vector<float> streamed_mel_spectrogram;
+  for (int start = 0; start < pcm_frames.size(); start += chunk_size) {
+    ASSERT_OK(preprocessor->PushPcmFrames(
+        absl::MakeConstSpan(pcm_frames).subspan(start, chunk_size),
+        streamed_mel_spectrogram));
+  }
+
+  ASSERT_EQ(streamed_mel_spectrogram.size(),
+            preprocessed_mel_spectrogram.size());
+  for (int i = 0; i < streamed_mel_spectrogram.size(); ++i) {
+    EXPECT_FLOAT_EQ(streamed_mel_spectrogram[i],
+                    preprocessed_mel_spectrogram[i]);
+  }
+}
+
+TEST(AudioPreprocessorMiniAudioTest, PushPcmFramesOnThreadPoolMatches) {
+  AudioPreprocessorConfig config =
+      AudioPreprocessorConfig::CreateDefaultUsmConfig();
+  ASSERT_OK_AND_ASSIGN(auto raw_audio_data, GetRawAudioData());
+  std::vector<float> pcm_frames;
+  ASSERT_OK(AudioPreprocessorMiniAudio::DecodeAudio(
+      raw_audio_data, config.GetNumChannels(), config.GetSampleRateHz(),
+      pcm_frames));
+
+  ASSERT_OK_AND_ASSIGN(auto preprocessor,
+                       AudioPreprocessorMiniAudio::Create(config));
+  std::vector<float> mel_spectrogram;
+  ASSERT_OK(preprocessor->PushPcmFrames(pcm_frames, mel_spectrogram));
+
+  // The frames are split across threads, and each frame is computed the same
+  // way regardless.
+  ThreadPool thread_pool(/*name_prefix=*/"audio", /*max_num_threads=*/3);
+  ASSERT_OK_AND_ASSIGN(
+      auto parallel_preprocessor,
+      AudioPreprocessorMiniAudio::Create(config, &thread_pool));
+  std::vector<float> parallel_mel_spectrogram;
+  ASSERT_OK(parallel_preprocessor->PushPcmFrames(pcm_frames,
+                                                 parallel_mel_spectrogram));
+
+  ASSERT_FALSE(mel_spectrogram.empty());
+  EXPECT_EQ(parallel_mel_spectrogram, mel_spectrogram);
+}
+
 #endif  // !defined(WIN32) && !defined(_WIN32) && !defined(__WIN32__) &&
         // !defined(__NT__) && !defined(_WIN64)
 
@@ -146,6 +146,36 @@ absl::Status MelFilterbank::Initialize(int fft_length, double sample_rate,
                       << " upper_frequency_limit: " << upper_frequency_limit;
   }
 
+  // Gathers the weights of every mel channel, whose FFT bins are contiguous
+  // since band_mapper_ is non-decreasing: the left side of the triangle of
+  // channel c comes from the bins mapped to c - 1, and the right side from
+  // the bins mapped to c.
+  channel_start_bin_.assign(num_mel_channels_, start_index_);
+  sparse_offsets_.assign(num_mel_channels_ + 1, 0);
+  sparse_weights_.clear();
+  for (int c = 0; c < num_mel_channels_; ++c) {
+    sparse_offsets_[c] = sparse_weights_.size();
+    bool found_start = false;
+    for (int i = start_index_; i <= end_index_; ++i) {
+      float weight;
+      if (band_mapper_[i] == c - 1) {
+        weight = 1.0 - weights_[i];
+      } else if (band_mapper_[i] == c) {
+        weight = weights_[i];
+      } else if (found_start) {
+        break;
+      } else {
+        continue;
+      }
+      if (!found_start) {
+        channel_start_bin_[c] = i;
+        found_start = true;
+      }
+      sparse_weights_.push_back(weight);
+    }
+  }
+  sparse_offsets_[num_mel_channels_] = sparse_weights_.size();
+
   initialized_ = true;
   return absl::OkStatus();
 }
@@ -180,6 +210,34 @@ absl::Status MelFilterbank::ToMelSpectrum(
   return absl::OkStatus();
 }
 
+absl::Status MelFilterbank::MagnitudeToMelSpectrum(
+    absl::Span<const float> magnitude_fft, absl::Span<float> mel) const {
+  if (!initialized_) {
+    return absl::InternalError("Mel Filterbank not initialized.");
+  }
+
+  if (magnitude_fft.size() <= end_index_) {
+    return absl::InternalError("FFT too short to compute filterbank");
+  }
+
+  if (mel.size() != num_mel_channels_) {
+    return absl::InternalError(
+        "Mel size does not match number of mel channels.");
+  }
+
+  for (int c = 0; c < num_mel_channels_; ++c) {
+    const float* spec = magnitude_fft.data() + channel_start_bin_[c];
+    const float* weights = sparse_weights_.data() + sparse_offsets_[c];
+    const int num_weights = sparse_offsets_[c + 1] - sparse_offsets_[c];
+    float sum = 0.0f;
+    for (int i = 0; i < num_weights; ++i) {
+      sum += spec[i] * weights[i];
+    }
+    mel[c] = sum;
+  }
+  return absl::OkStatus();
+}
+
 absl::Status MelFilterbank::ToSquaredMagnitudeFft(
     absl::Span<const double> mel,
     std::vector<double>* squared_magnitude_fft) const {
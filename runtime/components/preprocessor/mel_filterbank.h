@@ -52,6 +52,17 @@ class MelFilterbank {
   absl::Status ToMelSpectrum(absl::Span<const double> squared_magnitude_fft,
                              std::vector<double>* mel) const;
 
+  // Same as above in single precision, for frames computed in float, but takes
+  // the linear magnitudes: each FFT bin is under two mel triangles, so the
+  // caller takes its square root once. The filterbank is applied as a sparse
+  // matrix whose rows are the contiguous FFT bins under each mel triangle.
+  // Args:
+  // - magnitude_fft: Linear-magnitude spectrogram slice, i.e. the square roots
+  //  of the squared-magnitude spectrogram slice above.
+  // - mel: Output Mel spectrum. Must hold exactly `mel_channel_count` values.
+  absl::Status MagnitudeToMelSpectrum(absl::Span<const float> magnitude_fft,
+                                      absl::Span<float> mel) const;
+
   // Takes a triangular-mel-weighted linear-magnitude filterbank and estimates
   // the squared-magnitude spectrogram slice that corresponds to it. This is
   // merely an estimate, so ToMelSpectrum() followed by ToSquaredMagnitudeFft()
@@ -88,6 +99,14 @@ class MelFilterbank {
   // weights on both the left and right sides of the triangle.
   std::vector<double> channel_weights_sum_;
 
+  // The filterbank as a sparse matrix in float, in compressed sparse row
+  // format. Mel channel c sums FFT bins channel_start_bin_[c] onwards, with
+  // weights sparse_weights_[sparse_offsets_[c]] to
+  // sparse_weights_[sparse_offsets_[c + 1] - 1].
+  std::vector<int> channel_start_bin_;
+  std::vector<int> sparse_offsets_;
+  std::vector<float> sparse_weights_;
+
   int start_index_;  // Lowest FFT bin used to calculate mel spectrum.
   int end_index_;    // Highest FFT bin used to calculate mel spectrum.
 
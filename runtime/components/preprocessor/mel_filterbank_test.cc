@@ -21,6 +21,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/random/random.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "runtime/components/preprocessor/signal_vector_util.h"
 #include "runtime/util/test_utils.h"  // NOLINT
 
@@ -161,6 +162,41 @@ TEST(MelFilterbankTest, UpperEdgeAtFftBintIsOk) {
   ASSERT_EQ(output.size(), kChannelCount);
 }
 
+TEST(MelFilterbankTest, FloatAgreesWithDouble) {
+  // The USM configuration, i.e. an FFT size of 1024 at 16kHz.
+  MelFilterbank filterbank;
+  const int kSampleCount = 513;
+  const int kChannelCount = 128;
+  ASSERT_OK(filterbank.Initialize(kSampleCount, /*sample_rate=*/16000,
+                                  kChannelCount,
+                                  /*lower_frequency_limit=*/125.0,
+                                  /*upper_frequency_limit=*/7500.0));
+
+  absl::BitGen gen;
+  std::vector<double> input(kSampleCount);
+  std::vector<float> float_input(kSampleCount);
+  for (int i = 0; i < kSampleCount; ++i) {
+    input[i] = absl::Uniform<double>(gen, 0.0, 100.0);
+    float_input[i] = std::sqrt(input[i]);
+  }
+  std::vector<double> output;
+  ASSERT_OK(filterbank.ToMelSpectrum(input, &output));
+  std::vector<float> float_output(kChannelCount);
+  ASSERT_OK(filterbank.MagnitudeToMelSpectrum(float_input,
+                                              absl::MakeSpan(float_output)));
+
+  for (int i = 0; i < kChannelCount; ++i) {
+    EXPECT_NEAR(float_output[i], output[i], 1e-5 * (1 + output[i]));
+  }
+
+  // The output must have exactly one value per channel.
+  std::vector<float> short_output(kChannelCount - 1);
+  EXPECT_FALSE(filterbank
+                   .MagnitudeToMelSpectrum(float_input,
+                                           absl::MakeSpan(short_output))
+                   .ok());
+}
+
 TEST(MelFilterbankTest, InverseIsCloseToOriginal) {
   MelFilterbank filterbank;
 
@@ -34,6 +34,7 @@
 #include "runtime/components/sampler.h"
 #include "runtime/components/top_p_cpu_sampler.h"
 #include "runtime/executor/executor_settings_base.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/proto/sampler_params.pb.h"
 #include "runtime/util/status_macros.h"  // IWYU pragma: keep
 
@@ -303,7 +304,8 @@ class TopKWebGpuCApiSampler : public TopKCApiSampler {
 };
 
 absl::StatusOr<std::unique_ptr<Sampler>> CreateCpuSampler(
-    int batch_size, proto::SamplerParameters sampler_params) {
+    int batch_size, proto::SamplerParameters sampler_params,
+    ThreadPool* thread_pool) {
   switch (sampler_params.type()) {
     case proto::SamplerParameters::TYPE_UNSPECIFIED:
       ABSL_LOG(INFO) << "Sampler type is unspecified. Assume the LLM Executor "
@@ -312,7 +314,7 @@ absl::StatusOr<std::unique_ptr<Sampler>> CreateCpuSampler(
     case proto::SamplerParameters::TOP_P:
       return TopPSampler::Create(sampler_params.k(), sampler_params.p(),
                                  sampler_params.temperature(), batch_size,
-                                 sampler_params.seed());
+                                 sampler_params.seed(), thread_pool);
     default:
       return absl::UnimplementedError(absl::StrCat(
           "Sampler type: ", sampler_params.type(), " not implemented yet."));
@@ -378,7 +380,8 @@ absl::StatusOr<std::unique_ptr<Sampler>> CreateGpuSampler(
 absl::StatusOr<std::unique_ptr<Sampler>> CreateSampler(
     Backend backend, int batch_size, proto::SamplerParameters sampler_params,
     LiteRtEnvironment env, std::optional<int> vocab_size,
-    std::optional<ActivationDataType> activation_data_type) {
+    std::optional<ActivationDataType> activation_data_type,
+    ThreadPool* thread_pool) {
   switch (backend) {
     case Backend::GPU: {
       RET_CHECK(env != nullptr)
@@ -402,7 +405,7 @@ absl::StatusOr<std::unique_ptr<Sampler>> CreateSampler(
       ABSL_FALLTHROUGH_INTENDED;
     }
     case Backend::CPU:
-      return CreateCpuSampler(batch_size, sampler_params);
+      return CreateCpuSampler(batch_size, sampler_params, thread_pool);
     default:
       return absl::InvalidArgumentError(
           absl::StrCat("Unsupported backend: ", backend));
@@ -21,6 +21,7 @@
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "runtime/components/sampler.h"
 #include "runtime/executor/executor_settings_base.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/proto/sampler_params.pb.h"
 
 namespace litert::lm {
@@ -35,6 +36,9 @@ namespace litert::lm {
 //   env: The litert environment to use for the sampler.
 //   vocab_size: The vocabulary size for the sampler.
 //   activation_data_type: The activation data type for the sampler.
+//   The following parameter is optional and only used for CPU backend.
+//   thread_pool: The thread pool to sample the batches on. It must outlive the
+//     sampler.
 //
 // Returns:
 //   The created Sampler instance.
@@ -42,7 +46,8 @@ absl::StatusOr<std::unique_ptr<Sampler>> CreateSampler(
     Backend backend, int batch_size, proto::SamplerParameters sampler_params,
     LiteRtEnvironment env = nullptr,
     std::optional<int> vocab_size = std::nullopt,
-    std::optional<ActivationDataType> activation_data_type = std::nullopt);
+    std::optional<ActivationDataType> activation_data_type = std::nullopt,
+    ThreadPool* thread_pool = nullptr);
 
 }  // namespace litert::lm
 
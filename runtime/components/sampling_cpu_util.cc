@@ -21,8 +21,15 @@
 #include <limits>
 #include <numeric>
 #include <random>
+#include <utility>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #include "absl/random/random.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
@@ -31,47 +38,201 @@
 #include "absl/types/span.h"  // from @com_google_absl
 
 namespace litert::lm {
+namespace {
+
+// The number of logits scanned at once when looking for the largest logits.
+constexpr int kScanBlockSize = 64;
+
+// When k is larger than 1/kMinVocabSizeToTopKRatio of the vocab, a large part
+// of the logits end up in the top k and a bounded heap is slower than
+// partitioning all the logits.
+constexpr int kMinVocabSizeToTopKRatio = 16;
+
+// Returns the maximum of the kScanBlockSize values starting at `data`.
+inline float BlockMax(const float* data) {
+#if defined(__AVX2__)
+  __m256 max0 = _mm256_loadu_ps(data);
+  __m256 max1 = _mm256_loadu_ps(data + 8);
+  for (int i = 16; i < kScanBlockSize; i += 16) {
+    max0 = _mm256_max_ps(max0, _mm256_loadu_ps(data + i));
+    max1 = _mm256_max_ps(max1, _mm256_loadu_ps(data + i + 8));
+  }
+  max0 = _mm256_max_ps(max0, max1);
+  __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(max0),
+                           _mm256_extractf128_ps(max0, 1));
+  max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+  max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, 1));
+  return _mm_cvtss_f32(max4);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  float32x4_t max0 = vld1q_f32(data);
+  float32x4_t max1 = vld1q_f32(data + 4);
+  for (int i = 8; i < kScanBlockSize; i += 8) {
+    max0 = vmaxq_f32(max0, vld1q_f32(data + i));
+    max1 = vmaxq_f32(max1, vld1q_f32(data + i + 4));
+  }
+  return vmaxvq_f32(vmaxq_f32(max0, max1));
+#else
+  // Independent lanes, which the compiler can map to SIMD max instructions.
+  float max_values[8];
+  std::copy(data, data + 8, max_values);
+  for (int i = 8; i < kScanBlockSize; i += 8) {
+    for (int j = 0; j < 8; ++j) {
+      max_values[j] = data[i + j] > max_values[j] ? data[i + j] : max_values[j];
+    }
+  }
+  return *std::max_element(max_values, max_values + 8);
+#endif
+}
+
+// Returns the index of the first largest logit.
+int ArgMax(absl::Span<const float> logits) {
+  float max_value = logits[0];
+  // The start of the block holding the first largest logit.
+  int max_block_start = 0;
+  int i = 0;
+  for (; i + kScanBlockSize <= logits.size(); i += kScanBlockSize) {
+    const float block_max = BlockMax(logits.data() + i);
+    if (block_max > max_value) {
+      max_value = block_max;
+      max_block_start = i;
+    }
+  }
+  for (int j = max_block_start; j < i; ++j) {
+    if (logits[j] == max_value) {
+      max_block_start = j;
+      break;
+    }
+  }
+  int max_index = max_block_start;
+  for (; i < logits.size(); ++i) {
+    if (logits[i] > max_value) {
+      max_value = logits[i];
+      max_index = i;
+    }
+  }
+  return max_index;
+}
+
+absl::Status ValidateSamplingInputs(absl::Span<const float> logits, int k,
+                                    float p, float temperature,
+                                    int batch_size) {
+  if (logits.empty()) {
+    return absl::InvalidArgumentError("Logits vector cannot be empty.");
+  }
+  if (batch_size <= 0) {
+    return absl::InvalidArgumentError("batch_size must be greater than 0.");
+  }
+  if (logits.size() % batch_size != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Logits vector size must be a multiple of batch "
+                        "size. But got %d and "
+                        "%d.",
+                        logits.size(), batch_size));
+  }
+  if (k <= 0) {
+    return absl::InvalidArgumentError("k must be greater than 0.");
+  }
+  if (p < 0.0 || p > 1.0) {
+    return absl::InvalidArgumentError("p must be in the range [0.0, 1.0].");
+  }
+  if (temperature < 0.0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Temperature must be >= 0, but got ", temperature));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+void TopKLogits(absl::Span<const float> logits, int k,
+                std::vector<std::pair<float, int>>& topk) {
+  const int vocab_size = logits.size();
+  k = std::min(k, vocab_size);
+  topk.clear();
+  if (k <= 0) {
+    return;
+  }
+  if (k == 1) {
+    const int max_index = ArgMax(logits);
+    topk.emplace_back(logits[max_index], max_index);
+    return;
+  }
+  if (k > vocab_size / kMinVocabSizeToTopKRatio) {
+    for (int i = 0; i < vocab_size; ++i) {
+      topk.emplace_back(logits[i], i);
+    }
+    std::nth_element(topk.begin(), topk.begin() + k - 1, topk.end(),
+                     RanksBefore);
+    topk.resize(k);
+    std::sort(topk.begin(), topk.end(), RanksBefore);
+    return;
+  }
+
+  // A heap of the top k pairs seen so far. The front is the pair ranking last,
+  // whose logit is the threshold to enter the top k.
+  for (int i = 0; i < k; ++i) {
+    topk.emplace_back(logits[i], i);
+  }
+  std::make_heap(topk.begin(), topk.end(), RanksBefore);
+  float threshold = topk.front().first;
+  auto maybe_push = [&logits, &topk, &threshold](int i) {
+    // A later token id with the same logit ranks after the whole heap.
+    if (logits[i] > threshold) {
+      std::pop_heap(topk.begin(), topk.end(), RanksBefore);
+      topk.back() = {logits[i], i};
+      std::push_heap(topk.begin(), topk.end(), RanksBefore);
+      threshold = topk.front().first;
+    }
+  };
+  int i = k;
+  for (; i + kScanBlockSize <= vocab_size; i += kScanBlockSize) {
+    if (BlockMax(logits.data() + i) <= threshold) {
+      continue;
+    }
+    for (int j = i; j < i + kScanBlockSize; ++j) {
+      maybe_push(j);
+    }
+  }
+  for (; i < vocab_size; ++i) {
+    maybe_push(i);
+  }
+  std::sort_heap(topk.begin(), topk.end(), RanksBefore);
+}
 
 absl::StatusOr<std::vector<int>> TopKTokenIds(absl::Span<const float> logits,
                                               int k, int batch_size) {
-  if (logits.size() % batch_size != 0) {
+  if (batch_size <= 0 || logits.size() % batch_size != 0) {
     return absl::InvalidArgumentError(
         absl::StrFormat("Logits vector size must be a multiple of batch "
                         "size. But got %d and "
                         "%d.",
                         logits.size(), batch_size));
   }
+  if (k <= 0) {
+    return absl::InvalidArgumentError("k must be greater than 0.");
+  }
   const int vocab_size = logits.size() / batch_size;
-  std::vector<int> output_indices(batch_size * k);
-  if (k == 1) {  // Greedy sampling. Use std::max_element to be more efficient.
+  if (k >= vocab_size) {
+    // All the token ids are in the top k.
+    std::vector<int> output_indices(batch_size * vocab_size);
     for (int b = 0; b < batch_size; ++b) {
-      auto max_iterator =
-          std::max_element(logits.begin() + b * vocab_size,
-                           logits.begin() + (b + 1) * vocab_size);
-      // Gets the index of the max element in the logits of each batch.
-      const int max_logit_idx =
-          std::distance(logits.begin() + b * vocab_size, max_iterator);
-      output_indices[b] = max_logit_idx;
+      std::iota(output_indices.begin() + b * vocab_size,
+                output_indices.begin() + (b + 1) * vocab_size, 0);
     }
-  } else {
-    std::vector<int> indices(vocab_size);
+    return output_indices;
+  }
+  std::vector<int> output_indices(batch_size * k);
+  if (k == 1) {  // Greedy sampling.
     for (int b = 0; b < batch_size; ++b) {
-      // Fill with 0, 1, 2,...
-      std::iota(indices.begin(), indices.end(), 0);
-
-      // Define the comparator for descending probability
-      auto desc_prob_comp = [&logits, vocab_size, b](int i1, int i2) {
-        return logits[b * vocab_size + i1] > logits[b * vocab_size + i2];
-      };
-      // Partition Top-K.
-      // O(N) average time complexity.
-      // Rearranges 'indices' such that the k elements with the highest
-      // probabilities are in the range [indices.begin(), indices.begin() +
-      // k). The element at indices[k] is not necessarily the (k+1)th largest.
-      std::nth_element(indices.begin(), indices.begin() + k, indices.end(),
-                       desc_prob_comp);
-      std::copy(indices.begin(), indices.begin() + k,
-                output_indices.begin() + b * k);
+      output_indices[b] = ArgMax(logits.subspan(b * vocab_size, vocab_size));
+    }
+    return output_indices;
+  }
+  std::vector<std::pair<float, int>> topk;
+  for (int b = 0; b < batch_size; ++b) {
+    TopKLogits(logits.subspan(b * vocab_size, vocab_size), k, topk);
+    for (int i = 0; i < k; ++i) {
+      output_indices[b * k + i] = topk[i].second;
     }
   }
   return output_indices;
@@ -154,105 +315,127 @@ absl::StatusOr<std::vector<float>> Softmax(
 absl::StatusOr<std::vector<int>> TopKTopPSampling(
     absl::Span<const float> logits, int k, float p, float temperature,
     absl::BitGen& rng, int batch_size, std::vector<float>& sampled_scores) {
-  if (logits.empty()) {
-    return absl::InvalidArgumentError("Logits vector cannot be empty.");
+  auto status = ValidateSamplingInputs(logits, k, p, temperature, batch_size);
+  if (!status.ok()) {
+    return status;
   }
-  if (logits.size() % batch_size != 0) {
-    return absl::InvalidArgumentError(
-        absl::StrFormat("Logits vector size must be a multiple of batch "
-                        "size. But got %d and "
-                        "%d.",
-                        logits.size(), batch_size));
+  TopKTopPSamplingScratch scratch;
+  std::vector<int> sampled_ids(batch_size);
+  sampled_scores.resize(batch_size);
+  status = TopKTopPSampling(logits, k, p, temperature, rng, batch_size,
+                            scratch, absl::MakeSpan(sampled_ids),
+                            absl::MakeSpan(sampled_scores));
+  if (!status.ok()) {
+    return status;
   }
-  if (k <= 0) {
-    return absl::InvalidArgumentError("k must be greater than 0.");
+  return sampled_ids;
+}
+
+absl::Status TopKTopPSampling(absl::Span<const float> logits, int k, float p,
+                              float temperature, absl::BitGen& rng,
+                              int batch_size, TopKTopPSamplingScratch& scratch,
+                              absl::Span<int> sampled_ids,
+                              absl::Span<float> sampled_scores) {
+  auto status = ValidateSamplingInputs(logits, k, p, temperature, batch_size);
+  if (!status.ok()) {
+    return status;
   }
-  if (p < 0.0 || p > 1.0) {
-    return absl::InvalidArgumentError("p must be in the range [0.0, 1.0].");
+  if (sampled_ids.size() != batch_size || sampled_scores.size() != batch_size) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Sampled ids and scores must have the batch size %d, but got %d and "
+        "%d.",
+        batch_size, sampled_ids.size(), sampled_scores.size()));
   }
   const int vocab_size = logits.size() / batch_size;
   // Ensure k is not larger than the number of probabilities
   k = std::min(k, vocab_size);
+  for (int b = 0; b < batch_size; ++b) {
+    absl::Span<const float> batch_logits =
+        logits.subspan(b * vocab_size, vocab_size);
+    if (k == 1) {  // Greedy sampling.
+      sampled_ids[b] = ArgMax(batch_logits);
+      sampled_scores[b] = 1.0f;
+      continue;
+    }
 
-  auto topk_token_ids = TopKTokenIds(logits, k, batch_size);
-  if (!topk_token_ids.ok()) return topk_token_ids.status();
-
-  std::vector<float> max_logit_values;
-  auto probabilities = Softmax(logits, *topk_token_ids, temperature, batch_size,
-                               max_logit_values);
-  if (!probabilities.ok()) return probabilities.status();
+    // Top-K, sorted by descending logit, i.e. descending probability.
+    TopKLogits(batch_logits, k, scratch.topk);
+    sampled_ids[b] =
+        SampleFromTopKLogits(scratch.topk, p, temperature, rng,
+                             scratch.probabilities, sampled_scores[b]);
+  }
+  return absl::OkStatus();
+}
 
-  std::vector<int> sampled_ids;
-  if (k == 1) {  // Greedy sampling. Return the topk_token_ids directly.
-    sampled_ids.assign(topk_token_ids->begin(), topk_token_ids->end());
-    sampled_scores = std::vector<float>(batch_size, 1.0f);
-    return sampled_ids;
+int SampleFromTopKLogits(absl::Span<const std::pair<float, int>> topk, float p,
+                         float temperature, absl::BitGen& rng,
+                         std::vector<float>& probabilities,
+                         float& sampled_score) {
+  const int k = topk.size();
+  if (k == 1) {
+    sampled_score = 1.0f;
+    return topk[0].second;
   }
-  sampled_ids.resize(batch_size);
-  sampled_scores.resize(batch_size);
-  float current_temp =
+  const float current_temp =
       std::max(temperature, std::numeric_limits<float>::epsilon());
-  for (int b = 0; b < batch_size; ++b) {
-    // Define the comparator for descending probability
-    auto desc_prob_comp = [&probabilities, b, k](int i1, int i2) {
-      return (*probabilities)[b * k + i1] > (*probabilities)[b * k + i2];
-    };
-
-    // Sort Only the Top-K.
-    // O(k log k) time complexity.
-    // Sorts the indices of the top k elements based on their probabilities.
-    // - index_of_topk[i] stores the offset within the current batch's top-k
-    // range.
-    // - probabilities[b*k + index_of_topk[i]] is the probability of the i-th
-    // largest element.
-    // - topk_token_ids[b*k + index_of_topk[i]] is the actual token ID of the
-    // i-th largest element.
-    std::vector<int> index_of_topk(k);
-    std::iota(index_of_topk.begin(), index_of_topk.end(), 0);
-    std::sort(index_of_topk.begin(), index_of_topk.end(), desc_prob_comp);
-
-    // Determine Top-P Cutoff Index within Top-K.
-    // O(k) time complexity.
-    double cumulative_prob = 0.0;
-    int final_sample_size = 0;  // Actual number of elements to sample from
 
+  // Softmax over the top k.
+  const float max_logit_value = topk[0].first;
+  probabilities.resize(k);
+  // Sum from the smallest probability up, which loses the least precision.
+  float sum_of_exps = 0.0;
+  for (int i = k - 1; i >= 0; --i) {
+    probabilities[i] =
+        std::exp((topk[i].first - max_logit_value) / current_temp);
+    sum_of_exps += probabilities[i];
+  }
+  if (sum_of_exps <= std::numeric_limits<float>::epsilon()) {
+    // Handle potential zero sum (uniform distribution fallback)
+    std::fill(probabilities.begin(), probabilities.end(),
+              1.0 / static_cast<float>(k));
+  } else if (std::isinf(sum_of_exps)) {
+    // Handle inf sum which is caused by very small temperature.
+    std::fill(probabilities.begin(), probabilities.end(), 0.0f);
+    probabilities[0] = 1.0f;
+  } else {
+    float inv_sum = 1.0 / sum_of_exps;
     for (int i = 0; i < k; ++i) {
-      // Check if adding this probability would exceed the threshold p. It
-      // stops when cumulative_prob >= p.
-      cumulative_prob += (*probabilities)[b * k + index_of_topk[i]];
-      final_sample_size = i + 1;  // Include this element
-
-      if (cumulative_prob >= p) {
-        break;  // Found the smallest set within Top-K satisfying Top-P
-      }
+      probabilities[i] *= inv_sum;
     }
-    // final_sample_size now holds min(p_cutoff_within_top_k, k)
+  }
 
-    // Handle Edge Case: Cumulative Probability is Zero.
-    if (cumulative_prob <= std::numeric_limits<double>::epsilon()) {
-      // Fallback: Return the index with the absolute highest probability
-      // (indices[0] after sorting top-k).
-      sampled_ids[b] = (*topk_token_ids)[b * k + index_of_topk[0]];
-      sampled_scores[b] = std::exp(
-          (logits[b * vocab_size + sampled_ids[b]] - max_logit_values[b]) /
-          current_temp);
-      continue;
+  // Determine Top-P Cutoff Index within Top-K. It stops when
+  // cumulative_prob >= p.
+  double cumulative_prob = 0.0;
+  int final_sample_size = 0;  // Actual number of elements to sample from
+  for (int i = 0; i < k; ++i) {
+    cumulative_prob += probabilities[i];
+    final_sample_size = i + 1;
+    if (cumulative_prob >= p) {
+      break;
     }
+  }
 
-    // O(final_sample_size) which is O(k) time complexity.
-    std::uniform_real_distribution<double> dist(0.0, cumulative_prob);
-    double random_sample = dist(rng);
-    double current_cumulative = 0.0;
-    for (int i = 0; i < final_sample_size; ++i) {
-      current_cumulative += (*probabilities)[b * k + index_of_topk[i]];
-      if (random_sample <= current_cumulative) {
-        sampled_ids[b] = (*topk_token_ids)[b * k + index_of_topk[i]];
-        sampled_scores[b] = (*probabilities)[b * k + index_of_topk[i]];
-        break;
-      }
+  // Handle Edge Case: Cumulative Probability is Zero.
+  if (cumulative_prob <= std::numeric_limits<double>::epsilon()) {
+    // Fallback: Return the token with the highest probability.
+    sampled_score =
+        std::exp((topk[0].first - max_logit_value) / current_temp);
+    return topk[0].second;
+  }
+
+  std::uniform_real_distribution<double> dist(0.0, cumulative_prob);
+  double random_sample = dist(rng);
+  double current_cumulative = 0.0;
+  for (int i = 0; i < final_sample_size; ++i) {
+    current_cumulative += probabilities[i];
+    if (random_sample <= current_cumulative) {
+      sampled_score = probabilities[i];
+      return topk[i].second;
     }
   }
-  return sampled_ids;
+  sampled_score = probabilities[final_sample_size - 1];
+  return topk[final_sample_size - 1].second;
 }
 
 }  // namespace litert::lm
@@ -15,9 +15,11 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_SAMPLING_CPU_UTIL_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_SAMPLING_CPU_UTIL_H_
 
+#include <utility>
 #include <vector>
 
 #include "absl/random/random.h"  // from @com_google_absl
+#include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/types/span.h"  // from @com_google_absl
 
@@ -28,7 +30,10 @@ namespace litert::lm {
 //     [batch_size, vocab_size].
 //   - k: the number of top k.
 //   - batch_size: the batch size of the logits.
-// The output is a vector of token ids of shape [batch_size, k].
+// The output is a vector of token ids of shape [batch_size, k]. The token ids
+// of each batch are in descending order of the logits, except when k is not
+// less than the vocab size, in which case all the token ids are returned in
+// ascending order.
 absl::StatusOr<std::vector<int>> TopKTokenIds(absl::Span<const float> logits,
                                               int k, int batch_size = 1);
 
@@ -64,6 +69,59 @@ absl::StatusOr<std::vector<int>> TopKTopPSampling(
     absl::Span<const float> logits, int k, float p, float temperature,
     absl::BitGen& rng, int batch_size, std::vector<float>& sampled_scores);
 
+// The scratch buffers of TopKTopPSampling(). Reusing them across the calls
+// avoids allocating memory on every decode step.
+struct TopKTopPSamplingScratch {
+  // The top k (logit, token id) pairs of a batch, the largest logit first.
+  std::vector<std::pair<float, int>> topk;
+  // The probabilities of the top k tokens of a batch.
+  std::vector<float> probabilities;
+};
+
+// Same as above, but writes the sampled ids and scores of shape [batch_size]
+// to the given spans, and keeps the intermediate results in `scratch`.
+//
+// The top k logits are selected with a bounded heap. The logits are scanned in
+// blocks, and a block is skipped if its maximum (computed with AVX2 or NEON
+// when available) does not exceed the smallest logit in the heap, which is the
+// common case for large vocabularies. Ties are broken by the smaller token id.
+// The results are not bit-exact with older versions: the order of equal logits
+// used to be unspecified, and the softmax sum, which is now accumulated from
+// the smallest probability up, used to follow the order of a partition of the
+// logits. The scores may thus differ from Softmax() in the last bits.
+absl::Status TopKTopPSampling(absl::Span<const float> logits, int k, float p,
+                              float temperature, absl::BitGen& rng,
+                              int batch_size, TopKTopPSamplingScratch& scratch,
+                              absl::Span<int> sampled_ids,
+                              absl::Span<float> sampled_scores);
+
+// The building blocks of TopKTopPSampling() for a single batch, for callers
+// which split the work, e.g. across threads.
+
+// Returns true if the (logit, token id) pair `a` ranks before `b`, i.e. it has
+// a larger logit, or the same logit and a smaller token id. This is the order
+// of the pairs returned by TopKLogits().
+inline bool RanksBefore(const std::pair<float, int>& a,
+                        const std::pair<float, int>& b) {
+  return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+// Selects the top k logits of a single batch, as (logit, token id) pairs sorted
+// by descending logit and then ascending token id. k must be positive, and is
+// clamped to the number of logits. The capacity of `topk` is reused.
+void TopKLogits(absl::Span<const float> logits, int k,
+                std::vector<std::pair<float, int>>& topk);
+
+// Samples a token id of a single batch from its top k (logit, token id) pairs,
+// sorted as returned by TopKLogits(). `topk` must not be empty, p must be in
+// [0, 1] and temperature must be >= 0. Draws one number from `rng` unless there
+// is a single candidate. `probabilities` is scratch space. Returns the sampled
+// token id and writes its probability to `sampled_score`.
+int SampleFromTopKLogits(absl::Span<const std::pair<float, int>> topk, float p,
+                         float temperature, absl::BitGen& rng,
+                         std::vector<float>& probabilities,
+                         float& sampled_score);
+
 }  // namespace litert::lm
 
 #endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_SAMPLING_CPU_UTIL_H_
@@ -14,6 +14,9 @@
 
 #include "runtime/components/sampling_cpu_util.h"
 
+#include <algorithm>
+#include <numeric>
+#include <utility>
 #include <vector>
 
 #include <gmock/gmock.h>
@@ -43,6 +46,45 @@ TEST(SamplingCpuUtilTest, TopKTokenIds_BatchSize2) {
   EXPECT_THAT(*topk_token_ids, ElementsAre(1, 0));
 }
 
+TEST(SamplingCpuUtilTest, TopKTokenIds_LargeVocabMatchesSort) {
+  // A vocab with many ties, so that the order of equal logits is exercised.
+  constexpr int kVocabSize = 1000;
+  std::vector<float> logits(2 * kVocabSize);
+  for (int i = 0; i < logits.size(); ++i) {
+    logits[i] = (i * 7919) % 97 / 10.0f;
+  }
+  // Small k goes through the bounded heap, large k through a partition.
+  for (int k : {1, 2, 10, 64, 500}) {
+    auto topk_token_ids =
+        TopKTokenIds(absl::MakeConstSpan(logits), k, /*batch_size=*/2);
+    ASSERT_TRUE(topk_token_ids.ok());
+    ASSERT_EQ(topk_token_ids->size(), 2 * k);
+    for (int b = 0; b < 2; ++b) {
+      const float* row = logits.data() + b * kVocabSize;
+      std::vector<int> expected(kVocabSize);
+      std::iota(expected.begin(), expected.end(), 0);
+      std::stable_sort(expected.begin(), expected.end(),
+                       [row](int a, int b) { return row[a] > row[b]; });
+      expected.resize(k);
+      EXPECT_EQ(std::vector<int>(topk_token_ids->begin() + b * k,
+                                 topk_token_ids->begin() + (b + 1) * k),
+                expected)
+          << "k=" << k << " b=" << b;
+    }
+  }
+}
+
+TEST(SamplingCpuUtilTest, TopKTokenIds_KNotSmallerThanVocabSize) {
+  const std::vector<float> logits = {0.1, 0.5, 0.4, 0.2};
+  auto topk_token_ids =
+      TopKTokenIds(absl::MakeConstSpan(logits), /*k=*/4, /*batch_size=*/2);
+  ASSERT_TRUE(topk_token_ids.ok());
+  EXPECT_THAT(*topk_token_ids, ElementsAre(0, 1, 0, 1));
+  EXPECT_FALSE(
+      TopKTokenIds(absl::MakeConstSpan(logits), /*k=*/0, /*batch_size=*/1)
+          .ok());
+}
+
 TEST(SamplingCpuUtilTest, Softmax_BatchSize1) {
   const std::vector<float> logits = {0.1f, 0.1f};
   const std::vector<int> topk_indices = {0, 1};
@@ -203,5 +245,106 @@ TEST(SamplingCpuUtilTest, TopKTopPSampling_LargeVocabIndices) {
   EXPECT_THAT(sampled_scores, ElementsAre(0.99827528f));
 }
 
+TEST(SamplingCpuUtilTest, TopKTopPSampling_ScratchMatchesVectorOutput) {
+  constexpr int kVocabSize = 4096;
+  constexpr int kBatchSize = 3;
+  std::vector<float> logits(kBatchSize * kVocabSize);
+  for (int i = 0; i < logits.size(); ++i) {
+    logits[i] = ((i * 7919) % 4099) / 400.0f;
+  }
+  absl::BitGen rng1(std::seed_seq{42});
+  absl::BitGen rng2(std::seed_seq{42});
+  TopKTopPSamplingScratch scratch;
+  std::vector<int> sampled_ids(kBatchSize);
+  std::vector<float> sampled_scores(kBatchSize);
+  for (int k : {1, 40, 1024}) {
+    std::vector<float> expected_scores;
+    auto expected_ids = TopKTopPSampling(
+        absl::MakeConstSpan(logits), k, /*p=*/0.9f, /*temperature=*/0.8f,
+        rng1, kBatchSize, expected_scores);
+    ASSERT_TRUE(expected_ids.ok());
+    // The scratch space is reused across the calls.
+    ASSERT_TRUE(TopKTopPSampling(absl::MakeConstSpan(logits), k, /*p=*/0.9f,
+                                 /*temperature=*/0.8f, rng2, kBatchSize,
+                                 scratch, absl::MakeSpan(sampled_ids),
+                                 absl::MakeSpan(sampled_scores))
+                    .ok());
+    EXPECT_EQ(sampled_ids, *expected_ids);
+    EXPECT_EQ(sampled_scores, expected_scores);
+  }
+}
+
+TEST(SamplingCpuUtilTest, TopKTopPSampling_ScoresMatchSoftmax) {
+  constexpr int kVocabSize = 1000;
+  std::vector<float> logits(kVocabSize);
+  for (int i = 0; i < logits.size(); ++i) {
+    logits[i] = ((i * 7919) % 1009) / 100.0f;
+  }
+  constexpr int kK = 40;
+  constexpr float kTemperature = 0.7f;
+  auto topk_token_ids = TopKTokenIds(absl::MakeConstSpan(logits), kK);
+  ASSERT_TRUE(topk_token_ids.ok());
+  std::vector<float> max_logit_values;
+  auto probabilities =
+      Softmax(absl::MakeConstSpan(logits), *topk_token_ids, kTemperature,
+              /*batch_size=*/1, max_logit_values);
+  ASSERT_TRUE(probabilities.ok());
+
+  absl::BitGen rng(std::seed_seq{7});
+  for (int i = 0; i < 20; ++i) {
+    std::vector<float> sampled_scores;
+    auto sampled_ids =
+        TopKTopPSampling(absl::MakeConstSpan(logits), kK, /*p=*/1.0f,
+                         kTemperature, rng, /*batch_size=*/1, sampled_scores);
+    ASSERT_TRUE(sampled_ids.ok());
+    const int index =
+        std::find(topk_token_ids->begin(), topk_token_ids->end(),
+                  (*sampled_ids)[0]) -
+        topk_token_ids->begin();
+    ASSERT_LT(index, kK);
+    // The probabilities are summed in a different order.
+    EXPECT_FLOAT_EQ(sampled_scores[0], (*probabilities)[index]);
+  }
+}
+
+TEST(SamplingCpuUtilTest, TopKTopPSampling_ScratchInvalidOutputSize) {
+  const std::vector<float> logits = {0.1, 0.5, 0.4, 0.2};
+  absl::BitGen rng;
+  TopKTopPSamplingScratch scratch;
+  std::vector<int> sampled_ids(1);
+  std::vector<float> sampled_scores(1);
+  EXPECT_FALSE(TopKTopPSampling(absl::MakeConstSpan(logits), /*k=*/2,
+                                /*p=*/0.5f, /*temperature=*/1.0f, rng,
+                                /*batch_size=*/2, scratch,
+                                absl::MakeSpan(sampled_ids),
+                                absl::MakeSpan(sampled_scores))
+                   .ok());
+}
+
+TEST(SamplingCpuUtilTest, TopKLogitsAndSampleFromTopKLogits) {
+  const std::vector<float> logits = {0.1, 0.5, 0.4, 0.5};
+  std::vector<std::pair<float, int>> topk;
+  // k is clamped to the number of logits.
+  TopKLogits(absl::MakeConstSpan(logits), /*k=*/10, topk);
+  EXPECT_THAT(topk,
+              ElementsAre(std::make_pair(0.5f, 1), std::make_pair(0.5f, 3),
+                          std::make_pair(0.4f, 2), std::make_pair(0.1f, 0)));
+
+  absl::BitGen rng;
+  std::vector<float> probabilities;
+  float sampled_score = 0.0f;
+  EXPECT_EQ(SampleFromTopKLogits(absl::MakeConstSpan(topk).subspan(0, 1),
+                                 /*p=*/0.5f, /*temperature=*/1.0f, rng,
+                                 probabilities, sampled_score),
+            1);
+  EXPECT_EQ(sampled_score, 1.0f);
+  // A tiny temperature puts all the probability mass on the top logits.
+  const int sampled_id =
+      SampleFromTopKLogits(topk, /*p=*/1.0f, /*temperature=*/1e-6f, rng,
+                           probabilities, sampled_score);
+  EXPECT_TRUE(sampled_id == 1 || sampled_id == 3);
+  EXPECT_FLOAT_EQ(sampled_score, 0.5f);
+}
+
 }  // namespace
 }  // namespace litert::lm
@@ -19,14 +19,33 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"  // from @com_google_absl
 #include "absl/memory/memory.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/numbers.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "runtime/components/streaming_detokenizer.h"
 #include "sentencepiece_processor.h"  // from @sentencepiece
 
 namespace litert::lm {
+namespace {
+
+// Returns the text of the piece of `id`. The byte fallback pieces, of the form
+// "<0xAB>", are decoded to their raw byte.
+std::string PieceText(const sentencepiece::SentencePieceProcessor& processor,
+                      int id) {
+  const std::string& piece = processor.IdToPiece(id);
+  int byte;
+  if (processor.IsByte(id) && piece.size() == 6 &&
+      absl::SimpleHexAtoi(absl::string_view(piece).substr(3, 2), &byte)) {
+    return std::string(1, static_cast<char>(byte));
+  }
+  return piece;
+}
+
+}  // namespace
 
 absl::StatusOr<std::unique_ptr<SentencePieceTokenizer>>
 SentencePieceTokenizer::CreateFromFile(absl::string_view model_path) {
@@ -72,9 +91,30 @@ absl::StatusOr<std::string> SentencePieceTokenizer::TokenIdsToText(
     const std::vector<int>& token_ids) {
   std::string text = "";
   for (const auto& token_id : token_ids) {
-    text += processor_->IdToPiece(token_id);
+    text += PieceText(*processor_, token_id);
   }
   return text;
 }
 
+std::shared_ptr<const TokenBytesTable>
+SentencePieceTokenizer::GetTokenBytesTable() {
+  absl::call_once(token_bytes_once_, [this]() {
+    auto table = std::make_shared<TokenBytesTable>();
+    for (int id = 0; id < processor_->GetPieceSize(); ++id) {
+      table->Add(PieceText(*processor_, id));
+    }
+    token_bytes_ = std::move(table);
+  });
+  return token_bytes_;
+}
+
+absl::StatusOr<std::unique_ptr<StreamingDetokenizer>>
+SentencePieceTokenizer::CreateStreamingDetokenizer(int batch_size) {
+  return std::make_unique<StreamingDetokenizer>(
+      batch_size, GetTokenBytesTable(),
+      [this](const std::vector<int>& token_ids) {
+        return TokenIdsToText(token_ids);
+      });
+}
+
 }  // namespace litert::lm
@@ -20,8 +20,10 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "runtime/components/streaming_detokenizer.h"
 #include "runtime/components/tokenizer.h"
 #include "sentencepiece_processor.h"  // from @sentencepiece
 
@@ -51,10 +53,16 @@ class SentencePieceTokenizer : public Tokenizer {
   // PieceToId method.
   absl::StatusOr<int> TokenToId(absl::string_view token) override;
 
-  // Decodes the given sequence of token ids into a string.
+  // Decodes the given sequence of token ids into a string. The byte fallback
+  // pieces, of the form "<0xAB>", are decoded to their raw byte.
   absl::StatusOr<std::string> TokenIdsToText(
       const std::vector<int>& token_ids) override;
 
+  // Creates a StreamingDetokenizer decoding the pieces from a table built on
+  // the first call, the same way as TokenIdsToText().
+  absl::StatusOr<std::unique_ptr<StreamingDetokenizer>>
+  CreateStreamingDetokenizer(int batch_size) override;
+
   const sentencepiece::SentencePieceProcessor& GetProcessor() const {
     return *processor_;
   }
@@ -65,8 +73,15 @@ class SentencePieceTokenizer : public Tokenizer {
       std::unique_ptr<sentencepiece::SentencePieceProcessor> processor)
       : processor_(std::move(processor)) {};
 
+  // Returns the bytes of all the pieces, building the table on the first call.
+  std::shared_ptr<const TokenBytesTable> GetTokenBytesTable();
+
   // SentencePiece processor.
   std::unique_ptr<sentencepiece::SentencePieceProcessor> processor_;
+
+  // The bytes of all the pieces, shared by the streaming detokenizers.
+  absl::once_flag token_bytes_once_;
+  std::shared_ptr<const TokenBytesTable> token_bytes_;
 };
 
 }  // namespace litert::lm
@@ -29,9 +29,11 @@
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
+#include "absl/strings/str_format.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
 #include "runtime/components/tokenizer.h"
 #include "runtime/util/test_utils.h"  // IWYU pragma: keep
+#include "sentencepiece_model.pb.h"  // from @sentencepiece
 
 namespace litert::lm {
 namespace {
@@ -82,6 +84,30 @@ absl::StatusOr<std::string> GetContents(absl::string_view path) {
   return std::move(contents);
 }
 
+// The id of the byte fallback piece of `byte` in CreateByteFallbackModel().
+int ByteId(uint8_t byte) { return 1 + byte; }
+
+// Returns a serialized model with the unknown piece, the 256 byte fallback
+// pieces and the piece "a".
+std::string CreateByteFallbackModel() {
+  sentencepiece::ModelProto model;
+  model.mutable_trainer_spec()->set_model_type(
+      sentencepiece::TrainerSpec::BPE);
+  model.mutable_trainer_spec()->set_byte_fallback(true);
+  auto* unknown = model.add_pieces();
+  unknown->set_piece("<unk>");
+  unknown->set_type(sentencepiece::ModelProto::SentencePiece::UNKNOWN);
+  for (int byte = 0; byte < 256; ++byte) {
+    auto* piece = model.add_pieces();
+    piece->set_piece(absl::StrFormat("<0x%02X>", byte));
+    piece->set_type(sentencepiece::ModelProto::SentencePiece::BYTE);
+  }
+  auto* piece = model.add_pieces();
+  piece->set_piece("a");
+  piece->set_score(-1.0f);
+  return model.SerializeAsString();
+}
+
 TEST(SentencePieceTokenizerTtest, CreateFromFile) {
   auto tokenizer_or =
       SentencePieceTokenizer::CreateFromFile(GetSentencePieceModelPath());
@@ -150,5 +176,47 @@ TEST(SentencePieceTokenizerTest, TokenIdsToText) {
   EXPECT_EQ(text_or.value(), "▁Hello▁World!");
 }
 
+TEST(SentencePieceTokenizerTest, CreateStreamingDetokenizer) {
+  auto tokenizer_or =
+      SentencePieceTokenizer::CreateFromFile(GetSentencePieceModelPath());
+  EXPECT_TRUE(tokenizer_or.ok());
+  auto tokenizer = std::move(tokenizer_or.value());
+
+  auto detokenizer_or = tokenizer->CreateStreamingDetokenizer(/*batch_size=*/1);
+  ASSERT_TRUE(detokenizer_or.ok());
+  auto detokenizer = std::move(detokenizer_or.value());
+
+  const std::vector<int> ids = {90, 547, 58, 735, 210, 466, 2294};
+  std::string text;
+  for (int id : ids) {
+    auto piece_or = detokenizer->Decode(/*batch=*/0, id);
+    ASSERT_TRUE(piece_or.ok());
+    absl::StrAppend(&text, piece_or.value());
+  }
+  EXPECT_EQ(text, "▁Hello▁World!");
+}
+
+TEST(SentencePieceTokenizerTest, ByteFallbackPiecesDecodeTheSameWhenStreaming) {
+  auto tokenizer_or =
+      SentencePieceTokenizer::CreateFromBuffer(CreateByteFallbackModel());
+  ASSERT_TRUE(tokenizer_or.ok());
+  auto tokenizer = std::move(tokenizer_or.value());
+
+  // "aé", with "é" as its two UTF-8 bytes.
+  const std::vector<int> ids = {257, ByteId(0xC3), ByteId(0xA9)};
+  EXPECT_THAT(tokenizer->TokenIdsToText(ids), IsOkAndHolds("a\xC3\xA9"));
+
+  auto detokenizer_or = tokenizer->CreateStreamingDetokenizer(/*batch_size=*/1);
+  ASSERT_TRUE(detokenizer_or.ok());
+  auto detokenizer = std::move(detokenizer_or.value());
+  std::string text;
+  for (int id : ids) {
+    auto piece_or = detokenizer->Decode(/*batch=*/0, id);
+    ASSERT_TRUE(piece_or.ok());
+    absl::StrAppend(&text, piece_or.value());
+  }
+  EXPECT_EQ(text, "a\xC3\xA9");
+}
+
 }  // namespace
 }  // namespace litert::lm
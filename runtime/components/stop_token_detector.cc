@@ -16,7 +16,10 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <memory>
+#include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/log/absl_check.h"  // from @com_google_absl
@@ -44,11 +47,73 @@ inline std::string PrintSequence(const std::vector<int>& sequence) {
 
 }  // namespace
 
-StopTokenDetector::StopTokenDetector(size_t batch_size) {
+StopTokenDetector::StopTokenDetector(size_t batch_size)
+    : automaton_(CompileAutomaton({})) {
   ABSL_CHECK_GT(batch_size, 0) << "Batch size must be greater than 0.";
   ResetBatch(batch_size);
 }
 
+std::shared_ptr<const StopTokenDetector::Automaton>
+StopTokenDetector::CompileAutomaton(
+    const std::vector<std::vector<int>>& stop_sequences) {
+  auto automaton = std::make_shared<Automaton>();
+  for (const auto& stop_sequence : stop_sequences) {
+    for (int token_id : stop_sequence) {
+      automaton->symbols.try_emplace(token_id, automaton->symbols.size());
+    }
+  }
+  const int num_symbols = automaton->symbols.size();
+  std::vector<int>& transitions = automaton->transitions;
+  std::vector<int>& depths = automaton->depths;
+  std::vector<int>& match_lengths = automaton->match_lengths;
+
+  // Builds the trie of the stop sequences. -1 marks a missing edge.
+  transitions.assign(num_symbols, -1);
+  depths.assign(1, 0);
+  match_lengths.assign(1, 0);
+  for (const auto& stop_sequence : stop_sequences) {
+    int state = 0;
+    for (int token_id : stop_sequence) {
+      const int index =
+          state * num_symbols + automaton->symbols.at(token_id);
+      if (transitions[index] == -1) {
+        transitions[index] = depths.size();
+        transitions.resize(transitions.size() + num_symbols, -1);
+        depths.push_back(depths[state] + 1);
+        match_lengths.push_back(0);
+      }
+      state = transitions[index];
+    }
+    match_lengths[state] = stop_sequence.size();
+  }
+
+  // Turns the trie into a complete automaton in breadth-first order, filling
+  // the missing edges of each state from the edges of its failure state, i.e.
+  // the state of its longest proper suffix.
+  std::vector<int> failures(depths.size(), 0);
+  std::queue<int> pending_states;
+  pending_states.push(0);
+  while (!pending_states.empty()) {
+    const int state = pending_states.front();
+    pending_states.pop();
+    const int failure = failures[state];
+    for (int symbol = 0; symbol < num_symbols; ++symbol) {
+      int& next = transitions[state * num_symbols + symbol];
+      const int failure_next =
+          state == 0 ? 0 : transitions[failure * num_symbols + symbol];
+      if (next == -1) {
+        next = failure_next;
+        continue;
+      }
+      failures[next] = failure_next;
+      match_lengths[next] =
+          std::max(match_lengths[next], match_lengths[failure_next]);
+      pending_states.push(next);
+    }
+  }
+  return automaton;
+}
+
 absl::Status StopTokenDetector::AddStopTokenSequence(
     const std::vector<int>& stop_sequence) {
   if (stop_sequence.empty()) {
@@ -67,22 +132,16 @@ absl::Status StopTokenDetector::AddStopTokenSequence(
   }
 
   stop_sequences_storage_.push_back(stop_sequence);
-
-  // Add a progress tracker for the new stop sequence for each batch item.
-  for (auto& progress_vector_for_item : batch_item_match_progress_) {
-    progress_vector_for_item.push_back(0);
-  }
+  automaton_ = CompileAutomaton(stop_sequences_storage_);
+  // The states of the previous automaton are meaningless in the new one.
+  states_.assign(states_.size(), 0);
   return absl::OkStatus();
 }
 
 void StopTokenDetector::ResetBatch(size_t batch_size) {
   int new_batch_size = batch_size == 0 ? stop_token_found_.size() : batch_size;
   stop_token_found_.assign(new_batch_size, false);
-  max_batch_item_match_progress_.assign(new_batch_size, 0);
-  // Initialize progress for each batch item for all currently defined stop
-  // sequences.
-  batch_item_match_progress_.assign(
-      new_batch_size, std::vector<int>(stop_sequences_storage_.size(), 0));
+  states_.assign(new_batch_size, 0);
   matched_stop_sequence_length_.assign(new_batch_size, 0);
 }
 
@@ -106,40 +165,25 @@ absl::Status StopTokenDetector::ProcessTokens(
       matched_stop_sequence_length_[i]++;
       continue;
     }
-    max_batch_item_match_progress_[i] = 0;
-    int current_token_id = latest_tokens[i];
-    for (size_t k = 0; k < stop_sequences_storage_.size(); ++k) {
-      const auto& stop_seq_k =
-          stop_sequences_storage_[k];  // Guaranteed non-empty
-      int& current_match_len_for_k = batch_item_match_progress_[i][k];
-
-      if (current_match_len_for_k < stop_seq_k.size() &&
-          stop_seq_k[current_match_len_for_k] == current_token_id) {
-        current_match_len_for_k++;
-      } else {
-        // Mismatch or sequence completed; reset progress for this stop_seq_k.
-        // Check if current token starts stop_seq_k anew.
-        if (stop_seq_k[0] == current_token_id) {
-          current_match_len_for_k = 1;
-        } else {
-          current_match_len_for_k = 0;
-        }
-      }
-
-      if (current_match_len_for_k > 0 &&
-          current_match_len_for_k == stop_seq_k.size()) {
-        stop_token_found_[i] = true;
-        matched_stop_sequence_length_[i] = stop_seq_k.size();
-      }
-      max_batch_item_match_progress_[i] =
-          std::max(max_batch_item_match_progress_[i], current_match_len_for_k);
+    auto symbol = automaton_->symbols.find(latest_tokens[i]);
+    if (symbol == automaton_->symbols.end()) {
+      // The token is not in any stop sequence.
+      states_[i] = 0;
+      continue;
+    }
+    const int num_symbols = automaton_->symbols.size();
+    states_[i] =
+        automaton_->transitions[states_[i] * num_symbols + symbol->second];
+    if (automaton_->match_lengths[states_[i]] > 0) {
+      stop_token_found_[i] = true;
+      matched_stop_sequence_length_[i] = automaton_->match_lengths[states_[i]];
     }
   }
   return absl::OkStatus();
 }
 
 int StopTokenDetector::MaxPartialStopTokenLength(int index) const {
-  return max_batch_item_match_progress_[index];
+  return automaton_->depths[states_[index]];
 }
 
 const std::vector<int>& StopTokenDetector::GetStepsBeforeStopTokens() const {
@@ -16,8 +16,10 @@
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_STOP_TOKEN_DETECTOR_H_
 
 #include <cstddef>
+#include <memory>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/types/span.h"  // from @com_google_absl
@@ -25,8 +27,11 @@
 namespace litert::lm {
 
 // Detects stop token sequences in a batch of token streams.
-// Tracks match progress for each potential stop sequence independently per
-// batch item. Stop sequences can be added dynamically. Example usage:
+// The stop sequences are compiled into an Aho-Corasick automaton over the token
+// ids, so that each batch item advances by a single state transition per token
+// regardless of the number of stop sequences. The compiled automaton is shared
+// between the copies of the detector. Stop sequences can be added dynamically.
+// Example usage:
 //
 //   StopTokenDetector detector(batch_size);
 //   RETURN_IF_ERROR(detector.AddStopTokenSequence({1}));
@@ -49,7 +54,8 @@ class StopTokenDetector {
   //   - batch_size: The number of sequences to track in the batch.
   explicit StopTokenDetector(size_t batch_size);
 
-  // Adds a new stop token sequence.
+  // Adds a new stop token sequence. The automaton is recompiled and the partial
+  // matches of the batch items are reset.
   //   - stop_sequence: The token ID sequence to add. Must not be empty.
   //   - InvalidArgumentError if sequence is empty or added before.
   absl::Status AddStopTokenSequence(const std::vector<int>& stop_sequence);
@@ -83,22 +89,43 @@ class StopTokenDetector {
     return stop_token_found_;
   }
 
-  // Returns the maximum length of the partial stop token sequence found for the
-  // given batch index. zero if no partial stop token sequence is found or -1 if
-  // the stop token is already found.
+  // Returns the length of the longest suffix of the tokens of the given batch
+  // index which is a prefix of a stop token sequence, or zero if there is none.
+  // Once a stop token sequence is found, returns the length of the prefix
+  // matched by the token which completed it, which is at least the length of
+  // the found sequence.
   int MaxPartialStopTokenLength(int index) const;
 
  private:
+  // The Aho-Corasick automaton of the stop sequences. State 0 is the root, and
+  // the depth of a state is the length of the prefix of the stop sequences it
+  // represents.
+  struct Automaton {
+    // Maps the token ids of the stop sequences to the symbols of the
+    // automaton. The other token ids lead back to the root.
+    absl::flat_hash_map<int, int> symbols;
+    // transitions[state * symbols.size() + symbol]: the next state.
+    std::vector<int> transitions;
+    // depths[state]: the length of the prefix represented by the state.
+    std::vector<int> depths;
+    // match_lengths[state]: the length of the longest stop sequence ending at
+    // the state, or 0 if none.
+    std::vector<int> match_lengths;
+  };
+
+  // Compiles the automaton of `stop_sequences`.
+  static std::shared_ptr<const Automaton> CompileAutomaton(
+      const std::vector<std::vector<int>>& stop_sequences);
+
   // Stores all added stop sequences.
   std::vector<std::vector<int>> stop_sequences_storage_;
 
-  // batch_item_match_progress_[i][k]: current match length for batch item 'i'
-  // against stop_sequences_storage_[k].
-  std::vector<std::vector<int>> batch_item_match_progress_;
+  // The compiled automaton of stop_sequences_storage_.
+  std::shared_ptr<const Automaton> automaton_;
 
-  // max_batch_item_match_progress_[i]: maximum match length for batch item 'i'
-  // against all stop_sequences_storage_[k].
-  std::vector<int> max_batch_item_match_progress_;
+  // states_[i]: the current automaton state of batch item 'i', i.e. the
+  // longest suffix of its tokens which is a prefix of a stop sequence.
+  std::vector<int> states_;
 
   // stop_token_found_[i]: true if batch item 'i' has matched a stop sequence.
   std::vector<bool> stop_token_found_;
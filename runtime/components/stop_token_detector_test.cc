@@ -114,6 +114,39 @@ TEST(StopTokenDetectorTest, ProcessTokensMultipleStopTokens) {
   EXPECT_EQ(1, steps_before_stop_tokens[1]);
 }
 
+TEST(StopTokenDetectorTest, ProcessTokensOverlappingPrefixes) {
+  StopTokenDetector detector(1);
+  EXPECT_OK(detector.AddStopTokenSequence({1, 1, 2}));
+  EXPECT_OK(detector.AddStopTokenSequence({1, 3}));
+
+  // The third 1 must keep the partial match of {1, 1, 2} at length 2.
+  std::vector<int> tokens = {1, 1, 1, 2};
+  std::vector<int> expected_partial_lengths = {1, 2, 2, 3};
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    std::vector<int> current_batch_tokens = {tokens[i]};
+    EXPECT_OK(detector.ProcessTokens(absl::MakeSpan(current_batch_tokens)));
+    EXPECT_EQ(expected_partial_lengths[i],
+              detector.MaxPartialStopTokenLength(0));
+  }
+  EXPECT_TRUE(detector.AllDone().value());
+  EXPECT_EQ(3, detector.GetStepsBeforeStopTokens()[0]);
+}
+
+TEST(StopTokenDetectorTest, ProcessTokensStopSequenceSuffix) {
+  StopTokenDetector detector(1);
+  EXPECT_OK(detector.AddStopTokenSequence({4, 5, 6}));
+  EXPECT_OK(detector.AddStopTokenSequence({5}));
+
+  // {5} is found within the partial match of {4, 5, 6}.
+  std::vector<int> tokens = {4, 5};
+  for (int token : tokens) {
+    std::vector<int> current_batch_tokens = {token};
+    EXPECT_OK(detector.ProcessTokens(absl::MakeSpan(current_batch_tokens)));
+  }
+  EXPECT_TRUE(detector.AllDone().value());
+  EXPECT_EQ(1, detector.GetStepsBeforeStopTokens()[0]);
+}
+
 TEST(StopTokenDetectorTest, ResetBatch) {
   StopTokenDetector detector(1);
   EXPECT_OK(detector.AddStopTokenSequence({1}));
@@ -0,0 +1,124 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/components/streaming_detokenizer.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/string_view.h"  // from @com_google_absl
+
+namespace litert::lm {
+namespace {
+
+// Returns the length of the longest prefix of `text` which does not end within
+// a UTF-8 character. Invalid UTF-8 sequences are considered complete, so that
+// they are not held back forever.
+size_t CompleteUtf8Length(absl::string_view text) {
+  // A UTF-8 character has at most 3 continuation bytes.
+  for (size_t i = 1; i <= 4 && i <= text.size(); ++i) {
+    const unsigned char byte = text[text.size() - i];
+    if ((byte & 0xC0) == 0x80) {  // A continuation byte.
+      continue;
+    }
+    size_t char_length = 1;
+    if ((byte & 0xE0) == 0xC0) {
+      char_length = 2;
+    } else if ((byte & 0xF0) == 0xE0) {
+      char_length = 3;
+    } else if ((byte & 0xF8) == 0xF0) {
+      char_length = 4;
+    }
+    return char_length > i ? text.size() - i : text.size();
+  }
+  return text.size();
+}
+
+}  // namespace
+
+void TokenBytesTable::Add(absl::string_view bytes) {
+  bytes_.append(bytes.data(), bytes.size());
+  offsets_.push_back(bytes_.size());
+  undecodable_.push_back(false);
+}
+
+void TokenBytesTable::AddUndecodable() {
+  offsets_.push_back(bytes_.size());
+  undecodable_.push_back(true);
+}
+
+StreamingDetokenizer::StreamingDetokenizer(
+    int batch_size, std::shared_ptr<const TokenBytesTable> table,
+    DecodeFn decode_fn)
+    : streams_(batch_size),
+      table_(std::move(table)),
+      decode_fn_(std::move(decode_fn)),
+      incomplete_sequence_status_(absl::DataLossError(
+          "The token is part of an incomplete sequence and needs more tokens "
+          "to be decoded.")) {}
+
+absl::StatusOr<absl::string_view> StreamingDetokenizer::Decode(int batch,
+                                                               int token_id) {
+  if (batch < 0 || batch >= batch_size()) {
+    return absl::InvalidArgumentError("The batch index is out of range.");
+  }
+  Stream& stream = streams_[batch];
+  if (!stream.pending_token_ids.empty() || table_ == nullptr ||
+      !table_->IsDecodable(token_id)) {
+    return DecodeWithFallback(stream, token_id);
+  }
+
+  stream.text.assign(stream.pending_bytes);
+  const absl::string_view bytes = table_->Get(token_id);
+  stream.text.append(bytes.data(), bytes.size());
+  const size_t complete_length = CompleteUtf8Length(stream.text);
+  stream.pending_bytes.assign(stream.text, complete_length);
+  stream.text.resize(complete_length);
+  if (stream.text.empty() && !stream.pending_bytes.empty()) {
+    return incomplete_sequence_status_;
+  }
+  return stream.text;
+}
+
+absl::StatusOr<absl::string_view> StreamingDetokenizer::DecodeWithFallback(
+    Stream& stream, int token_id) {
+  stream.pending_token_ids.push_back(token_id);
+  absl::StatusOr<std::string> decoded = decode_fn_(stream.pending_token_ids);
+  if (!decoded.ok()) {
+    if (decoded.status().code() != absl::StatusCode::kDataLoss) {
+      stream.pending_token_ids.clear();
+    }
+    return decoded.status();
+  }
+  stream.pending_token_ids.clear();
+  // The bytes held back from the table tokens can no longer be completed.
+  stream.text.assign(stream.pending_bytes);
+  stream.pending_bytes.clear();
+  stream.text.append(*decoded);
+  return stream.text;
+}
+
+void StreamingDetokenizer::Reset() {
+  for (Stream& stream : streams_) {
+    stream.pending_token_ids.clear();
+    stream.pending_bytes.clear();
+  }
+}
+
+}  // namespace litert::lm
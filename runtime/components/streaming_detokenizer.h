@@ -0,0 +1,123 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_STREAMING_DETOKENIZER_H_
+#define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_STREAMING_DETOKENIZER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/string_view.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+// The bytes each token id decodes to on its own, indexed by token id and stored
+// contiguously. A token id may be marked as not decodable on its own, e.g. when
+// its text depends on the neighbouring tokens.
+class TokenBytesTable {
+ public:
+  // Appends the bytes of the next token id.
+  void Add(absl::string_view bytes);
+
+  // Appends the next token id as not decodable on its own.
+  void AddUndecodable();
+
+  // Returns the number of token ids in the table.
+  int size() const { return offsets_.size() - 1; }
+
+  // Returns true if `token_id` is in the table and decodable on its own.
+  bool IsDecodable(int token_id) const {
+    return token_id >= 0 && token_id < size() && !undecodable_[token_id];
+  }
+
+  // Returns the bytes of `token_id`, which must be decodable.
+  absl::string_view Get(int token_id) const {
+    return absl::string_view(bytes_).substr(
+        offsets_[token_id], offsets_[token_id + 1] - offsets_[token_id]);
+  }
+
+ private:
+  std::string bytes_;
+  // The offsets of the bytes of each token id in `bytes_`, followed by the
+  // total size.
+  std::vector<uint32_t> offsets_ = {0};
+  std::vector<bool> undecodable_;
+};
+
+// Decodes streams of token ids incrementally, one token at a time, e.g. the
+// output candidates of a decode loop.
+//
+// The tokens found in the table are decoded by appending their bytes, and only
+// the complete UTF-8 characters are emitted; the bytes of an incomplete
+// character are held back until the next token of the stream. The other tokens
+// are decoded by `decode_fn` together with the pending tokens of the stream,
+// until it no longer returns absl::DataLossError for an incomplete BPE
+// sequence.
+//
+// Decoding a token from the table does not allocate memory once the buffers of
+// the streams have grown to the size of the longest token.
+//
+// This class is not thread-safe.
+class StreamingDetokenizer {
+ public:
+  using DecodeFn =
+      absl::AnyInvocable<absl::StatusOr<std::string>(const std::vector<int>&)>;
+
+  // Creates a detokenizer of `batch_size` streams. `table` may be null, in
+  // which case all the tokens are decoded by `decode_fn`.
+  StreamingDetokenizer(int batch_size,
+                       std::shared_ptr<const TokenBytesTable> table,
+                       DecodeFn decode_fn);
+
+  // Decodes the next token id of the stream `batch`, and returns the new text.
+  // The returned view is valid until the next call for the same stream.
+  // Returns absl::DataLossError if the token id only extends an incomplete
+  // character or BPE sequence, so that no text is complete yet.
+  absl::StatusOr<absl::string_view> Decode(int batch, int token_id);
+
+  // Drops the pending bytes and tokens of all the streams.
+  void Reset();
+
+  int batch_size() const { return streams_.size(); }
+
+ private:
+  struct Stream {
+    // The token ids waiting for `decode_fn_` to complete a BPE sequence.
+    std::vector<int> pending_token_ids;
+    // The bytes of an incomplete UTF-8 character.
+    std::string pending_bytes;
+    // The buffer of the text returned by the last Decode().
+    std::string text;
+  };
+
+  // Decodes `token_id` with the pending tokens of `stream` by `decode_fn_`.
+  absl::StatusOr<absl::string_view> DecodeWithFallback(Stream& stream,
+                                                       int token_id);
+
+  std::vector<Stream> streams_;
+  const std::shared_ptr<const TokenBytesTable> table_;
+  DecodeFn decode_fn_;
+  // Returned for incomplete sequences. Kept to avoid creating a status, which
+  // allocates memory, on every step.
+  const absl::Status incomplete_sequence_status_;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_STREAMING_DETOKENIZER_H_
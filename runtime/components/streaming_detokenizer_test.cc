@@ -0,0 +1,141 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/components/streaming_detokenizer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/string_view.h"  // from @com_google_absl
+
+namespace litert::lm {
+namespace {
+
+// Token 0: "Hello", 1: " world", 2: the first two bytes of "€", 3: its last
+// byte, 4: not decodable on its own, 5: "!".
+std::shared_ptr<const TokenBytesTable> CreateTable() {
+  auto table = std::make_shared<TokenBytesTable>();
+  table->Add("Hello");
+  table->Add(" world");
+  table->Add("\xe2\x82");
+  table->Add("\xac");
+  table->AddUndecodable();
+  table->Add("!");
+  return table;
+}
+
+// Decodes the token ids with the fallback as "<ids>", or an incomplete
+// sequence if the ids end with 4.
+absl::StatusOr<std::string> FallbackDecode(const std::vector<int>& token_ids) {
+  if (token_ids.back() == 4) {
+    return absl::DataLossError("Incomplete BPE sequence.");
+  }
+  std::string text = "<";
+  for (int token_id : token_ids) {
+    text += std::to_string(token_id);
+  }
+  return text + ">";
+}
+
+TEST(TokenBytesTableTest, AddAndGet) {
+  auto table = CreateTable();
+  EXPECT_EQ(table->size(), 6);
+  EXPECT_EQ(table->Get(0), "Hello");
+  EXPECT_EQ(table->Get(1), " world");
+  EXPECT_EQ(table->Get(5), "!");
+  EXPECT_TRUE(table->IsDecodable(3));
+  EXPECT_FALSE(table->IsDecodable(4));
+  EXPECT_FALSE(table->IsDecodable(6));
+  EXPECT_FALSE(table->IsDecodable(-1));
+}
+
+TEST(StreamingDetokenizerTest, DecodesTokensFromTable) {
+  StreamingDetokenizer detokenizer(/*batch_size=*/1, CreateTable(),
+                                   FallbackDecode);
+  auto text = detokenizer.Decode(0, 0);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "Hello");
+  text = detokenizer.Decode(0, 1);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, " world");
+}
+
+TEST(StreamingDetokenizerTest, HoldsBackIncompleteUtf8Characters) {
+  StreamingDetokenizer detokenizer(/*batch_size=*/1, CreateTable(),
+                                   FallbackDecode);
+  auto text = detokenizer.Decode(0, 2);
+  EXPECT_EQ(text.status().code(), absl::StatusCode::kDataLoss);
+  text = detokenizer.Decode(0, 3);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "\xe2\x82\xac");
+  // A complete character followed by an incomplete one.
+  text = detokenizer.Decode(0, 5);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "!");
+}
+
+TEST(StreamingDetokenizerTest, FallsBackForUndecodableTokens) {
+  StreamingDetokenizer detokenizer(/*batch_size=*/1, CreateTable(),
+                                   FallbackDecode);
+  auto text = detokenizer.Decode(0, 4);
+  EXPECT_EQ(text.status().code(), absl::StatusCode::kDataLoss);
+  // The pending token is decoded together with the next one.
+  text = detokenizer.Decode(0, 0);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "<40>");
+  // Token ids out of the table also fall back.
+  text = detokenizer.Decode(0, 7);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "<7>");
+}
+
+TEST(StreamingDetokenizerTest, WithoutTableDecodesEverythingByFallback) {
+  StreamingDetokenizer detokenizer(/*batch_size=*/1, /*table=*/nullptr,
+                                   FallbackDecode);
+  auto text = detokenizer.Decode(0, 0);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "<0>");
+}
+
+TEST(StreamingDetokenizerTest, KeepsStreamsSeparate) {
+  StreamingDetokenizer detokenizer(/*batch_size=*/2, CreateTable(),
+                                   FallbackDecode);
+  EXPECT_FALSE(detokenizer.Decode(0, 2).ok());
+  auto text = detokenizer.Decode(1, 0);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "Hello");
+  text = detokenizer.Decode(0, 3);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "\xe2\x82\xac");
+  EXPECT_EQ(detokenizer.Decode(2, 0).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(StreamingDetokenizerTest, ResetDropsPendingBytes) {
+  StreamingDetokenizer detokenizer(/*batch_size=*/1, CreateTable(),
+                                   FallbackDecode);
+  EXPECT_FALSE(detokenizer.Decode(0, 2).ok());
+  detokenizer.Reset();
+  auto text = detokenizer.Decode(0, 0);
+  ASSERT_TRUE(text.ok());
+  EXPECT_EQ(*text, "Hello");
+}
+
+}  // namespace
+}  // namespace litert::lm
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_TOKENIZER_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_COMPONENTS_TOKENIZER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,7 @@
 #include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_macros.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/streaming_detokenizer.h"
 #include "runtime/util/convert_tensor_buffer.h"
 
 namespace litert::lm {
@@ -70,6 +72,20 @@ class Tokenizer {
   virtual absl::StatusOr<std::string> TokenIdsToText(
       const TokenIds& token_ids) = 0;
 
+  // Creates a StreamingDetokenizer decoding `batch_size` streams of token ids
+  // one token at a time. The tokenizer must outlive it.
+  //
+  // The default implementation decodes every token with TokenIdsToText(),
+  // together with the pending tokens of an incomplete BPE sequence. Tokenizers
+  // override it to decode the tokens from a precomputed TokenBytesTable.
+  virtual absl::StatusOr<std::unique_ptr<StreamingDetokenizer>>
+  CreateStreamingDetokenizer(int batch_size) {
+    return std::make_unique<StreamingDetokenizer>(
+        batch_size, /*table=*/nullptr, [this](const TokenIds& token_ids) {
+          return TokenIdsToText(token_ids);
+        });
+  }
+
   // Converts a tensor buffer of token ids into a vector of token ids. The input
   // is a 2D litert::TensorBuffer shape [batch_size, decode_steps].
   static absl::StatusOr<std::vector<TokenIds>> TensorBufferToTokenIds(
@@ -14,9 +14,11 @@
 
 #include "runtime/components/tool_use/parser_utils.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/base/const_init.h"  // from @com_google_absl
 #include "absl/base/no_destructor.h"  // from @com_google_absl
 #include "absl/container/flat_hash_map.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
@@ -25,6 +27,7 @@
 #include "absl/strings/str_join.h"  // from @com_google_absl
 #include "absl/strings/str_split.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
 #include "nlohmann/json.hpp"  // from @nlohmann_json
 #include "runtime/components/tool_use/json_parser_utils.h"
 #include "runtime/components/tool_use/python_parser_utils.h"
@@ -35,9 +38,26 @@ namespace litert::lm {
 
 namespace {
 
-RE2 TextAndToolCodeRegex(absl::string_view code_fence_start,
-                         absl::string_view code_fence_end,
-                         bool escape_fence_strings) {
+ABSL_CONST_INIT absl::Mutex regex_cache_mutex(absl::kConstInit);
+
+// Returns the regex compiled from the pattern. The regexes are compiled once
+// and cached, since the same few patterns from the data processor configs are
+// used for every response chunk.
+const RE2& GetCachedRegex(absl::string_view pattern) {
+  static absl::NoDestructor<
+      absl::flat_hash_map<std::string, std::unique_ptr<RE2>>>
+      regex_cache;
+  absl::MutexLock lock(&regex_cache_mutex);
+  std::unique_ptr<RE2>& regex = (*regex_cache)[pattern];
+  if (regex == nullptr) {
+    regex = std::make_unique<RE2>(pattern);
+  }
+  return *regex;
+}
+
+const RE2& TextAndToolCodeRegex(absl::string_view code_fence_start,
+                                absl::string_view code_fence_end,
+                                bool escape_fence_strings) {
   // Construct the regex pattern: (non-greedy text before) <start> (non-greedy
   // code) <end>.
   std::string pattern;
@@ -49,7 +69,7 @@ RE2 TextAndToolCodeRegex(absl::string_view code_fence_start,
     pattern =
         absl::StrCat("(?ms)(.*?)", code_fence_start, "(.*?)", code_fence_end);
   }
-  return RE2(pattern);
+  return GetCachedRegex(pattern);
 }
 
 std::string FilterLines(absl::string_view input, const RE2& regex) {
@@ -89,8 +109,8 @@ absl::StatusOr<nlohmann::ordered_json> ParseTextAndToolCalls(
     absl::string_view code_fence_end, SyntaxType syntax_type,
     bool escape_fence_strings, absl::string_view tool_code_regex) {
   nlohmann::ordered_json result = nlohmann::json::object();
-  RE2 regex = TextAndToolCodeRegex(code_fence_start, code_fence_end,
-                                   escape_fence_strings);
+  const RE2& regex = TextAndToolCodeRegex(code_fence_start, code_fence_end,
+                                          escape_fence_strings);
   if (!regex.ok()) {
     return absl::InvalidArgumentError(absl::StrCat(
         "Invalid regex: ", regex.pattern(), " error: ", regex.error()));
@@ -106,7 +126,7 @@ absl::StatusOr<nlohmann::ordered_json> ParseTextAndToolCalls(
 
     // Before parsing the code block, apply tool_code_regex to each line.
     if (!tool_code_regex.empty()) {
-      RE2 regex(tool_code_regex);
+      const RE2& regex = GetCachedRegex(tool_code_regex);
       if (!regex.ok()) {
         return absl::InvalidArgumentError(
             absl::StrCat("Invalid tool_code_regex: ", tool_code_regex));
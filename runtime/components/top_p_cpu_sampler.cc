@@ -14,9 +14,11 @@
 
 #include "runtime/components/top_p_cpu_sampler.h"
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"  // from @com_google_absl
@@ -27,12 +29,19 @@
 #include "litert/cc/litert_macros.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/sampling_cpu_util.h"
+#include "runtime/framework/parallel_for.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/tensor_buffer_util.h"
 
 namespace litert::lm {
 namespace {
 
+// The minimum number of logits of a vocab shard when the top-k selection of a
+// single batch is split across threads. Smaller shards do not pay for the
+// scheduling overhead.
+constexpr int kMinLogitsPerShard = 1 << 15;
+
 absl::Status ValidateTensor(const TensorBuffer& tensor, int max_num_dims,
                             int batch_size, const std::string& tensor_name) {
   LITERT_ASSIGN_OR_RETURN(auto tensor_type, tensor.TensorType());
@@ -55,7 +64,8 @@ absl::Status ValidateTensor(const TensorBuffer& tensor, int max_num_dims,
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<TopPSampler>> TopPSampler::Create(
-    int k, float p, float temperature, int batch_size, int seed) {
+    int k, float p, float temperature, int batch_size, int seed,
+    ThreadPool* thread_pool) {
   if (k <= 0) {
     return absl::InvalidArgumentError("k must be positive.");
   }
@@ -69,7 +79,8 @@ absl::StatusOr<std::unique_ptr<TopPSampler>> TopPSampler::Create(
     return absl::InvalidArgumentError(
         absl::StrCat("Temperature must be >= 0, but got ", temperature));
   }
-  return absl::WrapUnique(new TopPSampler(k, p, temperature, batch_size, seed));
+  return absl::WrapUnique(
+      new TopPSampler(k, p, temperature, batch_size, seed, thread_pool));
 }
 
 absl::Status TopPSampler::SampleToIdAndScoreBuffer(
@@ -100,27 +111,82 @@ absl::Status TopPSampler::SampleToIdAndScoreBuffer(
   } else {
     logits_data = logits_data_or.Value();
   }
-  std::vector<float> sampled_scores;
-  auto sampled_ids = TopKTopPSampling(logits_data, k_, p_, temperature_,
-                                      generator_, batch_size_, sampled_scores);
-  if (!sampled_ids.ok()) {
-    return sampled_ids.status();
+  if (logits_data.empty() || logits_data.size() % batch_size_ != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The logits size ", logits_data.size(),
+                     " is not a multiple of the batch size ", batch_size_));
+  }
+  const int vocab_size = logits_data.size() / batch_size_;
+  auto sample_batch = [this, logits_data, vocab_size](int b) {
+    TopKTopPSamplingScratch& scratch = batch_scratches_[b];
+    TopKLogits(logits_data.subspan(b * vocab_size, vocab_size), k_,
+               scratch.topk);
+    sampled_ids_[b] =
+        SampleFromTopKLogits(scratch.topk, p_, temperature_, generators_[b],
+                             scratch.probabilities, sampled_scores_[b]);
+  };
+  if (thread_pool_ == nullptr) {
+    for (int b = 0; b < batch_size_; ++b) {
+      sample_batch(b);
+    }
+  } else if (batch_size_ > 1) {
+    ParallelFor(*thread_pool_, batch_size_, sample_batch);
+  } else {
+    const int num_shards =
+        std::min<int>(thread_pool_->max_num_threads() + 1,
+                      vocab_size / kMinLogitsPerShard);
+    if (num_shards > 1) {
+      SampleInShards(logits_data, num_shards);
+    } else {
+      sample_batch(0);
+    }
   }
-  ids_tensor.Write(absl::MakeConstSpan(*sampled_ids));
+  ids_tensor.Write(absl::MakeConstSpan(sampled_ids_));
   if (scores_tensor != nullptr) {
     status = ValidateTensor(*scores_tensor, /*max_num_dims=*/1, batch_size_,
                             "output scores");
     if (!status.ok()) {
       return status;
     }
-    std::vector<float> scores(batch_size_);
     for (int i = 0; i < batch_size_; ++i) {
       // The scores are the log of the probability of the sampled token.
-      scores[i] = std::log(sampled_scores[i]);
+      scores_[i] = std::log(sampled_scores_[i]);
     }
-    scores_tensor->Write(absl::MakeConstSpan(scores));
+    scores_tensor->Write(absl::MakeConstSpan(scores_));
   }
   return absl::OkStatus();
 }
 
+void TopPSampler::SampleInShards(absl::Span<const float> logits,
+                                 int num_shards) {
+  const int vocab_size = logits.size();
+  shard_topks_.resize(num_shards);
+  ParallelFor(*thread_pool_, num_shards,
+              [this, logits, vocab_size, num_shards](int s) {
+                const int begin = vocab_size * s / num_shards;
+                const int end = vocab_size * (s + 1) / num_shards;
+                std::vector<std::pair<float, int>>& topk = shard_topks_[s];
+                TopKLogits(logits.subspan(begin, end - begin), k_, topk);
+                for (auto& [logit, token_id] : topk) {
+                  token_id += begin;
+                }
+              });
+
+  // The top k of the vocab is the top k of the union of the shard top k. The
+  // order is total, so the result does not depend on the number of shards.
+  TopKTopPSamplingScratch& scratch = batch_scratches_[0];
+  scratch.topk.clear();
+  for (const auto& shard_topk : shard_topks_) {
+    scratch.topk.insert(scratch.topk.end(), shard_topk.begin(),
+                        shard_topk.end());
+  }
+  const int k = std::min<int>(k_, scratch.topk.size());
+  std::partial_sort(scratch.topk.begin(), scratch.topk.begin() + k,
+                    scratch.topk.end(), RanksBefore);
+  scratch.topk.resize(k);
+  sampled_ids_[0] =
+      SampleFromTopKLogits(scratch.topk, p_, temperature_, generators_[0],
+                           scratch.probabilities, sampled_scores_[0]);
+}
+
 }  // namespace litert::lm
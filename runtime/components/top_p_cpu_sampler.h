@@ -22,8 +22,11 @@
 #include "absl/random/random.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/sampler.h"
+#include "runtime/components/sampling_cpu_util.h"
+#include "runtime/framework/threadpool.h"
 
 namespace litert::lm {
 
@@ -34,10 +37,15 @@ class TopPSampler : public Sampler {
   // - p: The top-p probability mass to consider.
   // - batch_size: The batch size of the input logits.
   // - seed: The seed for the random number generator.
-  static absl::StatusOr<std::unique_ptr<TopPSampler>> Create(int k, float p,
-                                                             float temperature,
-                                                             int batch_size,
-                                                             int seed);
+  // - thread_pool: Optional. If set, the batches are sampled in parallel on
+  //   the pool, and for batch size 1 the top-k selection of a large vocab is
+  //   split into shards across the pool. The pool must outlive the sampler.
+  //
+  // Each batch has its own random number generator seeded from `seed` and the
+  // batch index, so the sampled ids do not depend on the number of threads.
+  static absl::StatusOr<std::unique_ptr<TopPSampler>> Create(
+      int k, float p, float temperature, int batch_size, int seed,
+      ThreadPool* thread_pool = nullptr);
 
   // Given a batch of logits, samples a batch of token ids.
   // The expected shape of the logits is [batch_size, vocab_size].
@@ -51,23 +59,55 @@ class TopPSampler : public Sampler {
 
  private:
   explicit TopPSampler(int k, float p, float temperature, int batch_size,
-                       int seed)
-      : k_(k), p_(p), temperature_(temperature), batch_size_(batch_size) {
-    absl::SeedSeq proper_seed_seq({seed});
-    absl::BitGen rng(proper_seed_seq);
-    generator_ = std::move(rng);
+                       int seed, ThreadPool* thread_pool)
+      : k_(k),
+        p_(p),
+        temperature_(temperature),
+        batch_size_(batch_size),
+        thread_pool_(thread_pool),
+        batch_scratches_(batch_size),
+        sampled_ids_(batch_size),
+        sampled_scores_(batch_size),
+        scores_(batch_size) {
+    // The first batch is seeded with `seed` alone, which keeps the random
+    // sequence of batch size 1 independent of the batch index.
+    generators_.reserve(batch_size);
+    for (int b = 0; b < batch_size; ++b) {
+      std::vector<int> seeds = {seed};
+      if (b > 0) {
+        seeds.push_back(b);
+      }
+      absl::SeedSeq proper_seed_seq(seeds.begin(), seeds.end());
+      generators_.emplace_back(proper_seed_seq);
+    }
   }
 
+  // Samples the only batch of `logits`, splitting the top-k selection into
+  // `num_shards` vocab shards on the thread pool.
+  void SampleInShards(absl::Span<const float> logits, int num_shards);
+
   // The parameters for the sampler.
   const int k_;
   const float p_;
   const float temperature_;
   const int batch_size_;
-  absl::BitGen generator_;
+  // The thread pool to sample on. Not owned, and may be null.
+  ThreadPool* const thread_pool_;
+  // The random number generators of the batches.
+  std::vector<absl::BitGen> generators_;
 
   // The logits data to be used for sampling. Having it as a member to avoid
   // re-allocating the vector for each sampling call.
   std::vector<float> logits_data_;
+
+  // The buffers of the sampling results and the sampling scratch space of each
+  // batch and vocab shard, kept as members so that sampling does not allocate
+  // in the decode loop.
+  std::vector<TopKTopPSamplingScratch> batch_scratches_;
+  std::vector<std::vector<std::pair<float, int>>> shard_topks_;
+  std::vector<int> sampled_ids_;
+  std::vector<float> sampled_scores_;
+  std::vector<float> scores_;
 };
 
 }  // namespace litert::lm
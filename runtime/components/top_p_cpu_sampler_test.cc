@@ -22,11 +22,38 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/types/span.h"  // from @com_google_absl
+#include "runtime/framework/threadpool.h"
 #include "runtime/util/convert_tensor_buffer.h"
 
 namespace litert::lm {
 namespace {
 
+// Samples `num_steps` times from deterministic logits of shape
+// [batch_size, vocab_size], and returns the sampled ids of all the steps.
+std::vector<int> SampleSteps(TopPSampler& sampler, int batch_size,
+                             int vocab_size, int num_steps) {
+  std::vector<int> all_ids;
+  std::vector<float> logits(batch_size * vocab_size);
+  for (int step = 0; step < num_steps; ++step) {
+    for (int i = 0; i < logits.size(); ++i) {
+      logits[i] = ((i + step) * 7919 % 10007) / 1000.0f;
+    }
+    auto logits_tensor =
+        CopyToTensorBuffer<float>(logits, {batch_size, vocab_size});
+    std::vector<int> ids_vector(batch_size);
+    auto ids_tensor =
+        CopyToTensorBuffer<int>(absl::MakeConstSpan(ids_vector), {batch_size});
+    EXPECT_TRUE(sampler
+                    .SampleToIdAndScoreBuffer(*logits_tensor, *ids_tensor,
+                                              /*scores_tensor=*/nullptr)
+                    .ok());
+    auto ids = CopyFromTensorBuffer<int>(*ids_tensor);
+    EXPECT_TRUE(ids.HasValue());
+    all_ids.insert(all_ids.end(), ids->begin(), ids->end());
+  }
+  return all_ids;
+}
+
 TEST(TopPSamplerTest, Create) {
   auto sampler_or = TopPSampler::Create(/*k=*/1, /*p=*/0.5, /*temperature=*/1.0,
                                         /*batch_size=*/1, /*seed=*/1);
@@ -104,5 +131,26 @@ TEST(TopPSamplerTest, SampleToIdAndScoreBuffer_BatchSize2) {
   EXPECT_THAT(*scores, testing::ElementsAre(std::log(1.0f), std::log(1.0f)));
 }
 
+TEST(TopPSamplerTest, SampleToIdAndScoreBuffer_ThreadPoolMatchesSerial) {
+  ThreadPool thread_pool(/*name_prefix=*/"sampler", /*max_num_threads=*/3);
+  // Batch size 4 samples the batches in parallel. Batch size 1 with a large
+  // vocab splits the top-k selection into vocab shards.
+  for (const auto& [batch_size, vocab_size] :
+       std::vector<std::pair<int, int>>{{4, 1000}, {1, 1 << 17}}) {
+    auto serial_sampler =
+        TopPSampler::Create(/*k=*/40, /*p=*/0.9, /*temperature=*/0.8,
+                            batch_size, /*seed=*/1);
+    ASSERT_TRUE(serial_sampler.ok());
+    auto parallel_sampler =
+        TopPSampler::Create(/*k=*/40, /*p=*/0.9, /*temperature=*/0.8,
+                            batch_size, /*seed=*/1, &thread_pool);
+    ASSERT_TRUE(parallel_sampler.ok());
+    EXPECT_EQ(SampleSteps(**serial_sampler, batch_size, vocab_size,
+                          /*num_steps=*/5),
+              SampleSteps(**parallel_sampler, batch_size, vocab_size,
+                          /*num_steps=*/5));
+  }
+}
+
 }  // namespace
 }  // namespace litert::lm
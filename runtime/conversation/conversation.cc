@@ -26,9 +26,13 @@
 #include "absl/memory/memory.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/match.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
+#include "absl/strings/str_join.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
 #include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/time/clock.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "nlohmann/json.hpp"  // from @nlohmann_json
 #include "runtime/components/prompt_template.h"
 #include "runtime/conversation/internal_callback_util.h"
@@ -100,83 +104,183 @@ absl::StatusOr<ConversationConfig> ConversationConfig::CreateFromSessionConfig(
   );
 }
 
-absl::StatusOr<std::string> Conversation::GetSingleTurnText(
-    const Message& message) const {
-  PromptTemplateInput old_tmpl_input;
-  if (std::holds_alternative<JsonPreface>(preface_)) {
-    auto json_preface = std::get<JsonPreface>(preface_);
+namespace {
+
+// The number of turns where rendering only the last turn of the history is
+// checked against rendering the whole history, before it is used alone.
+constexpr int kNumIncrementalRenderChecks = 2;
+
+absl::StatusOr<PromptTemplateInput> CreatePrefaceTemplateInput(
+    const Preface& preface, const ModelDataProcessor& model_data_processor) {
+  PromptTemplateInput tmpl_input;
+  if (std::holds_alternative<JsonPreface>(preface)) {
+    auto json_preface = std::get<JsonPreface>(preface);
 
+    tmpl_input.messages = nlohmann::ordered_json::array();
     if (json_preface.messages.is_array()) {
       for (auto& message : json_preface.messages) {
-        ASSIGN_OR_RETURN(
-            nlohmann::ordered_json message_tmpl_input,
-            model_data_processor_->MessageToTemplateInput(message));
-        old_tmpl_input.messages.push_back(message_tmpl_input);
+        ASSIGN_OR_RETURN(nlohmann::ordered_json message_tmpl_input,
+                         model_data_processor.MessageToTemplateInput(message));
+        tmpl_input.messages.push_back(message_tmpl_input);
       }
     }
 
     if (json_preface.tools.is_null()) {
-      old_tmpl_input.tools = nullptr;
+      tmpl_input.tools = nullptr;
     } else {
-      ASSIGN_OR_RETURN(old_tmpl_input.tools,
-                       model_data_processor_->FormatTools(json_preface.tools));
+      ASSIGN_OR_RETURN(tmpl_input.tools,
+                       model_data_processor.FormatTools(json_preface.tools));
     }
-    old_tmpl_input.extra_context = json_preface.extra_context;
+    tmpl_input.extra_context = json_preface.extra_context;
   } else {
     return absl::UnimplementedError("Preface type is not supported yet");
   }
+  return tmpl_input;
+}
+
+}  // namespace
+
+absl::StatusOr<std::string> Conversation::RenderTurnText(
+    absl::Span<const nlohmann::ordered_json> history_tmpl_inputs,
+    absl::Span<const nlohmann::ordered_json> new_tmpl_inputs,
+    absl::string_view rendered_prefix) const {
+  PromptTemplateInput tmpl_input = preface_tmpl_input_;
+  tmpl_input.now = absl::Now();
+  for (const auto& message_tmpl_input : history_tmpl_inputs) {
+    tmpl_input.messages.push_back(message_tmpl_input);
+  }
+  tmpl_input.add_generation_prompt = false;
+  ASSIGN_OR_RETURN(const std::string old_string,
+                   prompt_template_.Apply(tmpl_input));
+  if (!absl::StartsWith(old_string, rendered_prefix)) {
+    return absl::InternalError(absl::StrCat(
+        "The rendered history does not start with the expected prefix. "
+        "\nprefix: ",
+        rendered_prefix, "\nold_string: ", old_string));
+  }
+
+  for (const auto& message_tmpl_input : new_tmpl_inputs) {
+    tmpl_input.messages.push_back(message_tmpl_input);
+  }
+  tmpl_input.add_generation_prompt = true;
+  ASSIGN_OR_RETURN(const std::string& new_string,
+                   prompt_template_.Apply(tmpl_input));
+  if (new_string.substr(0, old_string.size()) != old_string) {
+    return absl::InternalError(absl::StrCat(
+        "The new rendered template string does not start with the previous "
+        "rendered template string. \nold_string: ",
+        old_string, "\nnew_string: ", new_string));
+  }
+  return {new_string.substr(old_string.size(),
+                            new_string.size() - old_string.size())};
+}
+
+absl::StatusOr<std::string> Conversation::RenderPrefaceText() const {
+  PromptTemplateInput tmpl_input = preface_tmpl_input_;
+  tmpl_input.now = absl::Now();
+  tmpl_input.add_generation_prompt = false;
+  return prompt_template_.Apply(tmpl_input);
+}
+
+absl::StatusOr<std::string> Conversation::GetSingleTurnText(
+    const Message& message) {
   absl::MutexLock lock(history_mutex_);  // NOLINT
-  for (const auto& history_msg : history_) {
-    if (std::holds_alternative<nlohmann::ordered_json>(history_msg)) {
-      ASSIGN_OR_RETURN(nlohmann::ordered_json message_tmpl_input,
-                       model_data_processor_->MessageToTemplateInput(
-                           std::get<nlohmann::ordered_json>(history_msg)));
-      old_tmpl_input.messages.push_back(message_tmpl_input);
-    } else {
+  // Convert the messages added to the history since the last turn.
+  for (int i = history_tmpl_inputs_.size(); i < history_.size(); ++i) {
+    if (!std::holds_alternative<nlohmann::ordered_json>(history_[i])) {
       return absl::UnimplementedError("Message type is not supported yet");
     }
+    ASSIGN_OR_RETURN(nlohmann::ordered_json message_tmpl_input,
+                     model_data_processor_->MessageToTemplateInput(
+                         std::get<nlohmann::ordered_json>(history_[i])));
+    history_tmpl_inputs_.push_back(std::move(message_tmpl_input));
   }
 
   if (!std::holds_alternative<nlohmann::ordered_json>(message)) {
     return absl::InvalidArgumentError("Json message is required for now.");
   }
-  nlohmann::ordered_json json_message =
+  const nlohmann::ordered_json& json_message =
       std::get<nlohmann::ordered_json>(message);
   nlohmann::ordered_json messages =
       json_message.is_array() ? json_message
                               : nlohmann::ordered_json::array({json_message});
+  std::vector<nlohmann::ordered_json> new_tmpl_inputs;
+  new_tmpl_inputs.reserve(messages.size());
+  for (const auto& message : messages) {
+    ASSIGN_OR_RETURN(nlohmann::ordered_json message_tmpl_input,
+                     model_data_processor_->MessageToTemplateInput(message));
+    new_tmpl_inputs.push_back(std::move(message_tmpl_input));
+  }
+
   if (history_.empty()) {
-    PromptTemplateInput new_tmpl_input = std::move(old_tmpl_input);
-    for (const auto& message : messages) {
-      ASSIGN_OR_RETURN(nlohmann::ordered_json message_tmpl_input,
-                       model_data_processor_->MessageToTemplateInput(message));
-      new_tmpl_input.messages.push_back(message_tmpl_input);
+    // The preface is rendered as part of the first turn.
+    PromptTemplateInput tmpl_input = preface_tmpl_input_;
+    tmpl_input.now = absl::Now();
+    for (auto& message_tmpl_input : new_tmpl_inputs) {
+      tmpl_input.messages.push_back(std::move(message_tmpl_input));
     }
-    new_tmpl_input.add_generation_prompt = true;
-    return prompt_template_.Apply(new_tmpl_input);
+    tmpl_input.add_generation_prompt = true;
+    return prompt_template_.Apply(tmpl_input);
   }
 
-  old_tmpl_input.add_generation_prompt = false;
-  ASSIGN_OR_RETURN(const std::string old_string,
-                   prompt_template_.Apply(old_tmpl_input));
-
-  PromptTemplateInput new_tmpl_input = std::move(old_tmpl_input);
+  // The last turn of the history starts from its last user message.
+  int last_turn_start = history_.size() - 1;
+  while (last_turn_start > 0) {
+    const auto& history_msg =
+        std::get<nlohmann::ordered_json>(history_[last_turn_start]);
+    if (history_msg.is_object() && history_msg.value("role", "") == "user") {
+      break;
+    }
+    --last_turn_start;
+  }
+  const auto last_turn_tmpl_inputs =
+      absl::MakeConstSpan(history_tmpl_inputs_).subspan(last_turn_start);
+  // The template may render a kind of turn differently from the others, e.g.
+  // the tool responses, so each kind of turn is verified on its own.
+  auto get_role = [](const nlohmann::ordered_json& message) -> std::string {
+    return message.is_object() ? message.value("role", "") : "";
+  };
+  std::vector<std::string> roles;
+  for (int i = last_turn_start; i < history_.size(); ++i) {
+    roles.push_back(get_role(std::get<nlohmann::ordered_json>(history_[i])));
+  }
+  roles.push_back(">");
   for (const auto& message : messages) {
-    ASSIGN_OR_RETURN(nlohmann::ordered_json message_tmpl_input,
-                     model_data_processor_->MessageToTemplateInput(message));
-    new_tmpl_input.messages.push_back(message_tmpl_input);
+    roles.push_back(get_role(message));
   }
-  new_tmpl_input.add_generation_prompt = true;
-  ASSIGN_OR_RETURN(const std::string& new_string,
-                   prompt_template_.Apply(new_tmpl_input));
-  if (new_string.substr(0, old_string.size()) != old_string) {
-    return absl::InternalError(absl::StrCat(
-        "The new rendered template string does not start with the previous "
-        "rendered template string. \nold_string: ",
-        old_string, "\nnew_string: ", new_string));
+  int& num_checks = num_incremental_render_checks_[absl::StrJoin(roles, ",")];
+  if (incremental_render_supported_ &&
+      num_checks >= kNumIncrementalRenderChecks) {
+    absl::StatusOr<std::string> turn_text = RenderTurnText(
+        last_turn_tmpl_inputs, new_tmpl_inputs, rendered_preface_);
+    if (turn_text.ok()) {
+      return turn_text;
+    }
+    ABSL_LOG(WARNING) << "Failed to render the last turn of the history, the "
+                         "whole history is rendered instead: "
+                      << turn_text.status();
+    num_checks = 0;
   }
-  return {new_string.substr(old_string.size(),
-                            new_string.size() - old_string.size())};
+
+  ASSIGN_OR_RETURN(std::string turn_text,
+                   RenderTurnText(history_tmpl_inputs_, new_tmpl_inputs));
+  if (incremental_render_supported_ && last_turn_start > 0) {
+    absl::StatusOr<std::string> rendered_preface = RenderPrefaceText();
+    absl::StatusOr<std::string> incremental_turn_text =
+        rendered_preface.ok()
+            ? RenderTurnText(last_turn_tmpl_inputs, new_tmpl_inputs,
+                             *rendered_preface)
+            : rendered_preface.status();
+    if (incremental_turn_text.ok() && *incremental_turn_text == turn_text) {
+      rendered_preface_ = *std::move(rendered_preface);
+      ++num_checks;
+    } else {
+      ABSL_LOG(INFO) << "The prompt template depends on the earlier turns, "
+                        "the whole history will be rendered for every turn.";
+      incremental_render_supported_ = false;
+    }
+  }
+  return turn_text;
 }
 
 absl::StatusOr<DecodeConfig> Conversation::CreateDecodeConfig() {
@@ -210,10 +314,13 @@ absl::StatusOr<std::unique_ptr<Conversation>> Conversation::Create(
       std::unique_ptr<ModelDataProcessor> model_data_processor,
       CreateModelDataProcessor(config.GetProcessorConfig(),
                                session->GetTokenizer(), config.GetPreface()));
+  ASSIGN_OR_RETURN(
+      PromptTemplateInput preface_tmpl_input,
+      CreatePrefaceTemplateInput(config.GetPreface(), *model_data_processor));
 
   auto conversation = absl::WrapUnique(new Conversation(
       std::move(session), std::move(model_data_processor), config.GetPreface(),
-      config.GetPromptTemplate(), config));
+      std::move(preface_tmpl_input), config.GetPromptTemplate(), config));
   return conversation;
 }
 
@@ -285,6 +392,9 @@ absl::Status Conversation::SendMessageAsync(
   absl::AnyInvocable<void()> cancel_callback = [this]() {
     absl::MutexLock lock(this->history_mutex_);  // NOLINT
     this->history_.pop_back();
+    if (this->history_tmpl_inputs_.size() > this->history_.size()) {
+      this->history_tmpl_inputs_.resize(this->history_.size());
+    }
   };
 
   absl::AnyInvocable<void(absl::StatusOr<Responses>)> internal_callback =
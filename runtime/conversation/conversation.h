@@ -22,10 +22,14 @@
 #include <vector>
 
 #include "absl/base/thread_annotations.h"  // from @com_google_absl
+#include "absl/container/flat_hash_map.h"  // from @com_google_absl
 #include "absl/functional/any_invocable.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/string_view.h"  // from @com_google_absl
 #include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+#include "nlohmann/json.hpp"  // from @nlohmann_json
 #include "runtime/components/constrained_decoding/constraint.h"
 #include "runtime/components/prompt_template.h"
 #include "runtime/conversation/io_types.h"
@@ -254,20 +258,44 @@ class Conversation {
   explicit Conversation(
       std::unique_ptr<Engine::Session> session,
       std::unique_ptr<ModelDataProcessor> model_data_processor, Preface preface,
-      PromptTemplate prompt_template, ConversationConfig config)
+      PromptTemplateInput preface_tmpl_input, PromptTemplate prompt_template,
+      ConversationConfig config)
       : session_(std::move(session)),
         model_data_processor_(std::move(model_data_processor)),
         preface_(preface),
+        preface_tmpl_input_(std::move(preface_tmpl_input)),
         prompt_template_(std::move(prompt_template)),
         config_(config) {}
 
-  absl::StatusOr<std::string> GetSingleTurnText(const Message& message) const;
+  // Returns the text which sending the message adds to the rendered prompt of
+  // the conversation.
+  //
+  // Rendering the whole history for every turn makes the cost of a turn grow
+  // with the history. So once the template is verified to render the same
+  // turn text from the last turn of the history only for a kind of turn, e.g.
+  // it has no dependency on the earlier messages, only the last turn is
+  // rendered for the turns of that kind. The whole history is rendered again
+  // if rendering the last turn fails.
+  absl::StatusOr<std::string> GetSingleTurnText(const Message& message);
+
+  // Returns the text which appending the `new_tmpl_inputs` to the
+  // `history_tmpl_inputs` adds to the rendered prompt. Returns an error if the
+  // rendered history does not start with `rendered_prefix`.
+  absl::StatusOr<std::string> RenderTurnText(
+      absl::Span<const nlohmann::ordered_json> history_tmpl_inputs,
+      absl::Span<const nlohmann::ordered_json> new_tmpl_inputs,
+      absl::string_view rendered_prefix = "") const;
+
+  // Returns the rendered prompt of the preface alone.
+  absl::StatusOr<std::string> RenderPrefaceText() const;
 
   absl::StatusOr<DecodeConfig> CreateDecodeConfig();
 
   std::unique_ptr<Engine::Session> session_;
   std::unique_ptr<ModelDataProcessor> model_data_processor_;
   Preface preface_;
+  // The template input of the preface, which is created once.
+  const PromptTemplateInput preface_tmpl_input_;
   PromptTemplate prompt_template_;
   // The constraint is currently created from the tools defined in the preface,
   // if any.
@@ -275,6 +303,20 @@ class Conversation {
   const ConversationConfig config_;
   mutable absl::Mutex history_mutex_;
   std::vector<Message> history_ ABSL_GUARDED_BY(history_mutex_);
+  // The template inputs of the messages in the history, which are converted
+  // once per message.
+  std::vector<nlohmann::ordered_json> history_tmpl_inputs_
+      ABSL_GUARDED_BY(history_mutex_);
+  // The number of turns where rendering only the last turn of the history
+  // gave the same turn text as rendering the whole history, by the kind of the
+  // turn, i.e. the roles of the messages in the last turn and the new ones.
+  absl::flat_hash_map<std::string, int> num_incremental_render_checks_
+      ABSL_GUARDED_BY(history_mutex_);
+  // The rendered preface of the last time the whole history was rendered. The
+  // rendered last turn of the history must start with it.
+  std::string rendered_preface_ ABSL_GUARDED_BY(history_mutex_);
+  // Whether rendering only the last turn of the history can be used.
+  bool incremental_render_supported_ ABSL_GUARDED_BY(history_mutex_) = true;
 };
 }  // namespace litert::lm
 
@@ -502,6 +502,139 @@ TEST(ConversationTest, SendMultipleMessagesWithHistory) {
                                    assistant_message_2));
 }
 
+TEST(ConversationTest, SendMessagesInManyTurns) {
+  // Set up mock Session.
+  auto mock_session = std::make_unique<MockSession>();
+  MockSession* mock_session_ptr = mock_session.get();
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.SetStartTokenId(0);
+  session_config.GetMutableStopTokenIds().push_back({1});
+  *session_config.GetMutableLlmModelType().mutable_gemma3() = {};
+  session_config.GetMutableJinjaPromptTemplate() = kTestJinjaPromptTemplate;
+  EXPECT_CALL(*mock_session_ptr, GetSessionConfig())
+      .WillRepeatedly(testing::ReturnRef(session_config));
+  auto mock_tokenizer = std::make_unique<MockTokenizer>();
+  EXPECT_CALL(*mock_session_ptr, GetTokenizer())
+      .WillRepeatedly(testing::ReturnRef(*mock_tokenizer));
+
+  // Set up mock Engine.
+  auto mock_engine = std::make_unique<MockEngine>();
+  EXPECT_CALL(*mock_engine, CreateSession(testing::_))
+      .WillOnce(testing::Return(std::move(mock_session)));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(GetTestdataPath(kTestLlmPath)));
+  ASSERT_OK_AND_ASSIGN(auto engine_settings, EngineSettings::CreateDefault(
+                                                 model_assets, Backend::CPU));
+  EXPECT_CALL(*mock_engine, GetEngineSettings())
+      .WillRepeatedly(testing::ReturnRef(engine_settings));
+
+  // Create Conversation.
+  ASSERT_OK_AND_ASSIGN(auto conversation_config,
+                       ConversationConfig::CreateFromSessionConfig(
+                           *mock_engine, session_config));
+  ASSERT_OK_AND_ASSIGN(auto conversation,
+                       Conversation::Create(*mock_engine, conversation_config));
+
+  // The turn text stays the same after the history is long enough to render
+  // only the last turn of it.
+  constexpr int kNumTurns = 6;
+  for (int i = 0; i < kNumTurns; ++i) {
+    JsonMessage user_message = {{"role", "user"},
+                                {"content", absl::StrCat("foo ", i)}};
+    const std::string expected_input_text =
+        absl::StrCat("<start_of_turn>user\nfoo ", i, "<end_of_turn>\n");
+    EXPECT_CALL(*mock_session_ptr,
+                RunPrefill(testing::ElementsAre(
+                    testing::VariantWith<InputText>(testing::Property(
+                        &InputText::GetRawTextString, expected_input_text)))))
+        .WillOnce(testing::Return(absl::OkStatus()));
+    EXPECT_CALL(*mock_session_ptr, RunDecode(testing::_))
+        .WillOnce(testing::Return(
+            Responses(TaskState::kProcessing, {absl::StrCat("bar ", i)})));
+    ASSERT_OK(conversation->SendMessage(user_message));
+  }
+  EXPECT_EQ(conversation->GetHistory().size(), 2 * kNumTurns);
+}
+
+TEST(ConversationTest, SendMessageOfNewTurnKindRendersWholeHistory) {
+  // The system messages are numbered by their position in the whole history.
+  constexpr absl::string_view kNumberedSystemPromptTemplate = R"jinja(
+{%- for message in messages -%}
+  {%- if message.role == 'system' -%}
+    {{ '<start_of_turn>system ' }}{{ loop.index }}{{ '\n' }}
+  {%- else -%}
+    {{ '<start_of_turn>' + message.role + '\n' }}
+  {%- endif -%}
+  {{ message.content + '<end_of_turn>\n' }}
+{%- endfor -%}
+)jinja";
+  // Set up mock Session.
+  auto mock_session = std::make_unique<MockSession>();
+  MockSession* mock_session_ptr = mock_session.get();
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.SetStartTokenId(0);
+  session_config.GetMutableStopTokenIds().push_back({1});
+  *session_config.GetMutableLlmModelType().mutable_gemma3() = {};
+  session_config.GetMutableJinjaPromptTemplate() =
+      kNumberedSystemPromptTemplate;
+  EXPECT_CALL(*mock_session_ptr, GetSessionConfig())
+      .WillRepeatedly(testing::ReturnRef(session_config));
+  auto mock_tokenizer = std::make_unique<MockTokenizer>();
+  EXPECT_CALL(*mock_session_ptr, GetTokenizer())
+      .WillRepeatedly(testing::ReturnRef(*mock_tokenizer));
+
+  // Set up mock Engine.
+  auto mock_engine = std::make_unique<MockEngine>();
+  EXPECT_CALL(*mock_engine, CreateSession(testing::_))
+      .WillOnce(testing::Return(std::move(mock_session)));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(GetTestdataPath(kTestLlmPath)));
+  ASSERT_OK_AND_ASSIGN(auto engine_settings, EngineSettings::CreateDefault(
+                                                 model_assets, Backend::CPU));
+  EXPECT_CALL(*mock_engine, GetEngineSettings())
+      .WillRepeatedly(testing::ReturnRef(engine_settings));
+
+  // Create Conversation.
+  ASSERT_OK_AND_ASSIGN(auto conversation_config,
+                       ConversationConfig::CreateFromSessionConfig(
+                           *mock_engine, session_config));
+  ASSERT_OK_AND_ASSIGN(auto conversation,
+                       Conversation::Create(*mock_engine, conversation_config));
+
+  // Enough user turns to render only the last turn of the history for them.
+  constexpr int kNumUserTurns = 5;
+  for (int i = 0; i < kNumUserTurns; ++i) {
+    JsonMessage user_message = {{"role", "user"},
+                                {"content", absl::StrCat("foo ", i)}};
+    EXPECT_CALL(*mock_session_ptr,
+                RunPrefill(testing::ElementsAre(
+                    testing::VariantWith<InputText>(testing::Property(
+                        &InputText::GetRawTextString,
+                        absl::StrCat("<start_of_turn>user\nfoo ", i,
+                                     "<end_of_turn>\n"))))))
+        .WillOnce(testing::Return(absl::OkStatus()));
+    EXPECT_CALL(*mock_session_ptr, RunDecode(testing::_))
+        .WillOnce(testing::Return(
+            Responses(TaskState::kProcessing, {absl::StrCat("bar ", i)})));
+    ASSERT_OK(conversation->SendMessage(user_message));
+  }
+
+  // The system message is a new kind of turn, so it is rendered with the whole
+  // history and numbered after all the earlier messages.
+  JsonMessage system_message = {{"role", "system"}, {"content", "baz"}};
+  EXPECT_CALL(*mock_session_ptr,
+              RunPrefill(testing::ElementsAre(testing::VariantWith<InputText>(
+                  testing::Property(&InputText::GetRawTextString,
+                                    absl::StrCat("<start_of_turn>system ",
+                                                 2 * kNumUserTurns + 1,
+                                                 "\nbaz<end_of_turn>\n"))))))
+      .WillOnce(testing::Return(absl::OkStatus()));
+  EXPECT_CALL(*mock_session_ptr, RunDecode(testing::_))
+      .WillOnce(
+          testing::Return(Responses(TaskState::kProcessing, {"qux"})));
+  ASSERT_OK(conversation->SendMessage(system_message));
+}
+
 TEST(ConversationTest, SendMessageAsync) {
   ASSERT_OK_AND_ASSIGN(auto model_assets,
                        ModelAssets::Create(GetTestdataPath(kTestLlmPath)));
@@ -17,14 +17,17 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <optional>
 #include <string>
 #include <utility>
+#include <variant>
 
 #include "absl/functional/any_invocable.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/match.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "nlohmann/json.hpp"  // from @nlohmann_json
 #include "runtime/conversation/io_types.h"
 #include "runtime/conversation/model_data_processor/config_registry.h"
 #include "runtime/conversation/model_data_processor/model_data_processor.h"
@@ -51,19 +54,81 @@ size_t SuffixPrefixOverlap(absl::string_view a, absl::string_view b) {
   return 0;
 };
 
+// The message of the whole response, merged from the messages of the
+// response chunks.
+struct StreamedMessage {
+  JsonMessage message;
+  // Whether the last chunk message only has text contents and is not a tool
+  // code block, so that the text contents of the next chunk message are merged
+  // into its last one.
+  bool ends_with_text = false;
+};
+
+// Appends the message of a response chunk to the message of the whole
+// response, so that the whole response doesn't need to be parsed again once it
+// is complete. The consecutive text contents are merged into one, as if the
+// whole response was parsed at once. `is_code_block` tells if the chunk is a
+// whole code fenced block, which ends the text before it even if it has no
+// contents, e.g. an empty tool code block. Returns false if the chunk message
+// is not a JSON object, or has a different role.
+bool AppendChunkMessage(const Message& chunk_message, bool is_code_block,
+                        StreamedMessage& streamed_message) {
+  const auto* json_chunk_message = std::get_if<JsonMessage>(&chunk_message);
+  if (json_chunk_message == nullptr || !json_chunk_message->is_object()) {
+    return false;
+  }
+  JsonMessage& message = streamed_message.message;
+  if (message.is_null()) {
+    message = {{"role", json_chunk_message->value("role", "")}};
+  } else if (message["role"] != json_chunk_message->value("role", "")) {
+    return false;
+  }
+  bool ends_with_text = !is_code_block;
+  for (const auto& [key, value] : json_chunk_message->items()) {
+    if (key == "role") {
+      continue;
+    }
+    if (!value.is_array()) {
+      return false;
+    }
+    JsonMessage& message_value = message[key];
+    for (const auto& item : value) {
+      const bool is_text = key == "content" && item.value("type", "") == "text";
+      if (is_text && streamed_message.ends_with_text &&
+          !message_value.empty()) {
+        message_value.back()["text"] =
+            message_value.back()["text"].get<std::string>() +
+            item["text"].get<std::string>();
+      } else {
+        message_value.push_back(item);
+      }
+      ends_with_text = ends_with_text && is_text;
+    }
+  }
+  streamed_message.ends_with_text = ends_with_text;
+  return true;
+}
+
 void SendMessage(
     absl::AnyInvocable<void(absl::StatusOr<Message>)>& user_callback,
     absl::string_view text, const ModelDataProcessor& model_data_processor,
-    DataProcessorArguments processor_args) {
+    DataProcessorArguments processor_args,
+    std::optional<StreamedMessage>& streamed_message,
+    bool is_code_block = false) {
   if (text.empty()) {
     return;
   }
   auto message = model_data_processor.ToMessage(
       Responses(TaskState::kProcessing, {std::string(text)}), processor_args);
   if (!message.ok()) {
+    streamed_message.reset();
     user_callback(message.status());
     return;
   }
+  if (streamed_message.has_value() &&
+      !AppendChunkMessage(*message, is_code_block, *streamed_message)) {
+    streamed_message.reset();
+  }
   user_callback(std::move(message.value()));
 }
 
@@ -72,15 +137,30 @@ void SendCompleteMessage(
     absl::string_view accumulated_response_text,
     const ModelDataProcessor& model_data_processor,
     DataProcessorArguments processor_args, int cursor,
+    std::optional<StreamedMessage>& streamed_message,
     absl::AnyInvocable<void(Message)>& complete_message_callback) {
   if (cursor < accumulated_response_text.size()) {
     SendMessage(user_callback, accumulated_response_text.substr(cursor),
-                model_data_processor, processor_args);
+                model_data_processor, processor_args, streamed_message);
+  }
+  absl::StatusOr<Message> complete_message;
+  if (streamed_message.has_value() && !streamed_message->message.is_null()) {
+    JsonMessage& message = streamed_message->message;
+    // The data processors put the content before the tool calls.
+    if (message.contains("content") && message.contains("tool_calls")) {
+      JsonMessage tool_calls = std::move(message["tool_calls"]);
+      message.erase("tool_calls");
+      message["tool_calls"] = std::move(tool_calls);
+    }
+    complete_message = std::move(message);
+  } else {
+    // Parse the whole response if the chunk messages couldn't be merged, or
+    // there was no chunk.
+    complete_message = model_data_processor.ToMessage(
+        Responses(TaskState::kProcessing,
+                  {std::string(accumulated_response_text)}),
+        processor_args);
   }
-  const auto& complete_message = model_data_processor.ToMessage(
-      Responses(TaskState::kProcessing,
-                {std::string(accumulated_response_text)}),
-      processor_args);
   if (!complete_message.ok()) {
     user_callback(complete_message.status());
     return;
@@ -104,8 +184,10 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
           cancel_callback = std::move(cancel_callback),
           complete_message_callback = std::move(complete_message_callback),
           accumulated_response_text = std::string(), cursor = 0,
-          inside_tool_call =
-              false](absl::StatusOr<Responses> responses) mutable {
+          inside_tool_call = false, code_fence_end_search_pos = size_t{0},
+          streamed_message =
+              std::optional<StreamedMessage>(StreamedMessage())](
+             absl::StatusOr<Responses> responses) mutable {
     if (!responses.ok()) {
       // If the error is due to maximum kv-cache size reached, then we should
       // trigger the user callback with an OK status to indicate the inference
@@ -114,7 +196,7 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
                                       "Maximum kv-cache size reached")) {
         SendCompleteMessage(user_callback, accumulated_response_text,
                             model_data_processor, processor_args, cursor,
-                            complete_message_callback);
+                            streamed_message, complete_message_callback);
         return;
       }
       // If the error is due to cancellation, then we should trigger the cancel
@@ -131,7 +213,7 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
     if (responses->GetTaskState() == TaskState::kDone) {
       SendCompleteMessage(user_callback, accumulated_response_text,
                           model_data_processor, processor_args, cursor,
-                          complete_message_callback);
+                          streamed_message, complete_message_callback);
       return;
     }
     // Else, add the new response text to the accumulated text and process the
@@ -159,16 +241,18 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
             SendMessage(user_callback,
                         absl::string_view(accumulated_response_text)
                             .substr(cursor, code_fence_start_pos - cursor),
-                        model_data_processor, processor_args);
+                        model_data_processor, processor_args, streamed_message);
 
             // Move cursor up to code_fence_start.
             cursor = code_fence_start_pos;
             inside_tool_call = true;
+            code_fence_end_search_pos = cursor + code_fence_start.size();
           } else {
             // code_fence_start not found, but we still need to check
             // if there's a partial match at the end of the string.
             size_t overlap = SuffixPrefixOverlap(
-                accumulated_response_text.substr(cursor), code_fence_start);
+                absl::string_view(accumulated_response_text).substr(cursor),
+                code_fence_start);
 
             if (overlap > 0) {
               // There's a partial match of the code fence at the end of the
@@ -181,7 +265,8 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
               SendMessage(user_callback,
                           accumulated_response_text.substr(
                               cursor, possible_start_pos - cursor),
-                          model_data_processor, processor_args);
+                          model_data_processor, processor_args,
+                          streamed_message);
 
               // Move cursor up to potential start of code fence.
               cursor = possible_start_pos;
@@ -190,7 +275,8 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
               // Remaining string is text.
               SendMessage(user_callback,
                           accumulated_response_text.substr(cursor),
-                          model_data_processor, processor_args);
+                          model_data_processor, processor_args,
+                          streamed_message);
 
               cursor = accumulated_response_text.size();
             }
@@ -198,15 +284,18 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
         }
 
         if (inside_tool_call) {
-          // Look for code fence end.
+          // Look for code fence end. The tool code block is parsed once, when
+          // the code fence end is found, so only the text which may contain
+          // the code fence end is searched for it again.
           size_t code_fence_end_pos = accumulated_response_text.find(
-              code_fence_end, cursor + code_fence_start.size());
+              code_fence_end, code_fence_end_search_pos);
           if (code_fence_end_pos != std::string::npos) {
             SendMessage(user_callback,
                         accumulated_response_text.substr(
                             cursor, code_fence_end_pos + code_fence_end.size() -
                                         cursor),
-                        model_data_processor, processor_args);
+                        model_data_processor, processor_args, streamed_message,
+                        /*is_code_block=*/true);
 
             // Move cursor to end of tool code block.
             cursor = code_fence_end_pos + code_fence_end.size();
@@ -214,6 +303,12 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateInternalCallback(
           } else {
             // We're inside a tool call but the code fence end has not been
             // found. Break for the next token.
+            if (accumulated_response_text.size() >= code_fence_end.size()) {
+              code_fence_end_search_pos = std::max(
+                  code_fence_end_search_pos,
+                  accumulated_response_text.size() - code_fence_end.size() +
+                      1);
+            }
             break;
           }
         }
@@ -15,6 +15,7 @@
 #include "runtime/conversation/internal_callback_util.h"
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -477,6 +478,65 @@ TEST_F(InternalCallbackTest, TwoConsecutiveToolCodeBlocks) {
                           })json")));
 }
 
+TEST_F(InternalCallbackTest, CompleteMessageIsMergedFromChunks) {
+  auto user_callback = CreateUserMessageCallback(output_, done_, status_);
+  Message complete_message;
+  auto callback = CreateInternalCallback(
+      *model_data_processor_, processor_args_, std::move(user_callback),
+      /*cancel_callback=*/nullptr,
+      [&complete_message](Message message) { complete_message = message; });
+
+  constexpr absl::string_view kResponseChunks[] = {
+      "this ",         "is ",   "some ", "text\n", "```tool_code\n",
+      "tool_name",     "(x=1)", "\n```", "\nmore ", "text",
+  };
+  std::string response_text;
+  for (absl::string_view chunk : kResponseChunks) {
+    callback(Responses(TaskState::kProcessing, {std::string(chunk)}));
+    response_text += chunk;
+  }
+  callback(Responses(TaskState::kDone));
+
+  EXPECT_TRUE(done_);
+  EXPECT_OK(status_);
+  // The complete message is the same as parsing the whole response at once.
+  ASSERT_OK_AND_ASSIGN(
+      Message expected_message,
+      model_data_processor_->ToMessage(
+          Responses(TaskState::kProcessing, {response_text}), processor_args_));
+  EXPECT_EQ(std::get<JsonMessage>(complete_message),
+            std::get<JsonMessage>(expected_message));
+}
+
+TEST_F(InternalCallbackTest, EmptyToolCodeBlockSeparatesTexts) {
+  auto user_callback = CreateUserMessageCallback(output_, done_, status_);
+  Message complete_message;
+  auto callback = CreateInternalCallback(
+      *model_data_processor_, processor_args_, std::move(user_callback),
+      /*cancel_callback=*/nullptr,
+      [&complete_message](Message message) { complete_message = message; });
+
+  constexpr absl::string_view kResponseChunks[] = {
+      "some text\n", "```tool_code\n", "```", "\nmore text"};
+  std::string response_text;
+  for (absl::string_view chunk : kResponseChunks) {
+    callback(Responses(TaskState::kProcessing, {std::string(chunk)}));
+    response_text += chunk;
+  }
+  callback(Responses(TaskState::kDone));
+
+  EXPECT_TRUE(done_);
+  EXPECT_OK(status_);
+  // The texts before and after the empty tool code block are not merged, the
+  // same as parsing the whole response at once.
+  ASSERT_OK_AND_ASSIGN(
+      Message expected_message,
+      model_data_processor_->ToMessage(
+          Responses(TaskState::kProcessing, {response_text}), processor_args_));
+  EXPECT_EQ(std::get<JsonMessage>(complete_message),
+            std::get<JsonMessage>(expected_message));
+}
+
 TEST_F(InternalCallbackTest, IncompleteToolCodeBlock) {
   auto user_callback = CreateUserMessageCallback(output_, done_, status_);
   auto callback = CreateInternalCallback(
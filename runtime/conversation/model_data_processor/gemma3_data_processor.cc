@@ -14,10 +14,12 @@
 
 #include "runtime/conversation/model_data_processor/gemma3_data_processor.h"
 
+#include <algorithm>
 #include <deque>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>  // NOLINT: Required for hardware_concurrency.
 #include <utility>
 #include <variant>
 #include <vector>
@@ -39,6 +41,7 @@
 #include "runtime/conversation/model_data_processor/data_utils.h"
 #include "runtime/conversation/model_data_processor/gemma3_data_processor_config.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/util/memory_mapped_file.h"
 #include "runtime/util/status_macros.h"
 #include "re2/re2.h"  // from @com_googlesource_code_re2
@@ -69,12 +72,19 @@ bool IsToolMessage(const ordered_json& message) {
 absl::StatusOr<std::unique_ptr<Gemma3DataProcessor>>
 Gemma3DataProcessor::Create(Gemma3DataProcessorConfig config,
                             std::optional<Preface> preface) {
+  // The frames of long audio clips are split across the cores, including the
+  // calling thread. The threads are only started by the first long clip.
+  auto audio_thread_pool = std::make_unique<ThreadPool>(
+      /*name_prefix=*/"audio_preprocessor",
+      /*max_num_threads=*/std::max(
+          static_cast<int>(std::thread::hardware_concurrency()) - 1, 1));
   ASSIGN_OR_RETURN(auto audio_preprocessor,
                    AudioPreprocessorMiniAudio::Create(
-                       AudioPreprocessorConfig::CreateDefaultUsmConfig()));
+                       AudioPreprocessorConfig::CreateDefaultUsmConfig(),
+                       audio_thread_pool.get()));
   return absl::WrapUnique(new Gemma3DataProcessor(
       config, preface, std::make_unique<StbImagePreprocessor>(),
-      std::move(audio_preprocessor)));
+      std::move(audio_thread_pool), std::move(audio_preprocessor)));
 }
 
 absl::StatusOr<ordered_json> Gemma3DataProcessor::MessageToTemplateInput(
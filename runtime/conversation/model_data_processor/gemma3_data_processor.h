@@ -30,6 +30,7 @@
 #include "runtime/conversation/model_data_processor/gemma3_data_processor_config.h"
 #include "runtime/conversation/model_data_processor/model_data_processor.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/framework/threadpool.h"
 
 namespace litert::lm {
 
@@ -67,10 +68,12 @@ class Gemma3DataProcessor
       const Gemma3DataProcessorConfig& config = Gemma3DataProcessorConfig(),
       std::optional<Preface> preface = std::nullopt,
       std::unique_ptr<ImagePreprocessor> image_preprocessor = nullptr,
+      std::unique_ptr<ThreadPool> audio_thread_pool = nullptr,
       std::unique_ptr<AudioPreprocessor> audio_preprocessor = nullptr)
       : config_(config),
         preface_(preface),
         image_preprocessor_(std::move(image_preprocessor)),
+        audio_thread_pool_(std::move(audio_thread_pool)),
         audio_preprocessor_(std::move(audio_preprocessor)) {};
 
   absl::StatusOr<std::vector<InputData>> ToInputDataVectorImpl(
@@ -85,6 +88,10 @@ class Gemma3DataProcessor
   Gemma3DataProcessorConfig config_;
   std::optional<Preface> preface_;
   std::unique_ptr<ImagePreprocessor> image_preprocessor_;
+  // The thread pool the audio preprocessor splits the frames of long audio
+  // clips across. Declared before the audio preprocessor so that it outlives
+  // the preprocessor.
+  std::unique_ptr<ThreadPool> audio_thread_pool_;
   std::unique_ptr<AudioPreprocessor> audio_preprocessor_;
 };
 
@@ -14,10 +14,12 @@
 
 // TODO(b/417209286): Remove this once the model assets are stored in the
 // litertlm file format.
+#include <cstdint>
 #include <filesystem>  // NOLINT: Required for path manipulation.
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>  // NOLINT: For hardware_concurrency().
 #include <utility>
 #include <vector>
 
@@ -29,10 +31,12 @@
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
 #include "absl/time/time.h"  // from @com_google_absl
 #include "litert/cc/litert_environment.h"  // from @litert
 #include "litert/cc/litert_macros.h"  // from @litert
 #include "runtime/components/model_resources.h"
+#include "runtime/core/executor_locks.h"
 #include "runtime/core/session_factory.h"
 #include "runtime/engine/engine.h"
 #include "runtime/engine/engine_settings.h"
@@ -149,8 +153,16 @@ class EngineImpl : public Engine {
     return InitializeSession(executor_.get(), tokenizer,
                              /*vision_executor=*/vision_executor_.get(),
                              /*audio_executor=*/audio_executor_.get(), config,
-                             benchmark_info_, worker_thread_pool_.get());
+                             benchmark_info_, worker_thread_pool_.get(),
+                             &executor_locks_);
   }
+  absl::Status LoadLoRA(uint32_t lora_id,
+                        const ModelAssets& model_assets) override {
+    // Locked since the executor may be in use by the sessions.
+    absl::MutexLock lock(executor_locks_.llm_executor_mutex);
+    return executor_->LoadLoRA(lora_id, model_assets);
+  }
+
   absl::Status WaitUntilDone(absl::Duration timeout) override {
     return worker_thread_pool_->WaitUntilDone(timeout);
   }
@@ -177,7 +189,12 @@ class EngineImpl : public Engine {
   // Benchmark info for the engine.
   std::optional<BenchmarkInfo> benchmark_info_;
 
-  // Thread pool for the engine to execute the works.
+  // Locks serializing the use of the executors shared by the sessions, which
+  // run on the worker threads in parallel.
+  mutable ExecutorLocks executor_locks_;
+
+  // Thread pool for the engine to execute the works. Each session runs its
+  // works in order on a serial executor of its own.
   std::unique_ptr<ThreadPool> worker_thread_pool_;
 };
 
@@ -261,10 +278,12 @@ absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateEngine(
         benchmark_info->TimeInitPhaseEnd("Executor initialization"));
   }
 
-  // Creating the thread pool of a single thread to execute the works.
-  auto worker_thread_pool =
-      std::make_unique<ThreadPool>(/*name_prefix=*/"engine",
-                                   /*max_num_threads=*/1);
+  // Creating the thread pool sized to the machine to execute the works of the
+  // sessions in parallel. The use of the executors is serialized by the
+  // executor locks.
+  auto worker_thread_pool = std::make_unique<ThreadPool>(
+      /*name_prefix=*/"engine",
+      /*max_num_threads=*/std::thread::hardware_concurrency());
   auto llm_impl = std::make_unique<EngineImpl>(
       std::move(engine_settings), std::move(model_resources),
       std::move(executor), std::move(vision_executor),
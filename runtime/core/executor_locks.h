@@ -0,0 +1,43 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_CORE_EXECUTOR_LOCKS_H_
+#define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_CORE_EXECUTOR_LOCKS_H_
+
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+// The locks serializing the use of the executors an engine shares among its
+// sessions. The executors are not thread-safe, while the sessions run their
+// work in parallel on the worker threads of the engine. Each executor has its
+// own lock, so that e.g. a session encoding an image doesn't block the other
+// sessions from decoding.
+struct ExecutorLocks {
+  // Held while running the LLM executor, including switching its context.
+  absl::Mutex llm_executor_mutex;
+  // Held while running the vision executor.
+  absl::Mutex vision_executor_mutex;
+  // Held while running the audio executor.
+  absl::Mutex audio_executor_mutex;
+  // The session with an audio stream open on the audio executor, if any, since
+  // the executor encodes a single stream at a time. Guarded by
+  // audio_executor_mutex.
+  const void* audio_stream_owner = nullptr;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_CORE_EXECUTOR_LOCKS_H_
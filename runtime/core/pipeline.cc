@@ -19,7 +19,6 @@
 #include <limits>
 #include <memory>
 #include <optional>
-#include <queue>
 #include <string>
 #include <utility>
 #include <vector>
@@ -41,12 +40,16 @@
 #include "runtime/components/sampler.h"
 #include "runtime/components/scoring_cpu_util.h"
 #include "runtime/components/stop_token_detector.h"
+#include "runtime/components/streaming_detokenizer.h"
 #include "runtime/components/tokenizer.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/executor/kv_cache_prefix_cache.h"
 #include "runtime/executor/llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/llm_executor_settings.h"
 #include "runtime/executor/llm_litert_compiled_model_executor.h"
+#include "runtime/executor/speculative_decoding_util.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/proto/sampler_params.pb.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/status_macros.h"  //NOLINT
@@ -67,9 +70,31 @@ int TryGetMaxNumTokens(const LlmExecutor& executor) {
                       << settings.status();
     return kDefaultMaxNumTokens;
   }
+  const auto& advanced_settings = settings->GetAdvancedSettings();
+  if (advanced_settings && advanced_settings->enable_context_shifting) {
+    // The executor evicts the oldest tokens to make room, but never the
+    // attention sinks, so a prompt must fit in the rest of the KV cache.
+    return std::max(settings->GetMaxNumTokens() -
+                        advanced_settings->num_attention_sink_tokens,
+                    0);
+  }
   return settings->GetMaxNumTokens();
 }
 
+// Returns the max number of tokens the decoding loop may reach, i.e. the max
+// number of tokens, or no limit if the executor shifts the context instead of
+// running out of the KV cache.
+int TryGetMaxNumDecodeTokens(const LlmExecutor& executor) {
+  auto settings = executor.GetExecutorSettings();
+  if (settings.ok()) {
+    const auto& advanced_settings = settings->GetAdvancedSettings();
+    if (advanced_settings && advanced_settings->enable_context_shifting) {
+      return std::numeric_limits<int>::max();
+    }
+  }
+  return TryGetMaxNumTokens(executor);
+}
+
 // Check whether the decoding loop should stop.
 bool ShouldStop(bool hit_stop_tokens, int benchmark_decode_token_count,
                 int num_decoded_steps, int current_step, int max_num_tokens) {
@@ -98,16 +123,25 @@ class DecodeOneStep {
                 Tokenizer* absl_nonnull tokenizer, int num_output_candidates,
                 const StopTokenDetector& stop_token_detector,
                 std::optional<BenchmarkInfo>& benchmark_info,
-                std::optional<Sampler*> sampler, Constraint* constraint)
+                std::optional<Sampler*> sampler, Constraint* constraint,
+                SpeculativeDecodingMode speculative_decoding_mode =
+                    SpeculativeDecodingMode::kDraftModel,
+                ThreadPool* constraint_thread_pool = nullptr)
       : executor_(*executor),
         tokenizer_(*tokenizer),
         num_output_candidates_(num_output_candidates),
         sampler_(sampler),
+        speculative_decoding_mode_(speculative_decoding_mode),
         benchmark_info_(benchmark_info),
         stop_token_detector_(stop_token_detector) {
     if (constraint != nullptr) {
+      if (constraint_thread_pool == nullptr) {
+        owned_constraint_thread_pool_ = std::make_unique<ThreadPool>(
+            /*name_prefix=*/"constraint", /*max_num_threads=*/1);
+        constraint_thread_pool = owned_constraint_thread_pool_.get();
+      }
       constrained_decoder_ = std::make_unique<ConstrainedDecoder>(
-          constraint, num_output_candidates_);
+          constraint, num_output_candidates_, constraint_thread_pool);
     }
     if (!sampler_.has_value()) {  // Internal sampling setup
       auto output_tokens = CreateTensorBuffer<int>({num_output_candidates_, 1});
@@ -117,10 +151,9 @@ class DecodeOneStep {
       scores_tensor_ = std::move(*scores_tensor);
     }
     result_text_ = std::vector<std::string>(num_output_candidates_, "");
-    bpe_partial_token_ids_ =
+    pending_stop_text_ = std::vector<std::string>(num_output_candidates_);
+    pending_stop_token_lengths_ =
         std::vector<std::vector<int>>(num_output_candidates_);
-    pending_stop_tokens_ =
-        std::vector<std::queue<std::string>>(num_output_candidates_);
   }
 
   // Runs one step of the decode process and returns if all stops for all
@@ -131,14 +164,10 @@ class DecodeOneStep {
       std::optional<litert::TensorBuffer*> decoded_ids = std::nullopt) {
     ASSIGN_OR_RETURN(litert::TensorBuffer * next_tokens_buffer,
                      DecodeAndSample(decoded_ids));
-
-    // Post-processing the next tokens.
-    ASSIGN_OR_RETURN(auto token_ids,
-                     tokenizer_.TensorBufferToTokenIds(*next_tokens_buffer));
-
-    // Merge BPE partial token ids with the next token ids if any.
-    ASSIGN_OR_RETURN(
-        token_ids, tokenizer_.MergeTokenIds(bpe_partial_token_ids_, token_ids));
+    if (detokenizer_ == nullptr) {
+      ASSIGN_OR_RETURN(detokenizer_, tokenizer_.CreateStreamingDetokenizer(
+                                         num_output_candidates_));
+    }
 
     // Regardless of BPE, we always process the next tokens to detect stop
     // tokens.
@@ -147,33 +176,21 @@ class DecodeOneStep {
         ReferTensorBufferAsSpan<int>(*next_tokens_buffer));
     RETURN_IF_ERROR(stop_token_detector_.ProcessTokens(next_tokens_span));
 
-    auto decoded_result =
-        tokenizer_.TokenIdsToTexts(num_output_candidates_, token_ids);
+    // The next tokens are of shape [num_output_candidates, steps].
+    const int num_steps = next_tokens_span.size() / num_output_candidates_;
     for (int i = 0; i < num_output_candidates_; ++i) {
-      result_text_[i] = "";
-      if (Tokenizer::IsIncompleteBpeSequence(decoded_result.value()[i])) {
-        bpe_partial_token_ids_[i] = token_ids[i];
-      } else if (!stop_token_detector_.GetStopTokensFound()[i]) {
-        bpe_partial_token_ids_[i].clear();
-
-        // Handle partial stop tokens.
-        int max_length = stop_token_detector_.MaxPartialStopTokenLength(i);
-        if (max_length > 0) {
-          pending_stop_tokens_[i].push(decoded_result.value()[i].value());
+      result_text_[i].clear();
+      for (int step = 0; step < num_steps; ++step) {
+        absl::StatusOr<absl::string_view> decoded = detokenizer_->Decode(
+            i, next_tokens_span[i * num_steps + step]);
+        if (Tokenizer::IsIncompleteBpeSequence(decoded)) {
+          continue;
         }
-        // We only need the latest max_length tokens for partial stop tokens.
-        // Add the extra ones to the result text and we could keep only the
-        // latest max_length stop tokens in the queue.
-        while (pending_stop_tokens_[i].size() > max_length) {
-          result_text_[i] += pending_stop_tokens_[i].front();
-          pending_stop_tokens_[i].pop();
-        }
-
-        // No partial stop token is found - add the current token to the result
-        // text directly - this is the most common case.
-        if (max_length == 0) {
-          result_text_[i] += decoded_result.value()[i].value();
+        RETURN_IF_ERROR(decoded.status());
+        if (stop_token_detector_.GetStopTokensFound()[i]) {
+          continue;
         }
+        AppendToResultText(i, *decoded);
       }
     }
 
@@ -231,6 +248,33 @@ class DecodeOneStep {
   }
 
  private:
+  // Appends the decoded text of a token of candidate `i` to the result text,
+  // holding back the texts of the latest tokens which may be part of a stop
+  // token sequence.
+  void AppendToResultText(int i, absl::string_view text) {
+    std::string& pending_text = pending_stop_text_[i];
+    std::vector<int>& pending_lengths = pending_stop_token_lengths_[i];
+    int max_length = stop_token_detector_.MaxPartialStopTokenLength(i);
+    if (max_length > 0) {
+      pending_text.append(text.data(), text.size());
+      pending_lengths.push_back(text.size());
+    }
+    // We only need the latest max_length tokens for partial stop tokens.
+    // Add the extra ones to the result text and we could keep only the
+    // latest max_length stop tokens pending.
+    while (pending_lengths.size() > max_length) {
+      result_text_[i].append(pending_text, 0, pending_lengths.front());
+      pending_text.erase(0, pending_lengths.front());
+      pending_lengths.erase(pending_lengths.begin());
+    }
+
+    // No partial stop token is found - add the current token to the result
+    // text directly - this is the most common case.
+    if (max_length == 0) {
+      result_text_[i].append(text.data(), text.size());
+    }
+  }
+
   // Runs the core decoding and sampling step, for either internal or external
   // sampling. Returns a pointer to the tensor buffer containing the next token
   // IDs.
@@ -245,13 +289,14 @@ class DecodeOneStep {
                               decoded_ids.value()->Duplicate());
       ExecutorInputs inputs(ExecutorTextData(std::move(duplicate_decoded_ids)),
                             std::nullopt, std::nullopt);
-      // Update constraint state based on the current token id before the
-      // decode.
+      // Update constraint state based on the current token id on the
+      // constraint thread, while the executor decodes.
       if (constrained_decoder_) {
-        LITERT_ASSIGN_OR_RETURN(auto last_token_ids,
-                                decoded_ids.value()->Duplicate());
+        LITERT_ASSIGN_OR_RETURN(
+            auto last_token_ids,
+            ReferTensorBufferAsSpan<int>(*decoded_ids.value()));
         RETURN_IF_ERROR(
-            constrained_decoder_->UpdateConstraintState(last_token_ids));
+            constrained_decoder_->StartUpdateConstraintState(last_token_ids));
       }
       // Decoding section.
       if (benchmark_info_.has_value()) {
@@ -284,9 +329,11 @@ class DecodeOneStep {
         RETURN_IF_ERROR(
             benchmark_info_->TimeMarkDelta("executor_decode_and_sample"));
       }
-      if (constrained_decoder_) {
+      if (constrained_decoder_ || speculative_decoding_mode_ !=
+                                      SpeculativeDecodingMode::kDraftModel) {
         auto decode_params = ExecutorDecodeParams();
         decode_params.SetConstraintDecoder(constrained_decoder_.get());
+        decode_params.SetSpeculativeDecodingMode(speculative_decoding_mode_);
         RETURN_IF_ERROR(executor_.Decode(output_tokens_, decode_params));
       } else {
         RETURN_IF_ERROR(executor_.Decode(output_tokens_));
@@ -303,6 +350,12 @@ class DecodeOneStep {
   Tokenizer& tokenizer_;
   const int num_output_candidates_;
   std::optional<Sampler*> sampler_;
+  // The source of the draft tokens if the executor decodes speculatively.
+  const SpeculativeDecodingMode speculative_decoding_mode_;
+  // The thread pool the constraint states of the next step are computed on
+  // while the executor decodes, if the caller did not provide one. Declared
+  // before the constrained decoder, which waits for it on destruction.
+  std::unique_ptr<ThreadPool> owned_constraint_thread_pool_;
   std::unique_ptr<ConstrainedDecoder> constrained_decoder_;
   std::optional<BenchmarkInfo> benchmark_info_;
   StopTokenDetector stop_token_detector_;
@@ -317,78 +370,143 @@ class DecodeOneStep {
   absl::Span<float> scores_span_;
 
   // Common state
-  std::vector<std::vector<int>> bpe_partial_token_ids_;
-  std::vector<std::queue<std::string>> pending_stop_tokens_;
+  std::unique_ptr<StreamingDetokenizer> detokenizer_;
+  // The texts of the latest tokens of each candidate which may be part of a
+  // stop token sequence, and the text length of each of these tokens.
+  std::vector<std::string> pending_stop_text_;
+  std::vector<std::vector<int>> pending_stop_token_lengths_;
   std::vector<std::string> result_text_;
 };
 
-absl::StatusOr<Responses> DecodeLoop(
-    LlmExecutor& executor, Tokenizer& tokenizer,
-    const StopTokenDetector& stop_token_detector, int num_output_candidates,
-    std::optional<BenchmarkInfo>& benchmark_info,
-    std::optional<Sampler*> sampler, Constraint* constraint,
-    std::optional<litert::TensorBuffer*> decoded_ids,
-    std::optional<absl::AnyInvocable<void(absl::StatusOr<Responses>)>> callback,
-    std::atomic<bool>* cancelled) {
-  const bool is_streaming = callback.has_value();
-  const bool is_custom_sampling = sampler.has_value();
-
-  int benchmark_decode_token_count = 0;
-  if (benchmark_info.has_value()) {
-    // Initialize sampler early if the executor supports it.
-    auto* compiled_model_executor =
-        dynamic_cast<LlmLiteRtCompiledModelExecutorBase*>(&executor);
-    if (compiled_model_executor != nullptr) {
-      compiled_model_executor->InitializeSampler().IgnoreError();
+// Runs the decode loop incrementally. Each RunSteps() call runs a limited
+// number of decode steps, so that the decode steps of multiple sessions can be
+// interleaved on the same executor.
+class DecodeLoopTask : public DecodeTask {
+ public:
+  DecodeLoopTask(
+      LlmExecutor& executor, Tokenizer& tokenizer,
+      const StopTokenDetector& stop_token_detector, int num_output_candidates,
+      std::optional<BenchmarkInfo>& benchmark_info,
+      std::optional<Sampler*> sampler, Constraint* constraint,
+      std::optional<litert::TensorBuffer*> decoded_ids,
+      std::optional<absl::AnyInvocable<void(absl::StatusOr<Responses>)>>
+          callback,
+      std::atomic<bool>* cancelled,
+      SpeculativeDecodingMode speculative_decoding_mode,
+      ThreadPool* constraint_thread_pool)
+      : executor_(executor),
+        benchmark_info_(benchmark_info),
+        num_output_candidates_(num_output_candidates),
+        is_custom_sampling_(sampler.has_value()),
+        decoded_ids_(decoded_ids),
+        callback_(std::move(callback)),
+        cancelled_(cancelled),
+        max_num_tokens_(TryGetMaxNumDecodeTokens(executor)),
+        final_texts_(num_output_candidates),
+        final_scores_(num_output_candidates),
+        accumulated_scores_(num_output_candidates),
+        num_decoded_tokens_(num_output_candidates),
+        run_one_step_(&executor, &tokenizer, num_output_candidates,
+                      stop_token_detector, benchmark_info, sampler, constraint,
+                      speculative_decoding_mode, constraint_thread_pool) {}
+
+  // Starts the decode turn. Must be called once before RunSteps().
+  absl::Status Start() {
+    if (benchmark_info_.has_value()) {
+      // Initialize sampler early if the executor supports it.
+      auto* compiled_model_executor =
+          dynamic_cast<LlmLiteRtCompiledModelExecutorBase*>(&executor_);
+      if (compiled_model_executor != nullptr) {
+        compiled_model_executor->InitializeSampler().IgnoreError();
+      }
+      speculative_decoding_stats_ = executor_.GetSpeculativeDecodingStats();
+      if (speculative_decoding_stats_ != nullptr) {
+        initial_speculative_decoding_stats_ = *speculative_decoding_stats_;
+      }
+      benchmark_decode_token_count_ =
+          benchmark_info_->GetBenchmarkParams().num_decode_tokens();
+      RETURN_IF_ERROR(benchmark_info_->TimeDecodeTurnStart());
     }
-    benchmark_decode_token_count =
-        benchmark_info->GetBenchmarkParams().num_decode_tokens();
-    RETURN_IF_ERROR(benchmark_info->TimeDecodeTurnStart());
+    return absl::OkStatus();
   }
 
-  // The final decoded texts for each candidate.
-  std::vector<std::string> final_texts(num_output_candidates);
-  // The final scores for each candidate.
-  std::vector<float> final_scores(num_output_candidates);
-  // The accumulated scores for each candidate (for custom sampling).
-  std::vector<float> accumulated_scores(num_output_candidates);
-  // The number of decoded tokens for each candidate (for custom sampling).
-  std::vector<int> num_decoded_tokens(num_output_candidates);
+  absl::StatusOr<bool> RunSteps(int max_num_steps) override {
+    if (responses_.has_value()) {
+      return true;
+    }
+    for (int i = 0; i < max_num_steps; ++i) {
+      if (cancelled_ != nullptr && cancelled_->load()) {
+        if (benchmark_info_.has_value()) {
+          // If the process is cancelled, we need to end this benchmark phase.
+          absl::Status status = benchmark_info_->TimeDecodeTurnEnd(
+              num_decode_steps_ * num_output_candidates_);
+          if (!status.ok()) {
+            return Fail(status);
+          }
+          RecordSpeculativeDecoding();
+        }
+        return Fail(absl::CancelledError("Process cancelled."));
+      }
+      absl::StatusOr<bool> all_done = run_one_step_.Run(decoded_ids_);
+      if (!all_done.ok()) {
+        return Fail(all_done.status());
+      }
+      num_decode_steps_++;
+      ProcessStepResults(*all_done);
 
-  int num_decode_steps = 0;
-  const int max_num_tokens = TryGetMaxNumTokens(executor);
-  DecodeOneStep run_one_step(&executor, &tokenizer, num_output_candidates,
-                             stop_token_detector, benchmark_info, sampler,
-                             constraint);
-  while (true) {
-    if (cancelled != nullptr && cancelled->load()) {
-      if (benchmark_info.has_value()) {
-        // If the process is cancelled, we need to end this benchmark phase.
-        RETURN_IF_ERROR(benchmark_info->TimeDecodeTurnEnd(
-            num_decode_steps * num_output_candidates));
+      absl::StatusOr<int> current_step = executor_.GetCurrentStep();
+      if (!current_step.ok()) {
+        return Fail(current_step.status());
       }
-      if (is_streaming) {
-        callback.value()(absl::CancelledError("Process cancelled."));
+      if (ShouldStop(*all_done, benchmark_decode_token_count_,
+                     num_decode_steps_, *current_step, max_num_tokens_)) {
+        absl::Status status = Finish();
+        if (!status.ok()) {
+          return Fail(status);
+        }
+        return true;
       }
-      return absl::CancelledError("Process cancelled.");
     }
-    absl::StatusOr<bool> all_done = run_one_step.Run(decoded_ids);
-    if (!all_done.ok()) {
-      if (is_streaming) {
-        callback.value()(all_done.status());
-      }
-      return all_done.status();
+    return false;
+  }
+
+  absl::StatusOr<Responses> GetResponses() override {
+    if (!responses_.has_value()) {
+      return absl::FailedPreconditionError("Decoding is not finished yet.");
     }
-    num_decode_steps++;
+    return *responses_;
+  }
+
+  void Abort(absl::Status status) override {
+    if (!responses_.has_value()) {
+      Fail(status).IgnoreError();
+    }
+  }
+
+ private:
+  bool is_streaming() const { return callback_.has_value(); }
+
+  // Reports the error to the callback, if any, and finishes the task.
+  absl::Status Fail(absl::Status status) {
+    if (is_streaming()) {
+      callback_.value()(status);
+    }
+    responses_ = status;
+    return status;
+  }
+
+  // Accumulates the results of the last step, or passes them to the callback
+  // for streaming.
+  void ProcessStepResults(bool all_done) {
     std::vector<std::string> step_texts;
     std::vector<float> step_scores;
-    if (is_streaming) {
-      step_texts.resize(num_output_candidates);
-      step_scores.resize(num_output_candidates);
+    if (is_streaming()) {
+      step_texts.resize(num_output_candidates_);
+      step_scores.resize(num_output_candidates_);
     }
     bool any_updates = false;
-    for (int j = 0; j < num_output_candidates; ++j) {
-      std::string output_text = run_one_step.GetResultText()[j];
+    for (int j = 0; j < num_output_candidates_; ++j) {
+      std::string output_text = run_one_step_.GetResultText()[j];
       if (output_text.empty()) {
         // No output text for this candidate - could be due to
         // 1. early stopping.
@@ -400,76 +518,164 @@ absl::StatusOr<Responses> DecodeLoop(
       // The tokenizer may return a token with a special character "▁" that
       // should be replaced with a space.
       std::string result_text = absl::StrReplaceAll(output_text, {{"▁", " "}});
-      if (is_streaming) {
+      if (is_streaming()) {
         step_texts[j] = result_text;
-        if (is_custom_sampling) {
-          step_scores[j] = run_one_step.GetScores()[j];
+        if (is_custom_sampling_) {
+          step_scores[j] = run_one_step_.GetScores()[j];
         }
       } else {
-        final_texts[j] += result_text;
-        if (is_custom_sampling) {
-          accumulated_scores[j] += run_one_step.GetScores()[j];
-          num_decoded_tokens[j]++;
+        final_texts_[j] += result_text;
+        if (is_custom_sampling_) {
+          accumulated_scores_[j] += run_one_step_.GetScores()[j];
+          num_decoded_tokens_[j]++;
         }
       }
     }
 
-    if (is_streaming && any_updates && !*all_done) {
-      callback.value()(Responses(TaskState::kProcessing, std::move(step_texts),
-                                 std::move(step_scores)));
-    }
-
-    if (ShouldStop(*all_done, benchmark_decode_token_count, num_decode_steps,
-                   executor.GetCurrentStep().value(), max_num_tokens)) {
-      break;
+    if (is_streaming() && any_updates && !all_done) {
+      callback_.value()(Responses(TaskState::kProcessing,
+                                  std::move(step_texts),
+                                  std::move(step_scores)));
     }
   }
 
-  if (benchmark_info.has_value()) {
-    RETURN_IF_ERROR(benchmark_info->TimeDecodeTurnEnd(num_decode_steps *
-                                                      num_output_candidates));
+  // Records the speculative decoding steps of the decode turn, if any.
+  void RecordSpeculativeDecoding() {
+    if (speculative_decoding_stats_ == nullptr) {
+      return;
+    }
+    benchmark_info_->RecordSpeculativeDecoding(
+        speculative_decoding_stats_->num_verify_steps -
+            initial_speculative_decoding_stats_.num_verify_steps,
+        speculative_decoding_stats_->num_draft_tokens -
+            initial_speculative_decoding_stats_.num_draft_tokens,
+        speculative_decoding_stats_->num_accepted_tokens -
+            initial_speculative_decoding_stats_.num_accepted_tokens);
   }
 
-  if (is_custom_sampling) {
-    // For external sampling, the sampled tokens are provided by the sampler. We
-    // must run one prefill to add the stop token as pending token in the LLM
-    // Executor when stop condition is met.
-    LITERT_ASSIGN_OR_RETURN(auto duplicated_decoded_ids,
-                                 decoded_ids.value()->Duplicate());
-    ExecutorInputs inputs;
-    inputs.SetTextData(ExecutorTextData(std::move(duplicated_decoded_ids)));
-    std::optional<BenchmarkInfo> unused_benchmark_info;
-    auto status = Prefill(executor, inputs, /*wait_for_completion=*/true,
-                          unused_benchmark_info);
-    if (!status.ok()) {
-      if (is_streaming) callback.value()(status.status());
-      return status.status();
+  // Ends the decode turn and sets the final responses. On error, nothing is
+  // reported to the callback and the caller must finish the task with Fail().
+  absl::Status Finish() {
+    if (benchmark_info_.has_value()) {
+      RETURN_IF_ERROR(benchmark_info_->TimeDecodeTurnEnd(
+          num_decode_steps_ * num_output_candidates_));
+      RecordSpeculativeDecoding();
     }
-  }
 
-  if (is_streaming) {
-    if (executor.GetCurrentStep().value() >= max_num_tokens) {
-      callback.value()(absl::InternalError(absl::StrFormat(
-          "Maximum kv-cache size reached.(%d) Please exit and re-start.",
-          max_num_tokens)));
-    } else {
-      callback.value()(Responses(TaskState::kDone));
+    if (is_custom_sampling_) {
+      // For external sampling, the sampled tokens are provided by the sampler.
+      // We must run one prefill to add the stop token as pending token in the
+      // LLM Executor when stop condition is met.
+      LITERT_ASSIGN_OR_RETURN(auto duplicated_decoded_ids,
+                              decoded_ids_.value()->Duplicate());
+      ExecutorInputs inputs;
+      inputs.SetTextData(ExecutorTextData(std::move(duplicated_decoded_ids)));
+      std::optional<BenchmarkInfo> unused_benchmark_info;
+      RETURN_IF_ERROR(Prefill(executor_, inputs, /*wait_for_completion=*/true,
+                              unused_benchmark_info)
+                          .status());
     }
-    return Responses(TaskState::kDone);
-  }
 
-  // Finalize scores for non-streaming custom sampling.
-  if (is_custom_sampling) {
-    for (int j = 0; j < num_output_candidates; ++j) {
-      if (num_decoded_tokens[j] > 0) {
-        final_scores[j] = accumulated_scores[j] / num_decoded_tokens[j];
+    if (is_streaming()) {
+      ASSIGN_OR_RETURN(int current_step, executor_.GetCurrentStep());
+      if (current_step >= max_num_tokens_) {
+        callback_.value()(absl::InternalError(absl::StrFormat(
+            "Maximum kv-cache size reached.(%d) Please exit and re-start.",
+            max_num_tokens_)));
       } else {
-        final_scores[j] = -std::numeric_limits<float>::infinity();
+        callback_.value()(Responses(TaskState::kDone));
+      }
+      responses_ = Responses(TaskState::kDone);
+      return absl::OkStatus();
+    }
+
+    // Finalize scores for non-streaming custom sampling.
+    if (is_custom_sampling_) {
+      for (int j = 0; j < num_output_candidates_; ++j) {
+        if (num_decoded_tokens_[j] > 0) {
+          final_scores_[j] = accumulated_scores_[j] / num_decoded_tokens_[j];
+        } else {
+          final_scores_[j] = -std::numeric_limits<float>::infinity();
+        }
       }
     }
+    responses_ = Responses(TaskState::kDone, std::move(final_texts_),
+                           std::move(final_scores_));
+    return absl::OkStatus();
   }
-  return Responses(TaskState::kDone, std::move(final_texts),
-                   std::move(final_scores));
+
+  LlmExecutor& executor_;
+  std::optional<BenchmarkInfo>& benchmark_info_;
+  const int num_output_candidates_;
+  const bool is_custom_sampling_;
+  std::optional<litert::TensorBuffer*> decoded_ids_;
+  std::optional<absl::AnyInvocable<void(absl::StatusOr<Responses>)>> callback_;
+  std::atomic<bool>* cancelled_;
+  const int max_num_tokens_;
+  int benchmark_decode_token_count_ = 0;
+  int num_decode_steps_ = 0;
+  // The speculative decoding stats of the executor, if it decodes
+  // speculatively and the benchmark is enabled, and their values at the start
+  // of the decode turn.
+  const SpeculativeDecodingStats* speculative_decoding_stats_ = nullptr;
+  SpeculativeDecodingStats initial_speculative_decoding_stats_;
+
+  // The final decoded texts for each candidate.
+  std::vector<std::string> final_texts_;
+  // The final scores for each candidate.
+  std::vector<float> final_scores_;
+  // The accumulated scores for each candidate (for custom sampling).
+  std::vector<float> accumulated_scores_;
+  // The number of decoded tokens for each candidate (for custom sampling).
+  std::vector<int> num_decoded_tokens_;
+
+  DecodeOneStep run_one_step_;
+
+  // Set once the task is finished, either successfully or with an error.
+  std::optional<absl::StatusOr<Responses>> responses_;
+};
+
+absl::StatusOr<std::unique_ptr<DecodeLoopTask>> CreateDecodeLoopTask(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    std::optional<BenchmarkInfo>& benchmark_info,
+    std::optional<Sampler*> sampler, Constraint* constraint,
+    std::optional<litert::TensorBuffer*> decoded_ids,
+    std::optional<absl::AnyInvocable<void(absl::StatusOr<Responses>)>> callback,
+    std::atomic<bool>* cancelled,
+    SpeculativeDecodingMode speculative_decoding_mode =
+        SpeculativeDecodingMode::kDraftModel,
+    ThreadPool* constraint_thread_pool = nullptr) {
+  auto task = std::make_unique<DecodeLoopTask>(
+      executor, tokenizer, stop_token_detector, num_output_candidates,
+      benchmark_info, sampler, constraint, decoded_ids, std::move(callback),
+      cancelled, speculative_decoding_mode, constraint_thread_pool);
+  RETURN_IF_ERROR(task->Start());
+  return task;
+}
+
+absl::StatusOr<Responses> DecodeLoop(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    std::optional<BenchmarkInfo>& benchmark_info,
+    std::optional<Sampler*> sampler, Constraint* constraint,
+    std::optional<litert::TensorBuffer*> decoded_ids,
+    std::optional<absl::AnyInvocable<void(absl::StatusOr<Responses>)>> callback,
+    std::atomic<bool>* cancelled,
+    SpeculativeDecodingMode speculative_decoding_mode =
+        SpeculativeDecodingMode::kDraftModel,
+    ThreadPool* constraint_thread_pool = nullptr) {
+  ASSIGN_OR_RETURN(
+      auto task,
+      CreateDecodeLoopTask(executor, tokenizer, stop_token_detector,
+                           num_output_candidates, benchmark_info, sampler,
+                           constraint, decoded_ids, std::move(callback),
+                           cancelled, speculative_decoding_mode,
+                           constraint_thread_pool));
+  ASSIGN_OR_RETURN(bool done,
+                   task->RunSteps(std::numeric_limits<int>::max()));
+  RET_CHECK(done) << "Decoding is not finished.";
+  return task->GetResponses();
 }
 
 }  // namespace
@@ -563,26 +769,51 @@ absl::StatusOr<int> Prefill(LlmExecutor& executor, ExecutorInputs& inputs,
   ExecutorPrefillParams params;
   // Wait for prefill to complete if benchmark mode is enabled.
   params.SetWaitForCompletion(wait_for_completion | benchmark_info.has_value());
+  // Record the prefix KV cache lookups made by the prefill, if any.
+  const KvCachePrefixCache* prefix_cache = nullptr;
+  KvCachePrefixCache::Stats prefix_cache_stats;
   if (benchmark_info.has_value()) {
+    auto* compiled_model_executor =
+        dynamic_cast<LlmLiteRtCompiledModelExecutorBase*>(&executor);
+    if (compiled_model_executor != nullptr) {
+      prefix_cache = compiled_model_executor->GetPrefixCache();
+    }
+    if (prefix_cache != nullptr) {
+      prefix_cache_stats = prefix_cache->stats();
+    }
     RETURN_IF_ERROR(benchmark_info->TimePrefillTurnStart());
   }
   RETURN_IF_ERROR(executor.Prefill(inputs, params));
   if (benchmark_info.has_value()) {
     RETURN_IF_ERROR(benchmark_info->TimePrefillTurnEnd(ids_buffer_span.size()));
+    if (prefix_cache != nullptr) {
+      const KvCachePrefixCache::Stats& stats = prefix_cache->stats();
+      if (stats.hits > prefix_cache_stats.hits) {
+        benchmark_info->RecordPrefixCacheLookup(
+            /*hit=*/true,
+            stats.reused_tokens - prefix_cache_stats.reused_tokens);
+      } else if (stats.misses > prefix_cache_stats.misses) {
+        benchmark_info->RecordPrefixCacheLookup(/*hit=*/false,
+                                                /*num_reused_tokens=*/0);
+      }
+    }
   }
   return last_token_id;
 }
 
-absl::StatusOr<Responses> Decode(LlmExecutor& executor, Tokenizer& tokenizer,
-                                 const StopTokenDetector& stop_token_detector,
-                                 int num_output_candidates,
-                                 Constraint* constraint,
-                                 std::optional<BenchmarkInfo>& benchmark_info,
-                                 std::atomic<bool>* cancelled) {
-  return DecodeLoop(
-      executor, tokenizer, stop_token_detector, num_output_candidates,
-      benchmark_info, /*sampler=*/std::nullopt, constraint,
-      /*decoded_ids=*/std::nullopt, /*callback=*/std::nullopt, cancelled);
+absl::StatusOr<Responses> Decode(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    Constraint* constraint, std::optional<BenchmarkInfo>& benchmark_info,
+    std::atomic<bool>* cancelled,
+    SpeculativeDecodingMode speculative_decoding_mode,
+    ThreadPool* constraint_thread_pool) {
+  return DecodeLoop(executor, tokenizer, stop_token_detector,
+                    num_output_candidates, benchmark_info,
+                    /*sampler=*/std::nullopt, constraint,
+                    /*decoded_ids=*/std::nullopt, /*callback=*/std::nullopt,
+                    cancelled, speculative_decoding_mode,
+                    constraint_thread_pool);
 }
 
 absl::Status DecodeStreaming(
@@ -590,7 +821,9 @@ absl::Status DecodeStreaming(
     const StopTokenDetector& stop_token_detector, int num_output_candidates,
     Constraint* constraint, std::optional<BenchmarkInfo>& benchmark_info,
     absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
-    std::atomic<bool>* cancelled) {
+    std::atomic<bool>* cancelled,
+    SpeculativeDecodingMode speculative_decoding_mode,
+    ThreadPool* constraint_thread_pool) {
   if (callback == nullptr) {
     return absl::InvalidArgumentError(
         "Callback must not be null for streaming.");
@@ -599,7 +832,8 @@ absl::Status DecodeStreaming(
                     num_output_candidates, benchmark_info,
                     /*sampler=*/std::nullopt, constraint,
                     /*decoded_ids=*/std::nullopt, std::move(callback),
-                    cancelled)
+                    cancelled, speculative_decoding_mode,
+                    constraint_thread_pool)
       .status();
 }
 
@@ -607,11 +841,13 @@ absl::StatusOr<Responses> DecodeCustomSampling(
     LlmExecutor& executor, Tokenizer& tokenizer,
     const StopTokenDetector& stop_token_detector, int num_output_candidates,
     Sampler& sampler, litert::TensorBuffer& decoded_ids, Constraint* constraint,
-    std::optional<BenchmarkInfo>& benchmark_info,
-    std::atomic<bool>* cancelled) {
+    std::optional<BenchmarkInfo>& benchmark_info, std::atomic<bool>* cancelled,
+    ThreadPool* constraint_thread_pool) {
   return DecodeLoop(executor, tokenizer, stop_token_detector,
                     num_output_candidates, benchmark_info, &sampler, constraint,
-                    &decoded_ids, /*callback=*/std::nullopt, cancelled);
+                    &decoded_ids, /*callback=*/std::nullopt, cancelled,
+                    SpeculativeDecodingMode::kDraftModel,
+                    constraint_thread_pool);
 }
 
 absl::Status DecodeCustomSamplingStreaming(
@@ -620,15 +856,56 @@ absl::Status DecodeCustomSamplingStreaming(
     Sampler& sampler, litert::TensorBuffer& decoded_ids, Constraint* constraint,
     std::optional<BenchmarkInfo>& benchmark_info,
     absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
-    std::atomic<bool>* cancelled) {
+    std::atomic<bool>* cancelled, ThreadPool* constraint_thread_pool) {
   if (callback == nullptr) {
     return absl::InvalidArgumentError(
         "Callback must not be null for streaming.");
   }
   return DecodeLoop(executor, tokenizer, stop_token_detector,
                     num_output_candidates, benchmark_info, &sampler, constraint,
-                    &decoded_ids, std::move(callback), cancelled)
+                    &decoded_ids, std::move(callback), cancelled,
+                    SpeculativeDecodingMode::kDraftModel,
+                    constraint_thread_pool)
       .status();
 }
 
+absl::StatusOr<std::unique_ptr<DecodeTask>> CreateDecodeStreamingTask(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    Constraint* constraint, std::optional<BenchmarkInfo>& benchmark_info,
+    absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
+    std::atomic<bool>* cancelled,
+    SpeculativeDecodingMode speculative_decoding_mode,
+    ThreadPool* constraint_thread_pool) {
+  if (callback == nullptr) {
+    return absl::InvalidArgumentError(
+        "Callback must not be null for streaming.");
+  }
+  return CreateDecodeLoopTask(executor, tokenizer, stop_token_detector,
+                              num_output_candidates, benchmark_info,
+                              /*sampler=*/std::nullopt, constraint,
+                              /*decoded_ids=*/std::nullopt, std::move(callback),
+                              cancelled, speculative_decoding_mode,
+                              constraint_thread_pool);
+}
+
+absl::StatusOr<std::unique_ptr<DecodeTask>>
+CreateDecodeCustomSamplingStreamingTask(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    Sampler& sampler, litert::TensorBuffer& decoded_ids, Constraint* constraint,
+    std::optional<BenchmarkInfo>& benchmark_info,
+    absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
+    std::atomic<bool>* cancelled, ThreadPool* constraint_thread_pool) {
+  if (callback == nullptr) {
+    return absl::InvalidArgumentError(
+        "Callback must not be null for streaming.");
+  }
+  return CreateDecodeLoopTask(executor, tokenizer, stop_token_detector,
+                              num_output_candidates, benchmark_info, &sampler,
+                              constraint, &decoded_ids, std::move(callback),
+                              cancelled, SpeculativeDecodingMode::kDraftModel,
+                              constraint_thread_pool);
+}
+
 }  // namespace litert::lm
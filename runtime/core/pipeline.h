@@ -22,6 +22,7 @@
 #include <optional>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
@@ -33,6 +34,8 @@
 #include "runtime/engine/io_types.h"
 #include "runtime/executor/llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
+#include "runtime/executor/speculative_decoding_util.h"
+#include "runtime/framework/threadpool.h"
 #include "runtime/proto/sampler_params.pb.h"
 
 namespace litert::lm {
@@ -59,12 +62,19 @@ absl::StatusOr<int> Prefill(LlmExecutor& executor, ExecutorInputs& inputs,
 // - benchmark_info: The benchmark info to record the performance metrics.
 // - cancelled: A pointer to an atomic boolean. If the boolean is set to true,
 //   the decoding process will be cancelled.
-absl::StatusOr<Responses> Decode(LlmExecutor& executor, Tokenizer& tokenizer,
-                                 const StopTokenDetector& stop_token_detector,
-                                 int num_output_candidates,
-                                 Constraint* constraint,
-                                 std::optional<BenchmarkInfo>& benchmark_info,
-                                 std::atomic<bool>* cancelled = nullptr);
+// - speculative_decoding_mode: The source of the draft tokens if the executor
+//   decodes speculatively.
+// - constraint_thread_pool: The thread pool to update the constraint states on.
+//   Callers decoding repeatedly should pass a long-lived pool so that it is
+//   reused across the calls. If null, a pool is created for the call.
+absl::StatusOr<Responses> Decode(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    Constraint* constraint, std::optional<BenchmarkInfo>& benchmark_info,
+    std::atomic<bool>* cancelled = nullptr,
+    SpeculativeDecodingMode speculative_decoding_mode =
+        SpeculativeDecodingMode::kDraftModel,
+    ThreadPool* constraint_thread_pool = nullptr);
 
 // Runs the pipeline to decode the input prompt. The function is similar to
 // Decode, but it outputs the result using the callback to achieve streaming
@@ -77,7 +87,10 @@ absl::Status DecodeStreaming(
     const StopTokenDetector& stop_token_detector, int num_output_candidates,
     Constraint* constraint, std::optional<BenchmarkInfo>& benchmark_info,
     absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
-    std::atomic<bool>* cancelled = nullptr);
+    std::atomic<bool>* cancelled = nullptr,
+    SpeculativeDecodingMode speculative_decoding_mode =
+        SpeculativeDecodingMode::kDraftModel,
+    ThreadPool* constraint_thread_pool = nullptr);
 
 // Runs the pipeline to decode the input prompt.
 // - executor: The executor that call the core LLM model.
@@ -91,12 +104,15 @@ absl::Status DecodeStreaming(
 // - benchmark_info: The benchmark info to record the performance metrics.
 // - cancelled: A pointer to an atomic boolean. If the boolean is set to true,
 //   the decoding process will be cancelled.
+// - constraint_thread_pool: The thread pool to update the constraint states on,
+//   see Decode().
 absl::StatusOr<Responses> DecodeCustomSampling(
     LlmExecutor& executor, Tokenizer& tokenizer,
     const StopTokenDetector& stop_token_detector, int num_output_candidates,
     Sampler& sampler, litert::TensorBuffer& decoded_ids, Constraint* constraint,
     std::optional<BenchmarkInfo>& benchmark_info,
-    std::atomic<bool>* cancelled = nullptr);
+    std::atomic<bool>* cancelled = nullptr,
+    ThreadPool* constraint_thread_pool = nullptr);
 
 // Runs the pipeline to decode the input prompt. The function is similar to
 // DecodeCustomSampling, but it outputs the result using the callback to
@@ -110,7 +126,66 @@ absl::Status DecodeCustomSamplingStreaming(
     Sampler& sampler, litert::TensorBuffer& decoded_ids, Constraint* constraint,
     std::optional<BenchmarkInfo>& benchmark_info,
     absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
-    std::atomic<bool>* cancelled = nullptr);
+    std::atomic<bool>* cancelled = nullptr,
+    ThreadPool* constraint_thread_pool = nullptr);
+
+// A resumable decode loop. Instead of running the whole decode turn in one
+// call, the caller advances the loop a few steps at a time. This allows the
+// decode steps of several sessions sharing the same executor to be interleaved
+// (iteration-level scheduling), so that a long generation does not block the
+// other sessions until it finishes. The steps of different sessions are not
+// packed into one batched Decode() call, since the executor applies a single
+// position and attention mask to all the rows of a batch.
+//
+// The task must be driven from the thread that owns the executor, and the
+// executor state (e.g. the executor context of the session) must be activated
+// before every RunSteps() call.
+class DecodeTask {
+ public:
+  virtual ~DecodeTask() = default;
+
+  // Runs at most `max_num_steps` decode steps. Returns true once the decode
+  // turn has finished, after which further calls are no-ops. The streaming
+  // callback, if any, is invoked exactly as in the run-to-completion variants.
+  virtual absl::StatusOr<bool> RunSteps(int max_num_steps) = 0;
+
+  // Returns the responses of the finished decode turn. Returns
+  // FailedPreconditionError if the decode turn has not finished yet.
+  virtual absl::StatusOr<Responses> GetResponses() = 0;
+
+  // Finishes an unfinished decode turn with the given error, which is also
+  // reported to the streaming callback, if any.
+  //
+  // Errors returned by RunSteps() finish the task the same way, so the
+  // streaming callback always receives either the final response or the
+  // error.
+  virtual void Abort(absl::Status status) = 0;
+};
+
+// Creates a resumable task equivalent to DecodeStreaming(). The executor,
+// tokenizer, constraint, constraint thread pool and benchmark info must outlive
+// the task.
+absl::StatusOr<std::unique_ptr<DecodeTask>> CreateDecodeStreamingTask(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    Constraint* constraint, std::optional<BenchmarkInfo>& benchmark_info,
+    absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
+    std::atomic<bool>* cancelled = nullptr,
+    SpeculativeDecodingMode speculative_decoding_mode =
+        SpeculativeDecodingMode::kDraftModel,
+    ThreadPool* constraint_thread_pool = nullptr);
+
+// Creates a resumable task equivalent to DecodeCustomSamplingStreaming(). The
+// sampler and decoded_ids must outlive the task as well.
+absl::StatusOr<std::unique_ptr<DecodeTask>>
+CreateDecodeCustomSamplingStreamingTask(
+    LlmExecutor& executor, Tokenizer& tokenizer,
+    const StopTokenDetector& stop_token_detector, int num_output_candidates,
+    Sampler& sampler, litert::TensorBuffer& decoded_ids, Constraint* constraint,
+    std::optional<BenchmarkInfo>& benchmark_info,
+    absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
+    std::atomic<bool>* cancelled = nullptr,
+    ThreadPool* constraint_thread_pool = nullptr);
 
 // Runs the pipeline to score the input prompt.
 // - executor: The executor that calls the core LLM model.
@@ -39,13 +39,17 @@
 #include "runtime/engine/io_types.h"
 #include "runtime/executor/fake_llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
+#include "runtime/executor/llm_executor_settings.h"
+#include "runtime/executor/speculative_decoding_util.h"
 #include "runtime/framework/threadpool.h"
+#include "runtime/proto/engine.pb.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/test_utils.h"  // NOLINT
 
 namespace litert::lm {
 namespace {
 
+using ::testing::status::IsOkAndHolds;
 using ::testing::status::StatusIs;
 
 constexpr char kTestdataDir[] =
@@ -140,6 +144,32 @@ TEST_F(PipelineTest, PrefillTooLong) {
               StatusIs(absl::StatusCode::kInvalidArgument));
 }
 
+TEST_F(PipelineTest, PrefillTooLongWithContextShifting) {
+  const std::string prompt = "Hello World!";
+  // The 8 prompt tokens fit in the KV cache of 10 tokens, but not next to the
+  // 4 attention sink tokens context shifting keeps.
+  executor_->GetMutableExecutorSettings().value()->SetMaxNumTokens(10);
+  executor_->GetMutableExecutorSettings().value()->SetAdvancedSettings(
+      AdvancedSettings{.enable_context_shifting = true,
+                       .num_attention_sink_tokens = 4});
+  std::optional<BenchmarkInfo> benchmark_info;
+
+  ASSERT_OK_AND_ASSIGN(std::vector<int> token_ids,
+                       tokenizer_->TextToTokenIds(prompt));
+  // Prepend the bos token id.
+  token_ids.insert(token_ids.begin(), 2);
+  ASSERT_OK_AND_ASSIGN(auto token_ids_buffer,
+                       tokenizer_->TokenIdsToTensorBuffer(token_ids));
+  ExecutorTextData text_data(std::move(token_ids_buffer));
+  ExecutorInputs inputs(std::move(text_data), std::nullopt, std::nullopt);
+
+  auto last_prefill_token_id =
+      Prefill(*executor_, inputs,
+              /*wait_for_completion=*/true, benchmark_info);
+  EXPECT_THAT(last_prefill_token_id,
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST_F(PipelineTest, PrefillSucceed) {
   const std::string prompt = "Hello World!";
   std::optional<BenchmarkInfo> benchmark_info;
@@ -259,6 +289,34 @@ TEST_F(PipelineTest, DecodeWithConstrainedDecoding) {
   EXPECT_EQ(responses->GetTexts()[0], " How's it");
 }
 
+TEST_F(PipelineTest, DecodeWithConstrainedDecodingReusesThreadPool) {
+  // Fake constraint that expects " How's it".
+  std::vector<int> expected_token_ids = {2, 224, 24, 8, 66, 0};
+  auto constraint = std::make_unique<FakeConstraint>(expected_token_ids,
+                                                     /*vocabulary_size=*/2560);
+  ThreadPool constraint_thread_pool(/*name_prefix=*/"constraint",
+                                    /*max_num_threads=*/1);
+
+  std::optional<BenchmarkInfo> benchmark_info;
+  constexpr int kNumOutputCandidates = 1;
+  StopTokenDetector stop_token_detector(kNumOutputCandidates);
+  EXPECT_OK(stop_token_detector.AddStopTokenSequence({0}));
+  for (int i = 0; i < 2; ++i) {
+    std::vector<std::vector<int>> prefill_tokens = {{2}};
+    std::vector<std::vector<int>> decode_tokens = {
+        {224}, {24}, {8}, {66}, {246}, {18}, {2295}, {2294}, {0}};
+    auto executor = std::make_unique<FakeLlmExecutor>(
+        /*vocab_size=*/2560, prefill_tokens, decode_tokens, /*batch_size=*/1);
+    auto responses = Decode(
+        *executor, *tokenizer_, stop_token_detector, kNumOutputCandidates,
+        constraint.get(), benchmark_info, /*cancelled=*/nullptr,
+        SpeculativeDecodingMode::kDraftModel, &constraint_thread_pool);
+    EXPECT_OK(responses);
+    EXPECT_EQ(responses->GetTexts().size(), 1);
+    EXPECT_EQ(responses->GetTexts()[0], " How's it");
+  }
+}
+
 TEST_F(PipelineTest, DecodeStreaming) {
   std::optional<BenchmarkInfo> benchmark_info;
 
@@ -280,6 +338,76 @@ TEST_F(PipelineTest, DecodeStreaming) {
   EXPECT_OK(status);
 }
 
+TEST_F(PipelineTest, DecodeStreamingTaskRunsInSlices) {
+  std::optional<BenchmarkInfo> benchmark_info;
+
+  constexpr int kNumOutputCandidates = 1;
+  StopTokenDetector stop_token_detector(kNumOutputCandidates);
+  EXPECT_OK(stop_token_detector.AddStopTokenSequence({2294}));
+
+  std::vector<std::string> responses(kNumOutputCandidates);
+  absl::Status status;
+  bool done = false;
+  auto task = CreateDecodeStreamingTask(
+      *executor_, *tokenizer_, stop_token_detector, kNumOutputCandidates,
+      /*constraint=*/nullptr, benchmark_info,
+      CreateTestCallback(responses, status, done));
+  ASSERT_OK(task);
+  EXPECT_THAT((*task)->GetResponses(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+
+  // The decode turn is not finished after the first two steps.
+  auto task_done = (*task)->RunSteps(/*max_num_steps=*/2);
+  ASSERT_OK(task_done);
+  EXPECT_FALSE(*task_done);
+  EXPECT_FALSE(done);
+
+  while (!*task_done) {
+    task_done = (*task)->RunSteps(/*max_num_steps=*/2);
+    ASSERT_OK(task_done);
+  }
+  EXPECT_EQ(responses[0], " How's it going?");
+  EXPECT_TRUE(done);
+  EXPECT_OK(status);
+  auto final_responses = (*task)->GetResponses();
+  ASSERT_OK(final_responses);
+  EXPECT_EQ(final_responses->GetTaskState(), TaskState::kDone);
+
+  // Running a finished task is a no-op.
+  EXPECT_THAT((*task)->RunSteps(/*max_num_steps=*/2), IsOkAndHolds(true));
+}
+
+TEST_F(PipelineTest, DecodeStreamingTaskReportsFinishErrorToCallback) {
+  std::optional<BenchmarkInfo> benchmark_info;
+  benchmark_info.emplace(proto::BenchmarkParams());
+
+  constexpr int kNumOutputCandidates = 1;
+  StopTokenDetector stop_token_detector(kNumOutputCandidates);
+  EXPECT_OK(stop_token_detector.AddStopTokenSequence({2294}));
+
+  std::vector<std::string> responses(kNumOutputCandidates);
+  absl::Status status;
+  bool done = false;
+  auto task = CreateDecodeStreamingTask(
+      *executor_, *tokenizer_, stop_token_detector, kNumOutputCandidates,
+      /*constraint=*/nullptr, benchmark_info,
+      CreateTestCallback(responses, status, done));
+  ASSERT_OK(task);
+  // Ending the decode turn behind the task's back makes the task fail to end
+  // it at the end of decoding.
+  ASSERT_OK(benchmark_info->TimeDecodeTurnEnd(/*num_decode_tokens=*/0));
+
+  absl::StatusOr<bool> task_done = false;
+  while (task_done.ok() && !*task_done) {
+    task_done = (*task)->RunSteps(/*max_num_steps=*/2);
+  }
+  EXPECT_THAT(task_done, StatusIs(absl::StatusCode::kInternal));
+  EXPECT_TRUE(done);
+  EXPECT_THAT(status, StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT((*task)->GetResponses(),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
 TEST_F(PipelineTest, DecodeStreamingReachMaxNumTokens) {
   // Set the max number of tokens to 3.
   executor_->GetMutableExecutorSettings().value()->SetMaxNumTokens(3);
@@ -1013,6 +1141,29 @@ TEST_F(PipelineCallbackTest, DecodeStreaming_ErrorCompletion) {
                "Maximum kv-cache size reached.(3) Please exit and re-start."));
 }
 
+TEST_F(PipelineCallbackTest, DecodeStreaming_WithContextShifting) {
+  // The max number of tokens does not stop the decoding if the executor
+  // shifts the context.
+  auto* executor_settings = executor_->GetMutableExecutorSettings().value();
+  executor_settings->SetMaxNumTokens(3);
+  executor_settings->SetAdvancedSettings(
+      AdvancedSettings{.enable_context_shifting = true});
+  std::optional<BenchmarkInfo> benchmark_info;
+  constexpr int kNumOutputCandidates = 1;
+  StopTokenDetector stop_token_detector(kNumOutputCandidates);
+  EXPECT_OK(stop_token_detector.AddStopTokenSequence({2294}));
+  absl::Status status;
+  std::vector<std::string> responses(kNumOutputCandidates);
+  bool done = false;
+  EXPECT_OK(DecodeStreaming(*executor_, *tokenizer_, stop_token_detector,
+                            kNumOutputCandidates, /*constraint=*/nullptr,
+                            benchmark_info,
+                            CreateTestCallback(responses, status, done)));
+  EXPECT_EQ(responses[0], " How's it going?");
+  EXPECT_TRUE(done);
+  EXPECT_OK(status);
+}
+
 TEST_F(PipelineCallbackTest,
        DecodeStreaming_SuccessfulCompletion_WithMultipleCandidates) {
   constexpr int kNumOutputCandidates = 3;
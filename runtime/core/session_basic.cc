@@ -14,12 +14,15 @@
 
 #include "runtime/core/session_basic.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>  // NOLINT: For hardware_concurrency().
 #include <utility>
 #include <variant>
 #include <vector>
@@ -32,13 +35,18 @@
 #include "absl/strings/match.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_layout.h"  // from @litert
 #include "litert/cc/litert_macros.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/preprocessor/audio_preprocessor.h"
+#include "runtime/components/preprocessor/audio_preprocessor_miniaudio.h"
 #include "runtime/components/sampler.h"
 #include "runtime/components/sampler_factory.h"
 #include "runtime/components/stop_token_detector.h"
 #include "runtime/components/tokenizer.h"
+#include "runtime/core/executor_locks.h"
 #include "runtime/core/pipeline.h"
 #include "runtime/engine/engine.h"
 #include "runtime/engine/engine_settings.h"
@@ -47,7 +55,9 @@
 #include "runtime/executor/executor_settings_base.h"
 #include "runtime/executor/llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
+#include "runtime/executor/speculative_decoding_util.h"
 #include "runtime/executor/vision_executor.h"
+#include "runtime/framework/serial_executor.h"
 #include "runtime/framework/threadpool.h"
 #include "runtime/proto/sampler_params.pb.h"
 #include "runtime/util/convert_tensor_buffer.h"
@@ -56,28 +66,161 @@
 #include "runtime/util/tensor_buffer_util.h"
 
 namespace litert::lm {
+namespace {
 
-// static
-absl::StatusOr<std::unique_ptr<SessionBasic>> SessionBasic::Create(
-    LlmExecutor* executor, Tokenizer* tokenizer,
-    VisionExecutor* vision_executor, AudioExecutor* audio_executor,
-    const SessionConfig& session_config,
-    std::optional<BenchmarkInfo> benchmark_info,
-    ThreadPool* worker_thread_pool) {
+// The number of decode steps a streaming decode runs before yielding the worker
+// thread to the other sessions sharing the same executor.
+constexpr int kNumDecodeStepsPerSlice = 4;
+
+// The maximum number of threads the CPU sampler splits the top-k selection of
+// a single output candidate across. The sampler only splits large vocabs.
+constexpr int kMaxNumSamplerVocabShards = 4;
+
+// Creates the thread pool the CPU sampler of a session samples the output
+// candidates on, or the vocab shards of a single output candidate. Returns
+// null if a single thread samples all of them.
+std::unique_ptr<ThreadPool> CreateSamplerThreadPool(
+    const SessionConfig& session_config) {
+  if (session_config.GetSamplerBackend() != Backend::CPU) {
+    return nullptr;
+  }
+  const int num_output_candidates = session_config.GetNumOutputCandidates();
+  const int max_num_parallel_samples = num_output_candidates > 1
+                                           ? num_output_candidates
+                                           : kMaxNumSamplerVocabShards;
+  // The calling thread samples one of the output candidates or shards too.
+  const int num_threads =
+      std::min<int>(max_num_parallel_samples,
+                    std::thread::hardware_concurrency()) -
+      1;
+  if (num_threads <= 0) {
+    return nullptr;
+  }
+  return std::make_unique<ThreadPool>(/*name_prefix=*/"sampler", num_threads);
+}
+
+// Creates the sampler of a session. Returns null if the sampling is done by the
+// executor.
+absl::StatusOr<std::unique_ptr<Sampler>> CreateSessionSampler(
+    const SessionConfig& session_config, ThreadPool* sampler_thread_pool) {
   auto sampler_backend = session_config.GetSamplerBackend();
-  std::unique_ptr<Sampler> sampler;
   // If use CPU sampling, we create it here; For GPU sampling, we let executor
   // create it internally.
   if (sampler_backend == Backend::CPU) {
-    ASSIGN_OR_RETURN(
-        sampler,
-        CreateSampler(sampler_backend, session_config.GetNumOutputCandidates(),
-                      session_config.GetSamplerParams()));
+    return CreateSampler(
+        sampler_backend, session_config.GetNumOutputCandidates(),
+        session_config.GetSamplerParams(), /*env=*/nullptr,
+        /*vocab_size=*/std::nullopt, /*activation_data_type=*/std::nullopt,
+        sampler_thread_pool);
   } else if (sampler_backend != Backend::GPU &&
              sampler_backend != Backend::NPU) {
     return absl::InvalidArgumentError(
         absl::StrCat("Unsupported sampler backend: ", sampler_backend));
   }
+  return nullptr;
+}
+
+// Returns whether the session samples a single output candidate by picking the
+// token with the largest logit, i.e. the same token as the greedy verification
+// of speculative decoding.
+bool IsGreedySingleCandidateSampling(const SessionConfig& session_config) {
+  if (session_config.GetNumOutputCandidates() != 1) {
+    return false;
+  }
+  const proto::SamplerParameters& sampler_params =
+      session_config.GetSamplerParams();
+  switch (sampler_params.type()) {
+    case proto::SamplerParameters::GREEDY:
+      return true;
+    case proto::SamplerParameters::TOP_K:
+    case proto::SamplerParameters::TOP_P:
+      return sampler_params.k() == 1;
+    default:
+      return false;
+  }
+}
+
+// The session states captured by SessionBasic::Checkpoint().
+class SessionBasicCheckpoint : public Engine::Session::SessionCheckpoint {
+ public:
+  SessionBasicCheckpoint(LlmExecutor& executor, ThreadPool& worker_thread_pool,
+                         absl::Mutex* llm_executor_mutex,
+                         std::unique_ptr<LlmExecutorContext> executor_context,
+                         int last_prefill_token_id, bool is_first_turn)
+      : executor_(executor),
+        worker_thread_pool_(worker_thread_pool),
+        llm_executor_mutex_(llm_executor_mutex),
+        executor_context_(std::move(executor_context)),
+        last_prefill_token_id_(last_prefill_token_id),
+        is_first_turn_(is_first_turn) {}
+
+  ~SessionBasicCheckpoint() override {
+    if (executor_context_ == nullptr) {
+      return;
+    }
+    // Release the context through the executor on the worker thread, since
+    // the executor states may be in use by other sessions.
+    SerialExecutor serial_executor(&worker_thread_pool_);
+    absl::Status status;
+    auto schedule_status = serial_executor.Schedule([this, &status]() {
+      absl::MutexLockMaybe lock(llm_executor_mutex_);
+      status = executor_.ReleaseContext(std::move(executor_context_));
+    });
+    if (schedule_status.ok()) {
+      schedule_status = serial_executor.WaitUntilDone(Engine::kDefaultTimeout);
+    }
+    if (!schedule_status.ok() || !status.ok()) {
+      ABSL_LOG(ERROR) << "Failed to release checkpoint executor context: "
+                      << (schedule_status.ok() ? status : schedule_status);
+    }
+  }
+
+  LlmExecutorContext* executor_context() const {
+    return executor_context_.get();
+  }
+  std::unique_ptr<LlmExecutorContext> TakeExecutorContext() {
+    return std::move(executor_context_);
+  }
+  int last_prefill_token_id() const { return last_prefill_token_id_; }
+  bool is_first_turn() const { return is_first_turn_; }
+
+ private:
+  LlmExecutor& executor_;
+  ThreadPool& worker_thread_pool_;
+  absl::Mutex* llm_executor_mutex_;
+  // A copy of the executor context of the session. It is never activated, and
+  // only serves as the source of the copies made on restore.
+  std::unique_ptr<LlmExecutorContext> executor_context_;
+  int last_prefill_token_id_;
+  bool is_first_turn_;
+};
+
+}  // namespace
+
+// static
+absl::StatusOr<std::unique_ptr<SessionBasic>> SessionBasic::Create(
+    LlmExecutor* executor, Tokenizer* tokenizer,
+    VisionExecutor* vision_executor, AudioExecutor* audio_executor,
+    const SessionConfig& session_config,
+    std::optional<BenchmarkInfo> benchmark_info,
+    ThreadPool* worker_thread_pool, ExecutorLocks* executor_locks) {
+  if (executor_locks == nullptr && worker_thread_pool->max_num_threads() > 1) {
+    return absl::InvalidArgumentError(
+        "Executor locks are required if the worker thread pool runs more than "
+        "one thread.");
+  }
+  std::unique_ptr<ThreadPool> sampler_thread_pool =
+      CreateSamplerThreadPool(session_config);
+  ASSIGN_OR_RETURN(
+      std::unique_ptr<Sampler> sampler,
+      CreateSessionSampler(session_config, sampler_thread_pool.get()));
+  if (sampler != nullptr &&
+      executor->GetSpeculativeDecodingStats() != nullptr &&
+      !IsGreedySingleCandidateSampling(session_config)) {
+    ABSL_LOG(WARNING) << "The executor decodes speculatively, which only "
+                         "reproduces greedy sampling of a single output "
+                         "candidate. The session decodes without it.";
+  }
 
   if (benchmark_info.has_value()) {
     ABSL_LOG(INFO) << "Benchmark is enabled.";
@@ -88,15 +231,151 @@ absl::StatusOr<std::unique_ptr<SessionBasic>> SessionBasic::Create(
     RETURN_IF_ERROR(
         stop_token_detector.AddStopTokenSequence(stop_token_sequence));
   }
+
+  // Run on the worker thread pool since creating the context accesses the
+  // executor states which may be in use by other sessions.
+  absl::Mutex* llm_executor_mutex =
+      executor_locks == nullptr ? nullptr : &executor_locks->llm_executor_mutex;
+  SerialExecutor serial_executor(worker_thread_pool);
+  absl::StatusOr<std::unique_ptr<LlmExecutorContext>> executor_context;
+  RETURN_IF_ERROR(serial_executor.Schedule(
+      [executor, llm_executor_mutex, &executor_context]() {
+        absl::MutexLockMaybe lock(llm_executor_mutex);
+        executor_context = executor->CreateContext();
+      }));
+  RETURN_IF_ERROR(serial_executor.WaitUntilDone(Engine::kDefaultTimeout));
+  if (!executor_context.ok()) {
+    if (!absl::IsUnimplemented(executor_context.status())) {
+      return executor_context.status();
+    }
+    // The executor does not support contexts. Fall back to share the executor
+    // states among the sessions.
+    executor_context = std::unique_ptr<LlmExecutorContext>();
+  }
+  if (session_config.GetLoRAId().has_value()) {
+    // The LoRA is part of the context states, so it is selected while the
+    // context is active.
+    absl::Status lora_status;
+    LlmExecutorContext* context = executor_context->get();
+    RETURN_IF_ERROR(serial_executor.Schedule(
+        [executor, llm_executor_mutex, context, &session_config,
+         &lora_status]() {
+          absl::MutexLockMaybe lock(llm_executor_mutex);
+          if (context != nullptr) {
+            lora_status = executor->SwitchContext(context);
+            if (!lora_status.ok()) {
+              return;
+            }
+          }
+          lora_status = executor->UseLoRA(session_config.GetLoRAId());
+        }));
+    RETURN_IF_ERROR(serial_executor.WaitUntilDone(Engine::kDefaultTimeout));
+    RETURN_IF_ERROR(lora_status);
+  }
   return absl::WrapUnique(new SessionBasic(
-      executor, tokenizer, vision_executor, audio_executor, std::move(sampler),
-      session_config, benchmark_info, worker_thread_pool, stop_token_detector));
+      executor, tokenizer, vision_executor, audio_executor,
+      std::move(sampler_thread_pool), std::move(sampler), session_config,
+      benchmark_info, worker_thread_pool, executor_locks, stop_token_detector,
+      std::move(executor_context).value()));
 }
 
 SessionBasic::~SessionBasic() {
-  auto status = executor_.Reset();
+  if (audio_stream_preprocessor_ != nullptr) {
+    // Closes the audio stream left open by AppendAudio(), if any, so that the
+    // other sessions can stream audio.
+    if (serial_executor_.Schedule([this]() { ResetAudioStream(); }).ok()) {
+      serial_executor_.WaitUntilDone(Engine::kDefaultTimeout).IgnoreError();
+    }
+  }
+  if (executor_context_ == nullptr) {
+    absl::MutexLockMaybe lock(LlmExecutorMutex());
+    auto status = executor_.Reset();
+    if (!status.ok()) {
+      ABSL_LOG(ERROR) << "Failed to reset executor: " << status;
+    }
+    return;
+  }
+  absl::Status status;
+  auto schedule_status = serial_executor_.Schedule([this, &status]() {
+    absl::MutexLockMaybe lock(LlmExecutorMutex());
+    if (auto decode_status = FinishPendingDecode(); !decode_status.ok()) {
+      ABSL_LOG(ERROR) << "Failed to finish pending decode: " << decode_status;
+    }
+    status = executor_.ReleaseContext(std::move(executor_context_));
+  });
+  if (schedule_status.ok()) {
+    schedule_status = serial_executor_.WaitUntilDone(Engine::kDefaultTimeout);
+  }
+  if (!schedule_status.ok() || !status.ok()) {
+    ABSL_LOG(ERROR) << "Failed to release executor context: "
+                    << (schedule_status.ok() ? status : schedule_status);
+  }
+}
+
+absl::Status SessionBasic::ActivateExecutorContext() {
+  if (executor_context_ == nullptr) {
+    return absl::OkStatus();
+  }
+  return executor_.SwitchContext(executor_context_.get());
+}
+
+absl::Status SessionBasic::FinishPendingDecode() {
+  if (pending_decode_task_ == nullptr) {
+    return absl::OkStatus();
+  }
+  std::shared_ptr<DecodeTask> task = std::move(pending_decode_task_);
+  if (auto status = ActivateExecutorContext(); !status.ok()) {
+    task->Abort(status);
+    return status;
+  }
+  return task->RunSteps(std::numeric_limits<int>::max()).status();
+}
+
+absl::AnyInvocable<void(absl::StatusOr<Responses>)>
+SessionBasic::CallOutsideExecutorLock(
+    absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback) {
+  if (LlmExecutorMutex() == nullptr) {
+    return callback;
+  }
+  auto shared_callback =
+      std::make_shared<absl::AnyInvocable<void(absl::StatusOr<Responses>)>>(
+          std::move(callback));
+  return [this, shared_callback](absl::StatusOr<Responses> responses) {
+    auto status = callback_executor_.Schedule(
+        [shared_callback, responses = std::move(responses)]() mutable {
+          (*shared_callback)(std::move(responses));
+        });
+    if (!status.ok()) {
+      ABSL_LOG(ERROR) << "Failed to schedule the callback: " << status;
+    }
+  };
+}
+
+void SessionBasic::ScheduleDecodeSlice(std::weak_ptr<DecodeTask> task) {
+  auto status = serial_executor_.Schedule([this, task]() {
+    // The task is gone if it was finished by a later call of this session.
+    std::shared_ptr<DecodeTask> pending_task = task.lock();
+    if (pending_task == nullptr) {
+      return;
+    }
+    absl::MutexLockMaybe lock(LlmExecutorMutex());
+    if (auto status = ActivateExecutorContext(); !status.ok()) {
+      pending_task->Abort(status);
+      pending_decode_task_.reset();
+      return;
+    }
+    absl::StatusOr<bool> done = pending_task->RunSteps(kNumDecodeStepsPerSlice);
+    if (!done.ok() || *done) {
+      pending_decode_task_.reset();
+      return;
+    }
+    ScheduleDecodeSlice(task);
+  });
   if (!status.ok()) {
-    ABSL_LOG(ERROR) << "Failed to reset executor: " << status;
+    // The serial executor no longer accepts tasks, e.g. the worker thread pool
+    // is shutting down. Finish the decode in place.
+    ABSL_LOG(WARNING) << "Failed to schedule decode steps: " << status;
+    FinishPendingDecode().IgnoreError();
   }
 }
 
@@ -197,6 +476,40 @@ absl::StatusOr<ExecutorInputs> SessionBasic::ProcessAndCombineContents(
   std::vector<int> combined_token_ids;
   std::vector<ExecutorVisionData> all_image_data;
   std::vector<ExecutorAudioData> all_audio_data;
+
+  // Encode all the images at once, so that the vision executor can batch
+  // them.
+  std::vector<const litert::TensorBuffer*> image_tensors;
+  for (const auto& preprocessed_content : preprocessed_contents) {
+    if (const auto* input_image =
+            std::get_if<InputImage>(&preprocessed_content)) {
+      ASSIGN_OR_RETURN(const auto* image_tensor,
+                       input_image->GetPreprocessedImageTensor());
+      if (image_tensor == nullptr) {
+        return absl::InvalidArgumentError(
+            "Image tensor is null in preprocessed_contents.");
+      }
+      image_tensors.push_back(image_tensor);
+    }
+  }
+  if (!image_tensors.empty()) {
+    if (benchmark_info_.has_value()) {
+      RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("vision_executor"));
+    }
+    {
+      absl::MutexLockMaybe lock(executor_locks_ == nullptr
+                                    ? nullptr
+                                    : &executor_locks_->vision_executor_mutex);
+      ASSIGN_OR_RETURN(
+          all_image_data,
+          vision_executor_->Encode(absl::MakeConstSpan(image_tensors)));
+    }
+    if (benchmark_info_.has_value()) {
+      RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("vision_executor"));
+    }
+  }
+
+  int image_index = 0;
   for (const auto& preprocessed_content : preprocessed_contents) {
     if (const auto* input_text =
             std::get_if<InputText>(&preprocessed_content)) {
@@ -210,30 +523,14 @@ absl::StatusOr<ExecutorInputs> SessionBasic::ProcessAndCombineContents(
                                    ReferTensorBufferAsSpan<int>(*token_ids));
       combined_token_ids.insert(combined_token_ids.end(),
                                 ids_buffer_span.begin(), ids_buffer_span.end());
-    } else if (const auto* input_image =
-                   std::get_if<InputImage>(&preprocessed_content)) {
-      ASSIGN_OR_RETURN(const auto* image_tensor,
-                       input_image->GetPreprocessedImageTensor());
-      if (image_tensor == nullptr) {
-        return absl::InvalidArgumentError(
-            "Image tensor is null in preprocessed_contents.");
-      }
-      if (benchmark_info_.has_value()) {
-        RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("vision_executor"));
-      }
-      ASSIGN_OR_RETURN(auto single_image_data,
-                       vision_executor_->Encode(*image_tensor));
-      if (benchmark_info_.has_value()) {
-        RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("vision_executor"));
-      }
+    } else if (std::holds_alternative<InputImage>(preprocessed_content)) {
       ASSIGN_OR_RETURN(auto embeddings_ptr,
-                       single_image_data.GetEmbeddingsPtr());
+                       all_image_data[image_index++].GetEmbeddingsPtr());
       const auto& dimensions = TensorBufferDims(*embeddings_ptr);
       // The last two dimensions are [..., image_token_num, model_dimension].
       const int image_token_num = dimensions.at(dimensions.size() - 2);
       combined_token_ids.insert(combined_token_ids.end(), image_token_num,
                                 ExecutorVisionData::kSpecialToken);
-      all_image_data.push_back(std::move(single_image_data));
     } else if (const auto* input_audio =
                    std::get_if<InputAudio>(&preprocessed_content)) {
       ASSIGN_OR_RETURN(const auto* spectrogram_tensor,
@@ -241,13 +538,20 @@ absl::StatusOr<ExecutorInputs> SessionBasic::ProcessAndCombineContents(
       if (benchmark_info_.has_value()) {
         RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("audio_executor"));
       }
-      ASSIGN_OR_RETURN(auto single_audio_data,
-                       audio_executor_->Encode(*spectrogram_tensor));
+      absl::StatusOr<ExecutorAudioData> single_audio_data;
+      {
+        absl::MutexLockMaybe lock(
+            executor_locks_ == nullptr
+                ? nullptr
+                : &executor_locks_->audio_executor_mutex);
+        single_audio_data = audio_executor_->Encode(*spectrogram_tensor);
+      }
+      RETURN_IF_ERROR(single_audio_data.status());
       if (benchmark_info_.has_value()) {
         RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("audio_executor"));
       }
-      const int num_audio_tokens = single_audio_data.GetValidTokens();
-      all_audio_data.push_back(std::move(single_audio_data));
+      const int num_audio_tokens = single_audio_data->GetValidTokens();
+      all_audio_data.push_back(*std::move(single_audio_data));
       combined_token_ids.insert(combined_token_ids.end(), num_audio_tokens,
                                 ExecutorAudioData::kSpecialToken);
       combined_token_ids.push_back(ExecutorAudioData::kEndToken);
@@ -348,8 +652,18 @@ absl::StatusOr<std::vector<InputData>> SessionBasic::PreprocessContents(
 absl::Status SessionBasic::PrefillInternal(
     const std::vector<InputData>& preprocessed_contents,
     bool wait_for_completion) {
+  // The images and audios are encoded before taking the LLM executor, so that
+  // the other sessions keep using it meanwhile.
   ASSIGN_OR_RETURN(ExecutorInputs inputs,
                    ProcessAndCombineContents(preprocessed_contents));
+  return PrefillExecutorInputs(inputs, wait_for_completion);
+}
+
+absl::Status SessionBasic::PrefillExecutorInputs(ExecutorInputs& inputs,
+                                                 bool wait_for_completion) {
+  absl::MutexLockMaybe lock(LlmExecutorMutex());
+  RETURN_IF_ERROR(FinishPendingDecode());
+  RETURN_IF_ERROR(ActivateExecutorContext());
 
   // This should be added to the beginning of the next prefill call as will no?
   // Also, this is not thread safe. More discussion with @ztenghui is needed.
@@ -378,26 +692,154 @@ absl::Status SessionBasic::RunPrefill(const std::vector<InputData>& contents) {
                      PreprocessContents(templated_contents));
   }
   absl::Status status;
-  RETURN_IF_ERROR(worker_thread_pool_.Schedule(
+  RETURN_IF_ERROR(serial_executor_.Schedule(
       [this, preprocessed_contents = std::move(preprocessed_contents),
        &status]() {
         status = this->PrefillInternal(preprocessed_contents,
                                        /*wait_for_completion=*/true);
       }));
-  RETURN_IF_ERROR(worker_thread_pool_.WaitUntilDone(Engine::kDefaultTimeout));
+  RETURN_IF_ERROR(serial_executor_.WaitUntilDone(Engine::kDefaultTimeout));
   return status;
 }
 
 absl::Status SessionBasic::RunPrefillAsync(
     const std::vector<InputData>& contents,
     absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback) {
-  if (contents.empty()) {
-    return absl::InvalidArgumentError("Input is empty.");
+  if (cancelled_.load()) {
+    // Reset the cancelled flag before processing the next turn.
+    cancelled_ = false;
+  }
+  return SchedulePrefill(contents,
+                         CallOutsideExecutorLock(std::move(callback)));
+}
+
+absl::Status SessionBasic::AppendAudio(absl::Span<const float> pcm_frames) {
+  if (audio_executor_ == nullptr) {
+    return absl::FailedPreconditionError(
+        "Streaming audio requires an audio executor.");
+  }
+  if (audio_stream_preprocessor_ == nullptr) {
+    ASSIGN_OR_RETURN(audio_stream_preprocessor_,
+                     AudioPreprocessorMiniAudio::Create(
+                         AudioPreprocessorConfig::CreateDefaultUsmConfig()));
   }
+  std::vector<float> spectrogram_frames;
+  RETURN_IF_ERROR(audio_stream_preprocessor_->PushPcmFrames(
+      pcm_frames, spectrogram_frames));
+  if (spectrogram_frames.empty()) {
+    return absl::OkStatus();
+  }
+  // The capture is not blocked by the encoding, whose errors are kept for
+  // FinishAudio().
+  return serial_executor_.Schedule(
+      [this, spectrogram_frames = std::move(spectrogram_frames)]() {
+        if (!audio_stream_status_.ok()) {
+          return;
+        }
+        audio_stream_status_ = AppendAudioInternal(spectrogram_frames);
+        if (!audio_stream_status_.ok()) {
+          ResetAudioStream();
+        }
+      });
+}
+
+absl::Status SessionBasic::FinishAudio() {
   if (cancelled_.load()) {
     // Reset the cancelled flag before processing the next turn.
     cancelled_ = false;
   }
+  absl::Status status;
+  RETURN_IF_ERROR(serial_executor_.Schedule(
+      [this, &status]() { status = this->FinishAudioInternal(); }));
+  RETURN_IF_ERROR(serial_executor_.WaitUntilDone(Engine::kDefaultTimeout));
+  // The next stream starts from an empty window.
+  if (audio_stream_preprocessor_ != nullptr) {
+    audio_stream_preprocessor_->Reset();
+  }
+  return status;
+}
+
+absl::Status SessionBasic::AppendAudioInternal(
+    absl::Span<const float> spectrogram_frames) {
+  absl::MutexLockMaybe lock(executor_locks_ == nullptr
+                                ? nullptr
+                                : &executor_locks_->audio_executor_mutex);
+  if (!audio_stream_open_ && executor_locks_ != nullptr) {
+    if (executor_locks_->audio_stream_owner != nullptr) {
+      return absl::FailedPreconditionError(
+          "Another session is streaming audio to the audio executor.");
+    }
+    executor_locks_->audio_stream_owner = this;
+  }
+  audio_stream_open_ = true;
+  return audio_executor_->AppendSpectrogramFrames(spectrogram_frames);
+}
+
+absl::Status SessionBasic::FinishAudioInternal() {
+  absl::Status status = std::exchange(audio_stream_status_, absl::OkStatus());
+  if (!status.ok()) {
+    return status;
+  }
+  if (!audio_stream_open_) {
+    return absl::FailedPreconditionError(
+        "No audio frames were appended with AppendAudio().");
+  }
+  if (benchmark_info_.has_value()) {
+    RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("audio_executor"));
+  }
+  absl::StatusOr<ExecutorAudioData> audio_data;
+  {
+    absl::MutexLockMaybe lock(executor_locks_ == nullptr
+                                  ? nullptr
+                                  : &executor_locks_->audio_executor_mutex);
+    audio_data = audio_executor_->FinishStreamingEncode();
+    if (!audio_data.ok()) {
+      audio_executor_->ResetStreamingEncode().IgnoreError();
+    }
+    if (executor_locks_ != nullptr) {
+      executor_locks_->audio_stream_owner = nullptr;
+    }
+    audio_stream_open_ = false;
+  }
+  RETURN_IF_ERROR(audio_data.status());
+  if (benchmark_info_.has_value()) {
+    RETURN_IF_ERROR(benchmark_info_->TimeMarkDelta("audio_executor"));
+  }
+
+  // The same tokens as ProcessAndCombineContents() prefills for an audio.
+  std::vector<int> token_ids(audio_data->GetValidTokens(),
+                             ExecutorAudioData::kSpecialToken);
+  token_ids.push_back(ExecutorAudioData::kEndToken);
+  ASSIGN_OR_RETURN(auto token_ids_buffer,
+                   tokenizer_.TokenIdsToTensorBuffer(token_ids));
+  ExecutorInputs inputs(ExecutorTextData(std::move(token_ids_buffer)),
+                        /*vision_data=*/std::nullopt, *std::move(audio_data));
+  return PrefillExecutorInputs(inputs, /*wait_for_completion=*/true);
+}
+
+void SessionBasic::ResetAudioStream() {
+  if (!audio_stream_open_) {
+    return;
+  }
+  absl::MutexLockMaybe lock(executor_locks_ == nullptr
+                                ? nullptr
+                                : &executor_locks_->audio_executor_mutex);
+  if (absl::Status status = audio_executor_->ResetStreamingEncode();
+      !status.ok()) {
+    ABSL_LOG(ERROR) << "Failed to reset the audio stream: " << status;
+  }
+  if (executor_locks_ != nullptr) {
+    executor_locks_->audio_stream_owner = nullptr;
+  }
+  audio_stream_open_ = false;
+}
+
+absl::Status SessionBasic::SchedulePrefill(
+    const std::vector<InputData>& contents,
+    absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback) {
+  if (contents.empty()) {
+    return absl::InvalidArgumentError("Input is empty.");
+  }
   std::vector<InputData> preprocessed_contents;
   if (benchmark_info_.has_value() &&
       benchmark_info_->GetBenchmarkParams().num_prefill_tokens() > 0) {
@@ -408,7 +850,7 @@ absl::Status SessionBasic::RunPrefillAsync(
     ASSIGN_OR_RETURN(preprocessed_contents,
                      PreprocessContents(templated_contents));
   }
-  RETURN_IF_ERROR(worker_thread_pool_.Schedule(
+  RETURN_IF_ERROR(serial_executor_.Schedule(
       [this, preprocessed_contents = std::move(preprocessed_contents),
        callback = std::move(callback)]() mutable {
         absl::Status status = this->PrefillInternal(
@@ -423,14 +865,43 @@ absl::Status SessionBasic::RunPrefillAsync(
   return absl::OkStatus();
 }
 
+absl::StatusOr<Sampler*> SessionBasic::GetDecodeSampler(
+    const DecodeConfig& decode_config) const {
+  const SpeculativeDecodingMode mode =
+      decode_config.GetSpeculativeDecodingMode();
+  const bool can_speculate =
+      executor_.GetSpeculativeDecodingStats() != nullptr &&
+      decode_config.GetConstraint() == nullptr &&
+      (sampler_ == nullptr || IsGreedySingleCandidateSampling(session_config_));
+  // Prompt lookup is only requested explicitly, so it is an error if it would
+  // silently decode without it.
+  if (mode == SpeculativeDecodingMode::kPromptLookup && !can_speculate) {
+    return absl::InvalidArgumentError(
+        "Prompt lookup decoding requires an executor which decodes "
+        "speculatively, no constraint, and greedy sampling of a single output "
+        "candidate.");
+  }
+  if (sampler_ != nullptr && mode != SpeculativeDecodingMode::kDisabled &&
+      can_speculate) {
+    return nullptr;
+  }
+  return sampler_.get();
+}
+
 absl::StatusOr<Responses> SessionBasic::DecodeInternal(
     const DecodeConfig& decode_config) {
-  if (sampler_ == nullptr) {
+  absl::MutexLockMaybe lock(LlmExecutorMutex());
+  RETURN_IF_ERROR(FinishPendingDecode());
+  RETURN_IF_ERROR(ActivateExecutorContext());
+  ASSIGN_OR_RETURN(Sampler* sampler, GetDecodeSampler(decode_config));
+  if (sampler == nullptr) {
     ASSIGN_OR_RETURN(
         auto responses,
         Decode(executor_, tokenizer_, stop_token_detector_,
                session_config_.GetNumOutputCandidates(),
-               decode_config.GetConstraint(), benchmark_info_, &cancelled_));
+               decode_config.GetConstraint(), benchmark_info_, &cancelled_,
+               decode_config.GetSpeculativeDecodingMode(),
+               &constraint_thread_pool_));
     return responses;
   } else {
     std::vector<int> decoded_ids(session_config_.GetNumOutputCandidates(),
@@ -440,9 +911,10 @@ absl::StatusOr<Responses> SessionBasic::DecodeInternal(
     ASSIGN_OR_RETURN(auto responses,
                      DecodeCustomSampling(
                          executor_, tokenizer_, stop_token_detector_,
-                         session_config_.GetNumOutputCandidates(), *sampler_,
+                         session_config_.GetNumOutputCandidates(), *sampler,
                          *decoded_ids_buffer, decode_config.GetConstraint(),
-                         benchmark_info_, &cancelled_));
+                         benchmark_info_, &cancelled_,
+                         &constraint_thread_pool_));
     return responses;
   }
 }
@@ -450,22 +922,74 @@ absl::StatusOr<Responses> SessionBasic::DecodeInternal(
 absl::Status SessionBasic::DecodeInternalStreaming(
     absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
     const DecodeConfig& decode_config) {
-  if (sampler_ == nullptr) {
-    RETURN_IF_ERROR(DecodeStreaming(
-        executor_, tokenizer_, stop_token_detector_,
-        session_config_.GetNumOutputCandidates(), decode_config.GetConstraint(),
-        benchmark_info_, std::move(callback), &cancelled_));
+  absl::MutexLockMaybe lock(LlmExecutorMutex());
+  auto status = FinishPendingDecode();
+  if (status.ok()) {
+    status = ActivateExecutorContext();
+  }
+  if (!status.ok()) {
+    callback(status);
+    return status;
+  }
+  absl::StatusOr<Sampler*> sampler_or = GetDecodeSampler(decode_config);
+  if (!sampler_or.ok()) {
+    callback(sampler_or.status());
+    return sampler_or.status();
+  }
+  Sampler* sampler = *sampler_or;
+  if (executor_context_ == nullptr) {
+    // The executor states are shared among the sessions, so the decode loop
+    // can not be interleaved with other sessions.
+    if (sampler == nullptr) {
+      RETURN_IF_ERROR(DecodeStreaming(
+          executor_, tokenizer_, stop_token_detector_,
+          session_config_.GetNumOutputCandidates(),
+          decode_config.GetConstraint(), benchmark_info_, std::move(callback),
+          &cancelled_, decode_config.GetSpeculativeDecodingMode(),
+          &constraint_thread_pool_));
+    } else {
+      std::vector<int> decoded_ids(session_config_.GetNumOutputCandidates(),
+                                   last_prefill_token_id_);
+      auto decoded_ids_buffer = CopyToTensorBuffer<int>(
+          decoded_ids, {session_config_.GetNumOutputCandidates(), 1});
+      RETURN_IF_ERROR(DecodeCustomSamplingStreaming(
+          executor_, tokenizer_, stop_token_detector_,
+          session_config_.GetNumOutputCandidates(), *sampler,
+          *decoded_ids_buffer, decode_config.GetConstraint(), benchmark_info_,
+          std::move(callback), &cancelled_, &constraint_thread_pool_));
+    }
+    return absl::OkStatus();
+  }
+
+  // Run the decode loop in slices of a few steps, each scheduled at the back of
+  // the serial executor queue, so that the decode steps of all the sessions
+  // with pending work are interleaved instead of running one generation after
+  // another.
+  if (sampler == nullptr) {
+    ASSIGN_OR_RETURN(pending_decode_task_,
+                     CreateDecodeStreamingTask(
+                         executor_, tokenizer_, stop_token_detector_,
+                         session_config_.GetNumOutputCandidates(),
+                         decode_config.GetConstraint(), benchmark_info_,
+                         std::move(callback), &cancelled_,
+                         decode_config.GetSpeculativeDecodingMode(),
+                         &constraint_thread_pool_));
   } else {
     std::vector<int> decoded_ids(session_config_.GetNumOutputCandidates(),
                                  last_prefill_token_id_);
-    auto decoded_ids_buffer = CopyToTensorBuffer<int>(
-        decoded_ids, {session_config_.GetNumOutputCandidates(), 1});
-    RETURN_IF_ERROR(DecodeCustomSamplingStreaming(
-        executor_, tokenizer_, stop_token_detector_,
-        session_config_.GetNumOutputCandidates(), *sampler_,
-        *decoded_ids_buffer, decode_config.GetConstraint(), benchmark_info_,
-        std::move(callback), &cancelled_));
+    LITERT_ASSIGN_OR_RETURN(
+        pending_decoded_ids_,
+        CopyToTensorBuffer<int>(decoded_ids,
+                                {session_config_.GetNumOutputCandidates(), 1}));
+    ASSIGN_OR_RETURN(pending_decode_task_,
+                     CreateDecodeCustomSamplingStreamingTask(
+                         executor_, tokenizer_, stop_token_detector_,
+                         session_config_.GetNumOutputCandidates(), *sampler,
+                         pending_decoded_ids_, decode_config.GetConstraint(),
+                         benchmark_info_, std::move(callback), &cancelled_,
+                         &constraint_thread_pool_));
   }
+  ScheduleDecodeSlice(pending_decode_task_);
   return absl::OkStatus();
 }
 
@@ -482,10 +1006,10 @@ absl::StatusOr<Responses> SessionBasic::RunDecode(
   }
   absl::StatusOr<Responses> responses;
   RETURN_IF_ERROR(
-      worker_thread_pool_.Schedule([this, &responses, decode_config]() {
+      serial_executor_.Schedule([this, &responses, decode_config]() {
         responses = this->DecodeInternal(decode_config);
       }));
-  RETURN_IF_ERROR(worker_thread_pool_.WaitUntilDone(Engine::kDefaultTimeout));
+  RETURN_IF_ERROR(serial_executor_.WaitUntilDone(Engine::kDefaultTimeout));
   return responses;
 }
 
@@ -502,7 +1026,14 @@ absl::Status SessionBasic::RunDecodeAsync(
     // Reset the cancelled flag before processing the next turn.
     cancelled_ = false;
   }
-  return worker_thread_pool_.Schedule(
+  return ScheduleDecode(CallOutsideExecutorLock(std::move(callback)),
+                        decode_config);
+}
+
+absl::Status SessionBasic::ScheduleDecode(
+    absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
+    const DecodeConfig& decode_config) {
+  return serial_executor_.Schedule(
       [this, callback = std::move(callback), decode_config]() mutable {
         this->DecodeInternalStreaming(std::move(callback), decode_config)
             .IgnoreError();
@@ -536,14 +1067,23 @@ absl::StatusOr<Responses> SessionBasic::RunTextScoring(
   // testing.
   auto temperature = 1.0f;
   absl::StatusOr<Responses> score;
-  // Scheduled on the worker thread pool to ensure serialized execution with
-  // other engine operations as the function waits for completion.
-  RETURN_IF_ERROR(worker_thread_pool_.Schedule(
+  // Scheduled on the serial executor to ensure serialized execution with the
+  // other operations of the session as the function waits for completion.
+  RETURN_IF_ERROR(serial_executor_.Schedule(
       [this, &score, &target_text, &decoded_ids_buffer, &temperature]() {
+        absl::MutexLockMaybe lock(LlmExecutorMutex());
+        if (auto status = FinishPendingDecode(); !status.ok()) {
+          score = status;
+          return;
+        }
+        if (auto status = ActivateExecutorContext(); !status.ok()) {
+          score = status;
+          return;
+        }
         score = ScoreCustomSampling(executor_, tokenizer_, target_text,
                                     temperature, *decoded_ids_buffer);
       }));
-  RETURN_IF_ERROR(worker_thread_pool_.WaitUntilDone(Engine::kDefaultTimeout));
+  RETURN_IF_ERROR(serial_executor_.WaitUntilDone(Engine::kDefaultTimeout));
   return score;
 }
 
@@ -563,9 +1103,10 @@ absl::Status SessionBasic::GenerateContentStream(
     cancelled_ = false;
   }
 
-  RETURN_IF_ERROR(RunPrefillAsync(
+  RETURN_IF_ERROR(SchedulePrefill(
       contents,
-      [this, callback = std::move(callback), decode_config = decode_config](
+      [this, callback = CallOutsideExecutorLock(std::move(callback)),
+       decode_config = decode_config](
           absl::StatusOr<Responses> responses) mutable {
         if (!responses.ok()) {
           callback(responses.status());
@@ -575,12 +1116,99 @@ absl::Status SessionBasic::GenerateContentStream(
                 absl::CancelledError("Session is cancelled during prefill."));
             return;
           }
-          auto status = RunDecodeAsync(std::move(callback), decode_config);
+          auto status = ScheduleDecode(std::move(callback), decode_config);
         }
       }));
   return absl::OkStatus();
 }
 
+absl::StatusOr<std::unique_ptr<Engine::Session::SessionCheckpoint>>
+SessionBasic::Checkpoint() {
+  if (executor_context_ == nullptr) {
+    return absl::UnimplementedError(
+        "Checkpoint requires an executor supporting contexts.");
+  }
+  absl::StatusOr<std::unique_ptr<LlmExecutorContext>> executor_context;
+  RETURN_IF_ERROR(serial_executor_.Schedule([this, &executor_context]() {
+    absl::MutexLockMaybe lock(LlmExecutorMutex());
+    if (auto status = FinishPendingDecode(); !status.ok()) {
+      executor_context = status;
+      return;
+    }
+    executor_context = executor_.CloneContext(executor_context_.get());
+  }));
+  RETURN_IF_ERROR(serial_executor_.WaitUntilDone(Engine::kDefaultTimeout));
+  RETURN_IF_ERROR(executor_context.status());
+  return std::make_unique<SessionBasicCheckpoint>(
+      executor_, worker_thread_pool_, LlmExecutorMutex(),
+      std::move(executor_context).value(), last_prefill_token_id_,
+      is_first_turn_);
+}
+
+absl::Status SessionBasic::RestoreCheckpoint(
+    const SessionCheckpoint& checkpoint) {
+  if (executor_context_ == nullptr) {
+    return absl::UnimplementedError(
+        "RestoreCheckpoint requires an executor supporting contexts.");
+  }
+  const auto* session_checkpoint =
+      dynamic_cast<const SessionBasicCheckpoint*>(&checkpoint);
+  RET_CHECK(session_checkpoint != nullptr)
+      << "The checkpoint is not created by SessionBasic.";
+  absl::Status status;
+  RETURN_IF_ERROR(
+      serial_executor_.Schedule([this, session_checkpoint, &status]() {
+        absl::MutexLockMaybe lock(LlmExecutorMutex());
+        status = FinishPendingDecode();
+        if (!status.ok()) {
+          return;
+        }
+        // Copy the checkpoint instead of taking it over, so that it can be
+        // restored again.
+        auto executor_context =
+            executor_.CloneContext(session_checkpoint->executor_context());
+        if (!executor_context.ok()) {
+          status = executor_context.status();
+          return;
+        }
+        status = executor_.ReleaseContext(std::move(executor_context_));
+        executor_context_ = std::move(executor_context).value();
+      }));
+  RETURN_IF_ERROR(serial_executor_.WaitUntilDone(Engine::kDefaultTimeout));
+  RETURN_IF_ERROR(status);
+  last_prefill_token_id_ = session_checkpoint->last_prefill_token_id();
+  is_first_turn_ = session_checkpoint->is_first_turn();
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<Engine::Session>> SessionBasic::Fork() {
+  if (executor_context_ == nullptr) {
+    return absl::UnimplementedError(
+        "Fork requires an executor supporting contexts.");
+  }
+  std::unique_ptr<ThreadPool> sampler_thread_pool =
+      CreateSamplerThreadPool(session_config_);
+  ASSIGN_OR_RETURN(
+      std::unique_ptr<Sampler> sampler,
+      CreateSessionSampler(session_config_, sampler_thread_pool.get()));
+  ASSIGN_OR_RETURN(auto checkpoint, Checkpoint());
+  auto& session_checkpoint =
+      static_cast<SessionBasicCheckpoint&>(*checkpoint);
+  std::optional<BenchmarkInfo> benchmark_info;
+  if (benchmark_info_.has_value()) {
+    benchmark_info.emplace(benchmark_info_->GetBenchmarkParams());
+  }
+  // The forked session takes over the context copied by the checkpoint.
+  auto session = absl::WrapUnique(new SessionBasic(
+      &executor_, &tokenizer_, vision_executor_, audio_executor_,
+      std::move(sampler_thread_pool), std::move(sampler), session_config_,
+      std::move(benchmark_info), &worker_thread_pool_, executor_locks_,
+      stop_token_detector_, session_checkpoint.TakeExecutorContext()));
+  session->last_prefill_token_id_ = session_checkpoint.last_prefill_token_id();
+  session->is_first_turn_ = session_checkpoint.is_first_turn();
+  return session;
+}
+
 absl::StatusOr<BenchmarkInfo> SessionBasic::GetBenchmarkInfo() {
   if (benchmark_info_.has_value()) {
     return benchmark_info_.value();
@@ -28,9 +28,15 @@
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+#include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/components/preprocessor/audio_preprocessor_miniaudio.h"
 #include "runtime/components/sampler.h"
 #include "runtime/components/stop_token_detector.h"
 #include "runtime/components/tokenizer.h"
+#include "runtime/core/executor_locks.h"
+#include "runtime/core/pipeline.h"
 #include "runtime/engine/engine.h"
 #include "runtime/engine/engine_settings.h"
 #include "runtime/engine/io_types.h"
@@ -38,6 +44,7 @@
 #include "runtime/executor/llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/vision_executor.h"
+#include "runtime/framework/serial_executor.h"
 #include "runtime/framework/threadpool.h"
 #include "runtime/proto/sampler_params.pb.h"
 
@@ -57,12 +64,18 @@ class SessionBasic : public Engine::Session {
   // - sampler_params: The sampler parameters used for decoding. Note that if
   //   the sampler_params.type is TYPE_UNSPECIFIED, the sampling logic will be
   //   handled by the LLM Executor.
+  // - worker_thread_pool: The thread pool the session runs its work on, in
+  //   order, through a serial executor of its own.
+  // - executor_locks: The locks serializing the use of the executors shared
+  //   with the other sessions. Must be set if the worker_thread_pool runs more
+  //   than one thread, otherwise an InvalidArgumentError is returned.
   static absl::StatusOr<std::unique_ptr<SessionBasic>> Create(
       LlmExecutor* absl_nonnull executor, Tokenizer* absl_nonnull tokenizer,
       VisionExecutor* vision_executor, AudioExecutor* audio_executor,
       const SessionConfig& session_config,
       std::optional<BenchmarkInfo> benchmark_info,
-      ThreadPool* absl_nonnull worker_thread_pool);
+      ThreadPool* absl_nonnull worker_thread_pool,
+      ExecutorLocks* absl_nullable executor_locks = nullptr);
 
   virtual ~SessionBasic();
 
@@ -94,6 +107,15 @@ class SessionBasic : public Engine::Session {
       const std::vector<InputData>& contents,
       absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback) override;
 
+  // Preprocesses the PCM frames on the calling thread with the USM audio
+  // preprocessor, which is the one of the models with audio, and encodes the
+  // spectrogram frames on the worker thread. Requires an audio executor
+  // supporting streaming encoding. Must not be called concurrently with
+  // itself or FinishAudio().
+  absl::Status AppendAudio(absl::Span<const float> pcm_frames) override;
+
+  absl::Status FinishAudio() override;
+
   absl::StatusOr<Responses> RunDecode() override;
 
   absl::StatusOr<Responses> RunDecode(
@@ -108,8 +130,19 @@ class SessionBasic : public Engine::Session {
 
   absl::StatusOr<BenchmarkInfo> GetBenchmarkInfo() override;
 
-  // TODO(b/450903294): Add rollback history support for Session and
-  // Conversation.
+  // Copies the KV cache and the processed tokens of the session. Requires an
+  // executor supporting contexts. Note that the KV cache buffers are copied as
+  // a whole, since the executor runs on contiguous KV cache buffers.
+  absl::StatusOr<std::unique_ptr<SessionCheckpoint>> Checkpoint() override;
+
+  absl::Status RestoreCheckpoint(const SessionCheckpoint& checkpoint) override;
+
+  // The forked session shares the executor, the tokenizer and the worker
+  // thread pool with this session, and gets its own sampler and benchmark
+  // info.
+  absl::StatusOr<std::unique_ptr<Engine::Session>> Fork() override;
+
+  // TODO(b/450903294): Add rollback history support for Conversation.
   void CancelProcess() override {
     ABSL_LOG(INFO) << "SessionBasic::CancelProcess";
     cancelled_.store(true);
@@ -150,20 +183,70 @@ class SessionBasic : public Engine::Session {
                         Tokenizer* absl_nonnull tokenizer,
                         VisionExecutor* vision_executor,
                         AudioExecutor* audio_executor,
+                        std::unique_ptr<ThreadPool> sampler_thread_pool,
                         std::unique_ptr<Sampler> sampler,
                         const SessionConfig& session_config,
                         std::optional<BenchmarkInfo> benchmark_info,
                         ThreadPool* absl_nonnull worker_thread_pool,
-                        const StopTokenDetector& stop_token_detector)
+                        ExecutorLocks* absl_nullable executor_locks,
+                        const StopTokenDetector& stop_token_detector,
+                        std::unique_ptr<LlmExecutorContext> executor_context)
       : executor_(*executor),
         tokenizer_(*tokenizer),
         vision_executor_(vision_executor),
         audio_executor_(audio_executor),
+        sampler_thread_pool_(std::move(sampler_thread_pool)),
         sampler_(std::move(sampler)),
         session_config_(session_config),
         benchmark_info_(benchmark_info),
         worker_thread_pool_(*worker_thread_pool),
-        stop_token_detector_(stop_token_detector) {}
+        executor_locks_(executor_locks),
+        stop_token_detector_(stop_token_detector),
+        executor_context_(std::move(executor_context)),
+        constraint_thread_pool_(/*name_prefix=*/"constraint",
+                                /*max_num_threads=*/1),
+        callback_executor_(worker_thread_pool),
+        serial_executor_(worker_thread_pool) {}
+
+  // Returns the mutex to hold while running the LLM executor, or null if the
+  // session runs on a single worker thread.
+  absl::Mutex* LlmExecutorMutex() const {
+    return executor_locks_ == nullptr ? nullptr
+                                      : &executor_locks_->llm_executor_mutex;
+  }
+
+  // Activates the executor context of the session, if any. It must be called
+  // on the worker thread, holding LlmExecutorMutex(), before running the
+  // executor.
+  absl::Status ActivateExecutorContext();
+
+  // Runs the pending streaming decode of the session, if any, to completion.
+  // It must be called on the worker thread, holding LlmExecutorMutex(), before
+  // running anything else on the executor for this session, so that the calls
+  // of the session keep their order.
+  absl::Status FinishPendingDecode();
+
+  // Returns the callback to hand to the prefill and decode functions in place
+  // of the user callback. If the session holds LlmExecutorMutex() while running
+  // them, the user callback is run on the callback executor instead, so that it
+  // never runs with the mutex held, e.g. while calling back into the engine.
+  absl::AnyInvocable<void(absl::StatusOr<Responses>)> CallOutsideExecutorLock(
+      absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback);
+
+  // Schedules the prefill of the contents on the serial executor, and calls
+  // the callback on the worker thread once it is done.
+  absl::Status SchedulePrefill(
+      const std::vector<InputData>& contents,
+      absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback);
+
+  // Schedules the streaming decode on the serial executor.
+  absl::Status ScheduleDecode(
+      absl::AnyInvocable<void(absl::StatusOr<Responses>)> callback,
+      const DecodeConfig& decode_config);
+
+  // Schedules the next few decode steps of the pending streaming decode on the
+  // serial executor. The slice re-schedules itself until the decode is done.
+  void ScheduleDecodeSlice(std::weak_ptr<DecodeTask> task);
 
   // The internal function to prefill the input prompt. It is for convenience to
   // wrap it with lambda function for scheduling.
@@ -171,6 +254,32 @@ class SessionBasic : public Engine::Session {
       const std::vector<InputData>& preprocessed_contents,
       bool wait_for_completion);
 
+  // Prefills the combined inputs on the LLM executor.
+  absl::Status PrefillExecutorInputs(ExecutorInputs& inputs,
+                                     bool wait_for_completion);
+
+  // Appends the spectrogram frames to the audio stream of the session on the
+  // audio executor, and opens the stream if needed. Must be called on the
+  // worker thread.
+  absl::Status AppendAudioInternal(absl::Span<const float> spectrogram_frames);
+
+  // Encodes the rest of the audio stream of the session, closes it and
+  // prefills the encoded audio. Must be called on the worker thread.
+  absl::Status FinishAudioInternal();
+
+  // Discards the audio stream of the session on the audio executor, if any.
+  // Must be called on the worker thread.
+  void ResetAudioStream();
+
+  // Returns the sampler to decode with, or null to let the executor sample the
+  // tokens. The executor only decodes speculatively when it samples the tokens
+  // itself, so greedy sessions leave the sampling to an executor that decodes
+  // speculatively: its greedy verification picks the same tokens.
+  // Fails if `decode_config` requests prompt lookup decoding, which the
+  // executor could not run.
+  absl::StatusOr<Sampler*> GetDecodeSampler(
+      const DecodeConfig& decode_config) const;
+
   // The internal functions to decode the input prompt. It is for convenience to
   // wrap it with lambda function for scheduling.
   absl::StatusOr<Responses> DecodeInternal(const DecodeConfig& decode_config);
@@ -197,6 +306,10 @@ class SessionBasic : public Engine::Session {
   // The audio executor used for run the LLM for prefill/decode.
   AudioExecutor* audio_executor_;
 
+  // The thread pool the sampler samples the output candidates on, if any.
+  // Declared before the sampler so that it outlives the sampler.
+  std::unique_ptr<ThreadPool> sampler_thread_pool_;
+
   // The session config used for the session.
   std::unique_ptr<Sampler> sampler_;
 
@@ -205,7 +318,7 @@ class SessionBasic : public Engine::Session {
 
   // The last token id of the prefill ids. It is used for the first decode
   // process to determine the token id to start from.
-  int last_prefill_token_id_;
+  int last_prefill_token_id_ = 0;
 
   // The benchmark info used for the session.
   std::optional<BenchmarkInfo> benchmark_info_;
@@ -213,6 +326,10 @@ class SessionBasic : public Engine::Session {
   // The thread pool used for the session.
   ThreadPool& worker_thread_pool_;
 
+  // The locks of the executors shared with the other sessions, or null if the
+  // worker thread pool runs a single thread.
+  ExecutorLocks* const executor_locks_;
+
   // The stop token detector used for the session.
   StopTokenDetector stop_token_detector_;
 
@@ -224,6 +341,45 @@ class SessionBasic : public Engine::Session {
 
   // An atomic boolean to indicate whether the session is cancelled.
   std::atomic<bool> cancelled_{false};
+
+  // Turns the PCM frames of AppendAudio() into spectrogram frames. Created by
+  // the first AppendAudio() call, and only accessed by the calling thread.
+  std::unique_ptr<AudioPreprocessorMiniAudio> audio_stream_preprocessor_;
+
+  // Whether the session has an audio stream open on the audio executor. Only
+  // accessed on the serial executor.
+  bool audio_stream_open_ = false;
+
+  // The first error of the audio stream, returned by FinishAudio(). Only
+  // accessed on the serial executor.
+  absl::Status audio_stream_status_;
+
+  // The executor context holding the KV cache of the session, so that multiple
+  // sessions can share the executor. Null if the executor does not support
+  // contexts, in which case the sessions share the executor states.
+  std::unique_ptr<LlmExecutorContext> executor_context_;
+
+  // The thread pool the constrained decodes of the session update the
+  // constraint states on, reused across the decode calls. Declared before the
+  // pending decode task so that it outlives the task.
+  ThreadPool constraint_thread_pool_;
+
+  // The streaming decode being run in slices on the worker thread, if any. Only
+  // accessed on the serial executor.
+  std::shared_ptr<DecodeTask> pending_decode_task_;
+
+  // The decoded ids buffer used by the pending custom sampling decode.
+  litert::TensorBuffer pending_decoded_ids_;
+
+  // Runs the user callbacks in order, outside LlmExecutorMutex(), if the
+  // session runs on multiple worker threads. Declared before the serial
+  // executor so that it runs the callbacks of the pending work on destruction.
+  SerialExecutor callback_executor_;
+
+  // Runs the work of the session on the worker thread pool in order, while the
+  // work of the other sessions runs in parallel. Declared last so that the
+  // pending work finishes before the other members are destroyed.
+  SerialExecutor serial_executor_;
 };
 
 }  // namespace litert::lm
@@ -19,6 +19,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>  // NOLINT: Required for std::this_thread::get_id().
 #include <utility>
 #include <variant>
 #include <vector>
@@ -32,22 +33,28 @@
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/str_join.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
 #include "absl/synchronization/notification.h"  // from @com_google_absl
 #include "absl/time/clock.h"  // from @com_google_absl
 #include "absl/time/time.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_environment.h"  // from @litert
+#include "litert/cc/litert_macros.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "litert/test/matchers.h"  // from @litert
 #include "runtime/components/constrained_decoding/fake_constraint.h"
 #include "runtime/components/sentencepiece_tokenizer.h"
 #include "runtime/components/tokenizer.h"
+#include "runtime/core/executor_locks.h"
 #include "runtime/engine/engine_settings.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/executor/audio_executor.h"
 #include "runtime/executor/audio_executor_settings.h"
 #include "runtime/executor/audio_litert_compiled_model_executor.h"
 #include "runtime/executor/executor_settings_base.h"
 #include "runtime/executor/fake_llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
+#include "runtime/executor/speculative_decoding_util.h"
 #include "runtime/framework/threadpool.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/scoped_file.h"
@@ -229,6 +236,52 @@ absl::AnyInvocable<void(absl::StatusOr<Responses>)> CreateStreamingTestCallback(
   };
 }
 
+// Fake audio executor which encodes each spectrogram frame of an audio stream
+// into an audio token with the embedding {1}.
+class FakeStreamingAudioExecutor : public AudioExecutor {
+ public:
+  static constexpr int kNumMelBins = 128;
+
+  absl::StatusOr<ExecutorAudioData> Encode(
+      const TensorBuffer& spectrogram_tensor) override {
+    return absl::UnimplementedError("Only streaming encoding is faked.");
+  }
+
+  absl::Status AppendSpectrogramFrames(
+      absl::Span<const float> spectrogram_frames) override {
+    num_appended_frames_.push_back(spectrogram_frames.size() / kNumMelBins);
+    return absl::OkStatus();
+  }
+
+  absl::StatusOr<ExecutorAudioData> FinishStreamingEncode() override {
+    int num_frames = 0;
+    for (int num_appended_frames : num_appended_frames_) {
+      num_frames += num_appended_frames;
+    }
+    const std::vector<float> embeddings(num_frames, 1.0f);
+    LITERT_ASSIGN_OR_RETURN(
+        auto embeddings_buffer,
+        CopyToTensorBuffer<float>(absl::MakeConstSpan(embeddings),
+                                  {1, num_frames, 1}));
+    return ExecutorAudioData(std::move(embeddings_buffer),
+                             /*per_layer_embeddings=*/std::nullopt,
+                             num_frames);
+  }
+
+  absl::Status ResetStreamingEncode() override {
+    num_appended_frames_.clear();
+    return absl::OkStatus();
+  }
+
+  // The number of frames of each AppendSpectrogramFrames() call.
+  const std::vector<int>& num_appended_frames() const {
+    return num_appended_frames_;
+  }
+
+ private:
+  std::vector<int> num_appended_frames_;
+};
+
 TEST_F(SessionBasicTest, RunPrefill) {
   const std::vector<std::vector<int>> stop_token_ids = {{2294}};
   SessionConfig session_config = SessionConfig::CreateDefault();
@@ -258,6 +311,26 @@ TEST_F(SessionBasicTest, RunPrefill) {
   EXPECT_OK((*session)->RunPrefill(inputs));
 }
 
+TEST_F(SessionBasicTest, CreateWithLoRAIdFailsIfExecutorHasNoLoRA) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.GetMutableStopTokenIds() = {{2294}};
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  session_config.SetLoRAId(1);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          /*prefill_tokens=*/{{2, 90, 547, 58, 735, 210, 466, 2294}},
+          /*decode_tokens=*/{{224}}));
+  // The LoRA is not silently ignored.
+  EXPECT_THAT(SessionBasic::Create(executor.get(), tokenizer_.get(),
+                                   /*vision_executor=*/nullptr,
+                                   /*audio_executor=*/nullptr, session_config,
+                                   std::nullopt, worker_thread_pool_.get()),
+              testing::status::StatusIs(absl::StatusCode::kUnimplemented));
+}
+
 TEST_F(SessionBasicTest, RunDecode) {
   const std::vector<std::vector<int>> stop_token_ids = {{2294}};
   SessionConfig session_config = SessionConfig::CreateDefault();
@@ -289,6 +362,199 @@ TEST_F(SessionBasicTest, RunDecode) {
   EXPECT_EQ(responses->GetTexts()[0], " How's it going?");
 }
 
+TEST_F(SessionBasicTest, RunDecodeWithPromptLookupAndGreedySampler) {
+  // Top P sampler which always picks the most likely token.
+  proto::SamplerParameters sampler_params;
+  sampler_params.set_type(proto::SamplerParameters::TOP_P);
+  sampler_params.set_k(1);
+  sampler_params.set_temperature(1.0);
+  sampler_params.set_p(0.5);
+  sampler_params.set_seed(1);
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params;
+  session_config.GetMutableStopTokenIds() = {{2294}};
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          // "Hello World!"
+          /*prefill_tokens=*/{{2, 90, 547, 58, 735, 210, 466, 2294}},
+          // "How's it going?"
+          /*decode_tokens=*/{
+              {224}, {24}, {8}, {66}, {246}, {18}, {2295}, {2294}}));
+  executor->EnableSpeculativeDecoding(/*num_draft_tokens=*/3,
+                                      /*num_accepted_tokens=*/2);
+  BenchmarkInfo benchmark_info((proto::BenchmarkParams()));
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr,
+                           /*audio_executor=*/nullptr, session_config,
+                           benchmark_info, worker_thread_pool_.get()));
+
+  std::vector<InputData> inputs;
+  inputs.emplace_back(InputText("Hello World!"));
+  EXPECT_OK(session->RunPrefill(inputs));
+  auto decode_config = DecodeConfig::CreateDefault();
+  decode_config.SetSpeculativeDecodingMode(
+      SpeculativeDecodingMode::kPromptLookup);
+  ASSERT_OK_AND_ASSIGN(auto responses, session->RunDecode(decode_config));
+  ASSERT_EQ(responses.GetTexts().size(), 1);
+  EXPECT_EQ(responses.GetTexts()[0], " How's it going?");
+
+  // The executor samples the tokens itself to decode speculatively. The 8
+  // decoded tokens take 3 verification passes of 3 draft tokens each.
+  EXPECT_EQ(executor->last_speculative_decoding_mode(),
+            SpeculativeDecodingMode::kPromptLookup);
+  ASSERT_OK_AND_ASSIGN(auto session_benchmark_info,
+                       session->GetBenchmarkInfo());
+  EXPECT_EQ(session_benchmark_info.GetSpeculativeVerifySteps(), 3);
+  EXPECT_EQ(session_benchmark_info.GetSpeculativeDraftTokens(), 9);
+  EXPECT_EQ(session_benchmark_info.GetSpeculativeAcceptedTokens(), 6);
+  EXPECT_DOUBLE_EQ(session_benchmark_info.GetSpeculativeAcceptedTokensPerStep(),
+                   2.0);
+}
+
+TEST_F(SessionBasicTest, RunDecodeWithPromptLookupFailsWithRandomSampler) {
+  proto::SamplerParameters sampler_params;
+  sampler_params.set_type(proto::SamplerParameters::TOP_P);
+  sampler_params.set_k(40);
+  sampler_params.set_temperature(1.0);
+  sampler_params.set_p(0.9);
+  sampler_params.set_seed(1);
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params;
+  session_config.GetMutableStopTokenIds() = {{2294}};
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          /*prefill_tokens=*/{{2, 90, 547, 58, 735, 210, 466, 2294}},
+          /*decode_tokens=*/{{224}, {2294}}));
+  executor->EnableSpeculativeDecoding(/*num_draft_tokens=*/3,
+                                      /*num_accepted_tokens=*/2);
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr,
+                           /*audio_executor=*/nullptr, session_config,
+                           /*benchmark_info=*/std::nullopt,
+                           worker_thread_pool_.get()));
+
+  std::vector<InputData> inputs;
+  inputs.emplace_back(InputText("Hello World!"));
+  EXPECT_OK(session->RunPrefill(inputs));
+  auto decode_config = DecodeConfig::CreateDefault();
+  decode_config.SetSpeculativeDecodingMode(
+      SpeculativeDecodingMode::kPromptLookup);
+  // Prompt lookup does not silently decode without speculation.
+  EXPECT_THAT(session->RunDecode(decode_config),
+              testing::status::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(SessionBasicTest, GenerateContentStreamOnMultipleWorkerThreads) {
+  const std::vector<std::vector<int>> stop_token_ids = {{2294}};
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.GetMutableStopTokenIds() = stop_token_ids;
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          // "Hello World!"
+          /*prefill_tokens=*/{{2, 90, 547, 58, 735, 210, 466, 2294}},
+          // "How's it going?"
+          /*decode_tokens=*/{
+              {224}, {24}, {8}, {66}, {246}, {18}, {2295}, {2294}}));
+  ThreadPool worker_thread_pool(/*name_prefix=*/"engine",
+                                /*max_num_threads=*/4);
+  ExecutorLocks executor_locks;
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr,
+                           /*audio_executor=*/nullptr, session_config,
+                           std::nullopt, &worker_thread_pool, &executor_locks));
+  std::vector<InputData> inputs;
+  inputs.emplace_back(InputText("Hello World!"));
+  absl::Status status;
+  std::vector<std::string> responses;
+  absl::Notification done;
+  // The prefill and the decode run in order on the session's serial executor,
+  // though the worker thread pool runs multiple threads.
+  EXPECT_OK(session->GenerateContentStream(
+      inputs, CreateStreamingTestCallback(status, responses, done)));
+  done.WaitForNotification();
+  EXPECT_OK(status);
+  EXPECT_THAT(responses,
+              testing::ElementsAre(" How", "'", "s", " it", " go", "ing", "?"));
+}
+
+TEST_F(SessionBasicTest, CallbacksRunWithoutTheExecutorLock) {
+  const std::vector<std::vector<int>> stop_token_ids = {{2294}};
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.GetMutableStopTokenIds() = stop_token_ids;
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          // "Hello World!"
+          /*prefill_tokens=*/{{2, 90, 547, 58, 735, 210, 466, 2294}},
+          // "How's it going?"
+          /*decode_tokens=*/{
+              {224}, {24}, {8}, {66}, {246}, {18}, {2295}, {2294}}));
+  ThreadPool worker_thread_pool(/*name_prefix=*/"engine",
+                                /*max_num_threads=*/4);
+  ExecutorLocks executor_locks;
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr,
+                           /*audio_executor=*/nullptr, session_config,
+                           std::nullopt, &worker_thread_pool, &executor_locks));
+  std::vector<InputData> inputs;
+  inputs.emplace_back(InputText("Hello World!"));
+  absl::Status status;
+  std::vector<std::string> responses;
+  absl::Notification done;
+  // Taking the executor lock in the callback would deadlock if the callback
+  // ran with the lock held.
+  EXPECT_OK(session->GenerateContentStream(
+      inputs,
+      [&executor_locks,
+       callback = CreateStreamingTestCallback(status, responses, done)](
+          absl::StatusOr<Responses> result) mutable {
+        absl::MutexLock lock(&executor_locks.llm_executor_mutex);
+        callback(std::move(result));
+      }));
+  done.WaitForNotification();
+  EXPECT_OK(status);
+  EXPECT_THAT(responses,
+              testing::ElementsAre(" How", "'", "s", " it", " go", "ing", "?"));
+}
+
+TEST_F(SessionBasicTest, CreateRequiresLocksOnMultipleWorkerThreads) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.SetStartTokenId(2);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(/*prefill_tokens=*/{{2}},
+                            /*decode_tokens=*/{{224}}));
+  ThreadPool worker_thread_pool(/*name_prefix=*/"engine",
+                                /*max_num_threads=*/4);
+  EXPECT_THAT(SessionBasic::Create(executor.get(), tokenizer_.get(),
+                                   /*vision_executor=*/nullptr,
+                                   /*audio_executor=*/nullptr, session_config,
+                                   std::nullopt, &worker_thread_pool),
+              testing::status::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST_F(SessionBasicTest, RunDecodeWithMultipleOutputCandidates) {
   const std::vector<std::vector<int>> stop_token_ids = {{2294}};
   SessionConfig session_config = SessionConfig::CreateDefault();
@@ -447,6 +713,113 @@ TEST_F(SessionBasicTest, RunPrefillAsync) {
   EXPECT_TRUE(done);
 }
 
+TEST_F(SessionBasicTest, CheckpointAndForkRequireExecutorContexts) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.SetSamplerBackend(Backend::CPU);
+  // The fake executor does not support contexts.
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(/*prefill_tokens=*/{{2, 90, 547, 58, 735}},
+                            /*decode_tokens=*/{{224}}));
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr,
+                           /*audio_executor=*/nullptr, session_config,
+                           std::nullopt, worker_thread_pool_.get()));
+  EXPECT_THAT(session->Checkpoint(),
+              testing::status::StatusIs(absl::StatusCode::kUnimplemented));
+  EXPECT_THAT(session->Fork(),
+              testing::status::StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+TEST_F(SessionBasicTest, RestoreCheckpointDecodesFromTheCheckpointedState) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.GetMutableStopTokenIds() = {{2294}};
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          // "Hello World!"
+          /*prefill_tokens=*/{{2, 90, 547, 58, 735, 210, 466, 2294}},
+          // "How's it going?"
+          /*decode_tokens=*/{
+              {224}, {24}, {8}, {66}, {246}, {18}, {2295}, {2294}}));
+  executor->EnableContexts();
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr,
+                           /*audio_executor=*/nullptr, session_config,
+                           std::nullopt, worker_thread_pool_.get()));
+  std::vector<InputData> inputs;
+  inputs.emplace_back(InputText("Hello World!"));
+  ASSERT_OK(session->RunPrefill(inputs));
+  ASSERT_OK_AND_ASSIGN(auto checkpoint, session->Checkpoint());
+
+  ASSERT_OK_AND_ASSIGN(auto responses, session->RunDecode());
+  EXPECT_EQ(responses.GetTexts()[0], " How's it going?");
+  // The fake executor has no more tokens to decode, unless the state after
+  // the prefill is restored.
+  EXPECT_FALSE(session->RunDecode().ok());
+
+  // A checkpoint can be restored more than once.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK(session->RestoreCheckpoint(*checkpoint));
+    ASSERT_OK_AND_ASSIGN(responses, session->RunDecode());
+    EXPECT_EQ(responses.GetTexts()[0], " How's it going?");
+  }
+
+  // The contexts of the session and the checkpoint are alive. The checkpoint
+  // releases its context through the executor on the worker thread.
+  EXPECT_EQ(executor->num_live_contexts(), 2);
+  checkpoint.reset();
+  EXPECT_EQ(executor->num_live_contexts(), 1);
+  EXPECT_NE(executor->last_release_thread_id(), std::this_thread::get_id());
+  session.reset();
+  EXPECT_EQ(executor->num_live_contexts(), 0);
+}
+
+TEST_F(SessionBasicTest, ForkDecodesFromTheSameState) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.GetMutableStopTokenIds() = {{2294}};
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          // "Hello World!"
+          /*prefill_tokens=*/{{2, 90, 547, 58, 735, 210, 466, 2294}},
+          // "How's it going?"
+          /*decode_tokens=*/{
+              {224}, {24}, {8}, {66}, {246}, {18}, {2295}, {2294}}));
+  executor->EnableContexts();
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr,
+                           /*audio_executor=*/nullptr, session_config,
+                           std::nullopt, worker_thread_pool_.get()));
+  std::vector<InputData> inputs;
+  inputs.emplace_back(InputText("Hello World!"));
+  ASSERT_OK(session->RunPrefill(inputs));
+  ASSERT_OK_AND_ASSIGN(auto forked_session, session->Fork());
+  EXPECT_EQ(executor->num_live_contexts(), 2);
+
+  // Both sessions continue from the state after the prefill, independently.
+  ASSERT_OK_AND_ASSIGN(auto responses, session->RunDecode());
+  EXPECT_EQ(responses.GetTexts()[0], " How's it going?");
+  ASSERT_OK_AND_ASSIGN(auto forked_responses, forked_session->RunDecode());
+  EXPECT_EQ(forked_responses.GetTexts()[0], " How's it going?");
+
+  forked_session.reset();
+  EXPECT_EQ(executor->num_live_contexts(), 1);
+}
+
 TEST_F(SessionBasicTest, RunDecodeAsync) {
   const std::vector<std::vector<int>> stop_token_ids = {{2294}};
   SessionConfig session_config = SessionConfig::CreateDefault();
@@ -1521,6 +1894,59 @@ TEST_F(SessionBasicTest, ProcessAndCombineContentsTextAudioTextSuccess) {
 #endif  // !defined(WIN32) && !defined(_WIN32) && !defined(__WIN32__) && \
         // !defined(__NT__) && !defined(_WIN64)
 
+TEST_F(SessionBasicTest, AppendAudioEncodesTheFramesAsTheyAreReady) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.GetMutableStopTokenIds() = {{2294}};
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(
+      auto executor,
+      CreateFakeLlmExecutor(
+          // The 5 audio tokens and the end of the audio.
+          /*prefill_tokens=*/{{-2, -2, -2, -2, -2, -4}},
+          /*decode_tokens=*/{{224}},
+          /*audio_embedding=*/std::vector<float>(5, 1.0f)));
+  FakeStreamingAudioExecutor audio_executor;
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr, &audio_executor,
+                           session_config, std::nullopt,
+                           worker_thread_pool_.get()));
+
+  // The USM frames are 512 samples long, 160 samples apart, so the first 600
+  // samples make up one frame and the next 552 samples four more.
+  EXPECT_OK(session->AppendAudio(std::vector<float>(600, 0.0f)));
+  EXPECT_OK(session->AppendAudio(std::vector<float>(552, 0.0f)));
+  EXPECT_OK(session->FinishAudio());
+  EXPECT_THAT(audio_executor.num_appended_frames(), testing::ElementsAre(1, 4));
+}
+
+TEST_F(SessionBasicTest, FinishAudioFailsWithoutAudioFrames) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  session_config.GetMutableSamplerParams() = sampler_params_;
+  session_config.GetMutableStopTokenIds() = {{2294}};
+  session_config.SetStartTokenId(2);
+  session_config.SetSamplerBackend(Backend::CPU);
+  ASSERT_OK_AND_ASSIGN(auto executor,
+                       CreateFakeLlmExecutor(/*prefill_tokens=*/{},
+                                             /*decode_tokens=*/{{224}}));
+  FakeStreamingAudioExecutor audio_executor;
+  ASSERT_OK_AND_ASSIGN(
+      auto session,
+      SessionBasic::Create(executor.get(), tokenizer_.get(),
+                           /*vision_executor=*/nullptr, &audio_executor,
+                           session_config, std::nullopt,
+                           worker_thread_pool_.get()));
+
+  // Less than a frame of samples is not encoded.
+  EXPECT_OK(session->AppendAudio(std::vector<float>(100, 0.0f)));
+  EXPECT_THAT(session->FinishAudio(),
+              testing::status::StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(audio_executor.num_appended_frames(), testing::IsEmpty());
+}
+
 TEST_F(SessionBasicTest, GenerateContentStreamWithCancellation) {
   // Configure the executor to have a delay to simulate a long-running task.
   ASSERT_OK_AND_ASSIGN(
@@ -20,6 +20,7 @@
 #include "absl/base/nullability.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "runtime/components/tokenizer.h"
+#include "runtime/core/executor_locks.h"
 #include "runtime/core/session_basic.h"
 #include "runtime/engine/engine.h"
 #include "runtime/engine/engine_settings.h"
@@ -38,10 +39,11 @@ absl::StatusOr<std::unique_ptr<Engine::Session>> InitializeSession(
     VisionExecutor* vision_executor, AudioExecutor* audio_executor,
     const SessionConfig& session_config,
     std::optional<BenchmarkInfo> benchmark_info,
-    ThreadPool* absl_nonnull worker_thread_pool) {
-  auto session =
-      SessionBasic::Create(executor, tokenizer, vision_executor, audio_executor,
-                           session_config, benchmark_info, worker_thread_pool);
+    ThreadPool* absl_nonnull worker_thread_pool,
+    ExecutorLocks* absl_nullable executor_locks) {
+  auto session = SessionBasic::Create(
+      executor, tokenizer, vision_executor, audio_executor, session_config,
+      benchmark_info, worker_thread_pool, executor_locks);
   return session;
 }
 
@@ -21,6 +21,7 @@
 #include "absl/base/nullability.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "runtime/components/tokenizer.h"
+#include "runtime/core/executor_locks.h"
 #include "runtime/engine/engine.h"
 #include "runtime/engine/engine_settings.h"
 #include "runtime/engine/io_types.h"
@@ -37,12 +38,15 @@ namespace litert::lm {
 // image_preprocessor and vision_executor are optional and can be nullptr.
 // If image input is used in the session, the vision_executor must be provided.
 // If audio input is used in the session, the audio_executor must be provided.
+// executor_locks must be provided if the worker_thread_pool runs more than one
+// thread.
 absl::StatusOr<std::unique_ptr<Engine::Session>> InitializeSession(
     LlmExecutor* absl_nonnull executor, Tokenizer* absl_nonnull tokenizer,
     VisionExecutor* vision_executor, AudioExecutor* audio_executor,
     const SessionConfig& session_config,
     std::optional<BenchmarkInfo> benchmark_info,
-    ThreadPool* absl_nonnull worker_thread_pool);
+    ThreadPool* absl_nonnull worker_thread_pool,
+    ExecutorLocks* absl_nullable executor_locks = nullptr);
 
 }  // namespace litert::lm
 
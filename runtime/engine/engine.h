@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_ENGINE_ENGINE_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_ENGINE_ENGINE_H_
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -24,9 +25,11 @@
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
 #include "absl/time/time.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "runtime/components/tokenizer.h"
 #include "runtime/engine/engine_settings.h"
 #include "runtime/engine/io_types.h"
+#include "runtime/executor/executor_settings_base.h"
 
 namespace litert::lm {
 
@@ -70,6 +73,13 @@ class Engine {
   // history) of each separate interaction with LLM.
   class Session {
    public:
+    // An opaque snapshot of the session state, e.g. the processed tokens and
+    // the KV cache, created by Checkpoint().
+    class SessionCheckpoint {
+     public:
+      virtual ~SessionCheckpoint() = default;
+    };
+
     virtual ~Session() = default;
 
     // High-level API to generate content from the input prompt/query. This
@@ -132,6 +142,27 @@ class Engine {
       return absl::UnimplementedError("Not implemented.");
     }
 
+    // Appends the next PCM frames of an audio stream to the prompt, e.g. as
+    // they are captured from a microphone. The frames are mono, at the sample
+    // rate the audio model expects. They are encoded as soon as there are
+    // enough of them, so that little is left to encode when the stream ends.
+    //
+    // This is a not blocking call. The errors of the encoding are returned by
+    // FinishAudio().
+    virtual absl::Status AppendAudio(absl::Span<const float> pcm_frames) {
+      return absl::UnimplementedError("Not implemented.");
+    }
+
+    // Ends the audio stream of AppendAudio() and prefills the encoded audio,
+    // as RunPrefill() does for an InputAudio of the whole stream. The text
+    // around the audio is prefilled with RunPrefill() before and after.
+    //
+    // This is a blocking call and the function will return when the prefill
+    // process is done.
+    virtual absl::Status FinishAudio() {
+      return absl::UnimplementedError("Not implemented.");
+    }
+
     // Starts the decoding process for the model to predict the response based
     // on the input prompt/query added after using RunPrefill* functions.
     // This is a blocking call and the function will return when the decoding
@@ -172,6 +203,27 @@ class Engine {
       ABSL_LOG(FATAL) << "CancelProcess is not implemented.";
     }
 
+    // Captures the current state of the session, so that it can be restored
+    // later with RestoreCheckpoint(), e.g. to retry a turn from a shared
+    // prompt. The checkpoint must not outlive the session.
+    virtual absl::StatusOr<std::unique_ptr<SessionCheckpoint>> Checkpoint() {
+      return absl::UnimplementedError("Not implemented.");
+    }
+
+    // Restores the state of the session captured by Checkpoint(). The
+    // checkpoint stays valid and can be restored again.
+    virtual absl::Status RestoreCheckpoint(
+        const SessionCheckpoint& checkpoint) {
+      return absl::UnimplementedError("Not implemented.");
+    }
+
+    // Creates a new session starting from the current state of this session.
+    // The two sessions evolve independently afterwards, e.g. to explore
+    // several continuations of the same prompt without prefilling it again.
+    virtual absl::StatusOr<std::unique_ptr<Session>> Fork() {
+      return absl::UnimplementedError("Not implemented.");
+    }
+
     // Get the reference to the session config for the session.
     virtual const SessionConfig& GetSessionConfig() const = 0;
 
@@ -188,6 +240,15 @@ class Engine {
   virtual absl::StatusOr<std::unique_ptr<Session>> CreateSession(
       const SessionConfig& session_config) const = 0;
 
+  // Registers the LoRA model in `model_assets` under `lora_id`, so that the
+  // sessions can apply it with SessionConfig::SetLoRAId(). The LoRA model is
+  // loaded when a session first uses it. All the LoRA models share the base
+  // model of the engine.
+  virtual absl::Status LoadLoRA(uint32_t lora_id,
+                                const ModelAssets& model_assets) {
+    return absl::UnimplementedError("Not implemented.");
+  }
+
   // Waits until the engine is done with all the tasks. The function will
   // return error if the timeout is reached.
   virtual absl::Status WaitUntilDone(absl::Duration timeout) {
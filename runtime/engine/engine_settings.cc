@@ -231,6 +231,20 @@ absl::Status EngineSettings::MaybeUpdateAndValidate(
     ASSIGN_OR_RETURN(*metadata.mutable_llm_model_type(),
                      InferLlmModelType(metadata, tokenizer));
   }
+  // Gemma3 and Gemma3N rotate the keys of their local and global attention
+  // layers with different bases, so context shifting needs the base of each
+  // layer to move the kept keys.
+  const auto& main_advanced_settings =
+      main_executor_settings_.GetAdvancedSettings();
+  if (main_advanced_settings &&
+      main_advanced_settings->enable_context_shifting &&
+      main_advanced_settings->context_shift_layer_rope_thetas.empty() &&
+      (metadata.llm_model_type().has_gemma3() ||
+       metadata.llm_model_type().has_gemma3n())) {
+    return absl::InvalidArgumentError(
+        "Context shifting on Gemma3 models requires the rotary position "
+        "embedding base of each layer in context_shift_layer_rope_thetas.");
+  }
   if (!metadata.has_jinja_prompt_template()) {
     ASSIGN_OR_RETURN(*metadata.mutable_jinja_prompt_template(),
                      GetDefaultJinjaPromptTemplate(metadata.prompt_templates(),
@@ -530,6 +544,9 @@ std::ostream& operator<<(std::ostream& os, const SessionConfig& config) {
   }
   os << "  NumOutputCandidates: " << config.GetNumOutputCandidates()
      << std::endl;
+  if (config.GetLoRAId().has_value()) {
+    os << "  LoRAId: " << *config.GetLoRAId() << std::endl;
+  }
   os << "  LlmModelType: " << config.GetLlmModelType().DebugString()
      << std::endl;
   os << "  JinjaPromptTemplate: " << config.GetJinjaPromptTemplate()
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_ENGINE_ENGINE_SETTINGS_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_ENGINE_ENGINE_SETTINGS_H_
 
+#include <cstdint>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -183,6 +184,12 @@ class SessionConfig {
   Backend GetSamplerBackend() const;
   void SetSamplerBackend(Backend sampler_backend);
 
+  // LoRA id:
+  // Getters for the id of the LoRA applied to the model in the session, as
+  // registered by Engine::LoadLoRA(). If not set, no LoRA is applied.
+  const std::optional<uint32_t>& GetLoRAId() const { return lora_id_; }
+  void SetLoRAId(std::optional<uint32_t> lora_id) { lora_id_ = lora_id; }
+
   // Prompt templates:
   // Getters for the prompt templates.
 
@@ -246,6 +253,9 @@ class SessionConfig {
   // Backend to use for sampling.
   Backend sampler_backend_ = Backend::UNSPECIFIED;
 
+  // The id of the LoRA applied in the session, if any.
+  std::optional<uint32_t> lora_id_;
+
   // Whether to apply the deprecated prompt templates in the session.
   // TODO - b/453312248: Remove this field once the prompt templates are
   // removed.
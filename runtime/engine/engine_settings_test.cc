@@ -27,6 +27,7 @@
 #include "absl/types/optional.h"  // from @com_google_absl
 #include "runtime/components/tokenizer.h"
 #include "runtime/executor/executor_settings_base.h"
+#include "runtime/executor/llm_executor_settings.h"
 #include "runtime/proto/engine.pb.h"
 #include "runtime/proto/llm_metadata.pb.h"
 #include "runtime/proto/llm_model_type.pb.h"
@@ -611,6 +612,36 @@ TEST(EngineSettingsTest, MaybeUpdateAndValidateNPU) {
             proto::SamplerParameters::TOP_P);
 }
 
+TEST(EngineSettingsTest, MaybeUpdateAndValidateContextShiftingOnGemma3) {
+  auto model_assets = ModelAssets::Create("test_model_path_1");
+  ASSERT_OK(model_assets);
+  auto settings = EngineSettings::CreateDefault(*model_assets);
+  EXPECT_OK(settings);
+  settings->GetMutableMainExecutorSettings().SetAdvancedSettings(
+      AdvancedSettings{.enable_context_shifting = true});
+
+  MockTokenizer tokenizer;
+  EXPECT_CALL(tokenizer, TokenIdsToText).WillRepeatedly(Return("fake_text"));
+  EXPECT_CALL(tokenizer, TokenToId).WillRepeatedly(Return(1));
+  EXPECT_CALL(tokenizer, TextToTokenIds)
+      .WillRepeatedly(Return(std::vector<int>{1}));
+  proto::LlmMetadata gemma3_metadata = CreateLlmMetadata();
+  gemma3_metadata.mutable_llm_model_type()->mutable_gemma3();
+
+  // The local and global layers of Gemma3 use different bases.
+  proto::LlmMetadata llm_metadata = gemma3_metadata;
+  EXPECT_THAT(settings->MaybeUpdateAndValidate(tokenizer, &llm_metadata),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  settings->GetMutableMainExecutorSettings().SetAdvancedSettings(
+      AdvancedSettings{
+          .enable_context_shifting = true,
+          .context_shift_layer_rope_thetas = {10000.0f, 1000000.0f},
+      });
+  llm_metadata = gemma3_metadata;
+  EXPECT_OK(settings->MaybeUpdateAndValidate(tokenizer, &llm_metadata));
+}
+
 TEST(EngineSettingsTest, PrintOperator) {
   auto model_assets = ModelAssets::Create("test_model_path_1");
   ASSERT_OK(model_assets);
@@ -969,6 +1000,15 @@ TEST(SessionConfigTest, SetAndGetSamplerBackend) {
   EXPECT_EQ(session_config.GetSamplerBackend(), Backend::GPU);
 }
 
+TEST(SessionConfigTest, SetAndGetLoRAId) {
+  SessionConfig session_config = SessionConfig::CreateDefault();
+  EXPECT_EQ(session_config.GetLoRAId(), std::nullopt);
+  session_config.SetLoRAId(3);
+  EXPECT_EQ(session_config.GetLoRAId(), 3);
+  session_config.SetLoRAId(std::nullopt);
+  EXPECT_EQ(session_config.GetLoRAId(), std::nullopt);
+}
+
 TEST(SessionConfigTest,
      MaybeUpdateAndValidatePromptTemplates_NoSessionTemplate) {
   auto model_assets = ModelAssets::Create("test_model_path_1");
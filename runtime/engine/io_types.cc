@@ -200,6 +200,40 @@ absl::Status BenchmarkInfo::TimeMarkDelta(const std::string& mark_name) {
   return absl::OkStatus();
 }
 
+void BenchmarkInfo::RecordPrefixCacheLookup(bool hit,
+                                            uint64_t num_reused_tokens) {
+  if (hit) {
+    ++prefix_cache_hits_;
+    prefix_cache_reused_tokens_ += num_reused_tokens;
+  } else {
+    ++prefix_cache_misses_;
+  }
+}
+
+void BenchmarkInfo::RecordSpeculativeDecoding(uint64_t num_verify_steps,
+                                              uint64_t num_draft_tokens,
+                                              uint64_t num_accepted_tokens) {
+  speculative_verify_steps_ += num_verify_steps;
+  speculative_draft_tokens_ += num_draft_tokens;
+  speculative_accepted_tokens_ += num_accepted_tokens;
+}
+
+double BenchmarkInfo::GetSpeculativeAcceptanceRate() const {
+  if (speculative_draft_tokens_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(speculative_accepted_tokens_) /
+         speculative_draft_tokens_;
+}
+
+double BenchmarkInfo::GetSpeculativeAcceptedTokensPerStep() const {
+  if (speculative_verify_steps_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(speculative_accepted_tokens_) /
+         speculative_verify_steps_;
+}
+
 const std::map<std::string, absl::Duration>& BenchmarkInfo::GetMarkDurations()
     const {
   return mark_durations_;
@@ -378,6 +412,23 @@ std::ostream& operator<<(std::ostream& os, const BenchmarkInfo& info) {
   }
   os << "--------------------------------------------------" << std::endl;
 
+  if (info.GetPrefixCacheHits() + info.GetPrefixCacheMisses() > 0) {
+    os << "  Prefix Cache: " << info.GetPrefixCacheHits() << " hits, "
+       << info.GetPrefixCacheMisses() << " misses, "
+       << info.GetPrefixCacheReusedTokens() << " reused tokens." << std::endl;
+    os << "--------------------------------------------------" << std::endl;
+  }
+
+  if (info.GetSpeculativeDraftTokens() > 0) {
+    os << "  Speculative Decoding: " << info.GetSpeculativeAcceptedTokens()
+       << " of " << info.GetSpeculativeDraftTokens()
+       << " draft tokens accepted (" << info.GetSpeculativeAcceptanceRate()
+       << " acceptance rate, " << info.GetSpeculativeAcceptedTokensPerStep()
+       << " accepted tokens per step over "
+       << info.GetSpeculativeVerifySteps() << " steps)." << std::endl;
+    os << "--------------------------------------------------" << std::endl;
+  }
+
   if (!info.GetMarkDurations().empty()) {
     os << "  Mark Durations (" << info.GetMarkDurations().size() << "):"
        << std::endl;
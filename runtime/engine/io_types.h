@@ -30,6 +30,7 @@
 #include "absl/time/time.h"  // from @com_google_absl
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/constrained_decoding/constraint.h"
+#include "runtime/executor/speculative_decoding_util.h"
 #include "runtime/proto/engine.pb.h"
 
 namespace litert::lm {
@@ -251,6 +252,16 @@ class BenchmarkInfo {
   // TimeMarkDelta("sampling") calls. The duration will be stored / recorded for
   // each unique mark name.
   absl::Status TimeMarkDelta(const std::string& mark_name);
+  // Records the outcome of a prefix KV cache lookup of a prefill turn. The
+  // num_reused_tokens is the number of prompt tokens whose KV cache was
+  // restored from the prefix cache instead of being prefilled.
+  void RecordPrefixCacheLookup(bool hit, uint64_t num_reused_tokens);
+  // Records the outcome of the speculative decoding steps of a decode turn,
+  // i.e. the number of verification passes of the main model, the number of
+  // draft tokens they verified and the number of them accepted.
+  void RecordSpeculativeDecoding(uint64_t num_verify_steps,
+                                 uint64_t num_draft_tokens,
+                                 uint64_t num_accepted_tokens);
 
   // --- Getters for raw data ---
   const std::map<std::string, absl::Duration>& GetInitPhases() const;
@@ -266,6 +277,29 @@ class BenchmarkInfo {
   const BenchmarkTurnData& GetDecodeTurn(int turn_index) const;
   double GetDecodeTokensPerSec(int turn_index) const;
 
+  // --- Getters for the prefix KV cache ---
+  uint64_t GetPrefixCacheHits() const { return prefix_cache_hits_; }
+  uint64_t GetPrefixCacheMisses() const { return prefix_cache_misses_; }
+  uint64_t GetPrefixCacheReusedTokens() const {
+    return prefix_cache_reused_tokens_;
+  }
+
+  // --- Getters for speculative decoding ---
+  uint64_t GetSpeculativeVerifySteps() const {
+    return speculative_verify_steps_;
+  }
+  uint64_t GetSpeculativeDraftTokens() const {
+    return speculative_draft_tokens_;
+  }
+  uint64_t GetSpeculativeAcceptedTokens() const {
+    return speculative_accepted_tokens_;
+  }
+  // Returns the fraction of the draft tokens accepted, or 0 if none.
+  double GetSpeculativeAcceptanceRate() const;
+  // Returns the average number of draft tokens accepted per verification
+  // pass, or 0 if none. Each pass also produces one token of its own.
+  double GetSpeculativeAcceptedTokensPerStep() const;
+
   // --- Gets the time to the first token ---
   // Note that the first time to token doesn't include the time for
   // initialization. It is the sum of the prefill time for the first turn and
@@ -286,6 +320,14 @@ class BenchmarkInfo {
   std::map<std::string, absl::Duration> mark_durations_;
   std::vector<BenchmarkTurnData> prefill_turns_;
   std::vector<BenchmarkTurnData> decode_turns_;
+
+  uint64_t prefix_cache_hits_ = 0;
+  uint64_t prefix_cache_misses_ = 0;
+  uint64_t prefix_cache_reused_tokens_ = 0;
+
+  uint64_t speculative_verify_steps_ = 0;
+  uint64_t speculative_draft_tokens_ = 0;
+  uint64_t speculative_accepted_tokens_ = 0;
 };
 std::ostream& operator<<(std::ostream& os, const BenchmarkInfo& info);
 
@@ -305,10 +347,22 @@ class DecodeConfig {
   // Returns a pointer to the constraint, or nullptr if no constraint is set.
   Constraint* absl_nullable GetConstraint() const { return constraint_; }
 
+  // Sets the source of the draft tokens if the model decodes speculatively,
+  // e.g. prompt lookup for outputs which copy long spans of the prompt.
+  void SetSpeculativeDecodingMode(SpeculativeDecodingMode mode) {
+    speculative_decoding_mode_ = mode;
+  }
+
+  SpeculativeDecodingMode GetSpeculativeDecodingMode() const {
+    return speculative_decoding_mode_;
+  }
+
  private:
   DecodeConfig() = default;
 
   Constraint* absl_nullable constraint_ = nullptr;
+  SpeculativeDecodingMode speculative_decoding_mode_ =
+      SpeculativeDecodingMode::kDraftModel;
 };
 
 }  // namespace litert::lm
@@ -43,6 +43,7 @@ namespace {
 using ::testing::ContainsRegex;
 using ::testing::ElementsAre;
 using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
 using ::testing::status::IsOkAndHolds;
 using ::testing::status::StatusIs;
 
@@ -625,6 +626,48 @@ TEST(BenchmarkInfoTests, AddTwoMarks) {
             absl::Milliseconds(100));
 }
 
+TEST(BenchmarkInfoTests, RecordPrefixCacheLookups) {
+  BenchmarkInfo benchmark_info(GetBenchmarkParams());
+  benchmark_info.RecordPrefixCacheLookup(/*hit=*/false,
+                                         /*num_reused_tokens=*/0);
+  benchmark_info.RecordPrefixCacheLookup(/*hit=*/true,
+                                         /*num_reused_tokens=*/100);
+  benchmark_info.RecordPrefixCacheLookup(/*hit=*/true,
+                                         /*num_reused_tokens=*/20);
+  EXPECT_EQ(benchmark_info.GetPrefixCacheHits(), 2);
+  EXPECT_EQ(benchmark_info.GetPrefixCacheMisses(), 1);
+  EXPECT_EQ(benchmark_info.GetPrefixCacheReusedTokens(), 120);
+
+  std::stringstream oss;
+  oss << benchmark_info;
+  EXPECT_THAT(oss.str(),
+              HasSubstr("Prefix Cache: 2 hits, 1 misses, 120 reused tokens."));
+}
+
+TEST(BenchmarkInfoTests, RecordSpeculativeDecoding) {
+  BenchmarkInfo benchmark_info(GetBenchmarkParams());
+  EXPECT_EQ(benchmark_info.GetSpeculativeAcceptanceRate(), 0.0);
+  EXPECT_EQ(benchmark_info.GetSpeculativeAcceptedTokensPerStep(), 0.0);
+  benchmark_info.RecordSpeculativeDecoding(/*num_verify_steps=*/3,
+                                           /*num_draft_tokens=*/12,
+                                           /*num_accepted_tokens=*/6);
+  benchmark_info.RecordSpeculativeDecoding(/*num_verify_steps=*/1,
+                                           /*num_draft_tokens=*/4,
+                                           /*num_accepted_tokens=*/2);
+  EXPECT_EQ(benchmark_info.GetSpeculativeVerifySteps(), 4);
+  EXPECT_EQ(benchmark_info.GetSpeculativeDraftTokens(), 16);
+  EXPECT_EQ(benchmark_info.GetSpeculativeAcceptedTokens(), 8);
+  EXPECT_DOUBLE_EQ(benchmark_info.GetSpeculativeAcceptanceRate(), 0.5);
+  EXPECT_DOUBLE_EQ(benchmark_info.GetSpeculativeAcceptedTokensPerStep(), 2.0);
+
+  std::stringstream oss;
+  oss << benchmark_info;
+  EXPECT_THAT(oss.str(),
+              HasSubstr("Speculative Decoding: 8 of 16 draft tokens accepted "
+                        "(0.5 acceptance rate, 2 accepted tokens per step "
+                        "over 4 steps)."));
+}
+
 TEST(BenchmarkInfoTests, GetTimeToFirstTokenInvalid) {
   BenchmarkInfo benchmark_info(GetBenchmarkParams());
   EXPECT_OK(benchmark_info.TimePrefillTurnStart());
@@ -689,6 +732,8 @@ TEST(BenchmarkInfoTests, OperatorOutputWithData) {
 TEST(DecodeConfigTest, CreateDefault) {
   DecodeConfig decode_config = DecodeConfig::CreateDefault();
   EXPECT_EQ(decode_config.GetConstraint(), nullptr);
+  EXPECT_EQ(decode_config.GetSpeculativeDecodingMode(),
+            SpeculativeDecodingMode::kDraftModel);
 }
 
 TEST(DecodeConfigTest, SetAndGetConstraint) {
@@ -698,5 +743,13 @@ TEST(DecodeConfigTest, SetAndGetConstraint) {
   EXPECT_EQ(decode_config.GetConstraint(), &constraint);
 }
 
+TEST(DecodeConfigTest, SetAndGetSpeculativeDecodingMode) {
+  DecodeConfig decode_config = DecodeConfig::CreateDefault();
+  decode_config.SetSpeculativeDecodingMode(
+      SpeculativeDecodingMode::kPromptLookup);
+  EXPECT_EQ(decode_config.GetSpeculativeDecodingMode(),
+            SpeculativeDecodingMode::kPromptLookup);
+}
+
 }  // namespace
 }  // namespace litert::lm
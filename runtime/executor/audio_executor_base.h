@@ -15,7 +15,9 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_AUDIO_EXECUTOR_BASE_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_AUDIO_EXECUTOR_BASE_H_
 
+#include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/executor/llm_executor_io_types.h"
 
@@ -32,6 +34,32 @@ class AudioExecutorBase {
   // shape `[batch, 1, num_audio_tokens, model_dimension]`.
   virtual absl::StatusOr<::litert::lm::ExecutorAudioData> Encode(
       const litert::TensorBuffer& spectrogram_tensor) = 0;
+
+  // ------------Streaming Encode APIs------------:
+  // Appends spectrogram frames of an audio stream, with `num_channels` values
+  // per frame, and opens the stream if it is not open yet. The executor may
+  // encode the frames before the stream is finished, so that encoding overlaps
+  // with the audio capture. Encode() is rejected while a stream is open.
+  virtual absl::Status AppendSpectrogramFrames(
+      absl::Span<const float> spectrogram_frames) {
+    return absl::UnimplementedError(
+        "Streaming encoding is not supported by this audio executor.");
+  }
+
+  // Encodes the remaining frames of the open audio stream and closes it.
+  // Returns the audio data of all the frames appended to the stream.
+  virtual absl::StatusOr<::litert::lm::ExecutorAudioData>
+  FinishStreamingEncode() {
+    return absl::UnimplementedError(
+        "Streaming encoding is not supported by this audio executor.");
+  }
+
+  // Discards the open audio stream, if any, e.g. after an error or when the
+  // audio capture is cancelled.
+  virtual absl::Status ResetStreamingEncode() {
+    return absl::UnimplementedError(
+        "Streaming encoding is not supported by this audio executor.");
+  }
 };
 
 }  // namespace litert::lm
@@ -606,6 +606,11 @@ absl::StatusOr<int> AudioLiteRtCompiledModelExecutor::EncodeInternal(
 absl::StatusOr<ExecutorAudioData> AudioLiteRtCompiledModelExecutor::Encode(
     const TensorBuffer& spectrogram_tensor,
     const TensorBuffer& spectrogram_mask) {
+  if (is_stream_open_) {
+    return absl::FailedPreconditionError(
+        "Cannot encode while an audio stream is open. Finish or reset the "
+        "stream first.");
+  }
   ASSIGN_OR_RETURN(int input_sequence_length, GetValidCount(spectrogram_mask));
   LITERT_ASSIGN_OR_RETURN(
       auto spectrogram_host_buffer,
@@ -641,24 +646,111 @@ absl::StatusOr<ExecutorAudioData> AudioLiteRtCompiledModelExecutor::Encode(
     pos = end;
   }
 
+  return CreateAudioData(absl::MakeSpan(audio_embeddings), total_valid_tokens);
+}
+
+absl::StatusOr<ExecutorAudioData>
+AudioLiteRtCompiledModelExecutor::CreateAudioData(
+    absl::Span<float> audio_embeddings, int num_valid_tokens) {
   // Create the final audio embeddings tensor.
   RankedTensorType audio_embeddings_tensor_type(
       GetElementType<float>(),
-      Layout(Dimensions({1, total_valid_tokens, audio_embedding_dimensions_})));
+      Layout(Dimensions({1, num_valid_tokens, audio_embedding_dimensions_})));
   LITERT_ASSIGN_OR_RETURN(
       auto audio_embeddings_tensor,
       TensorBuffer::CreateManaged(env_, TensorBufferType::kHostMemory,
                                   audio_embeddings_tensor_type,
                                   audio_embeddings.size() * sizeof(float)));
   LITERT_RETURN_IF_ERROR(audio_embeddings_tensor.Write<float>(
-      absl::MakeSpan(audio_embeddings)
-          .subspan(0, total_valid_tokens * audio_embedding_dimensions_)));
+      audio_embeddings.first(num_valid_tokens * audio_embedding_dimensions_)));
   ExecutorAudioData audio_data;
   audio_data.SetEmbeddings(std::move(audio_embeddings_tensor));
-  audio_data.SetValidTokens(total_valid_tokens);
+  audio_data.SetValidTokens(num_valid_tokens);
+  return audio_data;
+}
+
+absl::Status AudioLiteRtCompiledModelExecutor::EncodeStreamingChunk(
+    int num_frames) {
+  std::vector<uint8_t> spectrogram_mask(num_frames, 1);
+  const int num_embeddings =
+      streamed_valid_tokens_ * audio_embedding_dimensions_;
+  streamed_audio_embeddings_.resize(
+      num_embeddings + CeilIntDiv(num_frames, encoder_shrinking_factor_) *
+                           audio_embedding_dimensions_);
+  ASSIGN_OR_RETURN(
+      int chunk_valid_tokens,
+      EncodeInternal(absl::MakeSpan(pending_spectrogram_frames_)
+                         .subspan(0, num_frames *
+                                         spectrogram_feature_dimensions_),
+                     absl::MakeSpan(spectrogram_mask),
+                     absl::MakeSpan(streamed_audio_embeddings_)
+                         .subspan(num_embeddings)));
+  streamed_valid_tokens_ += chunk_valid_tokens;
+  streamed_audio_embeddings_.resize(streamed_valid_tokens_ *
+                                    audio_embedding_dimensions_);
+  pending_spectrogram_frames_.erase(
+      pending_spectrogram_frames_.begin(),
+      pending_spectrogram_frames_.begin() +
+          num_frames * spectrogram_feature_dimensions_);
+  return absl::OkStatus();
+}
+
+absl::Status AudioLiteRtCompiledModelExecutor::AppendSpectrogramFrames(
+    absl::Span<const float> spectrogram_frames) {
+  if (spectrogram_frames.size() % spectrogram_feature_dimensions_ != 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "The spectrogram frames size must be divisible by the number of "
+        "frequency bins ",
+        spectrogram_feature_dimensions_, ", but got ",
+        spectrogram_frames.size()));
+  }
+  if (!is_stream_open_ && is_streaming_) {
+    // The stream starts from a fresh streaming encoder state.
+    RETURN_IF_ERROR(audio_encoder_->Reset());
+  }
+  is_stream_open_ = true;
+  pending_spectrogram_frames_.insert(pending_spectrogram_frames_.end(),
+                                     spectrogram_frames.begin(),
+                                     spectrogram_frames.end());
+  while (pending_spectrogram_frames_.size() >=
+         sequence_length_ * spectrogram_feature_dimensions_) {
+    RETURN_IF_ERROR(EncodeStreamingChunk(sequence_length_));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<ExecutorAudioData>
+AudioLiteRtCompiledModelExecutor::FinishStreamingEncode() {
+  if (!is_stream_open_) {
+    return absl::FailedPreconditionError(
+        "No spectrogram frames were appended to encode.");
+  }
+  const int num_remaining_frames =
+      pending_spectrogram_frames_.size() / spectrogram_feature_dimensions_;
+  if (num_remaining_frames > 0) {
+    RETURN_IF_ERROR(EncodeStreamingChunk(num_remaining_frames));
+  }
+  if (streamed_valid_tokens_ == 0) {
+    return absl::FailedPreconditionError(
+        "No spectrogram frames were appended to encode.");
+  }
+  ASSIGN_OR_RETURN(ExecutorAudioData audio_data,
+                   CreateAudioData(absl::MakeSpan(streamed_audio_embeddings_),
+                                   streamed_valid_tokens_));
+  streamed_audio_embeddings_.clear();
+  streamed_valid_tokens_ = 0;
+  is_stream_open_ = false;
   return audio_data;
 }
 
+absl::Status AudioLiteRtCompiledModelExecutor::ResetStreamingEncode() {
+  pending_spectrogram_frames_.clear();
+  streamed_audio_embeddings_.clear();
+  streamed_valid_tokens_ = 0;
+  is_stream_open_ = false;
+  return audio_encoder_->Reset();
+}
+
 absl::StatusOr<ExecutorAudioData> AudioLiteRtCompiledModelExecutor::Encode(
     const TensorBuffer& spectrogram_tensor) {
   LITERT_ASSIGN_OR_RETURN(auto tensor_type, spectrogram_tensor.TensorType());
@@ -84,6 +84,25 @@ class AudioLiteRtCompiledModelExecutor : public AudioExecutor {
       const TensorBuffer& spectrogram_tensor,
       const TensorBuffer& spectrogram_mask);
 
+  // Appends the spectrogram frames of an audio stream, e.g. as they are
+  // produced by AudioPreprocessorMiniAudio::PushPcmFrames(). The frames are
+  // encoded as soon as a whole chunk of the encoder sequence length is
+  // buffered, so that encoding overlaps with the audio capture.
+  // Args:
+  //   - spectrogram_frames: The spectrogram frames to append, with
+  //     `frequency_bins` values per frame.
+  absl::Status AppendSpectrogramFrames(
+      absl::Span<const float> spectrogram_frames) override;
+
+  // Encodes the remaining buffered spectrogram frames of the audio stream,
+  // and returns the audio embeddings of all the frames appended since the
+  // stream was opened.
+  absl::StatusOr<ExecutorAudioData> FinishStreamingEncode() override;
+
+  // Discards the buffered frames and embeddings of the audio stream and the
+  // state of the streaming encoder.
+  absl::Status ResetStreamingEncode() override;
+
  private:
   // The Audio Encoder LiteRT CompiledModel wrapper manage the input and
   // output buffers of the audio encoder model. It is not expected to be used
@@ -385,6 +404,15 @@ class AudioLiteRtCompiledModelExecutor : public AudioExecutor {
   absl::StatusOr<int> EncodeInternal(absl::Span<float> spectrogram_tensor,
                                      absl::Span<uint8_t> spectrogram_mask,
                                      absl::Span<float> audio_embeddings);
+
+  // Encodes the given number of buffered spectrogram frames of the audio
+  // stream, and appends their audio embeddings to the streamed ones.
+  absl::Status EncodeStreamingChunk(int num_frames);
+
+  // Creates the audio data from the audio embeddings of the valid tokens.
+  absl::StatusOr<ExecutorAudioData> CreateAudioData(
+      absl::Span<float> audio_embeddings, int num_valid_tokens);
+
   int sequence_length_;
   int spectrogram_feature_dimensions_;
   int audio_embedding_dimensions_;
@@ -396,6 +424,14 @@ class AudioLiteRtCompiledModelExecutor : public AudioExecutor {
   std::unique_ptr<ModelResources> resources_;
   std::unique_ptr<AudioEncoder> audio_encoder_;
   std::unique_ptr<AudioAdapter> audio_adapter_;
+  // The spectrogram frames of the audio stream which are not encoded yet.
+  std::vector<float> pending_spectrogram_frames_;
+  // The audio embeddings of the audio stream encoded so far.
+  std::vector<float> streamed_audio_embeddings_;
+  int streamed_valid_tokens_ = 0;
+  // Whether an audio stream is open, i.e. frames were appended since the last
+  // FinishStreamingEncode() or ResetStreamingEncode().
+  bool is_stream_open_ = false;
 };
 
 }  // namespace litert::lm
@@ -23,6 +23,7 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
 #include "absl/types/span.h"  // from @com_google_absl
@@ -33,6 +34,7 @@
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer_types.h"  // from @litert
+#include "runtime/executor/audio_executor.h"
 #include "runtime/executor/audio_executor_settings.h"
 #include "runtime/executor/executor_settings_base.h"
 #include "runtime/util/scoped_file.h"
@@ -50,6 +52,7 @@ constexpr int kEmbeddingSequenceLength = 5;
 constexpr int kEmbeddingDimensions = 6;
 
 using ::testing::ElementsAre;
+using ::testing::status::StatusIs;
 
 template <typename T>
 absl::StatusOr<std::vector<T>> GetDataAsVector(
@@ -155,6 +158,98 @@ TEST_F(AudioLiteRtCompiledModelExecutorTest,
   EXPECT_EQ(executor_audio_data.GetValidTokens(), kEmbeddingSequenceLength);
 }
 
+TEST_F(AudioLiteRtCompiledModelExecutorTest, StreamingEncodeTest) {
+  ASSERT_OK_AND_ASSIGN(
+      auto audio_executor,
+      CreateAudioExecutor(*env_,
+                          (std::filesystem::path(::testing::SrcDir()) /
+                           std::string(kTestAudioModelPath))
+                              .string(),
+                          /*max_sequence_length=*/0, Backend::CPU));
+
+  constexpr std::array<float,
+                       kSpectrogramSequenceLength * kSpectrogramFrequencySlots>
+      mel_spectrogram_data = {
+          0., 0., 0., 0., 0., 0., 1., 0., 1., 1., 1., 1., 0., 0., 0., 0.,
+          0., 1., 0., 0., 1., 1., 1., 1., 0., 1., 0., 0., 0., 0., 0., 0.,
+          0., 1., 0., 1., 0., 0., 1., 1., 1., 1., 1., 0., 0., 1., 1., 0.,
+          1., 0., 0., 1., 0., 1., 0., 1., 1., 0., 0., 1., 0., 1., 0., 0.,
+          0., 1., 0., 1., 1., 0., 1., 0., 0., 0., 1., 0., 1., 1., 1., 1.};
+
+  // Append the frames in two pieces, as if they were streamed.
+  constexpr int kFirstFrames = 3;
+  auto mel_spectrogram = absl::MakeConstSpan(mel_spectrogram_data);
+  ASSERT_OK(audio_executor->AppendSpectrogramFrames(
+      mel_spectrogram.first(kFirstFrames * kSpectrogramFrequencySlots)));
+  ASSERT_OK(audio_executor->AppendSpectrogramFrames(
+      mel_spectrogram.subspan(kFirstFrames * kSpectrogramFrequencySlots)));
+  ASSERT_OK_AND_ASSIGN(auto executor_audio_data,
+                       audio_executor->FinishStreamingEncode());
+  ASSERT_OK_AND_ASSIGN(auto audio_embeddings_ptr,
+                       executor_audio_data.GetMutableEmbeddingsPtr());
+  ASSERT_OK_AND_ASSIGN(auto audio_embeddings_data,
+                       GetDataAsVector<float>(*audio_embeddings_ptr));
+  EXPECT_THAT(
+      audio_embeddings_data,
+      ElementsAre(0., 0., 0., 0., 0., 0., 0., 1., 2., 3., 3., 3., 0., 1., 2.,
+                  4., 4., 4., 1., 2., 3., 5., 5., 5., 0., 1., 2., 4., 4., 4.));
+  EXPECT_EQ(executor_audio_data.GetValidTokens(), kEmbeddingSequenceLength);
+
+  // Nothing is left to encode after the stream is finished.
+  EXPECT_THAT(audio_executor->FinishStreamingEncode(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST_F(AudioLiteRtCompiledModelExecutorTest,
+       StreamingEncodeTest_RejectsEncodeWhileStreamIsOpen) {
+  ASSERT_OK_AND_ASSIGN(
+      auto audio_executor,
+      CreateAudioExecutor(*env_,
+                          (std::filesystem::path(::testing::SrcDir()) /
+                           std::string(kTestAudioModelPath))
+                              .string(),
+                          /*max_sequence_length=*/0, Backend::CPU));
+  // The streaming APIs are part of the AudioExecutor interface.
+  AudioExecutor& executor = *audio_executor;
+
+  constexpr std::array<float,
+                       kSpectrogramSequenceLength * kSpectrogramFrequencySlots>
+      mel_spectrogram_data = {
+          0., 0., 0., 0., 0., 0., 1., 0., 1., 1., 1., 1., 0., 0., 0., 0.,
+          0., 1., 0., 0., 1., 1., 1., 1., 0., 1., 0., 0., 0., 0., 0., 0.,
+          0., 1., 0., 1., 0., 0., 1., 1., 1., 1., 1., 0., 0., 1., 1., 0.,
+          1., 0., 0., 1., 0., 1., 0., 1., 1., 0., 0., 1., 0., 1., 0., 0.,
+          0., 1., 0., 1., 1., 0., 1., 0., 0., 0., 1., 0., 1., 1., 1., 1.};
+  ASSERT_OK_AND_ASSIGN(
+      auto mel_spectrogram_tensor_buffer,
+      CreateTensorBuffer<const float>(
+          mel_spectrogram_data,
+          RankedTensorType(GetElementType<float>(),
+                           Layout(Dimensions({1, kSpectrogramSequenceLength,
+                                              kSpectrogramFrequencySlots})))));
+
+  ASSERT_OK(executor.AppendSpectrogramFrames(
+      absl::MakeConstSpan(mel_spectrogram_data)
+          .first(2 * kSpectrogramFrequencySlots)));
+  EXPECT_THAT(executor.Encode(mel_spectrogram_tensor_buffer),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+
+  // Resetting discards the stream, after which Encode() works again.
+  ASSERT_OK(executor.ResetStreamingEncode());
+  EXPECT_THAT(executor.FinishStreamingEncode(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  ASSERT_OK_AND_ASSIGN(auto executor_audio_data,
+                       executor.Encode(mel_spectrogram_tensor_buffer));
+  ASSERT_OK_AND_ASSIGN(auto audio_embeddings_ptr,
+                       executor_audio_data.GetMutableEmbeddingsPtr());
+  ASSERT_OK_AND_ASSIGN(auto audio_embeddings_data,
+                       GetDataAsVector<float>(*audio_embeddings_ptr));
+  EXPECT_THAT(
+      audio_embeddings_data,
+      ElementsAre(0., 0., 0., 0., 0., 0., 0., 1., 2., 3., 3., 3., 0., 1., 2.,
+                  4., 4., 4., 1., 2., 3., 5., 5., 5., 0., 1., 2., 4., 4., 4.));
+}
+
 TEST_F(AudioLiteRtCompiledModelExecutorTest,
        EncodeTest_WithMaskFitSequenceLength) {
   ASSERT_OK_AND_ASSIGN(
@@ -0,0 +1,95 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/executor/encoded_image_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "absl/hash/hash.h"  // from @com_google_absl
+#include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+namespace {
+
+absl::string_view AsBytes(absl::Span<const float> values) {
+  return absl::string_view(reinterpret_cast<const char*>(values.data()),
+                           values.size() * sizeof(float));
+}
+
+}  // namespace
+
+EncodedImageCache::EncodedImageCache(size_t max_bytes)
+    : max_bytes_(max_bytes) {}
+
+// static
+uint64_t EncodedImageCache::Key(absl::Span<const float> image,
+                                absl::Span<const int> dimensions) {
+  return absl::HashOf(dimensions, AsBytes(image));
+}
+
+const EncodedImageCache::Embeddings* EncodedImageCache::Lookup(
+    absl::Span<const float> image, absl::Span<const int> dimensions) {
+  auto it = entries_.find(Key(image, dimensions));
+  // Compare the image contents, as different images may have the same hash.
+  if (it == entries_.end() ||
+      absl::MakeConstSpan(it->second->image_dimensions) != dimensions ||
+      AsBytes(it->second->image) != AsBytes(image)) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return &it->second->embeddings;
+}
+
+void EncodedImageCache::Insert(absl::Span<const float> image,
+                               absl::Span<const int> dimensions,
+                               Embeddings embeddings) {
+  const uint64_t key = Key(image, dimensions);
+  // Replaces the entry of the same image, or of another image with the same
+  // hash.
+  if (auto it = entries_.find(key); it != entries_.end()) {
+    Remove(it->second);
+  }
+  const size_t num_bytes = (embeddings.values.size() + image.size()) *
+                           sizeof(float);
+  if (num_bytes > max_bytes_) {
+    return;
+  }
+  while (size_bytes_ + num_bytes > max_bytes_) {
+    Remove(std::prev(lru_.end()));
+  }
+  lru_.push_front(
+      Entry{.key = key,
+            .image = std::vector<float>(image.begin(), image.end()),
+            .image_dimensions =
+                std::vector<int>(dimensions.begin(), dimensions.end()),
+            .embeddings = std::move(embeddings),
+            .num_bytes = num_bytes});
+  entries_[key] = lru_.begin();
+  size_bytes_ += num_bytes;
+}
+
+void EncodedImageCache::Remove(EntryList::iterator entry) {
+  size_bytes_ -= entry->num_bytes;
+  entries_.erase(entry->key);
+  lru_.erase(entry);
+}
+
+}  // namespace litert::lm
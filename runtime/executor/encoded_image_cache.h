@@ -0,0 +1,107 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_ENCODED_IMAGE_CACHE_H_
+#define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_ENCODED_IMAGE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+// A cache of the embeddings images are encoded into, keyed by the preprocessed
+// image contents, so that an image sent again, e.g. a screenshot referred to in
+// later turns, is not encoded again.
+//
+// The entries are looked up by the hash of the image contents. Each entry keeps
+// a copy of the contents, which is compared on a hit, so that an image whose
+// hash collides with a cached one is never given the wrong embeddings.
+//
+// The total size of the entries, i.e. the embeddings and the copies of the
+// image contents, is bounded by a byte budget. The least recently used entries
+// are evicted first.
+//
+// This class is not thread-safe.
+class EncodedImageCache {
+ public:
+  // The embeddings of an encoded image.
+  struct Embeddings {
+    // The dimensions of the embeddings tensor.
+    std::vector<int> dimensions;
+    std::vector<float> values;
+  };
+
+  // Cumulative lookup statistics.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  explicit EncodedImageCache(size_t max_bytes);
+
+  EncodedImageCache(const EncodedImageCache&) = delete;
+  EncodedImageCache& operator=(const EncodedImageCache&) = delete;
+
+  // Returns the cached embeddings of the image of the given preprocessed
+  // contents and dimensions, or null if they are not cached. Marks the
+  // embeddings as recently used and updates the hit/miss statistics. The
+  // pointer is valid until the next call to Insert().
+  const Embeddings* Lookup(absl::Span<const float> image,
+                           absl::Span<const int> dimensions);
+
+  // Caches the embeddings of the image, replacing the cached ones if any.
+  // Evicts the least recently used entries to fit in the byte budget. Entries
+  // larger than the whole budget are not cached.
+  void Insert(absl::Span<const float> image, absl::Span<const int> dimensions,
+              Embeddings embeddings);
+
+  size_t max_bytes() const { return max_bytes_; }
+  size_t size_bytes() const { return size_bytes_; }
+  int num_entries() const { return lru_.size(); }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Entry {
+    uint64_t key;
+    // A copy of the image the embeddings are of.
+    std::vector<float> image;
+    std::vector<int> image_dimensions;
+    Embeddings embeddings;
+    size_t num_bytes;
+  };
+  using EntryList = std::list<Entry>;
+
+  // Returns the hash of the image of the given contents and dimensions.
+  static uint64_t Key(absl::Span<const float> image,
+                      absl::Span<const int> dimensions);
+
+  // Removes the entry and its bytes from the cache.
+  void Remove(EntryList::iterator entry);
+
+  const size_t max_bytes_;
+  size_t size_bytes_ = 0;
+  // The entries in the order of use, the most recently used first.
+  EntryList lru_;
+  absl::flat_hash_map<uint64_t, EntryList::iterator> entries_;
+  Stats stats_;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_ENCODED_IMAGE_CACHE_H_
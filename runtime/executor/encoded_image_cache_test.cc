@@ -0,0 +1,115 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/executor/encoded_image_cache.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace litert::lm {
+namespace {
+
+using ::testing::ElementsAre;
+
+// Returns the embeddings of `num_tokens` tokens of dimension 2 filled with
+// `value`.
+EncodedImageCache::Embeddings MakeEmbeddings(int num_tokens, float value) {
+  return EncodedImageCache::Embeddings{
+      .dimensions = {1, 1, num_tokens, 2},
+      .values = std::vector<float>(num_tokens * 2, value)};
+}
+
+// Returns the contents of an image of 2 values filled with `value`.
+std::vector<float> MakeImage(float value) {
+  return std::vector<float>(2, value);
+}
+
+constexpr int kImageDimensions[] = {1, 1, 2, 1};
+
+TEST(EncodedImageCacheTest, LookupReturnsInsertedEmbeddings) {
+  EncodedImageCache cache(/*max_bytes=*/1024);
+  EXPECT_EQ(cache.Lookup(MakeImage(1.0f), kImageDimensions), nullptr);
+  cache.Insert(MakeImage(1.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/2, 1.0f));
+
+  const EncodedImageCache::Embeddings* embeddings =
+      cache.Lookup(MakeImage(1.0f), kImageDimensions);
+  ASSERT_NE(embeddings, nullptr);
+  EXPECT_THAT(embeddings->dimensions, ElementsAre(1, 1, 2, 2));
+  EXPECT_THAT(embeddings->values, ElementsAre(1.0f, 1.0f, 1.0f, 1.0f));
+  // The embeddings and the copy of the image.
+  EXPECT_EQ(cache.size_bytes(), 24);
+  EXPECT_EQ(cache.stats().hits, 1);
+  EXPECT_EQ(cache.stats().misses, 1);
+}
+
+TEST(EncodedImageCacheTest, LookupComparesImageContentsAndDimensions) {
+  EncodedImageCache cache(/*max_bytes=*/1024);
+  cache.Insert(MakeImage(1.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/2, 1.0f));
+
+  EXPECT_EQ(cache.Lookup(MakeImage(2.0f), kImageDimensions), nullptr);
+  EXPECT_EQ(cache.Lookup(MakeImage(1.0f), {1, 2, 1, 1}), nullptr);
+  EXPECT_NE(cache.Lookup(MakeImage(1.0f), kImageDimensions), nullptr);
+  EXPECT_EQ(cache.stats().hits, 1);
+  EXPECT_EQ(cache.stats().misses, 2);
+}
+
+TEST(EncodedImageCacheTest, EvictsLeastRecentlyUsed) {
+  // Fits two entries of 24 bytes.
+  EncodedImageCache cache(/*max_bytes=*/56);
+  cache.Insert(MakeImage(1.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/2, 1.0f));
+  cache.Insert(MakeImage(2.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/2, 2.0f));
+  // Uses the first entry, so the second one is the least recently used.
+  ASSERT_NE(cache.Lookup(MakeImage(1.0f), kImageDimensions), nullptr);
+  cache.Insert(MakeImage(3.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/2, 3.0f));
+
+  EXPECT_EQ(cache.num_entries(), 2);
+  EXPECT_EQ(cache.size_bytes(), 48);
+  EXPECT_NE(cache.Lookup(MakeImage(1.0f), kImageDimensions), nullptr);
+  EXPECT_EQ(cache.Lookup(MakeImage(2.0f), kImageDimensions), nullptr);
+  EXPECT_NE(cache.Lookup(MakeImage(3.0f), kImageDimensions), nullptr);
+}
+
+TEST(EncodedImageCacheTest, InsertReplacesExistingEmbeddings) {
+  EncodedImageCache cache(/*max_bytes=*/1024);
+  cache.Insert(MakeImage(1.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/2, 1.0f));
+  cache.Insert(MakeImage(1.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/1, 2.0f));
+
+  EXPECT_EQ(cache.num_entries(), 1);
+  EXPECT_EQ(cache.size_bytes(), 16);
+  const EncodedImageCache::Embeddings* embeddings =
+      cache.Lookup(MakeImage(1.0f), kImageDimensions);
+  ASSERT_NE(embeddings, nullptr);
+  EXPECT_THAT(embeddings->values, ElementsAre(2.0f, 2.0f));
+}
+
+TEST(EncodedImageCacheTest, DoesNotCacheEntriesLargerThanBudget) {
+  EncodedImageCache cache(/*max_bytes=*/16);
+  cache.Insert(MakeImage(1.0f), kImageDimensions,
+               MakeEmbeddings(/*num_tokens=*/2, 1.0f));
+  EXPECT_EQ(cache.num_entries(), 0);
+  EXPECT_EQ(cache.size_bytes(), 0);
+  EXPECT_EQ(cache.Lookup(MakeImage(1.0f), kImageDimensions), nullptr);
+}
+
+}  // namespace
+}  // namespace litert::lm
@@ -17,7 +17,9 @@
 #include <algorithm>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <optional>
+#include <thread>  // NOLINT: Required for std::this_thread::get_id().
 #include <utility>
 #include <vector>
 
@@ -151,6 +153,8 @@ absl::Status FakeLlmExecutor::Prefill(const ExecutorInputs& inputs) {
                       *text_token_ids_span));
   prefill_times_++;
   current_step_ += text_token_ids_span->size();
+  // The prefilled tokens invalidate the speculated ones.
+  num_speculated_tokens_ = 0;
   return absl::OkStatus();
 }
 
@@ -219,6 +223,19 @@ absl::Status FakeLlmExecutor::Decode(
       (*tokens_span)[i] = decode_tokens_set_[decode_times_][i];
     }
   }
+  last_speculative_decoding_mode_ = decode_params.GetSpeculativeDecodingMode();
+  if (num_draft_tokens_ > 0 && !decode_params.HasConstraintDecoder() &&
+      last_speculative_decoding_mode_ != SpeculativeDecodingMode::kDisabled) {
+    if (num_speculated_tokens_ == 0) {
+      ++speculative_decoding_stats_.num_verify_steps;
+      speculative_decoding_stats_.num_draft_tokens += num_draft_tokens_;
+      speculative_decoding_stats_.num_accepted_tokens += num_accepted_tokens_;
+      num_speculated_tokens_ = num_accepted_tokens_ + 1;
+    }
+    --num_speculated_tokens_;
+  } else {
+    num_speculated_tokens_ = 0;
+  }
   decode_times_++;
   current_step_++;
   return absl::OkStatus();
@@ -286,6 +303,99 @@ absl::Status FakeLlmExecutor::Reset() {
   prefill_times_ = 0;
   decode_times_ = 0;
   current_step_ = 0;
+  num_speculated_tokens_ = 0;
+  return absl::OkStatus();
+}
+
+void FakeLlmExecutor::EnableSpeculativeDecoding(int num_draft_tokens,
+                                                int num_accepted_tokens) {
+  num_draft_tokens_ = num_draft_tokens;
+  num_accepted_tokens_ = num_accepted_tokens;
+}
+
+namespace {
+
+class FakeLlmExecutorContext : public LlmExecutorContext {
+ public:
+  int prefill_times = 0;
+  int decode_times = 0;
+  int current_step = 0;
+};
+
+absl::Status CheckContextsEnabled(const LlmExecutorContext* default_context) {
+  if (default_context == nullptr) {
+    return absl::UnimplementedError(
+        "Contexts are not enabled in the fake LLM executor.");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+void FakeLlmExecutor::EnableContexts() {
+  default_context_ = std::make_unique<FakeLlmExecutorContext>();
+  active_context_ = default_context_.get();
+}
+
+void FakeLlmExecutor::SaveStatesTo(LlmExecutorContext* context) const {
+  auto* fake_context = static_cast<FakeLlmExecutorContext*>(context);
+  fake_context->prefill_times = prefill_times_;
+  fake_context->decode_times = decode_times_;
+  fake_context->current_step = current_step_;
+}
+
+void FakeLlmExecutor::LoadStatesFrom(const LlmExecutorContext* context) {
+  const auto* fake_context =
+      static_cast<const FakeLlmExecutorContext*>(context);
+  prefill_times_ = fake_context->prefill_times;
+  decode_times_ = fake_context->decode_times;
+  current_step_ = fake_context->current_step;
+}
+
+absl::StatusOr<std::unique_ptr<LlmExecutorContext>>
+FakeLlmExecutor::CreateContext() {
+  RETURN_IF_ERROR(CheckContextsEnabled(default_context_.get()));
+  num_live_contexts_++;
+  return std::make_unique<FakeLlmExecutorContext>();
+}
+
+absl::Status FakeLlmExecutor::SwitchContext(LlmExecutorContext* context) {
+  RETURN_IF_ERROR(CheckContextsEnabled(default_context_.get()));
+  if (context == nullptr) {
+    context = default_context_.get();
+  }
+  SaveStatesTo(active_context_);
+  LoadStatesFrom(context);
+  active_context_ = context;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<LlmExecutorContext>>
+FakeLlmExecutor::CloneContext(LlmExecutorContext* context) {
+  RETURN_IF_ERROR(CheckContextsEnabled(default_context_.get()));
+  if (context == nullptr) {
+    context = default_context_.get();
+  }
+  if (context == active_context_) {
+    SaveStatesTo(active_context_);
+  }
+  num_live_contexts_++;
+  return std::make_unique<FakeLlmExecutorContext>(
+      *static_cast<FakeLlmExecutorContext*>(context));
+}
+
+absl::Status FakeLlmExecutor::ReleaseContext(
+    std::unique_ptr<LlmExecutorContext> context) {
+  RETURN_IF_ERROR(CheckContextsEnabled(default_context_.get()));
+  if (context == nullptr) {
+    return absl::InvalidArgumentError("The context to release is null.");
+  }
+  if (context.get() == active_context_) {
+    LoadStatesFrom(default_context_.get());
+    active_context_ = default_context_.get();
+  }
+  num_live_contexts_--;
+  last_release_thread_id_ = std::this_thread::get_id();
   return absl::OkStatus();
 }
 
@@ -15,7 +15,9 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_MOCK_LLM_EXECUTOR_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_MOCK_LLM_EXECUTOR_H_
 
+#include <memory>
 #include <optional>
+#include <thread>  // NOLINT: Required for std::thread::id.
 #include <vector>
 
 #include "absl/status/status.h"  // from @com_google_absl
@@ -26,6 +28,7 @@
 #include "runtime/executor/llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/llm_executor_settings.h"
+#include "runtime/executor/speculative_decoding_util.h"
 
 namespace litert::lm {
 
@@ -99,7 +102,44 @@ class FakeLlmExecutor : public LlmExecutor {
 
   absl::Status Reset() override;
 
+  // Makes Decode() with the output tokens simulate speculative decoding unless
+  // it is disabled in the decode params or constrained: every verification
+  // pass accepts `num_accepted_tokens` of `num_draft_tokens` draft tokens, so
+  // it returns the tokens of the next `num_accepted_tokens` + 1 decodes.
+  void EnableSpeculativeDecoding(int num_draft_tokens, int num_accepted_tokens);
+
+  const SpeculativeDecodingStats* GetSpeculativeDecodingStats() const override {
+    return num_draft_tokens_ > 0 ? &speculative_decoding_stats_ : nullptr;
+  }
+
+  // The speculative decoding mode of the last Decode() with the output tokens.
+  SpeculativeDecodingMode last_speculative_decoding_mode() const {
+    return last_speculative_decoding_mode_;
+  }
+
+  // Enables the context APIs, which are not implemented by default. A context
+  // holds the number of Prefill and Decode calls and the current step.
+  void EnableContexts();
+
+  absl::StatusOr<std::unique_ptr<LlmExecutorContext>> CreateContext() override;
+  absl::Status SwitchContext(LlmExecutorContext* context) override;
+  absl::StatusOr<std::unique_ptr<LlmExecutorContext>> CloneContext(
+      LlmExecutorContext* context) override;
+  absl::Status ReleaseContext(
+      std::unique_ptr<LlmExecutorContext> context) override;
+
+  // The number of contexts created or cloned and not released yet.
+  int num_live_contexts() const { return num_live_contexts_; }
+  // The thread which called ReleaseContext() last.
+  std::thread::id last_release_thread_id() const {
+    return last_release_thread_id_;
+  }
+
  private:
+  // Copies the states of the executor to `context`, or the other way around.
+  void SaveStatesTo(LlmExecutorContext* context) const;
+  void LoadStatesFrom(const LlmExecutorContext* context);
+
   // Util function to try to sleep for the decode delay duration (if set). This
   // is used to simulate a long-running task.
   void TryDecodeDelay();
@@ -129,6 +169,22 @@ class FakeLlmExecutor : public LlmExecutor {
   // The delay before decoding. Useful for testing the cancellation logic.
   // The default value is 0, which means no delay.
   absl::Duration decode_delay_;
+
+  // The simulated speculative decoding, if enabled.
+  int num_draft_tokens_ = 0;
+  int num_accepted_tokens_ = 0;
+  SpeculativeDecodingStats speculative_decoding_stats_;
+  // The number of tokens accepted by the last verification pass which are not
+  // returned yet.
+  int num_speculated_tokens_ = 0;
+  SpeculativeDecodingMode last_speculative_decoding_mode_ =
+      SpeculativeDecodingMode::kDraftModel;
+
+  // The default context and the active one, if the contexts are enabled.
+  std::unique_ptr<LlmExecutorContext> default_context_;
+  LlmExecutorContext* active_context_ = nullptr;
+  int num_live_contexts_ = 0;
+  std::thread::id last_release_thread_id_;
 };
 
 }  // namespace litert::lm
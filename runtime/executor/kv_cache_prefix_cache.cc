@@ -0,0 +1,189 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/executor/kv_cache_prefix_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+namespace {
+
+// Returns the length of the common prefix of `a` and `b`.
+size_t CommonPrefixLength(absl::Span<const int> a, absl::Span<const int> b) {
+  return std::mismatch(a.begin(), a.begin() + std::min(a.size(), b.size()),
+                       b.begin())
+             .first -
+         a.begin();
+}
+
+}  // namespace
+
+KvCachePrefixCache::KvCachePrefixCache(size_t max_bytes)
+    : max_bytes_(max_bytes) {}
+
+KvCachePrefixCache::~KvCachePrefixCache() = default;
+
+std::pair<int, KvCachePrefixCache::Node*> KvCachePrefixCache::Walk(
+    absl::Span<const int> tokens, uint64_t partition) const {
+  auto root = roots_.find(partition);
+  if (root == roots_.end()) {
+    return {0, nullptr};
+  }
+  Node* node = root->second.get();
+  size_t depth = 0;
+  while (depth < tokens.size()) {
+    auto it = node->children.find(tokens[depth]);
+    if (it == node->children.end()) {
+      break;
+    }
+    Node* child = it->second.get();
+    const size_t matched =
+        CommonPrefixLength(child->edge, tokens.subspan(depth));
+    depth += matched;
+    node = child;
+    if (matched < child->edge.size()) {
+      // The match ends in the middle of the edge, all the sequences in the
+      // subtree of the child still share the matched prefix.
+      break;
+    }
+  }
+  return {static_cast<int>(depth), node};
+}
+
+// static
+KvCachePrefixCache::Node* KvCachePrefixCache::FindEntryInSubtree(Node* node) {
+  if (node->has_entry) {
+    return node;
+  }
+  for (auto& [unused_token, child] : node->children) {
+    if (Node* found = FindEntryInSubtree(child.get()); found != nullptr) {
+      return found;
+    }
+  }
+  return nullptr;
+}
+
+KvCachePrefixCache::Match KvCachePrefixCache::Lookup(
+    absl::Span<const int> tokens, uint64_t partition) {
+  auto [num_tokens, node] = Walk(tokens, partition);
+  Node* entry_node = num_tokens > 0 ? FindEntryInSubtree(node) : nullptr;
+  if (entry_node == nullptr) {
+    ++stats_.misses;
+    return Match();
+  }
+  lru_.splice(lru_.begin(), lru_, entry_node->entry);
+  ++stats_.hits;
+  stats_.reused_tokens += num_tokens;
+  return Match{.num_tokens = num_tokens,
+               .snapshot = &entry_node->entry->snapshot};
+}
+
+bool KvCachePrefixCache::Covers(absl::Span<const int> tokens,
+                                uint64_t partition) const {
+  auto [num_tokens, node] = Walk(tokens, partition);
+  return node != nullptr && num_tokens == tokens.size() &&
+         FindEntryInSubtree(node) != nullptr;
+}
+
+void KvCachePrefixCache::Insert(absl::Span<const int> tokens,
+                                Snapshot snapshot, uint64_t partition) {
+  size_t num_bytes = 0;
+  for (const auto& [unused_name, data] : snapshot) {
+    num_bytes += data.size();
+  }
+  if (tokens.empty() || num_bytes > max_bytes_) {
+    return;
+  }
+
+  // Find or create the node of the sequence, splitting the edges as needed.
+  std::unique_ptr<Node>& root = roots_[partition];
+  if (root == nullptr) {
+    root = std::make_unique<Node>();
+  }
+  Node* node = root.get();
+  size_t depth = 0;
+  while (depth < tokens.size()) {
+    auto it = node->children.find(tokens[depth]);
+    if (it == node->children.end()) {
+      auto child = std::make_unique<Node>();
+      child->edge.assign(tokens.begin() + depth, tokens.end());
+      child->parent = node;
+      node = (node->children[tokens[depth]] = std::move(child)).get();
+      break;
+    }
+    Node* child = it->second.get();
+    const size_t matched =
+        CommonPrefixLength(child->edge, tokens.subspan(depth));
+    if (matched < child->edge.size()) {
+      auto middle = std::make_unique<Node>();
+      middle->edge.assign(child->edge.begin(), child->edge.begin() + matched);
+      middle->parent = node;
+      child->edge.erase(child->edge.begin(), child->edge.begin() + matched);
+      child->parent = middle.get();
+      middle->children[child->edge.front()] = std::move(it->second);
+      it->second = std::move(middle);
+      child = it->second.get();
+    }
+    depth += matched;
+    node = child;
+  }
+
+  if (node->has_entry) {
+    size_bytes_ -= node->entry->num_bytes;
+    lru_.erase(node->entry);
+  }
+  lru_.push_front(Entry{node, std::move(snapshot), num_bytes});
+  node->entry = lru_.begin();
+  node->has_entry = true;
+  size_bytes_ += num_bytes;
+
+  // The ancestors are prefixes of the new sequence. They keep their nodes since
+  // they have children.
+  for (Node* ancestor = node->parent; ancestor->parent != nullptr;
+       ancestor = ancestor->parent) {
+    if (ancestor->has_entry) {
+      RemoveEntry(ancestor);
+    }
+  }
+
+  while (size_bytes_ > max_bytes_) {
+    RemoveEntry(lru_.back().node);
+  }
+}
+
+void KvCachePrefixCache::Clear() {
+  roots_.clear();
+  lru_.clear();
+  size_bytes_ = 0;
+}
+
+void KvCachePrefixCache::RemoveEntry(Node* node) {
+  size_bytes_ -= node->entry->num_bytes;
+  lru_.erase(node->entry);
+  node->has_entry = false;
+  while (node->parent != nullptr && !node->has_entry &&
+         node->children.empty()) {
+    Node* parent = node->parent;
+    parent->children.erase(node->edge.front());
+    node = parent;
+  }
+}
+
+}  // namespace litert::lm
@@ -0,0 +1,144 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_KV_CACHE_PREFIX_CACHE_H_
+#define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_KV_CACHE_PREFIX_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+// A cache of KV cache snapshots keyed by the token id sequences they were
+// computed from, organized as a radix tree.
+//
+// A snapshot holds the KV cache entries of a token sequence, i.e. the slices of
+// the KV cache buffers at the positions of its tokens, after processing it.
+// Since the attention mask hides the positions after the current step, a
+// snapshot of a sequence is also a valid snapshot of any prefix of it.
+// Lookup() thus returns the longest common prefix of the queried tokens with
+// any cached sequence.
+//
+// The sequences are grouped in partitions which never share a prefix, e.g. for
+// the KV caches computed with different LoRA weights.
+//
+// The total size of the snapshots is bounded by a byte budget. The least
+// recently used snapshots are evicted first.
+//
+// This class is not thread-safe.
+class KvCachePrefixCache {
+ public:
+  // The KV cache entries of the tokens keyed by the KV cache tensor names.
+  using Snapshot = absl::flat_hash_map<std::string, std::vector<uint8_t>>;
+
+  // The result of Lookup().
+  struct Match {
+    // The number of leading tokens covered by the snapshot. 0 if no cached
+    // sequence shares a prefix with the queried tokens.
+    int num_tokens = 0;
+    // The snapshot covering the prefix. Valid until the next call to Insert().
+    const Snapshot* snapshot = nullptr;
+  };
+
+  // Cumulative lookup statistics.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // The total number of prefix tokens served from the cache.
+    uint64_t reused_tokens = 0;
+  };
+
+  explicit KvCachePrefixCache(size_t max_bytes);
+  ~KvCachePrefixCache();
+
+  KvCachePrefixCache(const KvCachePrefixCache&) = delete;
+  KvCachePrefixCache& operator=(const KvCachePrefixCache&) = delete;
+
+  // Returns the longest prefix of `tokens` covered by a cached snapshot of the
+  // same partition and marks the snapshot as recently used. Updates the
+  // hit/miss statistics.
+  Match Lookup(absl::Span<const int> tokens, uint64_t partition = 0);
+
+  // Returns true if `tokens` is a prefix of a cached sequence of the same
+  // partition, i.e. inserting it would not cover anything new. Does not update
+  // the statistics.
+  bool Covers(absl::Span<const int> tokens, uint64_t partition = 0) const;
+
+  // Caches the snapshot of `tokens`. The cached sequences which are prefixes
+  // of `tokens` are dropped, since the new snapshot covers them. Evicts the
+  // least recently used snapshots to fit in the byte budget. Snapshots larger
+  // than the whole budget are not cached.
+  void Insert(absl::Span<const int> tokens, Snapshot snapshot,
+              uint64_t partition = 0);
+
+  // Drops all the cached snapshots. The statistics are kept.
+  void Clear();
+
+  size_t max_bytes() const { return max_bytes_; }
+  size_t size_bytes() const { return size_bytes_; }
+  int num_entries() const { return lru_.size(); }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Node;
+  struct Entry {
+    Node* node;
+    Snapshot snapshot;
+    size_t num_bytes;
+  };
+  using EntryList = std::list<Entry>;
+
+  struct Node {
+    // The token ids on the edge from the parent to this node.
+    std::vector<int> edge;
+    Node* parent = nullptr;
+    absl::flat_hash_map<int, std::unique_ptr<Node>> children;
+    // Set if the sequence ending at this node has a snapshot.
+    EntryList::iterator entry;
+    bool has_entry = false;
+  };
+
+  // Walks down the tree of `partition` along `tokens`. Returns the number of
+  // matched tokens and the deepest node whose subtree contains all the
+  // sequences sharing the matched prefix, or null if the partition is empty.
+  std::pair<int, Node*> Walk(absl::Span<const int> tokens,
+                             uint64_t partition) const;
+
+  // Returns a node with a snapshot in the subtree of `node`, or null.
+  static Node* FindEntryInSubtree(Node* node);
+
+  // Removes the snapshot of `node` and prunes the tree.
+  void RemoveEntry(Node* node);
+
+  const size_t max_bytes_;
+  size_t size_bytes_ = 0;
+  // The root of the tree of each partition. A node is a root if it has no
+  // parent.
+  absl::flat_hash_map<uint64_t, std::unique_ptr<Node>> roots_;
+  // The snapshots in the order of use, the most recently used first.
+  EntryList lru_;
+  Stats stats_;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_KV_CACHE_PREFIX_CACHE_H_
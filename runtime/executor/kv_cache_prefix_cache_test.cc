@@ -0,0 +1,173 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/executor/kv_cache_prefix_cache.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace litert::lm {
+namespace {
+
+// Returns a snapshot of a single KV cache tensor of `size` bytes filled with
+// `value`.
+KvCachePrefixCache::Snapshot MakeSnapshot(int size, uint8_t value) {
+  KvCachePrefixCache::Snapshot snapshot;
+  snapshot["kv_cache_k_0"] = std::vector<uint8_t>(size, value);
+  return snapshot;
+}
+
+TEST(KvCachePrefixCacheTest, LookupEmptyCacheIsMiss) {
+  KvCachePrefixCache cache(/*max_bytes=*/1024);
+  auto match = cache.Lookup({1, 2, 3});
+  EXPECT_EQ(match.num_tokens, 0);
+  EXPECT_EQ(match.snapshot, nullptr);
+  EXPECT_EQ(cache.stats().hits, 0);
+  EXPECT_EQ(cache.stats().misses, 1);
+}
+
+TEST(KvCachePrefixCacheTest, LookupReturnsLongestCommonPrefix) {
+  KvCachePrefixCache cache(/*max_bytes=*/1024);
+  cache.Insert({1, 2, 3, 4}, MakeSnapshot(8, 1));
+  cache.Insert({1, 2, 5}, MakeSnapshot(8, 2));
+
+  // Shares {1, 2, 3} with the first sequence.
+  auto match = cache.Lookup({1, 2, 3, 7, 8});
+  EXPECT_EQ(match.num_tokens, 3);
+  ASSERT_NE(match.snapshot, nullptr);
+  EXPECT_EQ(match.snapshot->at("kv_cache_k_0")[0], 1);
+
+  // Matches the second sequence entirely.
+  match = cache.Lookup({1, 2, 5, 6});
+  EXPECT_EQ(match.num_tokens, 3);
+  ASSERT_NE(match.snapshot, nullptr);
+  EXPECT_EQ(match.snapshot->at("kv_cache_k_0")[0], 2);
+
+  // Shares only {1, 2}, which either snapshot covers.
+  match = cache.Lookup({1, 2, 9});
+  EXPECT_EQ(match.num_tokens, 2);
+  EXPECT_NE(match.snapshot, nullptr);
+
+  match = cache.Lookup({9, 1, 2});
+  EXPECT_EQ(match.num_tokens, 0);
+
+  EXPECT_EQ(cache.stats().hits, 3);
+  EXPECT_EQ(cache.stats().misses, 1);
+  EXPECT_EQ(cache.stats().reused_tokens, 8);
+}
+
+TEST(KvCachePrefixCacheTest, Covers) {
+  KvCachePrefixCache cache(/*max_bytes=*/1024);
+  cache.Insert({1, 2, 3, 4}, MakeSnapshot(8, 1));
+  EXPECT_TRUE(cache.Covers({1, 2}));
+  EXPECT_TRUE(cache.Covers({1, 2, 3, 4}));
+  EXPECT_FALSE(cache.Covers({1, 2, 3, 4, 5}));
+  EXPECT_FALSE(cache.Covers({1, 3}));
+  // Covers() does not count as a lookup.
+  EXPECT_EQ(cache.stats().hits + cache.stats().misses, 0);
+}
+
+TEST(KvCachePrefixCacheTest, InsertDropsCoveredPrefixes) {
+  KvCachePrefixCache cache(/*max_bytes=*/1024);
+  cache.Insert({1, 2}, MakeSnapshot(8, 1));
+  cache.Insert({1, 2, 3}, MakeSnapshot(8, 2));
+  EXPECT_EQ(cache.num_entries(), 1);
+  EXPECT_EQ(cache.size_bytes(), 8);
+
+  auto match = cache.Lookup({1, 2});
+  EXPECT_EQ(match.num_tokens, 2);
+  ASSERT_NE(match.snapshot, nullptr);
+  EXPECT_EQ(match.snapshot->at("kv_cache_k_0")[0], 2);
+}
+
+TEST(KvCachePrefixCacheTest, InsertSameSequenceReplacesSnapshot) {
+  KvCachePrefixCache cache(/*max_bytes=*/1024);
+  cache.Insert({1, 2}, MakeSnapshot(8, 1));
+  cache.Insert({1, 2}, MakeSnapshot(16, 2));
+  EXPECT_EQ(cache.num_entries(), 1);
+  EXPECT_EQ(cache.size_bytes(), 16);
+}
+
+TEST(KvCachePrefixCacheTest, EvictsLeastRecentlyUsed) {
+  KvCachePrefixCache cache(/*max_bytes=*/32);
+  cache.Insert({1, 2}, MakeSnapshot(16, 1));
+  cache.Insert({3, 4}, MakeSnapshot(16, 2));
+  // Touch {1, 2} so that {3, 4} becomes the least recently used.
+  EXPECT_EQ(cache.Lookup({1, 2}).num_tokens, 2);
+
+  cache.Insert({5, 6}, MakeSnapshot(16, 3));
+  EXPECT_EQ(cache.num_entries(), 2);
+  EXPECT_EQ(cache.size_bytes(), 32);
+  EXPECT_EQ(cache.Lookup({1, 2}).num_tokens, 2);
+  EXPECT_EQ(cache.Lookup({3, 4}).num_tokens, 0);
+  EXPECT_EQ(cache.Lookup({5, 6}).num_tokens, 2);
+}
+
+TEST(KvCachePrefixCacheTest, SnapshotLargerThanBudgetIsNotCached) {
+  KvCachePrefixCache cache(/*max_bytes=*/8);
+  cache.Insert({1, 2}, MakeSnapshot(16, 1));
+  EXPECT_EQ(cache.num_entries(), 0);
+  EXPECT_EQ(cache.size_bytes(), 0);
+}
+
+TEST(KvCachePrefixCacheTest, EvictionPrunesSplitNodes) {
+  KvCachePrefixCache cache(/*max_bytes=*/16);
+  cache.Insert({1, 2, 3}, MakeSnapshot(16, 1));
+  // Splits the edge {1, 2, 3} at {1} and evicts {1, 2, 3}.
+  cache.Insert({1, 4}, MakeSnapshot(16, 2));
+  EXPECT_EQ(cache.num_entries(), 1);
+
+  auto match = cache.Lookup({1, 2, 3});
+  EXPECT_EQ(match.num_tokens, 1);
+  ASSERT_NE(match.snapshot, nullptr);
+  EXPECT_EQ(match.snapshot->at("kv_cache_k_0")[0], 2);
+}
+
+TEST(KvCachePrefixCacheTest, PartitionsDoNotSharePrefixes) {
+  KvCachePrefixCache cache(/*max_bytes=*/1024);
+  cache.Insert({1, 2, 3}, MakeSnapshot(8, 1), /*partition=*/1);
+  EXPECT_EQ(cache.Lookup({1, 2, 3}).num_tokens, 0);
+  EXPECT_FALSE(cache.Covers({1, 2}));
+  EXPECT_TRUE(cache.Covers({1, 2}, /*partition=*/1));
+
+  cache.Insert({1, 2}, MakeSnapshot(8, 2));
+  // The sequence of the other partition is not dropped as a covered prefix.
+  EXPECT_EQ(cache.num_entries(), 2);
+  auto match = cache.Lookup({1, 2, 3}, /*partition=*/1);
+  EXPECT_EQ(match.num_tokens, 3);
+  ASSERT_NE(match.snapshot, nullptr);
+  EXPECT_EQ(match.snapshot->at("kv_cache_k_0")[0], 1);
+  match = cache.Lookup({1, 2, 3});
+  EXPECT_EQ(match.num_tokens, 2);
+  ASSERT_NE(match.snapshot, nullptr);
+  EXPECT_EQ(match.snapshot->at("kv_cache_k_0")[0], 2);
+}
+
+TEST(KvCachePrefixCacheTest, Clear) {
+  KvCachePrefixCache cache(/*max_bytes=*/1024);
+  cache.Insert({1, 2}, MakeSnapshot(8, 1));
+  EXPECT_EQ(cache.Lookup({1, 2}).num_tokens, 2);
+  cache.Clear();
+  EXPECT_EQ(cache.num_entries(), 0);
+  EXPECT_EQ(cache.size_bytes(), 0);
+  EXPECT_EQ(cache.Lookup({1, 2}).num_tokens, 0);
+  EXPECT_EQ(cache.stats().hits, 1);
+  EXPECT_EQ(cache.stats().misses, 1);
+}
+
+}  // namespace
+}  // namespace litert::lm
@@ -291,6 +291,48 @@ absl::Status FillAttentionMask(litert::TensorBuffer& mask, int start_timestep,
   return absl::OkStatus();
 }
 
+absl::Status ExtendAttentionMask(litert::TensorBuffer& mask, int from_timestep,
+                                 int to_timestep) {
+  LITERT_ASSIGN_OR_RETURN(auto mask_tensor_type, mask.TensorType());
+  RET_CHECK_EQ(mask_tensor_type.Layout().Rank(), 4)
+          .SetCode(absl::StatusCode::kInvalidArgument)
+      << "Attention mask must be 4D.";
+  RET_CHECK_EQ(mask_tensor_type.Layout().Dimensions()[1], 1)
+          .SetCode(absl::StatusCode::kInvalidArgument)
+      << "Attention mask must be a decode mask.";
+  int batch_size = mask_tensor_type.Layout().Dimensions()[0];
+  int channel_size = mask_tensor_type.Layout().Dimensions()[3];
+  RET_CHECK(0 <= from_timestep && from_timestep <= to_timestep &&
+            to_timestep < channel_size)
+          .SetCode(absl::StatusCode::kInvalidArgument)
+      << "Invalid timesteps: " << from_timestep << " to " << to_timestep;
+  LITERT_ASSIGN_OR_RETURN(auto mask_size, mask.PackedSize());
+  LITERT_ASSIGN_OR_RETURN(auto mask_lock_and_addr,
+                          litert::TensorBufferScopedLock::Create(
+                              mask, litert::TensorBuffer::LockMode::kWrite));
+
+  for (int b = 0; b < batch_size; ++b) {
+    if (mask_tensor_type.ElementType() == litert::ElementType::Bool) {
+      // Boolean mask: Fill value = true.
+      bool* bool_ptr = static_cast<bool*>(mask_lock_and_addr.second) +
+                       b * (mask_size / sizeof(bool) / batch_size);
+      std::fill(bool_ptr + from_timestep + 1, bool_ptr + to_timestep + 1,
+                true);
+    } else if (mask_tensor_type.ElementType() ==
+               litert::ElementType::Float32) {
+      // Float mask: Fill value = 0.0f.
+      float* float_ptr = static_cast<float*>(mask_lock_and_addr.second) +
+                         b * (mask_size / sizeof(float) / batch_size);
+      std::fill(float_ptr + from_timestep + 1, float_ptr + to_timestep + 1,
+                0.0f);
+    } else {
+      return absl::InvalidArgumentError(
+          "Unsupported attention mask data type.");
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::StatusOr<std::unique_ptr<ModelResources>>
 BuildLiteRtCompiledModelResources(const ModelAssets& model_assets) {
   ASSIGN_OR_RETURN(  // NOLINT
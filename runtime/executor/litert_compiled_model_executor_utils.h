@@ -120,6 +120,14 @@ absl::Status InitializeAttentionMask(::litert::TensorBuffer& mask, bool is_f16);
 absl::Status FillAttentionMask(::litert::TensorBuffer& mask, int start_timestep,
                                int steps);
 
+// Extends the decode attention mask filled for `from_timestep` to
+// `to_timestep`, i.e. unmasks the positions in (from_timestep, to_timestep]
+// for every batch. Unlike re-initializing and filling the mask, the cost is
+// proportional to the number of new positions.
+// The mask is a 4D tensor with shape [batch, seq_len=1, 1, max_kv_len].
+absl::Status ExtendAttentionMask(::litert::TensorBuffer& mask,
+                                 int from_timestep, int to_timestep);
+
 // Builds the model resources from the model_path for compiled model only.
 // Supports .task and .litertlm formats.
 absl::StatusOr<std::unique_ptr<ModelResources>>
@@ -440,6 +440,67 @@ TEST(LlmLiteRTCompiledModelExecutorUtilsTest,
   }
 }
 
+TEST(LlmLiteRTCompiledModelExecutorUtilsTest,
+     ExtendAttentionMask_Float32_MatchesFill) {
+  LITERT_ASSERT_OK_AND_ASSIGN(auto env, ::litert::Environment::Create({}));
+  // Mask shape: [batch=2, seq_len=1, 1, max_kv_len=8]
+  auto layout = ::litert::Layout(::litert::Dimensions({2, 1, 1, 8}));
+  RankedTensorType ranked_tensor_type(ElementType::Float32, std::move(layout));
+  auto extended_mask =
+      TensorBuffer::CreateManaged(env, ::litert::TensorBufferType::kHostMemory,
+                                  ranked_tensor_type, sizeof(float) * 16);
+  ASSERT_TRUE(extended_mask);
+  auto filled_mask =
+      TensorBuffer::CreateManaged(env, ::litert::TensorBufferType::kHostMemory,
+                                  ranked_tensor_type, sizeof(float) * 16);
+  ASSERT_TRUE(filled_mask);
+
+  // Extending the mask of timestep 2 step by step to timestep 5 must give the
+  // same mask as filling it for timestep 5 from scratch.
+  ASSERT_OK(InitializeAttentionMask(*extended_mask, /*is_f16=*/false));
+  ASSERT_OK(FillAttentionMask(*extended_mask, /*start_timestep=*/2,
+                              /*steps=*/1));
+  ASSERT_OK(ExtendAttentionMask(*extended_mask, /*from_timestep=*/2,
+                                /*to_timestep=*/3));
+  ASSERT_OK(ExtendAttentionMask(*extended_mask, /*from_timestep=*/3,
+                                /*to_timestep=*/5));
+  ASSERT_OK(InitializeAttentionMask(*filled_mask, /*is_f16=*/false));
+  ASSERT_OK(FillAttentionMask(*filled_mask, /*start_timestep=*/5,
+                              /*steps=*/1));
+
+  auto extended_lock = litert::TensorBufferScopedLock::Create(
+      *extended_mask, litert::TensorBuffer::LockMode::kRead);
+  ASSERT_TRUE(extended_lock);
+  auto filled_lock = litert::TensorBufferScopedLock::Create(
+      *filled_mask, litert::TensorBuffer::LockMode::kRead);
+  ASSERT_TRUE(filled_lock);
+  float* extended_ptr = static_cast<float*>(extended_lock->second);
+  float* filled_ptr = static_cast<float*>(filled_lock->second);
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(extended_ptr[i], filled_ptr[i]) << " at index " << i;
+    EXPECT_EQ(extended_ptr[i] == 0.0f, i % 8 <= 5) << " at index " << i;
+  }
+}
+
+TEST(LlmLiteRTCompiledModelExecutorUtilsTest,
+     ExtendAttentionMask_InvalidTimesteps) {
+  LITERT_ASSERT_OK_AND_ASSIGN(auto env, ::litert::Environment::Create({}));
+  auto layout = ::litert::Layout(::litert::Dimensions({1, 1, 1, 8}));
+  RankedTensorType ranked_tensor_type(ElementType::Bool, std::move(layout));
+  auto mask_buffer =
+      TensorBuffer::CreateManaged(env, ::litert::TensorBufferType::kHostMemory,
+                                  ranked_tensor_type, sizeof(bool) * 8);
+  ASSERT_TRUE(mask_buffer);
+  ASSERT_OK(InitializeAttentionMask(*mask_buffer, /*is_f16=*/false));
+
+  EXPECT_THAT(ExtendAttentionMask(*mask_buffer, /*from_timestep=*/3,
+                                  /*to_timestep=*/2),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ExtendAttentionMask(*mask_buffer, /*from_timestep=*/3,
+                                  /*to_timestep=*/8),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST(LlmLiteRTCompiledModelExecutorUtilsTest,
      BuildModelResourcesTaskBundleFromPath) {
   auto model_path =
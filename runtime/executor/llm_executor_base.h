@@ -15,16 +15,30 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_LLM_EXECUTOR_BASE_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_LLM_EXECUTOR_BASE_H_
 
+#include <cstdint>
+#include <memory>
+#include <optional>
+
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
+#include "runtime/executor/executor_settings_base.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/llm_executor_settings.h"
+#include "runtime/executor/speculative_decoding_util.h"
 
 namespace litert::lm {
 
+// The per-session states of an LLM executor, e.g. the KV cache and the
+// processed tokens. The content is opaque to the callers and only meaningful to
+// the executor which created it through LlmExecutorBase::CreateContext().
+class LlmExecutorContext {
+ public:
+  virtual ~LlmExecutorContext() = default;
+};
+
 // The LLM Executor serves as a lightweight and portable wrapper around various
 // converted LLM model formats, i.e. LiteRT. It aims to provide a general,
 // minimal-dependency interface for the users, abstracting the complexities of
@@ -108,6 +122,14 @@ class LlmExecutorBase {
                      ExecutorBackendName()));
   };
 
+  // Returns the cumulative speculative decoding statistics, or null if the
+  // executor does not decode speculatively. An executor only decodes
+  // speculatively in Decode() with the output tokens, i.e. when it samples
+  // the tokens itself.
+  virtual const SpeculativeDecodingStats* GetSpeculativeDecodingStats() const {
+    return nullptr;
+  }
+
   // ------------Vision APIs------------:
   // This function will populate the GPU tensors with the vision embeddings and
   // vision per layer embeddings. This should only be used before the
@@ -129,6 +151,59 @@ class LlmExecutorBase {
     return absl::UnimplementedError(absl::StrCat(
         "Reset not implemented for backend: ", ExecutorBackendName()));
   };
+
+  // ------------Context APIs------------:
+  // Creates a new context with its own KV cache and processed tokens. All the
+  // contexts of an executor share the same model and weights, so that multiple
+  // sessions can run on one executor without overwriting each other's states.
+  virtual absl::StatusOr<std::unique_ptr<LlmExecutorContext>> CreateContext() {
+    return absl::UnimplementedError(absl::StrCat(
+        "CreateContext not implemented for backend: ", ExecutorBackendName()));
+  };
+
+  // Saves the states of the active context and makes the given context active.
+  // All the following Prefill/Decode calls operate on the active context. If
+  // `context` is null, the default context of the executor is activated.
+  virtual absl::Status SwitchContext(LlmExecutorContext* context) {
+    return absl::UnimplementedError(absl::StrCat(
+        "SwitchContext not implemented for backend: ", ExecutorBackendName()));
+  };
+
+  // Creates a new context holding a copy of the states of the given context,
+  // e.g. to checkpoint or fork a session. The two contexts evolve
+  // independently afterwards. If `context` is null, the default context of the
+  // executor is copied.
+  virtual absl::StatusOr<std::unique_ptr<LlmExecutorContext>> CloneContext(
+      LlmExecutorContext* context) {
+    return absl::UnimplementedError(absl::StrCat(
+        "CloneContext not implemented for backend: ", ExecutorBackendName()));
+  };
+
+  // Releases the context created by CreateContext(). If the context is active,
+  // the default context of the executor is activated.
+  virtual absl::Status ReleaseContext(
+      std::unique_ptr<LlmExecutorContext> context) {
+    return absl::UnimplementedError(absl::StrCat(
+        "ReleaseContext not implemented for backend: ", ExecutorBackendName()));
+  };
+
+  // ------------LoRA APIs------------:
+  // Registers the LoRA model in `model_assets` under `lora_id`. The LoRA model
+  // is loaded when it is first used.
+  virtual absl::Status LoadLoRA(uint32_t lora_id,
+                                const ModelAssets& model_assets) {
+    return absl::UnimplementedError(absl::StrCat(
+        "LoadLoRA not implemented for backend: ", ExecutorBackendName()));
+  };
+
+  // Applies the LoRA registered under `lora_id` to the following Prefill/Decode
+  // calls of the active context, or no LoRA if `lora_id` is not set. The LoRA
+  // is part of the context states, i.e. it is restored when the context becomes
+  // active again. The model is not recompiled.
+  virtual absl::Status UseLoRA(std::optional<uint32_t> lora_id) {
+    return absl::UnimplementedError(absl::StrCat(
+        "UseLoRA not implemented for backend: ", ExecutorBackendName()));
+  };
 };
 
 }  // namespace litert::lm
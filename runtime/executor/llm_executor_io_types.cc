@@ -569,6 +569,9 @@ std::ostream& operator<<(std::ostream& os, const ExecutorDecodeParams& params) {
     os << "not set";
   }
   os << "\n"
+     << kFieldIndent
+     << "SpeculativeDecodingMode: " << params.GetSpeculativeDecodingMode()
+     << "\n"
      << "}";
   return os;
 }
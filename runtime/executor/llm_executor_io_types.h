@@ -23,6 +23,7 @@
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/constrained_decoding/constrained_decoder.h"
+#include "runtime/executor/speculative_decoding_util.h"
 
 namespace litert::lm {
 
@@ -291,8 +292,19 @@ class ExecutorDecodeParams {
   // Returns the constraint decoder if it exists. Otherwise, returns nullptr.
   ConstrainedDecoder* GetConstraintDecoder() const;
 
+  // Sets the source of the draft tokens, if the executor decodes
+  // speculatively.
+  void SetSpeculativeDecodingMode(SpeculativeDecodingMode mode) {
+    speculative_decoding_mode_ = mode;
+  }
+  SpeculativeDecodingMode GetSpeculativeDecodingMode() const {
+    return speculative_decoding_mode_;
+  }
+
  private:
   ConstrainedDecoder* absl_nullable constraint_decoder_ = nullptr;
+  SpeculativeDecodingMode speculative_decoding_mode_ =
+      SpeculativeDecodingMode::kDraftModel;
 };
 std::ostream& operator<<(std::ostream& os, const ExecutorDecodeParams& params);
 
@@ -789,6 +789,12 @@ TEST(LlmExecutorIoTypesTest, ExecutorDecodeParamsGetSet) {
   params.SetConstraintDecoder(&constraint_decoder);
   EXPECT_TRUE(params.HasConstraintDecoder());
   EXPECT_EQ(params.GetConstraintDecoder(), &constraint_decoder);
+
+  EXPECT_EQ(params.GetSpeculativeDecodingMode(),
+            SpeculativeDecodingMode::kDraftModel);
+  params.SetSpeculativeDecodingMode(SpeculativeDecodingMode::kPromptLookup);
+  EXPECT_EQ(params.GetSpeculativeDecodingMode(),
+            SpeculativeDecodingMode::kPromptLookup);
 }
 
 }  // namespace
@@ -22,6 +22,7 @@
 #include "absl/log/absl_check.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 
 namespace litert::lm {
 
@@ -111,6 +112,25 @@ absl::Status ProcessedTokens::RollBackToStep(int new_step) {
   return absl::OkStatus();
 }
 
+absl::Status ProcessedTokens::EraseTokens(int start_step, int num_tokens) {
+  if (start_step < 0 || num_tokens < 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "start_step and num_tokens must be non-negative, got ", start_step,
+        " and ", num_tokens));
+  }
+  if (start_step + num_tokens > GetStep()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "The tokens to erase must be processed, got ", start_step, " + ",
+        num_tokens, " vs ", GetStep()));
+  }
+
+  for (auto& t : tokens_) {
+    t.token_ids.erase(t.token_ids.begin() + start_step,
+                      t.token_ids.begin() + start_step + num_tokens);
+  }
+  return absl::OkStatus();
+}
+
 std::vector<int> ProcessedTokens::GetTokenAtStep(int step) const {
   std::vector<int> token;
   if (step < 0 || step >= TokenCount()) {
@@ -156,6 +176,10 @@ std::vector<std::vector<int>> ProcessedTokens::GetCopyOfTokens() const {
   return copy_of_tokens;
 }
 
+absl::Span<const int> ProcessedTokens::GetProcessedTokenIds(int batch) const {
+  return tokens_[batch].token_ids;
+}
+
 const std::vector<int>& ProcessedTokens::GetTokensUnsafe() const {
   ABSL_CHECK_EQ(tokens_[0].pending_input_token, nullptr);
   return tokens_[0].token_ids;
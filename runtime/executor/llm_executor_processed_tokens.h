@@ -119,6 +119,12 @@ class ProcessedTokens {
   // non-negative and smaller than the current token count.
   absl::Status RollBackToStep(int new_step);
 
+  // Erases `num_tokens` processed tokens starting at `start_step`, so that the
+  // following tokens, inclusive of the pending input token, move back by
+  // `num_tokens` steps. The erased tokens must not include the pending input
+  // token.
+  absl::Status EraseTokens(int start_step, int num_tokens);
+
   // Returns the token at the given `step` or empty if the step does not
   // correspond to a token. It may contains tokens more than one during decode
   // when decode batch size is greater than one.
@@ -132,6 +138,11 @@ class ProcessedTokens {
   // the pending input token, if any.
   std::vector<std::vector<int>> GetCopyOfTokens() const;
 
+  // Returns the processed tokens of the given batch, exclusive of the pending
+  // input token, without copying them. The span is invalidated by any change
+  // of the tokens.
+  absl::Span<const int> GetProcessedTokenIds(int batch) const;
+
   // WARNING: This function returns a reference to the internal `tokens_`
   // directly, which may not include the pending input token. This method MUST
   // NOT be used in code that runs a backend which uses a pending input token.
@@ -25,6 +25,7 @@
 namespace litert::lm {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::status::StatusIs;
 
 TEST(ProcessedTokensTest, TokenEmpty) {
@@ -137,6 +138,34 @@ TEST(ProcessedTokensTest, RollBackToStep_WithPendingInputToken) {
   EXPECT_TRUE(processed_tokens.GetTokenAtStep(1).empty());
 }
 
+TEST(ProcessedTokensTest, EraseTokens) {
+  ProcessedTokens processed_tokens;
+  processed_tokens.AddProcessedTokens({1, 2, 3, 4, 5});
+  EXPECT_OK(
+      processed_tokens.AddPendingInputToken({std::make_shared<TokenData>(6)}));
+
+  EXPECT_OK(processed_tokens.EraseTokens(/*start_step=*/1, /*num_tokens=*/2));
+  EXPECT_EQ(processed_tokens.TokenCount(), 4);
+  auto step_and_token = processed_tokens.GetNextUnprocessedToken();
+  EXPECT_EQ(step_and_token.step, 3);
+  ASSERT_EQ(step_and_token.token.size(), 1);
+  EXPECT_EQ(step_and_token.token[0]->id(), 6);
+  EXPECT_THAT(processed_tokens.GetCopyOfTokens()[0], ElementsAre(1, 4, 5, 6));
+}
+
+TEST(ProcessedTokensTest, EraseTokens_FailsWithPendingInputToken) {
+  ProcessedTokens processed_tokens;
+  processed_tokens.AddProcessedTokens({1, 2, 3});
+  EXPECT_OK(
+      processed_tokens.AddPendingInputToken({std::make_shared<TokenData>(4)}));
+  EXPECT_THAT(processed_tokens.EraseTokens(/*start_step=*/2,
+                                           /*num_tokens=*/2),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(processed_tokens.EraseTokens(/*start_step=*/-1,
+                                           /*num_tokens=*/1),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST(ProcessedTokensTest, MarkPendingInputTokenAsProcessed) {
   ProcessedTokens processed_tokens;
   processed_tokens.AddProcessedTokens({1, 2, 3});
@@ -196,6 +225,15 @@ TEST(ProcessedTokensTest, GetCopyOfTokens_WithPendingInputToken) {
               (std::vector<std::vector<int>>{{1, 2, 3, 4}}));
 }
 
+TEST(ProcessedTokensTest, GetProcessedTokenIds) {
+  ProcessedTokens processed_tokens;
+  processed_tokens.AddProcessedTokens({1, 2, 3});
+  EXPECT_OK(
+      processed_tokens.AddPendingInputToken({std::make_shared<TokenData>(4)}));
+  EXPECT_THAT(processed_tokens.GetProcessedTokenIds(/*batch=*/0),
+              ElementsAre(1, 2, 3));
+}
+
 TEST(ProcessedTokensTest, InvalidPendingInputToken) {
   ProcessedTokens processed_tokens;
   processed_tokens.AddProcessedTokens({1, 2, 3});
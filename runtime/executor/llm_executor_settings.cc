@@ -67,6 +67,24 @@ std::ostream& operator<<(std::ostream& os, const AdvancedSettings& settings) {
      << settings.num_logits_to_print_after_decode << "\n";
   os << "gpu_madvise_original_shared_tensors: "
      << settings.gpu_madvise_original_shared_tensors << "\n";
+  os << "prefix_cache_max_bytes: " << settings.prefix_cache_max_bytes << "\n";
+  os << "embedding_cache_max_bytes: " << settings.embedding_cache_max_bytes
+     << "\n";
+  os << "lora_cache_max_bytes: " << settings.lora_cache_max_bytes << "\n";
+  os << "num_draft_tokens: " << settings.num_draft_tokens << "\n";
+  os << "enable_context_shifting: " << settings.enable_context_shifting
+     << "\n";
+  os << "num_attention_sink_tokens: " << settings.num_attention_sink_tokens
+     << "\n";
+  os << "num_context_shift_tokens: " << settings.num_context_shift_tokens
+     << "\n";
+  os << "context_shift_rope_theta: " << settings.context_shift_rope_theta
+     << "\n";
+  os << "context_shift_layer_rope_thetas: ["
+     << absl::StrJoin(settings.context_shift_layer_rope_thetas, ", ") << "]\n";
+  os << "context_shift_layer_rope_scaling_factors: ["
+     << absl::StrJoin(settings.context_shift_layer_rope_scaling_factors, ", ")
+     << "]\n";
   return os;
 }
 
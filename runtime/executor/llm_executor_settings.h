@@ -140,6 +140,63 @@ struct AdvancedSettings {
   // use.
   bool gpu_madvise_original_shared_tensors = true;
 
+  // The byte budget of the prefix KV cache, which keeps snapshots of the KV
+  // cache of processed prompts so that a later prompt sharing a prefix with
+  // them (e.g. the same system prompt) only prefills the rest. If 0, the
+  // prefix KV cache is disabled.
+  uint64_t prefix_cache_max_bytes = 0;
+
+  // The byte budget of the embedding cache of each embedder model, which keeps
+  // the embeddings of tokens in memory so that looking them up does not run the
+  // embedder model. If the embeddings of the whole vocabulary fit, they are all
+  // computed at initialization. Otherwise, the most recently used ones are
+  // kept. If 0, the embedding cache is disabled.
+  uint64_t embedding_cache_max_bytes = 0;
+
+  // The byte budget of the loaded LoRA weights. The least recently used LoRAs
+  // other than the ones in use are unloaded to fit in it, and loaded again
+  // from their model assets when used. If 0, the loaded LoRAs are never
+  // unloaded.
+  uint64_t lora_cache_max_bytes = 0;
+
+  // The maximum number of draft tokens proposed at each speculative decoding
+  // step, which are verified by the main model in a single pass. Only used if
+  // the main model has a "verify" signature. If 0, the draft model is not
+  // loaded, and prompt lookup decoding proposes as many tokens as the verify
+  // signature takes.
+  int num_draft_tokens = 0;
+
+  // Whether to shift the context instead of stopping when the KV cache is
+  // full, i.e. to evict the oldest tokens after the attention sink tokens from
+  // the KV cache, so that long sessions keep running in constant memory. Only
+  // supported with static KV caches.
+  bool enable_context_shifting = false;
+
+  // The number of tokens at the beginning of the context, i.e. the attention
+  // sinks, which are never evicted by context shifting.
+  int num_attention_sink_tokens = 4;
+
+  // The number of tokens evicted at once by context shifting. If 0, half of
+  // the tokens after the attention sink tokens are evicted.
+  int num_context_shift_tokens = 0;
+
+  // The base of the rotary position embedding frequencies of the model, with
+  // which context shifting moves the kept keys to their new positions. It must
+  // match every layer of the model unless context_shift_layer_rope_thetas is
+  // set, or the kept keys of the other layers end up at wrong positions.
+  float context_shift_rope_theta = 10000.0f;
+
+  // The bases of the rotary position embedding frequencies of each layer,
+  // indexed by the number ending the name of its key cache, for models whose
+  // layers use different bases, e.g. the local and global attention layers of
+  // Gemma3. If empty, every layer uses context_shift_rope_theta.
+  std::vector<float> context_shift_layer_rope_thetas;
+
+  // The linear scaling factors of the rotary positions of each layer, indexed
+  // as above, i.e. a layer rotates position p by the angles of
+  // p / scaling_factor. If empty, no layer scales its positions.
+  std::vector<float> context_shift_layer_rope_scaling_factors;
+
   bool operator==(const AdvancedSettings& other) const {
     return prefill_batch_sizes == other.prefill_batch_sizes &&
            num_output_candidates == other.num_output_candidates &&
@@ -150,7 +207,19 @@ struct AdvancedSettings {
            num_logits_to_print_after_decode ==
                other.num_logits_to_print_after_decode &&
            gpu_madvise_original_shared_tensors ==
-               other.gpu_madvise_original_shared_tensors;
+               other.gpu_madvise_original_shared_tensors &&
+           prefix_cache_max_bytes == other.prefix_cache_max_bytes &&
+           embedding_cache_max_bytes == other.embedding_cache_max_bytes &&
+           lora_cache_max_bytes == other.lora_cache_max_bytes &&
+           num_draft_tokens == other.num_draft_tokens &&
+           enable_context_shifting == other.enable_context_shifting &&
+           num_attention_sink_tokens == other.num_attention_sink_tokens &&
+           num_context_shift_tokens == other.num_context_shift_tokens &&
+           context_shift_rope_theta == other.context_shift_rope_theta &&
+           context_shift_layer_rope_thetas ==
+               other.context_shift_layer_rope_thetas &&
+           context_shift_layer_rope_scaling_factors ==
+               other.context_shift_layer_rope_scaling_factors;
   }
 };
 std::ostream& operator<<(std::ostream& os, const AdvancedSettings& settings);
@@ -223,6 +223,16 @@ TEST(LlmExecutorConfigTest, LlmExecutorSettingsWithAdvancedSettings) {
       .clear_kv_cache_before_prefill = true,
       .num_logits_to_print_after_decode = 10,
       .gpu_madvise_original_shared_tensors = true,
+      .prefix_cache_max_bytes = 1024,
+      .embedding_cache_max_bytes = 2048,
+      .lora_cache_max_bytes = 4096,
+      .num_draft_tokens = 4,
+      .enable_context_shifting = true,
+      .num_attention_sink_tokens = 2,
+      .num_context_shift_tokens = 256,
+      .context_shift_rope_theta = 1000000.0f,
+      .context_shift_layer_rope_thetas = {10000.0f, 1000000.0f},
+      .context_shift_layer_rope_scaling_factors = {1.0f, 8.0f},
   });
 
   std::stringstream oss;
@@ -253,6 +263,16 @@ verify_magic_numbers: 1
 clear_kv_cache_before_prefill: 1
 num_logits_to_print_after_decode: 10
 gpu_madvise_original_shared_tensors: 1
+prefix_cache_max_bytes: 1024
+embedding_cache_max_bytes: 2048
+lora_cache_max_bytes: 4096
+num_draft_tokens: 4
+enable_context_shifting: 1
+num_attention_sink_tokens: 2
+num_context_shift_tokens: 256
+context_shift_rope_theta: 1e+06
+context_shift_layer_rope_thetas: [10000, 1e+06]
+context_shift_layer_rope_scaling_factors: [1, 8]
 
 )";
   EXPECT_EQ(oss.str(), expected_output);
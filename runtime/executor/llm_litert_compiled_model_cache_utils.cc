@@ -14,13 +14,21 @@
 
 #include "runtime/executor/llm_litert_compiled_model_cache_utils.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/strings/match.h"  // from @com_google_absl
+#include "absl/strings/numbers.h"  // from @com_google_absl
+#include "absl/strings/str_cat.h"  // from @com_google_absl
 #include "absl/strings/string_view.h"  // from @com_google_absl
 #include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_element_type.h"  // from @litert
@@ -120,6 +128,108 @@ using ::litert::TensorBuffer;
   return false;
 }
 
+absl::Status ShiftRotaryPositionsOfKeys(
+    absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>*
+        input_kv_cache_buffers,
+    int start_token, int num_tokens, int position_delta,
+    absl::Span<const RopeParams> layer_rope_params) {
+  RET_CHECK(!layer_rope_params.empty());
+  if (start_token < 0 || num_tokens < 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "start_token and num_tokens must be non-negative, got ", start_token,
+        " and ", num_tokens));
+  }
+  if (num_tokens == 0 || position_delta == 0) {
+    return absl::OkStatus();
+  }
+  for (auto& [input_name, input_buffer] : *input_kv_cache_buffers) {
+    constexpr absl::string_view kKeyCacheInfix = "cache_k_";
+    const size_t layer_pos = input_name.rfind(kKeyCacheInfix);
+    if (layer_pos == absl::string_view::npos) {
+      continue;
+    }
+    RopeParams rope = layer_rope_params[0];
+    if (layer_rope_params.size() > 1) {
+      int layer = 0;
+      if (!absl::SimpleAtoi(
+              input_name.substr(layer_pos + kKeyCacheInfix.size()), &layer) ||
+          layer < 0 || layer >= static_cast<int>(layer_rope_params.size())) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "No rotary position embedding parameters for the key cache ",
+            input_name, " among ", layer_rope_params.size(), " layers."));
+      }
+      rope = layer_rope_params[layer];
+    }
+    LITERT_ASSIGN_OR_RETURN(auto type, input_buffer.TensorType());
+    if (type.ElementType() != ::litert::ElementType::Float32) {
+      return absl::UnimplementedError(absl::StrCat(
+          "Only float32 key caches can be rotated, but ", input_name,
+          " is not."));
+    }
+    const auto dims = type.Layout().Dimensions();
+    if (dims.size() != 4 || dims[0] != 1) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The key cache ", input_name,
+          " must be [1, heads, context_size, head_dim]."));
+    }
+    const int num_heads = dims[1];
+    const int context_size = dims[2];
+    const int head_dim = dims[3];
+    if (head_dim % 2 != 0) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The head dimension of ", input_name, " must be even."));
+    }
+    if (start_token + num_tokens > context_size) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The keys to rotate must be in the KV cache, got ", start_token,
+          " + ", num_tokens, " vs ", context_size));
+    }
+
+    // The rotation by position_delta is the same for every key of the layer.
+    const int half_dim = head_dim / 2;
+    const double scaled_delta =
+        static_cast<double>(position_delta) / rope.scaling_factor;
+    std::vector<float> cos_delta(half_dim);
+    std::vector<float> sin_delta(half_dim);
+    for (int i = 0; i < half_dim; ++i) {
+      const double angle =
+          scaled_delta * std::pow(static_cast<double>(rope.theta),
+                                  -2.0 * i / head_dim);
+      cos_delta[i] = std::cos(angle);
+      sin_delta[i] = std::sin(angle);
+    }
+
+    LITERT_ASSIGN_OR_RETURN(
+        auto lock_and_addr,
+        ::litert::TensorBufferScopedLock::Create(
+            input_buffer, TensorBuffer::LockMode::kReadWrite));
+    auto* keys = static_cast<float*>(lock_and_addr.second);
+    for (int h = 0; h < num_heads; ++h) {
+      for (int t = start_token; t < start_token + num_tokens; ++t) {
+        float* key = keys + (static_cast<size_t>(h) * context_size + t) *
+                                head_dim;
+        for (int i = 0; i < half_dim; ++i) {
+          const float x1 = key[i];
+          const float x2 = key[i + half_dim];
+          key[i] = x1 * cos_delta[i] - x2 * sin_delta[i];
+          key[i + half_dim] = x2 * cos_delta[i] + x1 * sin_delta[i];
+        }
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ShiftRotaryPositionsOfKeys(
+    absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>*
+        input_kv_cache_buffers,
+    int start_token, int num_tokens, int position_delta, float rope_theta) {
+  const RopeParams rope = {.theta = rope_theta};
+  return ShiftRotaryPositionsOfKeys(input_kv_cache_buffers, start_token,
+                                    num_tokens, position_delta,
+                                    absl::MakeConstSpan(&rope, 1));
+}
+
 absl::Status ExpandBuffer(const uint8_t* src_data,
                           absl::Span<const int> src_shape, uint8_t* dst_data,
                           absl::Span<const int> dst_shape,
@@ -187,4 +297,59 @@ absl::Status ExpandBuffer(const uint8_t* src_data,
   return absl::OkStatus();
 };
 
+int GetKvCacheCapacity(int num_entries, int page_size) {
+  if (num_entries <= 0) {
+    return page_size;
+  }
+  int64_t num_pages = (num_entries + page_size - 1) / page_size;
+  // Round the number of pages up to a multiple of a quarter of its highest
+  // power of two, e.g. 5, 6, 7, 8, 10, 12, 14, 16, 20 pages.
+  int highest_bit = 0;
+  while ((num_pages >> (highest_bit + 1)) > 0) {
+    ++highest_bit;
+  }
+  const int64_t granularity = int64_t{1} << std::max(0, highest_bit - 2);
+  num_pages = (num_pages + granularity - 1) / granularity * granularity;
+  return num_pages * page_size;
+}
+
+std::optional<TensorBuffer> KvCacheBufferPool::Acquire(absl::string_view name,
+                                                       int kv_length) {
+  for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+    if (it->kv_length == kv_length && it->name == name) {
+      TensorBuffer buffer = std::move(it->buffer);
+      size_bytes_ -= it->num_bytes;
+      buffers_.erase(it);
+      return buffer;
+    }
+  }
+  return std::nullopt;
+}
+
+absl::Status KvCacheBufferPool::Release(absl::string_view name, int kv_length,
+                                        TensorBuffer buffer) {
+  LITERT_ASSIGN_OR_RETURN(size_t num_bytes, buffer.PackedSize());
+  if (num_bytes > max_bytes_) {
+    // Free the buffer right away.
+    return absl::OkStatus();
+  }
+  buffers_.push_front(
+      {std::string(name), kv_length, std::move(buffer), num_bytes});
+  size_bytes_ += num_bytes;
+  Evict();
+  return absl::OkStatus();
+}
+
+void KvCacheBufferPool::SetMaxBytes(size_t max_bytes) {
+  max_bytes_ = max_bytes;
+  Evict();
+}
+
+void KvCacheBufferPool::Evict() {
+  while (size_bytes_ > max_bytes_) {
+    size_bytes_ -= buffers_.back().num_bytes;
+    buffers_.pop_back();
+  }
+}
+
 }  // namespace litert::lm
@@ -17,6 +17,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
 
 #include "absl/container/flat_hash_map.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
@@ -72,6 +75,45 @@ namespace litert::lm {
     int num_tokens_to_drop, int init_tokens_to_retain, int current_step,
     int& start_position, size_t context_size);
 
+// The rotary position embedding (RoPE) of the keys of a layer.
+struct RopeParams {
+  // The base of the rotary position embedding frequencies.
+  float theta = 10000.0f;
+  // The linear scaling factor of the positions, i.e. position p is rotated by
+  // the angles of p / scaling_factor.
+  float scaling_factor = 1.0f;
+};
+
+// Function to move the keys in the KV cache to other positions by re-applying
+// the rotary position embedding (RoPE) to them, e.g. after tokens before them
+// were deleted from the KV cache. The keys are assumed to be rotated in
+// half-split pairs (i, i + head_dim / 2) with frequencies
+// theta^(-2i / head_dim), as in Gemma and Llama models.
+// Args:
+//   input_kv_cache_buffers: The input KV cache buffers. Only the float32 key
+//   caches of shape [1, heads, context_size, head_dim] are changed.
+//   start_token: The first KV cache slot of the keys to move.
+//   num_tokens: The number of KV cache slots of the keys to move.
+//   position_delta: The number of positions to move the keys by, negative to
+//   move them back.
+//   layer_rope_params: The rotary position embedding of each layer, indexed
+//   by the number ending the name of its key cache, e.g. 3 for "kv_cache_k_3".
+//   A single entry applies to every layer.
+// Returns:
+//   Status of the rotation.
+absl::Status ShiftRotaryPositionsOfKeys(
+    absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>*
+        input_kv_cache_buffers,
+    int start_token, int num_tokens, int position_delta,
+    absl::Span<const RopeParams> layer_rope_params);
+
+// Same as above for models whose layers all use the same rotary position
+// embedding base and no position scaling.
+absl::Status ShiftRotaryPositionsOfKeys(
+    absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>*
+        input_kv_cache_buffers,
+    int start_token, int num_tokens, int position_delta, float rope_theta);
+
 // Function to expand the buffer from src_data to dst_data. This function can
 // only handle a single expansion axis. Args:
 //   src_data: The source data.
@@ -85,5 +127,62 @@ absl::Status ExpandBuffer(const uint8_t* src_data,
                           absl::Span<const int> src_shape, uint8_t* dst_data,
                           absl::Span<const int> dst_shape, size_t element_size);
 
+// Function to get the KV cache length to allocate for a dynamic KV cache.
+// The length is a multiple of `page_size` entries, rounded up to one of the
+// four size classes per power of two. Growing the KV cache one entry at a
+// time thus reallocates it O(log n) times and copies O(n) bytes in total,
+// while over-allocating at most 25% of the entries.
+// Args:
+//   num_entries: The number of entries the KV cache must hold.
+//   page_size: The allocation granularity in entries.
+// Returns:
+//   The KV cache length, which is at least `num_entries`.
+int GetKvCacheCapacity(int num_entries, int page_size);
+
+// A pool of released KV cache buffers keyed by the KV cache tensor name and
+// the length of the KV cache, so that the dynamic KV cache buffers of the
+// same length can be reused instead of being allocated again. The total size
+// of the pooled buffers is bounded by a byte budget, and the least recently
+// released buffers are freed first.
+//
+// This class is not thread-safe.
+class KvCacheBufferPool {
+ public:
+  explicit KvCacheBufferPool(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+  // Removes and returns a pooled buffer of the tensor with the given KV cache
+  // length, if any.
+  std::optional<::litert::TensorBuffer> Acquire(absl::string_view name,
+                                                int kv_length);
+
+  // Adds the buffer of the tensor with the given KV cache length to the pool.
+  // Frees the least recently released buffers to fit in the byte budget.
+  absl::Status Release(absl::string_view name, int kv_length,
+                       ::litert::TensorBuffer buffer);
+
+  // Updates the byte budget, freeing buffers if needed.
+  void SetMaxBytes(size_t max_bytes);
+
+  size_t max_bytes() const { return max_bytes_; }
+  size_t size_bytes() const { return size_bytes_; }
+  int num_buffers() const { return buffers_.size(); }
+
+ private:
+  struct PooledBuffer {
+    std::string name;
+    int kv_length;
+    ::litert::TensorBuffer buffer;
+    size_t num_bytes;
+  };
+
+  // Frees the least recently released buffers to fit in the byte budget.
+  void Evict();
+
+  size_t max_bytes_;
+  size_t size_bytes_ = 0;
+  // The pooled buffers, the most recently released first.
+  std::list<PooledBuffer> buffers_;
+};
+
 }  // namespace litert::lm
 #endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_LLM_LITERT_COMPILED_MODEL_CACHE_UTILS_H_
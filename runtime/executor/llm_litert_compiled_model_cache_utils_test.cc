@@ -14,6 +14,7 @@
 
 #include "runtime/executor/llm_litert_compiled_model_cache_utils.h"
 
+#include <cmath>
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -124,6 +125,126 @@ TEST(LlmLiteRtCompiledModelCacheUtilsTest, DeleteTokensIfNeededTest_Success) {
                                          0.0f, 0.0f, 0.0f, 0.0f}));
 }
 
+// Returns the key `key` rotated to `position` in half-split pairs.
+std::vector<float> ApplyRope(const std::vector<float>& key, double position,
+                             float rope_theta) {
+  const int half_dim = key.size() / 2;
+  std::vector<float> rotated(key.size());
+  for (int i = 0; i < half_dim; ++i) {
+    const double angle =
+        position * std::pow(static_cast<double>(rope_theta),
+                            -2.0 * i / key.size());
+    rotated[i] = key[i] * std::cos(angle) - key[i + half_dim] * std::sin(angle);
+    rotated[i + half_dim] =
+        key[i + half_dim] * std::cos(angle) + key[i] * std::sin(angle);
+  }
+  return rotated;
+}
+
+TEST(LlmLiteRtCompiledModelCacheUtilsTest, ShiftRotaryPositionsOfKeys) {
+  constexpr float kRopeTheta = 10000.0f;
+  const std::vector<std::vector<float>> keys = {
+      {1, 2, 3, 4}, {-1, 0.5, 2, 1}, {0.25, -3, 1, 2}};
+  // The keys are in slots 0 to 2 at positions 0, 7 and 8, i.e. as if the
+  // tokens at positions 1 to 6 were deleted from the KV cache.
+  const std::vector<int> positions = {0, 7, 8};
+  std::vector<float> data;
+  for (int t = 0; t < keys.size(); ++t) {
+    auto rotated = ApplyRope(keys[t], positions[t], kRopeTheta);
+    data.insert(data.end(), rotated.begin(), rotated.end());
+  }
+  LITERT_ASSERT_OK_AND_ASSIGN(auto key_buffer,
+                              CopyToTensorBuffer<float>(data, {1, 1, 3, 4}));
+  LITERT_ASSERT_OK_AND_ASSIGN(auto value_buffer,
+                              CopyToTensorBuffer<float>(data, {1, 1, 4, 3}));
+  absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>
+      input_kv_cache_buffers;
+  input_kv_cache_buffers.try_emplace("cache_k_0", std::move(key_buffer));
+  input_kv_cache_buffers.try_emplace("cache_v_0", std::move(value_buffer));
+
+  EXPECT_OK(ShiftRotaryPositionsOfKeys(&input_kv_cache_buffers,
+                                       /*start_token=*/1, /*num_tokens=*/2,
+                                       /*position_delta=*/-6, kRopeTheta));
+
+  // The keys match the keys computed at their slots, and the values are
+  // unchanged.
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto shifted_keys,
+      CopyFromTensorBuffer<float>(input_kv_cache_buffers.at("cache_k_0")));
+  for (int t = 0; t < keys.size(); ++t) {
+    auto expected = ApplyRope(keys[t], t, kRopeTheta);
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_NEAR(shifted_keys[t * 4 + i], expected[i], 1e-5)
+          << "slot " << t << " dim " << i;
+    }
+  }
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto values,
+      CopyFromTensorBuffer<float>(input_kv_cache_buffers.at("cache_v_0")));
+  EXPECT_EQ(values, data);
+
+  EXPECT_THAT(ShiftRotaryPositionsOfKeys(&input_kv_cache_buffers,
+                                         /*start_token=*/2, /*num_tokens=*/2,
+                                         /*position_delta=*/-1, kRopeTheta),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(LlmLiteRtCompiledModelCacheUtilsTest,
+     ShiftRotaryPositionsOfKeysWithPerLayerRope) {
+  // A local layer with the default base and a global layer with a larger base
+  // and linearly scaled positions, as in Gemma3.
+  const std::vector<RopeParams> layer_rope_params = {
+      {.theta = 10000.0f}, {.theta = 1000000.0f, .scaling_factor = 8.0f}};
+  const std::vector<std::vector<float>> keys = {
+      {1, 2, 3, 4}, {-1, 0.5, 2, 1}, {0.25, -3, 1, 2}};
+  const std::vector<int> positions = {0, 7, 8};
+  std::vector<std::vector<float>> layer_data(layer_rope_params.size());
+  absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>
+      input_kv_cache_buffers;
+  const std::vector<std::string> names = {"kv_cache_k_0", "kv_cache_k_1"};
+  for (int l = 0; l < layer_rope_params.size(); ++l) {
+    for (int t = 0; t < keys.size(); ++t) {
+      auto rotated =
+          ApplyRope(keys[t], positions[t] / layer_rope_params[l].scaling_factor,
+                    layer_rope_params[l].theta);
+      layer_data[l].insert(layer_data[l].end(), rotated.begin(),
+                           rotated.end());
+    }
+    LITERT_ASSERT_OK_AND_ASSIGN(
+        auto key_buffer,
+        CopyToTensorBuffer<float>(layer_data[l], {1, 1, 3, 4}));
+    input_kv_cache_buffers.try_emplace(names[l], std::move(key_buffer));
+  }
+
+  EXPECT_OK(ShiftRotaryPositionsOfKeys(
+      &input_kv_cache_buffers, /*start_token=*/1, /*num_tokens=*/2,
+      /*position_delta=*/-6, layer_rope_params));
+
+  for (int l = 0; l < layer_rope_params.size(); ++l) {
+    LITERT_ASSERT_OK_AND_ASSIGN(
+        auto shifted_keys,
+        CopyFromTensorBuffer<float>(input_kv_cache_buffers.at(names[l])));
+    for (int t = 0; t < keys.size(); ++t) {
+      auto expected =
+          ApplyRope(keys[t], t / layer_rope_params[l].scaling_factor,
+                    layer_rope_params[l].theta);
+      for (int i = 0; i < expected.size(); ++i) {
+        EXPECT_NEAR(shifted_keys[t * 4 + i], expected[i], 1e-5)
+            << "layer " << l << " slot " << t << " dim " << i;
+      }
+    }
+  }
+
+  // The key cache of a third layer has no parameters.
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto key_buffer, CopyToTensorBuffer<float>(layer_data[0], {1, 1, 3, 4}));
+  input_kv_cache_buffers.try_emplace("kv_cache_k_2", std::move(key_buffer));
+  EXPECT_THAT(ShiftRotaryPositionsOfKeys(
+                  &input_kv_cache_buffers, /*start_token=*/1, /*num_tokens=*/2,
+                  /*position_delta=*/-1, layer_rope_params),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST(LlmLiteRtCompiledModelCacheUtilsTest, ExpandBufferMiddleDim) {
   std::vector<float> src_data = {1, 2, 3, 4, 5, 6, 7, 8};
   std::vector<int> src_shape = {2, 2, 2};
@@ -210,5 +331,74 @@ TEST(LlmLiteRtCompiledModelCacheUtilsTest, ExpandBufferNoExpansionAxis) {
       StatusIs(absl::StatusCode::kInvalidArgument, "No expansion axis found."));
 }
 
+TEST(LlmLiteRtCompiledModelCacheUtilsTest, GetKvCacheCapacity) {
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/0, /*page_size=*/16), 16);
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/1, /*page_size=*/16), 16);
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/16, /*page_size=*/16), 16);
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/17, /*page_size=*/16), 32);
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/65, /*page_size=*/16), 80);
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/129, /*page_size=*/16), 160);
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/1000, /*page_size=*/16), 1024);
+  EXPECT_EQ(GetKvCacheCapacity(/*num_entries=*/1025, /*page_size=*/16), 1280);
+}
+
+TEST(LlmLiteRtCompiledModelCacheUtilsTest, GetKvCacheCapacityBoundsGrowth) {
+  // Growing one entry at a time reallocates O(log n) times and over-allocates
+  // at most 25%.
+  int capacity = 0;
+  int num_reallocations = 0;
+  for (int num_entries = 1; num_entries <= 100000; ++num_entries) {
+    if (num_entries > capacity) {
+      capacity = GetKvCacheCapacity(num_entries, /*page_size=*/16);
+      ++num_reallocations;
+    }
+    EXPECT_GE(capacity, num_entries);
+    if (num_entries > 64) {
+      EXPECT_LE(capacity, num_entries * 5 / 4 + 16);
+    }
+  }
+  EXPECT_LT(num_reallocations, 60);
+}
+
+TEST(LlmLiteRtCompiledModelCacheUtilsTest, KvCacheBufferPoolAcquireRelease) {
+  KvCacheBufferPool pool(/*max_bytes=*/1024);
+  EXPECT_FALSE(pool.Acquire("cache_k_0", /*kv_length=*/16).has_value());
+
+  std::vector<float> data(16, 1.0f);
+  LITERT_ASSERT_OK_AND_ASSIGN(auto buffer,
+                              CopyToTensorBuffer<float>(data, {1, 1, 16, 1}));
+  EXPECT_OK(pool.Release("cache_k_0", /*kv_length=*/16, std::move(buffer)));
+  EXPECT_EQ(pool.num_buffers(), 1);
+  EXPECT_EQ(pool.size_bytes(), 16 * sizeof(float));
+
+  // Only the buffer of the same tensor and length is reused.
+  EXPECT_FALSE(pool.Acquire("cache_v_0", /*kv_length=*/16).has_value());
+  EXPECT_FALSE(pool.Acquire("cache_k_0", /*kv_length=*/32).has_value());
+  auto acquired = pool.Acquire("cache_k_0", /*kv_length=*/16);
+  ASSERT_TRUE(acquired.has_value());
+  LITERT_ASSERT_OK_AND_ASSIGN(auto acquired_data,
+                              CopyFromTensorBuffer<float>(*acquired));
+  EXPECT_THAT(acquired_data, testing::ElementsAreArray(data));
+  EXPECT_EQ(pool.num_buffers(), 0);
+  EXPECT_EQ(pool.size_bytes(), 0);
+}
+
+TEST(LlmLiteRtCompiledModelCacheUtilsTest, KvCacheBufferPoolEvictsOldest) {
+  KvCacheBufferPool pool(/*max_bytes=*/2 * 16 * sizeof(float));
+  std::vector<float> data(16, 1.0f);
+  for (int kv_length : {16, 32, 48}) {
+    LITERT_ASSERT_OK_AND_ASSIGN(auto buffer,
+                                CopyToTensorBuffer<float>(data, {1, 16}));
+    EXPECT_OK(pool.Release("cache_k_0", kv_length, std::move(buffer)));
+  }
+  EXPECT_EQ(pool.num_buffers(), 2);
+  EXPECT_FALSE(pool.Acquire("cache_k_0", /*kv_length=*/16).has_value());
+  EXPECT_TRUE(pool.Acquire("cache_k_0", /*kv_length=*/48).has_value());
+
+  pool.SetMaxBytes(0);
+  EXPECT_EQ(pool.num_buffers(), 0);
+  EXPECT_FALSE(pool.Acquire("cache_k_0", /*kv_length=*/32).has_value());
+}
+
 }  // namespace
 }  // namespace litert::lm
@@ -18,12 +18,14 @@
 #include <cstdint>
 #include <cstring>
 #include <memory>
+#include <numeric>
 #include <optional>
 #include <string>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "absl/cleanup/cleanup.h"  // from @com_google_absl
 #include "absl/container/flat_hash_map.h"  // from @com_google_absl
 #include "absl/log/absl_log.h"  // from @com_google_absl
 #include "absl/memory/memory.h"  // from @com_google_absl
@@ -49,15 +51,20 @@
 #include "litert/cc/options/litert_cpu_options.h"  // from @litert
 #include "litert/cc/options/litert_gpu_options.h"  // from @litert
 #include "litert/cc/options/litert_runtime_options.h"  // from @litert
+#include "runtime/components/embedding_lookup/embedding_cache.h"
 #include "runtime/components/embedding_lookup/embedding_lookup_manager.h"
+#include "runtime/components/lora.h"
+#include "runtime/components/lora_manager.h"
 #include "runtime/components/model_resources.h"
 #include "runtime/components/sampler_factory.h"
 #include "runtime/executor/executor_settings_base.h"
+#include "runtime/executor/kv_cache_prefix_cache.h"
 #include "runtime/executor/litert_compiled_model_executor_utils.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/llm_executor_processed_tokens.h"
 #include "runtime/executor/llm_executor_settings.h"
 #include "runtime/executor/llm_litert_compiled_model_cache_utils.h"
+#include "runtime/executor/speculative_decoding_util.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/file_util.h"
 #include "runtime/util/lora_util.h"
@@ -77,13 +84,23 @@ using ::litert::TensorBuffer;
 // interpreter.
 constexpr absl::string_view kPrefillSignatureRunner = "prefill";
 constexpr absl::string_view kDecodeSignatureRunner = "decode";
+// The signature of the main model which runs a draft of tokens at once and
+// outputs their logits, for speculative decoding.
+constexpr absl::string_view kVerifySignatureRunner = "verify";
+// The n-gram sizes looked up by prompt lookup decoding. Unigrams are not
+// looked up, since their continuation is rarely accepted.
+constexpr int kPromptLookupMinNgramSize = 2;
+constexpr int kPromptLookupMaxNgramSize = 3;
 constexpr int kDynamicDimValue = -1;
 
 bool IsCalculationPrecisionF16() { return true; }
 
+// Creates the embedding lookups of the embedder models in `resources`, if any.
+// `vocab_size` is the number of token ids of the embedder models, or 0 if it
+// is unknown.
 absl::Status InitializeEmbeddingLookups(
-    ModelResources& resources,
-    std::unique_ptr<EmbeddingLookupManager>& embedding_lookup,
+    ModelResources& resources, const LlmExecutorSettings& executor_settings,
+    int vocab_size, std::unique_ptr<EmbeddingLookupManager>& embedding_lookup,
     std::unique_ptr<EmbeddingLookupManager>& per_layer_embedding_lookup) {
   auto end_of_audio_model =
       resources.GetTFLiteModel(ModelType::kTfLiteEndOfAudio);
@@ -94,13 +111,22 @@ absl::Status InitializeEmbeddingLookups(
         {ExecutorAudioData::kEndToken, end_of_audio_model.value()});
   }
 
+  EmbeddingCacheOptions cache_options;
+  const auto& advanced_settings = executor_settings.GetAdvancedSettings();
+  if (advanced_settings) {
+    cache_options.max_bytes = advanced_settings->embedding_cache_max_bytes;
+  }
+  cache_options.vocab_size = vocab_size;
+
   auto text_embedder_model =
       resources.GetTFLiteModel(ModelType::kTfLiteEmbedder);
   if (text_embedder_model.ok()) {
-    ASSIGN_OR_RETURN(
-        embedding_lookup,
-        EmbeddingLookupManager::Create(*text_embedder_model,
-                                       end_of_multi_modal_embedding_models));
+    ASSIGN_OR_RETURN(embedding_lookup,
+                     EmbeddingLookupManager::Create(
+                         *text_embedder_model,
+                         end_of_multi_modal_embedding_models,
+                         /*fully_supports_multi_modal=*/true,
+                         /*signature_key=*/std::nullopt, cache_options));
   }
 
   // Create per layer embedding lookups from the resources.
@@ -110,7 +136,9 @@ absl::Status InitializeEmbeddingLookups(
     ASSIGN_OR_RETURN(
         per_layer_embedding_lookup,
         EmbeddingLookupManager::Create(*per_layer_embedder_model,
-                                       /*fully_supports_multi_modal=*/false));
+                                       /*fully_supports_multi_modal=*/false,
+                                       /*signature_key=*/std::nullopt,
+                                       cache_options));
   }
   return absl::OkStatus();
 }
@@ -289,22 +317,18 @@ absl::Status ResolveDynamicShape(const Model& model,
   return absl::OkStatus();
 }
 
-absl::StatusOr<TensorBuffer> ResizeKVCacheTensorBuffer(
-    Environment& env, TensorBuffer& tensor_buffer, int dynamic_dim_index,
-    int num_entries_to_insert) {
+// Creates a KV cache buffer of the same type as `tensor_buffer` except for the
+// dynamic dimension, which is set to `kv_length`.
+absl::StatusOr<TensorBuffer> CreateKVCacheTensorBuffer(
+    Environment& env, const TensorBuffer& tensor_buffer, int dynamic_dim_index,
+    int kv_length) {
   LITERT_ASSIGN_OR_RETURN(const RankedTensorType& tensor_type,
                           tensor_buffer.TensorType());
   RET_CHECK(!tensor_type.Layout().HasStrides());
   auto dimensions = tensor_type.Layout().Dimensions();
-  std::vector<int> new_dimensions;
-  new_dimensions.reserve(dimensions.size());
-  for (int i = 0; i < dimensions.size(); ++i) {
-    if (i == dynamic_dim_index) {
-      new_dimensions.push_back(dimensions[i] + num_entries_to_insert);
-    } else {
-      new_dimensions.push_back(dimensions[i]);
-    }
-  }
+  std::vector<int> new_dimensions(dimensions.begin(), dimensions.end());
+  RET_CHECK_LT(dynamic_dim_index, new_dimensions.size());
+  new_dimensions[dynamic_dim_index] = kv_length;
 
   LITERT_ASSIGN_OR_RETURN(litert::TensorBufferType buffer_type,
                           tensor_buffer.BufferTypeCC());
@@ -312,30 +336,33 @@ absl::StatusOr<TensorBuffer> ResizeKVCacheTensorBuffer(
   auto new_out_type =
       RankedTensorType(tensor_type.ElementType(), std::move(new_layout));
   LITERT_ASSIGN_OR_RETURN(size_t new_size, new_out_type.Bytes());
-
   LITERT_ASSIGN_OR_RETURN(
       TensorBuffer new_tensor_buffer,
       TensorBuffer::CreateManaged(env, buffer_type, new_out_type, new_size));
+  return new_tensor_buffer;
+}
 
-  LITERT_ASSIGN_OR_RETURN(auto tensor_buffer_lock_and_addr,
-                          TensorBufferScopedLock::Create(
-                              tensor_buffer, TensorBuffer::LockMode::kRead));
-  auto* tensor_buffer_ptr =
-      static_cast<uint8_t*>(tensor_buffer_lock_and_addr.second);
-  LITERT_ASSIGN_OR_RETURN(
-      auto new_tensor_buffer_lock_and_addr,
-      TensorBufferScopedLock::Create(new_tensor_buffer,
-                                     TensorBuffer::LockMode::kWrite));
-  auto* new_tensor_buffer_ptr =
-      static_cast<uint8_t*>(new_tensor_buffer_lock_and_addr.second);
-  std::optional<size_t> element_size = GetByteWidth(tensor_type.ElementType());
+// Copies the entries of the KV cache buffer `from` into the longer KV cache
+// buffer `to`. The entries past the length of `from` are zeroed.
+absl::Status ExpandKVCacheTensorBuffer(const TensorBuffer& from,
+                                       TensorBuffer& to) {
+  LITERT_ASSIGN_OR_RETURN(const RankedTensorType& from_type, from.TensorType());
+  LITERT_ASSIGN_OR_RETURN(const RankedTensorType& to_type, to.TensorType());
+  auto from_dimensions = from_type.Layout().Dimensions();
+  auto to_dimensions = to_type.Layout().Dimensions();
+  std::optional<size_t> element_size = GetByteWidth(from_type.ElementType());
   RET_CHECK(element_size.has_value());
 
-  RETURN_IF_ERROR(ExpandBuffer(tensor_buffer_ptr, dimensions,
-                               new_tensor_buffer_ptr, new_dimensions,
-                               element_size.value()));
-
-  return new_tensor_buffer;
+  LITERT_ASSIGN_OR_RETURN(
+      auto from_lock_and_addr,
+      TensorBufferScopedLock::Create(from, TensorBuffer::LockMode::kRead));
+  LITERT_ASSIGN_OR_RETURN(
+      auto to_lock_and_addr,
+      TensorBufferScopedLock::Create(to, TensorBuffer::LockMode::kWrite));
+  return ExpandBuffer(static_cast<const uint8_t*>(from_lock_and_addr.second),
+                      from_dimensions,
+                      static_cast<uint8_t*>(to_lock_and_addr.second),
+                      to_dimensions, element_size.value());
 }
 
 absl::Status CopyBuffer(const TensorBuffer& buffers_from,
@@ -356,6 +383,113 @@ absl::Status CopyBuffer(const TensorBuffer& buffers_from,
   return absl::OkStatus();
 }
 
+// Creates a new buffer of the same type as the given buffer and copies the
+// contents into it.
+absl::StatusOr<TensorBuffer> CloneTensorBuffer(Environment& env,
+                                               const TensorBuffer& buffer) {
+  LITERT_ASSIGN_OR_RETURN(litert::TensorBufferType buffer_type,
+                          buffer.BufferTypeCC());
+  LITERT_ASSIGN_OR_RETURN(auto tensor_type, buffer.TensorType());
+  LITERT_ASSIGN_OR_RETURN(size_t buffer_size, buffer.PackedSize());
+  LITERT_ASSIGN_OR_RETURN(
+      TensorBuffer new_buffer,
+      TensorBuffer::CreateManaged(env, buffer_type, tensor_type, buffer_size));
+  RETURN_IF_ERROR(CopyBuffer(buffer, new_buffer));
+  return new_buffer;
+}
+
+// Where the entries of the tokens are in a KV cache buffer: `num_rows` rows of
+// `context_size` token entries of `token_bytes` bytes each. A key cache of
+// [1, heads, context_size, head_dim] has a row per head, and a value cache of
+// [1, heads, head_dim, context_size] a row per head and dimension.
+struct KvCacheLayout {
+  size_t num_rows;
+  size_t context_size;
+  size_t token_bytes;
+};
+
+absl::StatusOr<KvCacheLayout> GetKvCacheLayout(absl::string_view name,
+                                               const TensorBuffer& buffer) {
+  LITERT_ASSIGN_OR_RETURN(auto buffer_size, buffer.PackedSize());
+  LITERT_ASSIGN_OR_RETURN(auto type, buffer.TensorType());
+  const auto dims = type.Layout().Dimensions();
+  const int axis = absl::StrContains(name, "cache_k_")   ? 2
+                   : absl::StrContains(name, "cache_v_") ? 3
+                                                         : -1;
+  if (axis == -1 || dims.size() != 4) {
+    // Unknown layouts are copied as a whole.
+    return KvCacheLayout{.num_rows = 1, .context_size = 1,
+                         .token_bytes = buffer_size};
+  }
+  size_t num_rows = 1;
+  for (int i = 0; i < axis; ++i) {
+    num_rows *= dims[i];
+  }
+  const size_t context_size = dims[axis];
+  RET_CHECK_GT(num_rows * context_size, 0);
+  RET_CHECK_EQ(buffer_size % (num_rows * context_size), 0);
+  return KvCacheLayout{
+      .num_rows = num_rows,
+      .context_size = context_size,
+      .token_bytes = buffer_size / (num_rows * context_size)};
+}
+
+// Copies the entries of the first `num_tokens` tokens of the KV cache buffers
+// to the host memory. The entries of the later positions are not needed, since
+// the attention mask hides them until they are overwritten.
+absl::StatusOr<KvCachePrefixCache::Snapshot> CreateKvCacheSnapshot(
+    const absl::flat_hash_map<absl::string_view, TensorBuffer>&
+        kv_cache_buffers,
+    int num_tokens) {
+  KvCachePrefixCache::Snapshot snapshot;
+  for (const auto& [name, buffer] : kv_cache_buffers) {
+    ASSIGN_OR_RETURN(KvCacheLayout layout, GetKvCacheLayout(name, buffer));
+    const size_t num_slice_tokens =
+        std::min<size_t>(num_tokens, layout.context_size);
+    const size_t slice_bytes = num_slice_tokens * layout.token_bytes;
+    const size_t row_bytes = layout.context_size * layout.token_bytes;
+    LITERT_ASSIGN_OR_RETURN(auto read_lock,
+                            ::litert::TensorBufferScopedLock::Create(
+                                buffer, TensorBuffer::LockMode::kRead));
+    const auto* data = static_cast<const uint8_t*>(read_lock.second);
+    std::vector<uint8_t>& slice = snapshot[name];
+    slice.resize(layout.num_rows * slice_bytes);
+    for (size_t row = 0; row < layout.num_rows; ++row) {
+      memcpy(slice.data() + row * slice_bytes, data + row * row_bytes,
+             slice_bytes);
+    }
+  }
+  return snapshot;
+}
+
+// Copies the contents of a snapshot created by CreateKvCacheSnapshot() back to
+// the first token entries of the KV cache buffers.
+absl::Status RestoreKvCacheSnapshot(
+    const KvCachePrefixCache::Snapshot& snapshot,
+    absl::flat_hash_map<absl::string_view, TensorBuffer>& kv_cache_buffers) {
+  RET_CHECK_EQ(snapshot.size(), kv_cache_buffers.size());
+  for (auto& [name, buffer] : kv_cache_buffers) {
+    auto it = snapshot.find(name);
+    RET_CHECK(it != snapshot.end()) << "No snapshot of " << name;
+    ASSIGN_OR_RETURN(KvCacheLayout layout, GetKvCacheLayout(name, buffer));
+    const std::vector<uint8_t>& slice = it->second;
+    RET_CHECK_EQ(slice.size() % layout.num_rows, 0);
+    const size_t slice_bytes = slice.size() / layout.num_rows;
+    const size_t row_bytes = layout.context_size * layout.token_bytes;
+    RET_CHECK_EQ(slice_bytes % layout.token_bytes, 0);
+    RET_CHECK_LE(slice_bytes, row_bytes);
+    LITERT_ASSIGN_OR_RETURN(auto write_lock,
+                            ::litert::TensorBufferScopedLock::Create(
+                                buffer, TensorBuffer::LockMode::kReadWrite));
+    auto* data = static_cast<uint8_t*>(write_lock.second);
+    for (size_t row = 0; row < layout.num_rows; ++row) {
+      memcpy(data + row * row_bytes, slice.data() + row * slice_bytes,
+             slice_bytes);
+    }
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 absl::Status LlmLiteRtCompiledModelExecutorBase::CreatePrefillInputBuffers(
@@ -475,6 +609,7 @@ absl::Status LlmLiteRtCompiledModelExecutorBase::PrefillInternal(
     absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>&
         prefill_input_buffers,
     Span<const int> ids) {
+  RETURN_IF_ERROR(ShiftContextIfNeeded(/*num_tokens=*/ids.size() - 1));
 
   {
     // Fill the input buffers with scoped locks.
@@ -619,11 +754,16 @@ absl::Status LlmLiteRtCompiledModelExecutorBase::PrefillInternal(
     current_step_++;
   }
 
+  RETURN_IF_ERROR(BindLoRA(lora_id_));
   absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer> input_buffers;
   for (const auto& [input_name, input_buffer] : prefill_input_buffers) {
     LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
     input_buffers[input_name] = std::move(input_buffer_dup);
   }
+  for (const auto& [input_name, input_buffer] : lora_input_buffers_) {
+    LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
+    input_buffers[input_name] = std::move(input_buffer_dup);
+  }
   for (const auto& [input_name, input_buffer] : *input_kv_cache_buffers_) {
     LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
     input_buffers[input_name] = std::move(input_buffer_dup);
@@ -683,6 +823,7 @@ LlmLiteRtCompiledModelExecutorBase::GetTokenToDecode(
       }
     }
   }
+  RETURN_IF_ERROR(ShiftContextIfNeeded(/*num_tokens=*/0));
   return processed_tokens_.GetNextUnprocessedToken();
 }
 
@@ -705,6 +846,51 @@ LlmLiteRtCompiledModelExecutorBase::ConsumePendingOrAddProcessedToken(
   return absl::OkStatus();
 }
 
+absl::Status LlmLiteRtCompiledModelExecutorBase::ShiftContextIfNeeded(
+    int num_tokens) {
+  const int num_overflow_tokens = processed_tokens_.TokenCount() + num_tokens -
+                                  context_shift_kv_cache_length_;
+  if (context_shift_kv_cache_length_ == 0 || num_overflow_tokens <= 0) {
+    return absl::OkStatus();
+  }
+  // Evicting more tokens than needed at once keeps the shifts, which move the
+  // whole KV cache, rare.
+  const int num_evicted_tokens = std::max(
+      num_overflow_tokens,
+      num_context_shift_tokens_ > 0
+          ? num_context_shift_tokens_
+          : (context_shift_kv_cache_length_ - num_attention_sink_tokens_) / 2);
+  const int num_processed_tokens =
+      processed_tokens_.GetNextUnprocessedToken().step;
+  if (num_attention_sink_tokens_ + num_evicted_tokens > num_processed_tokens) {
+    return absl::ResourceExhaustedError(absl::StrCat(
+        "Cannot shift the context to fit ", num_tokens,
+        " more tokens in the KV cache of ", context_shift_kv_cache_length_,
+        " tokens."));
+  }
+
+  // The evicted tokens are gone from both the KV cache and the processed
+  // tokens, so the steps of the tokens after them are their new positions in
+  // the KV cache. The model takes a single position for both the rotary
+  // position embedding and the KV cache slot, so the kept keys after the
+  // attention sinks are rotated back to their new positions too. Otherwise
+  // the new tokens would attend to them with wrong relative positions.
+  LITERT_RETURN_IF_ERROR(DeleteTokensFromKvCache(
+      input_kv_cache_buffers_, num_evicted_tokens, num_attention_sink_tokens_));
+  RETURN_IF_ERROR(ShiftRotaryPositionsOfKeys(
+      input_kv_cache_buffers_, /*start_token=*/num_attention_sink_tokens_,
+      /*num_tokens=*/num_processed_tokens - num_attention_sink_tokens_ -
+          num_evicted_tokens,
+      /*position_delta=*/-num_evicted_tokens,
+      context_shift_layer_rope_params_));
+  RETURN_IF_ERROR(processed_tokens_.EraseTokens(num_attention_sink_tokens_,
+                                                num_evicted_tokens));
+  current_step_ -= num_evicted_tokens;
+  ABSL_LOG(INFO) << "Shifted the context by evicting " << num_evicted_tokens
+                 << " tokens from the KV cache.";
+  return absl::OkStatus();
+}
+
 absl::Status LlmLiteRtCompiledModelExecutorBase::DecodeInternal(
     int step, const std::vector<std::shared_ptr<TokenData>>& token,
     TensorBuffer& output_logits) {
@@ -756,20 +942,20 @@ absl::Status LlmLiteRtCompiledModelExecutorBase::DecodeInternal(
   }
 
   if (signatures_.input_attn_mask.has_value()) {
-    RETURN_IF_ERROR(InitializeAttentionMask(
-        decode_input_buffers_[signatures_.input_attn_mask.value()],
-        IsCalculationPrecisionF16()));
-    RETURN_IF_ERROR(FillAttentionMask(
-        decode_input_buffers_[signatures_.input_attn_mask.value()], step,
-        /*steps=*/1));
+    RETURN_IF_ERROR(UpdateDecodeAttentionMask(step));
   }
 
+  RETURN_IF_ERROR(BindLoRA(lora_id_));
   absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>
       decode_input_buffers;
   for (const auto& [input_name, input_buffer] : decode_input_buffers_) {
     LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
     decode_input_buffers[input_name] = std::move(input_buffer_dup);
   }
+  for (const auto& [input_name, input_buffer] : lora_input_buffers_) {
+    LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
+    decode_input_buffers[input_name] = std::move(input_buffer_dup);
+  }
   for (const auto& [input_name, input_buffer] : *input_kv_cache_buffers_) {
     LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
     decode_input_buffers[input_name] = std::move(input_buffer_dup);
@@ -796,6 +982,23 @@ absl::Status LlmLiteRtCompiledModelExecutorBase::DecodeInternal(
   return absl::OkStatus();
 }
 
+absl::Status LlmLiteRtCompiledModelExecutorBase::UpdateDecodeAttentionMask(
+    int step) {
+  TensorBuffer& mask =
+      decode_input_buffers_[signatures_.input_attn_mask.value()];
+  if (decode_attn_mask_step_ < 0 || step < decode_attn_mask_step_) {
+    // Positions can't be masked again incrementally, e.g. after a rollback or
+    // a context switch, so fill the mask from scratch.
+    decode_attn_mask_step_ = -1;
+    RETURN_IF_ERROR(InitializeAttentionMask(mask, IsCalculationPrecisionF16()));
+    RETURN_IF_ERROR(FillAttentionMask(mask, step, /*steps=*/1));
+  } else if (step > decode_attn_mask_step_) {
+    RETURN_IF_ERROR(ExtendAttentionMask(mask, decode_attn_mask_step_, step));
+  }
+  decode_attn_mask_step_ = step;
+  return absl::OkStatus();
+}
+
 absl::Status LlmLiteRtCompiledModelExecutorBase::PrepareFirstDecode() {
   if (ran_decode_) {
     return absl::OkStatus();
@@ -900,21 +1103,26 @@ LlmLiteRtCompiledModelExecutorBase::DecodeLogits(
 
   RETURN_IF_ERROR(PrepareFirstDecode());
   ASSIGN_OR_RETURN(auto step_and_token, GetTokenToDecode(inputs));
-  RETURN_IF_ERROR(
-      DecodeInternal(step_and_token.step, step_and_token.token, output_logits));
-  RETURN_IF_ERROR(ConsumePendingOrAddProcessedToken(step_and_token.token));
-
-  if (decode_params.HasConstraintDecoder() && !step_and_token.token.empty()) {
+  const bool use_constraint =
+      decode_params.HasConstraintDecoder() && !step_and_token.token.empty();
+  if (use_constraint) {
     RET_CHECK_EQ(step_and_token.token.size(), output_batch_size_);
     std::vector<int> current_token_ids;
     current_token_ids.reserve(output_batch_size_);
     for (const auto& token : step_and_token.token) {
       current_token_ids.push_back(token->id());
     }
-    // Update constraint state based on the current token id.
-    RETURN_IF_ERROR(decode_params.GetConstraintDecoder()->UpdateConstraintState(
-        absl::MakeSpan(current_token_ids)));
+    // Update constraint state based on the current token id, concurrently with
+    // the decode if the constraint decoder has a thread pool.
+    RETURN_IF_ERROR(
+        decode_params.GetConstraintDecoder()->StartUpdateConstraintState(
+            current_token_ids));
+  }
+  RETURN_IF_ERROR(
+      DecodeInternal(step_and_token.step, step_and_token.token, output_logits));
+  RETURN_IF_ERROR(ConsumePendingOrAddProcessedToken(step_and_token.token));
 
+  if (use_constraint) {
     LITERT_ASSIGN_OR_RETURN(auto output_logits_buffer_type,
                             output_logits.BufferTypeCC());
     // If the output logits are already on the host memory, use the buffer
@@ -993,6 +1201,185 @@ absl::Status LlmLiteRtCompiledModelExecutorBase::Reset() {
   return absl::OkStatus();
 }
 
+absl::StatusOr<std::unique_ptr<LlmExecutorContext>>
+LlmLiteRtCompiledModelExecutorBase::CreateContext() {
+  auto context = std::make_unique<KvCacheContext>();
+  const ProcessedTokens& default_processed_tokens =
+      active_context_ == nullptr ? processed_tokens_
+                                 : default_context_.processed_tokens;
+  if (!default_context_in_use_ && default_processed_tokens.TokenCount() == 0) {
+    // Hand out the default context first to avoid allocating another set of
+    // KV cache buffers when only one context is used.
+    default_context_in_use_ = true;
+    context->is_default = true;
+    return context;
+  }
+  RETURN_IF_ERROR(CreateContextKvCacheBuffers(*context));
+  return context;
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorBase::SwitchContext(
+    LlmExecutorContext* context) {
+  KvCacheContext* next_context = nullptr;
+  if (context != nullptr) {
+    next_context = dynamic_cast<KvCacheContext*>(context);
+    RET_CHECK(next_context != nullptr)
+        << "The context is not created by this executor.";
+    if (next_context->is_default) {
+      next_context = nullptr;
+    }
+  }
+  if (next_context == active_context_) {
+    return absl::OkStatus();
+  }
+
+  SaveActiveContext(active_context_ == nullptr ? default_context_
+                                               : *active_context_);
+  LoadActiveContext(next_context == nullptr ? default_context_
+                                            : *next_context);
+  active_context_ = next_context;
+  ++context_generation_;
+  return OnContextSwitched();
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorBase::ReleaseContext(
+    std::unique_ptr<LlmExecutorContext> context) {
+  RET_CHECK(context != nullptr) << "The context must not be null.";
+  auto* kv_cache_context = dynamic_cast<KvCacheContext*>(context.get());
+  RET_CHECK(kv_cache_context != nullptr)
+      << "The context is not created by this executor.";
+  ++context_generation_;
+  if (kv_cache_context->is_default) {
+    RETURN_IF_ERROR(SwitchContext(nullptr));
+    default_context_in_use_ = false;
+    lora_id_ = std::nullopt;
+    return Reset();
+  }
+  if (kv_cache_context == active_context_) {
+    // Moves the states back to the context being released, so they are freed
+    // along with it.
+    RETURN_IF_ERROR(SwitchContext(nullptr));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<LlmExecutorContext>>
+LlmLiteRtCompiledModelExecutorBase::CloneContext(LlmExecutorContext* context) {
+  KvCacheContext* source = &default_context_;
+  if (context != nullptr) {
+    auto* kv_cache_context = dynamic_cast<KvCacheContext*>(context);
+    RET_CHECK(kv_cache_context != nullptr)
+        << "The context is not created by this executor.";
+    if (!kv_cache_context->is_default) {
+      source = kv_cache_context;
+    }
+  }
+
+  auto clone = std::make_unique<KvCacheContext>();
+  RETURN_IF_ERROR(CreateContextKvCacheBuffers(*clone));
+
+  // Move the active states into their context temporarily, so that the source
+  // states can be read from the context regardless of whether it is active.
+  KvCacheContext& active =
+      active_context_ == nullptr ? default_context_ : *active_context_;
+  SaveActiveContext(active);
+  absl::Cleanup restore_active = [this, &active] { LoadActiveContext(active); };
+
+  auto get_buffers = [](KvCacheContext& context, KvCacheBuffersSlot slot)
+      -> absl::flat_hash_map<absl::string_view, TensorBuffer>* {
+    switch (slot) {
+      case KvCacheBuffersSlot::kSecond:
+        return &context.kv_cache_buffers_2;
+      case KvCacheBuffersSlot::kDecodeFirst:
+        return context.decode_kv_cache_buffers_1.has_value()
+                   ? &context.decode_kv_cache_buffers_1.value()
+                   : nullptr;
+      case KvCacheBuffersSlot::kDecodeSecond:
+        return context.decode_kv_cache_buffers_2.has_value()
+                   ? &context.decode_kv_cache_buffers_2.value()
+                   : nullptr;
+      default:
+        return &context.kv_cache_buffers_1;
+    }
+  };
+  // Only the input KV cache buffers hold the latest KV cache. The others are
+  // overwritten as outputs before they are read.
+  auto* source_buffers = get_buffers(*source, source->input_slot);
+  auto* clone_buffers = get_buffers(*clone, source->input_slot);
+  RET_CHECK(source_buffers != nullptr && clone_buffers != nullptr);
+  if (clone_buffers->empty()) {
+    // The KV cache buffers are allocated lazily, e.g. by the dynamic executor.
+    for (const auto& [name, buffer] : *source_buffers) {
+      ASSIGN_OR_RETURN((*clone_buffers)[name], CloneTensorBuffer(env_, buffer));
+    }
+  } else {
+    for (const auto& [name, buffer] : *source_buffers) {
+      auto it = clone_buffers->find(name);
+      RET_CHECK(it != clone_buffers->end()) << "No KV cache buffer " << name;
+      RETURN_IF_ERROR(CopyBuffer(buffer, it->second));
+    }
+  }
+  clone->input_slot = source->input_slot;
+  clone->output_slot = source->output_slot;
+  clone->ran_decode = source->ran_decode;
+  clone->current_step = source->current_step;
+  clone->processed_tokens = source->processed_tokens;
+  clone->lora_id = source->lora_id;
+  return clone;
+}
+
+void LlmLiteRtCompiledModelExecutorBase::SaveActiveContext(
+    KvCacheContext& context) {
+  auto get_slot = [this](const auto* buffers) {
+    if (buffers == &kv_cache_buffers_2_) {
+      return KvCacheBuffersSlot::kSecond;
+    } else if (decode_kv_cache_buffers_1_.has_value() &&
+               buffers == &decode_kv_cache_buffers_1_.value()) {
+      return KvCacheBuffersSlot::kDecodeFirst;
+    } else if (decode_kv_cache_buffers_2_.has_value() &&
+               buffers == &decode_kv_cache_buffers_2_.value()) {
+      return KvCacheBuffersSlot::kDecodeSecond;
+    }
+    return KvCacheBuffersSlot::kFirst;
+  };
+  context.input_slot = get_slot(input_kv_cache_buffers_);
+  context.output_slot = get_slot(output_kv_cache_buffers_);
+  context.kv_cache_buffers_1 = std::move(kv_cache_buffers_1_);
+  context.kv_cache_buffers_2 = std::move(kv_cache_buffers_2_);
+  context.decode_kv_cache_buffers_1 = std::move(decode_kv_cache_buffers_1_);
+  context.decode_kv_cache_buffers_2 = std::move(decode_kv_cache_buffers_2_);
+  context.ran_decode = ran_decode_;
+  context.current_step = current_step_;
+  context.processed_tokens = std::move(processed_tokens_);
+  context.lora_id = lora_id_;
+}
+
+void LlmLiteRtCompiledModelExecutorBase::LoadActiveContext(
+    KvCacheContext& context) {
+  kv_cache_buffers_1_ = std::move(context.kv_cache_buffers_1);
+  kv_cache_buffers_2_ = std::move(context.kv_cache_buffers_2);
+  decode_kv_cache_buffers_1_ = std::move(context.decode_kv_cache_buffers_1);
+  decode_kv_cache_buffers_2_ = std::move(context.decode_kv_cache_buffers_2);
+  ran_decode_ = context.ran_decode;
+  current_step_ = context.current_step;
+  processed_tokens_ = std::move(context.processed_tokens);
+  lora_id_ = context.lora_id;
+  auto get_buffers = [this](KvCacheBuffersSlot slot) {
+    switch (slot) {
+      case KvCacheBuffersSlot::kSecond:
+        return &kv_cache_buffers_2_;
+      case KvCacheBuffersSlot::kDecodeFirst:
+        return &decode_kv_cache_buffers_1_.value();
+      case KvCacheBuffersSlot::kDecodeSecond:
+        return &decode_kv_cache_buffers_2_.value();
+      default:
+        return &kv_cache_buffers_1_;
+    }
+  };
+  input_kv_cache_buffers_ = get_buffers(context.input_slot);
+  output_kv_cache_buffers_ = get_buffers(context.output_slot);
+}
+
 absl::StatusOr<int> LlmLiteRtCompiledModelExecutorBase::GetVocabSize() {
   if (!decode_output_buffers_.contains(signatures_.output_logits)) {
     return absl::NotFoundError("Output logits info not found.");
@@ -1005,12 +1392,72 @@ absl::StatusOr<int> LlmLiteRtCompiledModelExecutorBase::GetVocabSize() {
   return logits_tensor_type.Layout().Dimensions()[2];
 }
 
+absl::Status LlmLiteRtCompiledModelExecutorBase::LoadLoRA(
+    uint32_t lora_id, const ModelAssets& model_assets) {
+  if (lora_manager_ == nullptr) {
+    return absl::FailedPreconditionError("The model has no LoRA inputs.");
+  }
+  return lora_manager_->LoadLoRA(lora_id, model_assets);
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorBase::UseLoRA(
+    std::optional<uint32_t> lora_id) {
+  if (lora_manager_ == nullptr) {
+    if (!lora_id.has_value()) {
+      return absl::OkStatus();
+    }
+    return absl::FailedPreconditionError("The model has no LoRA inputs.");
+  }
+  // Binds the LoRA right away to report unknown or invalid LoRAs early.
+  RETURN_IF_ERROR(BindLoRA(lora_id));
+  lora_id_ = lora_id;
+  return absl::OkStatus();
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorBase::InitializeLoRA() {
+  LITERT_ASSIGN_OR_RETURN(
+      auto input_names, model_.GetSignatureInputNames(kDecodeSignatureRunner));
+  if (std::none_of(input_names.begin(), input_names.end(), IsLoRAInputName)) {
+    return absl::OkStatus();
+  }
+  const auto& advanced_settings = executor_settings_.GetAdvancedSettings();
+  ASSIGN_OR_RETURN(
+      lora_manager_,
+      LoraManager::Create(
+          model_, compiled_model_,
+          advanced_settings ? advanced_settings->lora_cache_max_bytes : 0));
+  ASSIGN_OR_RETURN(zero_lora_, LoRA::Create(/*lora_data=*/nullptr, model_,
+                                            compiled_model_));
+  ASSIGN_OR_RETURN(lora_input_buffers_, zero_lora_->GetLoRABuffers());
+  bound_lora_id_ = std::nullopt;
+  return absl::OkStatus();
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorBase::BindLoRA(
+    std::optional<uint32_t> lora_id) {
+  if (lora_id == bound_lora_id_) {
+    return absl::OkStatus();
+  }
+  RET_CHECK(lora_manager_ != nullptr);
+  if (lora_id.has_value()) {
+    // The LoRA may have been unloaded while other contexts were active, in
+    // which case it is loaded again.
+    RETURN_IF_ERROR(lora_manager_->UseLoRA(*lora_id));
+    ASSIGN_OR_RETURN(lora_input_buffers_, lora_manager_->GetLoRABuffers());
+  } else {
+    ASSIGN_OR_RETURN(lora_input_buffers_, zero_lora_->GetLoRABuffers());
+  }
+  bound_lora_id_ = lora_id;
+  return absl::OkStatus();
+}
+
 /* ===========================================================================*/
 /* LlmLiteRtCompiledModelExecutorStatic */
 /* ===========================================================================*/
 
 absl::Status LlmLiteRtCompiledModelExecutorStatic::Prefill(
     const ExecutorInputs& inputs, const ExecutorPrefillParams& params) {
+  speculated_tokens_.clear();
 
   // For now, we reduce the input and processed tokens for prefill only with
   // the first input and processed tokens. This should be updated if user select
@@ -1049,24 +1496,45 @@ absl::Status LlmLiteRtCompiledModelExecutorStatic::Prefill(
   // Reduce the input ids only with one user selected.
   auto input_length = ids.size() / input_batch_size;
   ids = ids.subspan(kTokenIndexToReduce * input_length, input_length);
-  ASSIGN_OR_RETURN(auto work_groups, GetOptimizedPrefillWorkGroups(
-                                         prefill_signature_map_, ids.size()));
-  for (const auto& [prefill_signature, prefill_length] : work_groups) {
-    // Keep track of the signatures that have already had their buffers
-    // created only create them once.
-    if (!prefill_input_buffers_.contains(prefill_signature)) {
-      prefill_input_buffers_[prefill_signature] = {};
-      RETURN_IF_ERROR(CreatePrefillInputBuffers(
-          prefill_signature, prefill_length, prefill_length,
-          prefill_input_buffers_[prefill_signature]));
+
+  // The prefix KV cache only applies to prompts processed from scratch, and
+  // not to multi-modal prompts whose token ids do not identify the contents.
+  // The KV caches computed with different LoRAs are kept in different
+  // partitions.
+  const uint64_t prefix_cache_partition =
+      lora_id_.has_value() ? uint64_t{*lora_id_} + 1 : 0;
+  const bool use_prefix_cache = prefix_cache_ != nullptr &&
+                                processed_tokens_.TokenCount() == 0 &&
+                                !inputs.GetVisionDataPtr().ok() &&
+                                !inputs.GetAudioDataPtr().ok();
+  // The last token is kept as the pending input token which is not in the KV
+  // cache yet.
+  const absl::Span<const int> prefix_cache_tokens = ids.first(ids.size() - 1);
+  if (use_prefix_cache) {
+    KvCachePrefixCache::Match match =
+        prefix_cache_->Lookup(prefix_cache_tokens, prefix_cache_partition);
+    if (match.num_tokens > 0) {
+      RETURN_IF_ERROR(
+          RestoreKvCacheSnapshot(*match.snapshot, *input_kv_cache_buffers_));
+      processed_tokens_.AddProcessedTokens(std::vector<int>(
+          ids.begin(), ids.begin() + match.num_tokens));
+      current_step_ = match.num_tokens;
+      ids = ids.subspan(/*pos=*/match.num_tokens);
     }
-    RETURN_IF_ERROR(PrefillInternal(prefill_signature,
-                                    prefill_input_buffers_[prefill_signature],
-                                    ids.subspan(/*pos=*/0, prefill_length)));
-    ids = ids.subspan(/*pos=*/prefill_length);
   }
-  RET_CHECK_EQ(ids.size(), 0).SetCode(absl::StatusCode::kInternal)
-      << "Work groups not covering the entire prefill input.";
+
+  RETURN_IF_ERROR(PrefillIds(ids));
+
+  // The KV cache no longer matches the prompt if the context was shifted.
+  if (use_prefix_cache && !prefix_cache_tokens.empty() &&
+      processed_tokens_.TokenCount() == prefix_cache_tokens.size() + 1 &&
+      !prefix_cache_->Covers(prefix_cache_tokens, prefix_cache_partition)) {
+    ASSIGN_OR_RETURN(auto snapshot,
+                     CreateKvCacheSnapshot(*input_kv_cache_buffers_,
+                                           prefix_cache_tokens.size()));
+    prefix_cache_->Insert(prefix_cache_tokens, std::move(snapshot),
+                          prefix_cache_partition);
+  }
 
   // If requested, wait for prefill to complete, for example, by benchmark.
   if (params.GetWaitForCompletion()) {
@@ -1095,14 +1563,485 @@ absl::Status LlmLiteRtCompiledModelExecutorStatic::Prefill(
   return absl::OkStatus();
 }
 
+absl::Status LlmLiteRtCompiledModelExecutorStatic::InitializeContextShifting(
+    const AdvancedSettings& settings) {
+  // Shifting moves the tokens of a single sequence, so neither the KV cache
+  // nor the decode inputs may be batched.
+  if (output_batch_size_ != 1) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Context shifting does not support a decode batch size of ",
+        output_batch_size_, "."));
+  }
+  // A key cache is [1, heads, kv_cache_length, head_dim] in float32, as
+  // expected by DeleteTokensFromKvCache() and ShiftRotaryPositionsOfKeys().
+  int kv_cache_length = 0;
+  int num_key_caches = 0;
+  for (const auto& [input_name, input_buffer] : *input_kv_cache_buffers_) {
+    if (!absl::StrContains(input_name, "cache_k_")) {
+      continue;
+    }
+    ++num_key_caches;
+    LITERT_ASSIGN_OR_RETURN(auto type, input_buffer.TensorType());
+    const auto dims = type.Layout().Dimensions();
+    RET_CHECK_EQ(dims.size(), 4);
+    if (dims[0] != 1) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Context shifting does not support a KV cache batch size of ",
+          dims[0], "."));
+    }
+    if (type.ElementType() != ::litert::ElementType::Float32) {
+      return absl::UnimplementedError(
+          "Context shifting requires float32 key caches to re-rotate the "
+          "kept keys.");
+    }
+    kv_cache_length = dims[2];
+  }
+  RET_CHECK_GT(kv_cache_length, 0) << "The model has no key cache inputs.";
+  if (settings.num_attention_sink_tokens < 0 ||
+      settings.num_context_shift_tokens < 0 ||
+      settings.num_attention_sink_tokens + settings.num_context_shift_tokens >=
+          kv_cache_length) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "The attention sink tokens (", settings.num_attention_sink_tokens,
+        ") and the context shift tokens (", settings.num_context_shift_tokens,
+        ") must fit in the KV cache of ", kv_cache_length, " tokens."));
+  }
+  const auto& layer_thetas = settings.context_shift_layer_rope_thetas;
+  const auto& layer_scaling_factors =
+      settings.context_shift_layer_rope_scaling_factors;
+  for (const auto* layer_values : {&layer_thetas, &layer_scaling_factors}) {
+    if (!layer_values->empty() &&
+        static_cast<int>(layer_values->size()) != num_key_caches) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The per-layer rotary position embedding settings must have one "
+          "value for each of the ",
+          num_key_caches, " layers, got ", layer_values->size(), "."));
+    }
+  }
+  // A single entry applies to every layer.
+  const int num_rope_layers =
+      layer_thetas.empty() && layer_scaling_factors.empty() ? 1
+                                                            : num_key_caches;
+  std::vector<RopeParams> layer_rope_params(num_rope_layers);
+  for (int layer = 0; layer < num_rope_layers; ++layer) {
+    RopeParams& rope = layer_rope_params[layer];
+    rope.theta = layer_thetas.empty() ? settings.context_shift_rope_theta
+                                      : layer_thetas[layer];
+    if (!layer_scaling_factors.empty()) {
+      rope.scaling_factor = layer_scaling_factors[layer];
+    }
+    if (rope.theta <= 0.0f || rope.scaling_factor <= 0.0f) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The rotary position embedding base and scaling factor of layer ",
+          layer, " must be positive."));
+    }
+  }
+  context_shift_kv_cache_length_ = kv_cache_length;
+  num_attention_sink_tokens_ = settings.num_attention_sink_tokens;
+  num_context_shift_tokens_ = settings.num_context_shift_tokens;
+  context_shift_layer_rope_params_ = std::move(layer_rope_params);
+  // The max number of tokens bounds the prompts by the real KV cache.
+  executor_settings_.SetMaxNumTokens(kv_cache_length);
+  return absl::OkStatus();
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorStatic::PrefillIds(
+    absl::Span<const int> ids) {
+  ASSIGN_OR_RETURN(auto work_groups, GetOptimizedPrefillWorkGroups(
+                                         prefill_signature_map_, ids.size()));
+  for (const auto& [prefill_signature, prefill_length] : work_groups) {
+    // Keep track of the signatures that have already had their buffers
+    // created only create them once.
+    if (!prefill_input_buffers_.contains(prefill_signature)) {
+      prefill_input_buffers_[prefill_signature] = {};
+      RETURN_IF_ERROR(CreatePrefillInputBuffers(
+          prefill_signature, prefill_length, prefill_length,
+          prefill_input_buffers_[prefill_signature]));
+    }
+    RETURN_IF_ERROR(PrefillInternal(prefill_signature,
+                                    prefill_input_buffers_[prefill_signature],
+                                    ids.subspan(/*pos=*/0, prefill_length)));
+    ids = ids.subspan(/*pos=*/prefill_length);
+  }
+  RET_CHECK_EQ(ids.size(), 0).SetCode(absl::StatusCode::kInternal)
+      << "Work groups not covering the entire prefill input.";
+  return absl::OkStatus();
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorStatic::Decode(
+    ::litert::TensorBuffer& output_tokens,
+    const ExecutorDecodeParams& decode_params) {
+  const SpeculativeDecodingMode mode =
+      decode_params.GetSpeculativeDecodingMode();
+  const bool can_speculate =
+      num_draft_tokens_ > 0 &&
+      (mode == SpeculativeDecodingMode::kPromptLookup ||
+       (mode == SpeculativeDecodingMode::kDraftModel &&
+        draft_executor_ != nullptr));
+  if (!can_speculate || decode_params.HasConstraintDecoder() ||
+      output_batch_size_ != 1) {
+    speculated_tokens_.clear();
+    return LlmLiteRtCompiledModelExecutorBase::Decode(output_tokens,
+                                                      decode_params);
+  }
+  RETURN_IF_ERROR(PrepareFirstDecode());
+  const ProcessedTokens::StepAndToken step_and_token =
+      processed_tokens_.GetNextUnprocessedToken();
+  if (step_and_token.token.size() != 1) {
+    speculated_tokens_.clear();
+    return LlmLiteRtCompiledModelExecutorBase::Decode(output_tokens,
+                                                      decode_params);
+  }
+  const int step = step_and_token.step;
+  const int pending_token = step_and_token.token[0]->id();
+
+  // The accepted tokens are only valid if the context is the one they were
+  // accepted in.
+  if (speculated_context_generation_ != context_generation_ ||
+      speculated_step_ != step || speculated_pending_token_ != pending_token) {
+    speculated_tokens_.clear();
+  }
+  if (speculated_tokens_.empty()) {
+    // Leave room in the KV cache for the pending input token and the draft.
+    const int num_draft_tokens =
+        std::min(num_draft_tokens_, verify_kv_cache_length_ - step - 1);
+    if (num_draft_tokens <= 0) {
+      return LlmLiteRtCompiledModelExecutorBase::Decode(output_tokens,
+                                                        decode_params);
+    }
+    std::vector<int> draft_tokens;
+    if (mode == SpeculativeDecodingMode::kPromptLookup) {
+      // Search the processed tokens in place instead of copying them with the
+      // pending input token on every step.
+      draft_tokens = ProposePromptLookupTokens(
+          processed_tokens_.GetProcessedTokenIds(/*batch=*/0), pending_token,
+          kPromptLookupMinNgramSize, kPromptLookupMaxNgramSize,
+          num_draft_tokens);
+      if (draft_tokens.empty()) {
+        // Nothing to copy from the context, so a regular decode is cheaper.
+        return LlmLiteRtCompiledModelExecutorBase::Decode(output_tokens,
+                                                          decode_params);
+      }
+    } else {
+      ASSIGN_OR_RETURN(draft_tokens, ProposeDraftTokens(num_draft_tokens));
+    }
+    ASSIGN_OR_RETURN(std::vector<int> accepted_tokens,
+                     VerifyDraftTokens(step, pending_token, draft_tokens));
+    ++speculative_decoding_stats_.num_verify_steps;
+    speculative_decoding_stats_.num_draft_tokens += draft_tokens.size();
+    speculative_decoding_stats_.num_accepted_tokens +=
+        accepted_tokens.size() - 1;
+    speculated_tokens_.assign(accepted_tokens.begin(), accepted_tokens.end());
+  }
+
+  // The pending input token and the accepted tokens before the next one are
+  // already in the KV cache, so the next one only becomes the pending input
+  // token. The KV cache entries of the rejected tokens are overwritten before
+  // the attention mask ever covers them.
+  const int next_token = speculated_tokens_.front();
+  speculated_tokens_.pop_front();
+  RETURN_IF_ERROR(processed_tokens_.MarkPendingInputTokenAsProcessed());
+  RETURN_IF_ERROR(processed_tokens_.AddPendingInputToken(
+      {std::make_shared<TokenData>(next_token)}));
+  current_step_ = step + 1;
+  speculated_context_generation_ = context_generation_;
+  speculated_step_ = step + 1;
+  speculated_pending_token_ = next_token;
+
+  LITERT_ASSIGN_OR_RETURN(auto output_tokens_size, output_tokens.PackedSize());
+  RET_CHECK_EQ(output_tokens_size, sizeof(int32_t));
+  LITERT_RETURN_IF_ERROR(
+      output_tokens.Write<int32_t>(absl::MakeConstSpan(&next_token, 1)));
+  return absl::OkStatus();
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorStatic::Reset() {
+  speculated_tokens_.clear();
+  if (draft_executor_ != nullptr) {
+    RETURN_IF_ERROR(draft_executor_->Reset());
+  }
+  return LlmLiteRtCompiledModelExecutorBase::Reset();
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorStatic::SyncDraftTokens(
+    absl::Span<const int> tokens) {
+  RET_CHECK(!tokens.empty());
+  const std::vector<int> draft_tokens = processed_tokens_.GetCopyOfTokens()[0];
+  // The last token is always prefilled again, so that it becomes the pending
+  // input token.
+  size_t num_common_tokens = 0;
+  while (num_common_tokens < tokens.size() - 1 &&
+         num_common_tokens < draft_tokens.size() &&
+         tokens[num_common_tokens] == draft_tokens[num_common_tokens]) {
+    ++num_common_tokens;
+  }
+  if (num_common_tokens < draft_tokens.size()) {
+    RETURN_IF_ERROR(processed_tokens_.RollBackToStep(num_common_tokens));
+    current_step_ = num_common_tokens;
+  }
+  return PrefillIds(tokens.subspan(num_common_tokens));
+}
+
+absl::StatusOr<std::vector<int>>
+LlmLiteRtCompiledModelExecutorStatic::ProposeDraftTokens(int num_tokens) {
+  RETURN_IF_ERROR(
+      draft_executor_->SyncDraftTokens(processed_tokens_.GetCopyOfTokens()[0]));
+  std::vector<int> draft_tokens;
+  draft_tokens.reserve(num_tokens);
+  for (int i = 0; i < num_tokens; ++i) {
+    RETURN_IF_ERROR(draft_executor_->Decode(draft_output_tokens_));
+    LITERT_ASSIGN_OR_RETURN(
+        auto token, CopyFromTensorBuffer<int32_t>(draft_output_tokens_));
+    draft_tokens.push_back(token[0]);
+  }
+  return draft_tokens;
+}
+
+void LlmLiteRtCompiledModelExecutorStatic::SetVerifyFunctionForTesting(
+    VerifyFunction verify, int num_draft_tokens) {
+  verify_for_testing_ = std::move(verify);
+  num_draft_tokens_ = num_draft_tokens;
+  verify_kv_cache_length_ = executor_settings_.GetMaxNumTokens();
+}
+
+absl::StatusOr<std::vector<int>>
+LlmLiteRtCompiledModelExecutorStatic::VerifyDraftTokens(
+    int step, int pending_token, absl::Span<const int> draft_tokens) {
+  const int num_tokens = draft_tokens.size() + 1;
+  ASSIGN_OR_RETURN(int vocab_size, GetVocabSize());
+  if (verify_for_testing_) {
+    std::vector<int> tokens = {pending_token};
+    tokens.insert(tokens.end(), draft_tokens.begin(), draft_tokens.end());
+    ASSIGN_OR_RETURN(std::vector<float> logits,
+                     verify_for_testing_(step, tokens));
+    return AcceptDraftTokensGreedily(draft_tokens, logits, vocab_size);
+  }
+  {
+    auto& input_tokens = verify_input_buffers_[signatures_.input_tokens];
+    LITERT_ASSIGN_OR_RETURN(auto input_tokens_size, input_tokens.PackedSize());
+    LITERT_ASSIGN_OR_RETURN(
+        auto input_tokens_lock_and_addr,
+        ::litert::TensorBufferScopedLock::Create(
+            input_tokens, TensorBuffer::LockMode::kWrite));
+    auto* input_tokens_ptr =
+        static_cast<int32_t*>(input_tokens_lock_and_addr.second);
+    memset(input_tokens_ptr, 0, input_tokens_size);
+    input_tokens_ptr[0] = pending_token;
+    std::copy(draft_tokens.begin(), draft_tokens.end(), input_tokens_ptr + 1);
+
+    auto& input_pos = verify_input_buffers_[signatures_.input_positions];
+    LITERT_ASSIGN_OR_RETURN(auto input_pos_size, input_pos.PackedSize());
+    LITERT_ASSIGN_OR_RETURN(auto input_pos_lock_and_addr,
+                            ::litert::TensorBufferScopedLock::Create(
+                                input_pos, TensorBuffer::LockMode::kWrite));
+    auto* input_pos_ptr = static_cast<int32_t*>(input_pos_lock_and_addr.second);
+    memset(input_pos_ptr, 0, input_pos_size);
+    std::iota(input_pos_ptr, input_pos_ptr + num_tokens, step);
+  }
+  auto& attn_mask = verify_input_buffers_[signatures_.input_attn_mask.value()];
+  RETURN_IF_ERROR(
+      InitializeAttentionMask(attn_mask, IsCalculationPrecisionF16()));
+  RETURN_IF_ERROR(FillAttentionMask(attn_mask, step, /*steps=*/num_tokens));
+
+  RETURN_IF_ERROR(BindLoRA(lora_id_));
+  absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer> input_buffers;
+  for (const auto& [input_name, input_buffer] : verify_input_buffers_) {
+    LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
+    input_buffers[input_name] = std::move(input_buffer_dup);
+  }
+  for (const auto& [input_name, input_buffer] : lora_input_buffers_) {
+    LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
+    input_buffers[input_name] = std::move(input_buffer_dup);
+  }
+  for (const auto& [input_name, input_buffer] : *input_kv_cache_buffers_) {
+    LITERT_ASSIGN_OR_RETURN(auto input_buffer_dup, input_buffer.Duplicate());
+    input_buffers[input_name] = std::move(input_buffer_dup);
+  }
+  absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer> output_buffers;
+  for (const auto& [output_name, output_buffer] : *output_kv_cache_buffers_) {
+    LITERT_ASSIGN_OR_RETURN(auto output_buffer_dup, output_buffer.Duplicate());
+    output_buffers[output_name] = std::move(output_buffer_dup);
+  }
+  LITERT_ASSIGN_OR_RETURN(auto output_logits_dup,
+                          verify_output_logits_.Duplicate());
+  output_buffers[signatures_.output_logits] = std::move(output_logits_dup);
+
+  LITERT_RETURN_IF_ERROR(compiled_model_.Run(kVerifySignatureRunner,
+                                             input_buffers, output_buffers));
+  std::swap(input_kv_cache_buffers_, output_kv_cache_buffers_);
+
+  LITERT_ASSIGN_OR_RETURN(auto logits,
+                          CopyFromTensorBuffer<float>(verify_output_logits_));
+  return AcceptDraftTokensGreedily(draft_tokens, logits, vocab_size);
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorStatic::CreateContextKvCacheBuffers(
+    KvCacheContext& context) {
+  RET_CHECK(!prefill_signature_map_.empty()) << "No prefill runner available.";
+  // All the prefill signatures share the same KV cache tensors.
+  const std::string& prefill_signature = prefill_signature_map_.begin()->second;
+  // For CPU, a single buffer is used for both KV cache input and output. See
+  // Create().
+  const bool is_cpu = executor_settings_.GetBackend() == Backend::CPU;
+  for (const auto& [input_name, unused_buffer] : kv_cache_buffers_1_) {
+    LITERT_ASSIGN_OR_RETURN(
+        auto input_buffer,
+        compiled_model_.CreateInputBuffer(prefill_signature, input_name));
+    if (is_cpu) {
+      LITERT_ASSIGN_OR_RETURN(auto output_buffer, input_buffer.Duplicate());
+      context.kv_cache_buffers_2[input_name] = std::move(output_buffer);
+    }
+    context.kv_cache_buffers_1[input_name] = std::move(input_buffer);
+  }
+  if (!is_cpu) {
+    for (const auto& [output_name, unused_buffer] : kv_cache_buffers_2_) {
+      LITERT_ASSIGN_OR_RETURN(
+          auto output_buffer,
+          compiled_model_.CreateOutputBuffer(prefill_signature, output_name));
+      context.kv_cache_buffers_2[output_name] = std::move(output_buffer);
+    }
+  }
+
+  if (decode_kv_cache_buffers_1_.has_value() &&
+      decode_kv_cache_buffers_2_.has_value()) {
+    context.decode_kv_cache_buffers_1.emplace();
+    context.decode_kv_cache_buffers_2.emplace();
+    for (const auto& [input_name, unused_buffer] :
+         *decode_kv_cache_buffers_1_) {
+      LITERT_ASSIGN_OR_RETURN(
+          auto input_buffer,
+          compiled_model_.CreateInputBuffer(kDecodeSignatureRunner, input_name));
+      (*context.decode_kv_cache_buffers_1)[input_name] =
+          std::move(input_buffer);
+    }
+    for (const auto& [output_name, unused_buffer] :
+         *decode_kv_cache_buffers_2_) {
+      LITERT_ASSIGN_OR_RETURN(auto output_buffer,
+                              compiled_model_.CreateOutputBuffer(
+                                  kDecodeSignatureRunner, output_name));
+      (*context.decode_kv_cache_buffers_2)[output_name] =
+          std::move(output_buffer);
+    }
+  }
+  return absl::OkStatus();
+}
+
 // static
 // Creates a LlmLiteRtCompiledModelExecutorStatic from a LiteRt model.
 absl::StatusOr<std::unique_ptr<LlmLiteRtCompiledModelExecutorStatic>>
 LlmLiteRtCompiledModelExecutorStatic::Create(
     LlmExecutorSettings executor_settings, Environment& lrt_env,
     ModelResources& resources) {
-  ASSIGN_OR_RETURN(auto litert_model,
-                   resources.GetTFLiteModel(ModelType::kTfLitePrefillDecode));
+  ASSIGN_OR_RETURN(auto executor,
+                   CreateFromModel(std::move(executor_settings), lrt_env,
+                                   resources, ModelType::kTfLitePrefillDecode));
+  RETURN_IF_ERROR(executor->InitializeSpeculativeDecoding(lrt_env, resources));
+  return executor;
+}
+
+absl::Status
+LlmLiteRtCompiledModelExecutorStatic::InitializeSpeculativeDecoding(
+    Environment& lrt_env, ModelResources& resources) {
+  const auto& advanced_settings = executor_settings_.GetAdvancedSettings();
+  const int requested_num_draft_tokens =
+      advanced_settings ? advanced_settings->num_draft_tokens : 0;
+  // Prompt lookup decoding only needs the verify signature, so the
+  // verification pass is set up whenever the model has one, while the draft
+  // model is only loaded if requested.
+  if (output_batch_size_ != 1 || signatures_.input_tokens.empty() ||
+      !signatures_.input_attn_mask.has_value() ||
+      !model_.FindSignature(kVerifySignatureRunner)) {
+    if (requested_num_draft_tokens > 0) {
+      ABSL_LOG(WARNING) << "Speculative decoding is only supported for models "
+                           "with token inputs, an attention mask, a "
+                        << kVerifySignatureRunner
+                        << " signature and a single output candidate. It is "
+                           "disabled.";
+    }
+    return absl::OkStatus();
+  }
+
+  // The verify signature runs the pending input token and the draft tokens,
+  // so the number of draft tokens is bounded by its sequence length.
+  LITERT_ASSIGN_OR_RETURN(
+      verify_output_logits_,
+      compiled_model_.CreateOutputBuffer(kVerifySignatureRunner,
+                                         signatures_.output_logits));
+  LITERT_ASSIGN_OR_RETURN(auto logits_type,
+                          verify_output_logits_.TensorType());
+  RET_CHECK_EQ(logits_type.Layout().Dimensions().size(), 3)
+      << "Verify logits must be (batch, seq, vocab)";
+  const int verify_length = logits_type.Layout().Dimensions()[1];
+  if (logits_type.ElementType() != ::litert::ElementType::Float32 ||
+      verify_length < 2) {
+    ABSL_LOG(WARNING) << "The verify signature must output float32 logits of "
+                         "more than one token. Speculative decoding is "
+                         "disabled.";
+    return absl::OkStatus();
+  }
+  RETURN_IF_ERROR(CreatePrefillInputBuffers(kVerifySignatureRunner,
+                                            verify_length, verify_length,
+                                            verify_input_buffers_));
+  LITERT_ASSIGN_OR_RETURN(
+      auto attn_mask_type,
+      verify_input_buffers_[signatures_.input_attn_mask.value()].TensorType());
+  RET_CHECK_EQ(attn_mask_type.Layout().Dimensions().size(), 4)
+      << "Verify attention mask must be (batch, 1, seq, kv_cache_length)";
+  verify_kv_cache_length_ = attn_mask_type.Layout().Dimensions()[3];
+  num_draft_tokens_ = verify_length - 1;
+  if (requested_num_draft_tokens > 0) {
+    num_draft_tokens_ = std::min(num_draft_tokens_, requested_num_draft_tokens);
+  }
+  ABSL_LOG(INFO) << "Speculative decoding enabled with up to "
+                 << num_draft_tokens_ << " draft tokens.";
+  if (requested_num_draft_tokens <= 0) {
+    return absl::OkStatus();
+  }
+
+  auto draft_model =
+      resources.GetTFLiteModel(ModelType::kTfLiteDraftPrefillDecode);
+  if (!draft_model.ok()) {
+    ABSL_LOG(WARNING) << "The model has no draft model. Speculative decoding "
+                         "with a draft model is disabled: "
+                      << draft_model.status();
+    return absl::OkStatus();
+  }
+  // The draft model is small, so it does not share the weight cache of the
+  // main model, nor the options which only apply to the main model.
+  LlmExecutorSettings draft_settings = executor_settings_;
+  draft_settings.SetCacheDir(":nocache");
+  AdvancedSettings draft_advanced_settings = *advanced_settings;
+  draft_advanced_settings.num_draft_tokens = 0;
+  draft_advanced_settings.prefix_cache_max_bytes = 0;
+  // The draft model follows the tokens of the main model, including the
+  // evictions of its context shifts.
+  draft_advanced_settings.enable_context_shifting = false;
+  draft_settings.SetAdvancedSettings(draft_advanced_settings);
+  ASSIGN_OR_RETURN(auto draft_executor,
+                   CreateFromModel(std::move(draft_settings), lrt_env,
+                                   resources,
+                                   ModelType::kTfLiteDraftPrefillDecode));
+  ASSIGN_OR_RETURN(int vocab_size, GetVocabSize());
+  ASSIGN_OR_RETURN(int draft_vocab_size, draft_executor->GetVocabSize());
+  if (draft_executor->signatures_.input_tokens.empty() ||
+      draft_vocab_size != vocab_size) {
+    ABSL_LOG(WARNING) << "The draft model must take token inputs and share "
+                         "the vocabulary of the main model. Speculative "
+                         "decoding with a draft model is disabled.";
+    return absl::OkStatus();
+  }
+  LITERT_ASSIGN_OR_RETURN(draft_output_tokens_,
+                          CreateTensorBuffer<int>({1, 1}));
+  draft_executor_ = std::move(draft_executor);
+  return absl::OkStatus();
+}
+
+// static
+absl::StatusOr<std::unique_ptr<LlmLiteRtCompiledModelExecutorStatic>>
+LlmLiteRtCompiledModelExecutorStatic::CreateFromModel(
+    LlmExecutorSettings executor_settings, Environment& lrt_env,
+    ModelResources& resources, ModelType model_type) {
+  ASSIGN_OR_RETURN(auto litert_model, resources.GetTFLiteModel(model_type));
   // For the LlmLiteRtCompiledModelExecutorStatic, ML_DRIFT backend is used by
   // default.
   // TODO(b/405424188): - Add support for NPU backends.
@@ -1370,9 +2309,18 @@ LlmLiteRtCompiledModelExecutorStatic::Create(
 
   std::unique_ptr<EmbeddingLookupManager> embedding_lookup;
   std::unique_ptr<EmbeddingLookupManager> per_layer_embedding_lookup;
-  RETURN_IF_ERROR(InitializeEmbeddingLookups(resources, embedding_lookup,
-                                             per_layer_embedding_lookup));
-  return absl::WrapUnique(new LlmLiteRtCompiledModelExecutorStatic(
+  // The embedder models only apply to the main model.
+  if (model_type == ModelType::kTfLitePrefillDecode) {
+    RETURN_IF_ERROR(InitializeEmbeddingLookups(
+        resources, executor_settings,
+        /*vocab_size=*/
+        output_logits_buffer_tensor_type.Layout().Dimensions()[2],
+        embedding_lookup, per_layer_embedding_lookup));
+  }
+  const auto& advanced_settings = executor_settings.GetAdvancedSettings();
+  const uint64_t prefix_cache_max_bytes =
+      advanced_settings ? advanced_settings->prefix_cache_max_bytes : 0;
+  auto executor = absl::WrapUnique(new LlmLiteRtCompiledModelExecutorStatic(
       std::move(executor_settings), lrt_env, litert_model,
       std::move(compiled_model), std::move(decode_input_buffers),
       std::move(decode_output_buffers), std::move(input_kv_cache_buffers),
@@ -1382,6 +2330,20 @@ LlmLiteRtCompiledModelExecutorStatic::Create(
       signatures, batch_size, std::move(weight_cache_path),
       std::move(embedding_lookup), std::move(per_layer_embedding_lookup),
       activation_data_type));
+  if (prefix_cache_max_bytes > 0) {
+    executor->prefix_cache_ =
+        std::make_unique<KvCachePrefixCache>(prefix_cache_max_bytes);
+  }
+  // The executor settings have been moved into the executor.
+  const auto& executor_advanced_settings =
+      executor->executor_settings_.GetAdvancedSettings();
+  if (executor_advanced_settings &&
+      executor_advanced_settings->enable_context_shifting) {
+    RETURN_IF_ERROR(
+        executor->InitializeContextShifting(*executor_advanced_settings));
+  }
+  RETURN_IF_ERROR(executor->InitializeLoRA());
+  return executor;
 }
 
 /* ===========================================================================*/
@@ -1413,62 +2375,9 @@ absl::Status LlmLiteRtCompiledModelExecutorDynamic::Prefill(
     return absl::OkStatus();
   }
 
-  int kv_length = 0;
-  if (kv_cache_buffers_1_.empty()) {
-    kv_length = prefill_length;
-    // First time prefilling, allocate KV cache buffers.
-    for (const auto& k_cache_input_name : key_cache_input_names_) {
-      RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "prefill",
-                                          k_cache_input_name, prefill_length));
-      LITERT_ASSIGN_OR_RETURN(
-          auto input_buffer,
-          compiled_model_.CreateInputBuffer("prefill", k_cache_input_name));
-      kv_cache_buffers_1_[k_cache_input_name] = std::move(input_buffer);
-    }
-    for (const auto& v_cache_input_name : value_cache_input_names_) {
-      RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "prefill",
-                                          v_cache_input_name, prefill_length));
-      LITERT_ASSIGN_OR_RETURN(
-          auto input_buffer,
-          compiled_model_.CreateInputBuffer("prefill", v_cache_input_name));
-      kv_cache_buffers_1_[v_cache_input_name] = std::move(input_buffer);
-    }
-  } else {
-    {
-      RET_CHECK(!kv_cache_buffers_1_.empty());
-      const TensorBuffer& key_buffer =
-          kv_cache_buffers_1_[key_cache_input_names_[0]];
-      LITERT_ASSIGN_OR_RETURN(const RankedTensorType& key_buffer_tensor_type,
-                              key_buffer.TensorType());
-      kv_length =
-          key_buffer_tensor_type.Layout().Dimensions()[key_dynamic_dim_index_];
-    }
-
-    int free_kv_entries = kv_length - step_and_token.step;
-    if (prefill_length > free_kv_entries) {
-      int new_kv_seq_len = kv_length + prefill_length;
-      int entries_to_add = new_kv_seq_len - kv_length;
-      for (const auto& k_cache_input_name : key_cache_input_names_) {
-        RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "prefill",
-                                            k_cache_input_name,
-                                            new_kv_seq_len));
-        ASSIGN_OR_RETURN(kv_cache_buffers_1_[k_cache_input_name],
-                         ResizeKVCacheTensorBuffer(
-                             env_, kv_cache_buffers_1_[k_cache_input_name],
-                             key_dynamic_dim_index_, entries_to_add));
-      }
-      for (const auto& v_cache_input_name : value_cache_input_names_) {
-        RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "prefill",
-                                            v_cache_input_name,
-                                            new_kv_seq_len));
-        ASSIGN_OR_RETURN(kv_cache_buffers_1_[v_cache_input_name],
-                         ResizeKVCacheTensorBuffer(
-                             env_, kv_cache_buffers_1_[v_cache_input_name],
-                             value_dynamic_dim_index_, entries_to_add));
-      }
-      kv_length = new_kv_seq_len;
-    }
-  }
+  ASSIGN_OR_RETURN(
+      const int kv_length,
+      ReserveKvCacheBuffers(step_and_token.step + prefill_length));
 
   absl::flat_hash_map<absl::string_view, TensorBuffer> prefill_input_buffers;
   RETURN_IF_ERROR(CreatePrefillInputBuffers("prefill", prefill_length,
@@ -1485,49 +2394,131 @@ absl::Status LlmLiteRtCompiledModelExecutorDynamic::Prefill(
 absl::Status LlmLiteRtCompiledModelExecutorDynamic::DecodeInternal(
     int step, const std::vector<std::shared_ptr<TokenData>>& token,
     TensorBuffer& output_logits) {
-  int current_kv_len = 0;
-  {
-    RET_CHECK(!kv_cache_buffers_1_.empty());
-    const TensorBuffer& key_buffer =
-        kv_cache_buffers_1_[key_cache_input_names_[0]];
-    LITERT_ASSIGN_OR_RETURN(const RankedTensorType& key_buffer_tensor_type,
-                            key_buffer.TensorType());
-    current_kv_len =
-        key_buffer_tensor_type.Layout().Dimensions()[key_dynamic_dim_index_];
-  }
-
-  if (current_kv_len <= step) {
-    int entries_to_add = kv_increament_size_;
-    int new_kv_len = current_kv_len + entries_to_add;
+  RET_CHECK(!kv_cache_buffers_1_.empty());
+  ASSIGN_OR_RETURN(const int current_kv_len,
+                   ReserveKvCacheBuffers(step + 1));
+
+  // The attention mask spans the whole KV cache, so it is re-created only when
+  // the KV cache grows, and is otherwise updated incrementally.
+  if (decode_attn_mask_kv_len_ != current_kv_len) {
+    RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "decode",
+                                        signatures_.input_attn_mask.value(),
+                                        current_kv_len));
+    LITERT_ASSIGN_OR_RETURN(
+        decode_input_buffers_[signatures_.input_attn_mask.value()],
+        compiled_model_.CreateInputBuffer(
+            "decode", signatures_.input_attn_mask.value()));
+    decode_attn_mask_kv_len_ = current_kv_len;
+    decode_attn_mask_step_ = -1;
+  }
+
+  return LlmLiteRtCompiledModelExecutorBase::DecodeInternal(step, token,
+                                                            output_logits);
+}
+
+absl::Status LlmLiteRtCompiledModelExecutorDynamic::OnContextSwitched() {
+  ASSIGN_OR_RETURN(const int kv_length, GetKvCacheLength());
+  if (kv_length == 0) {
+    // KV cache buffers will be allocated on the first prefill.
+    return absl::OkStatus();
+  }
+  for (absl::string_view signature : {"prefill", "decode"}) {
     for (const auto& k_cache_input_name : key_cache_input_names_) {
-      RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "decode",
-                                          k_cache_input_name, new_kv_len));
-      ASSIGN_OR_RETURN(kv_cache_buffers_1_[k_cache_input_name],
-                       ResizeKVCacheTensorBuffer(
-                           env_, kv_cache_buffers_1_[k_cache_input_name],
-                           key_dynamic_dim_index_, entries_to_add));
+      RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, signature,
+                                          k_cache_input_name, kv_length));
     }
     for (const auto& v_cache_input_name : value_cache_input_names_) {
-      RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "decode",
-                                          v_cache_input_name, new_kv_len));
-      ASSIGN_OR_RETURN(kv_cache_buffers_1_[v_cache_input_name],
-                       ResizeKVCacheTensorBuffer(
-                           env_, kv_cache_buffers_1_[v_cache_input_name],
-                           value_dynamic_dim_index_, entries_to_add));
+      RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, signature,
+                                          v_cache_input_name, kv_length));
     }
-    current_kv_len = new_kv_len;
   }
+  return absl::OkStatus();
+}
 
-  RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, "decode",
-                                      signatures_.input_attn_mask.value(),
-                                      current_kv_len));
-  LITERT_ASSIGN_OR_RETURN(
-      decode_input_buffers_[signatures_.input_attn_mask.value()],
-      compiled_model_.CreateInputBuffer("decode",
-                                        signatures_.input_attn_mask.value()));
+absl::Status LlmLiteRtCompiledModelExecutorDynamic::Reset() {
+  RETURN_IF_ERROR(LlmLiteRtCompiledModelExecutorBase::Reset());
+  ASSIGN_OR_RETURN(const int kv_length, GetKvCacheLength());
+  for (auto& [name, buffer] : kv_cache_buffers_1_) {
+    RETURN_IF_ERROR(
+        kv_cache_buffer_pool_.Release(name, kv_length, std::move(buffer)));
+  }
+  kv_cache_buffers_1_.clear();
+  return absl::OkStatus();
+}
 
-  return LlmLiteRtCompiledModelExecutorBase::DecodeInternal(step, token,
-                                                            output_logits);
+absl::StatusOr<int> LlmLiteRtCompiledModelExecutorDynamic::GetKvCacheLength() {
+  auto it = kv_cache_buffers_1_.find(key_cache_input_names_[0]);
+  if (it == kv_cache_buffers_1_.end()) {
+    return 0;
+  }
+  LITERT_ASSIGN_OR_RETURN(const RankedTensorType& key_buffer_tensor_type,
+                          it->second.TensorType());
+  return key_buffer_tensor_type.Layout().Dimensions()[key_dynamic_dim_index_];
+}
+
+absl::StatusOr<int>
+LlmLiteRtCompiledModelExecutorDynamic::ReserveKvCacheBuffers(int num_entries) {
+  ASSIGN_OR_RETURN(const int kv_length, GetKvCacheLength());
+  if (num_entries <= kv_length) {
+    return kv_length;
+  }
+  int new_kv_length = GetKvCacheCapacity(num_entries, kv_increament_size_);
+  const int max_num_tokens = executor_settings_.GetMaxNumTokens();
+  if (max_num_tokens > 0) {
+    // Do not round up past the maximum number of tokens.
+    new_kv_length =
+        std::min(new_kv_length, std::max(num_entries, max_num_tokens));
+  }
+
+  auto reserve = [&](absl::string_view name,
+                     int dynamic_dim_index) -> absl::Status {
+    for (absl::string_view signature : {"prefill", "decode"}) {
+      RETURN_IF_ERROR(ResolveDynamicShape(model_, compiled_model_, signature,
+                                          name, new_kv_length));
+    }
+    std::optional<TensorBuffer> new_buffer =
+        kv_cache_buffer_pool_.Acquire(name, new_kv_length);
+    auto it = kv_cache_buffers_1_.find(name);
+    if (it == kv_cache_buffers_1_.end()) {
+      // First time prefilling, allocate the KV cache buffer.
+      if (!new_buffer.has_value()) {
+        LITERT_ASSIGN_OR_RETURN(
+            auto input_buffer,
+            compiled_model_.CreateInputBuffer("prefill", name));
+        new_buffer = std::move(input_buffer);
+      }
+      kv_cache_buffers_1_[name] = std::move(*new_buffer);
+      return absl::OkStatus();
+    }
+    if (!new_buffer.has_value()) {
+      ASSIGN_OR_RETURN(new_buffer,
+                       CreateKVCacheTensorBuffer(env_, it->second,
+                                                 dynamic_dim_index,
+                                                 new_kv_length));
+    }
+    RETURN_IF_ERROR(ExpandKVCacheTensorBuffer(it->second, *new_buffer));
+    RETURN_IF_ERROR(
+        kv_cache_buffer_pool_.Release(name, kv_length, std::move(it->second)));
+    it->second = std::move(*new_buffer);
+    return absl::OkStatus();
+  };
+  for (const auto& k_cache_input_name : key_cache_input_names_) {
+    RETURN_IF_ERROR(reserve(k_cache_input_name, key_dynamic_dim_index_));
+  }
+  for (const auto& v_cache_input_name : value_cache_input_names_) {
+    RETURN_IF_ERROR(reserve(v_cache_input_name, value_dynamic_dim_index_));
+  }
+
+  // Let the pool hold up to one KV cache of the largest length so far.
+  size_t kv_cache_bytes = 0;
+  for (const auto& [name, buffer] : kv_cache_buffers_1_) {
+    LITERT_ASSIGN_OR_RETURN(size_t buffer_size, buffer.PackedSize());
+    kv_cache_bytes += buffer_size;
+  }
+  if (kv_cache_bytes > kv_cache_buffer_pool_.max_bytes()) {
+    kv_cache_buffer_pool_.SetMaxBytes(kv_cache_bytes);
+  }
+  return new_kv_length;
 }
 
 // static
@@ -1543,6 +2534,11 @@ LlmLiteRtCompiledModelExecutorDynamic::Create(
   const Backend backend = executor_settings.GetBackend();
   RET_CHECK_EQ(backend, Backend::CPU)
       << "LlmLiteRtCompiledModelExecutorDynamic only supports CPU backend.";
+  const auto& advanced_settings = executor_settings.GetAdvancedSettings();
+  if (advanced_settings && advanced_settings->enable_context_shifting) {
+    return absl::InvalidArgumentError(
+        "Context shifting is only supported with static KV caches.");
+  }
   uint32_t kv_increament_size = 0;
   {
     Expected<CpuOptions> cpu_compilation_options = CpuOptions::Create();
@@ -1618,7 +2614,9 @@ LlmLiteRtCompiledModelExecutorDynamic::Create(
     bool is_attn_mask_input =
         signatures.input_attn_mask.has_value() &&
         absl::StartsWith(input_name, signatures.input_attn_mask.value());
-    if (!is_kv_cache_input && !is_attn_mask_input) {
+    // We let LoraManager handle LoRA inputs.
+    if (!is_kv_cache_input && !is_attn_mask_input &&
+        !IsLoRAInputName(input_name)) {
       LITERT_ASSIGN_OR_RETURN(
           auto input_buffer,
           compiled_model.CreateInputBuffer(kDecodeSignatureRunner, input_name));
@@ -1653,10 +2651,12 @@ LlmLiteRtCompiledModelExecutorDynamic::Create(
   RET_CHECK_EQ(batch_size, 1) << "Only support batch size 1 for now.";
   std::unique_ptr<EmbeddingLookupManager> embedding_lookup;
   std::unique_ptr<EmbeddingLookupManager> per_layer_embedding_lookup;
-  RETURN_IF_ERROR(InitializeEmbeddingLookups(resources, embedding_lookup,
-                                             per_layer_embedding_lookup));
+  RETURN_IF_ERROR(InitializeEmbeddingLookups(
+      resources, executor_settings,
+      /*vocab_size=*/output_logits_buffer_tensor_type.Layout().Dimensions()[2],
+      embedding_lookup, per_layer_embedding_lookup));
 
-  return absl::WrapUnique(new LlmLiteRtCompiledModelExecutorDynamic(
+  auto executor = absl::WrapUnique(new LlmLiteRtCompiledModelExecutorDynamic(
       std::move(executor_settings), lrt_env, litert_model,
       std::move(compiled_model), std::move(decode_input_buffers),
       std::move(decode_output_buffers), k_dynamic_dim, v_dynamic_dim,
@@ -1664,6 +2664,8 @@ LlmLiteRtCompiledModelExecutorDynamic::Create(
       std::move(value_cache_input_names), signatures, batch_size,
       std::move(weight_cache_path), std::move(embedding_lookup),
       std::move(per_layer_embedding_lookup)));
+  RETURN_IF_ERROR(executor->InitializeLoRA());
+  return executor;
 }
 
 }  // namespace litert::lm
@@ -16,6 +16,7 @@
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_LLM_LITERT_COMPILED_MODEL_EXECUTOR_H_
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
@@ -24,6 +25,7 @@
 
 #include "absl/base/nullability.h"  // from @com_google_absl
 #include "absl/container/flat_hash_map.h"  // from @com_google_absl
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
 #include "absl/log/absl_log.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
@@ -34,14 +36,19 @@
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/embedding_lookup/embedding_lookup_manager.h"
+#include "runtime/components/lora.h"
+#include "runtime/components/lora_manager.h"
 #include "runtime/components/model_resources.h"
 #include "runtime/components/sampler.h"
 #include "runtime/executor/executor_settings_base.h"
+#include "runtime/executor/kv_cache_prefix_cache.h"
 #include "runtime/executor/litert_compiled_model_executor_utils.h"
 #include "runtime/executor/llm_executor.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/llm_executor_processed_tokens.h"
 #include "runtime/executor/llm_executor_settings.h"
+#include "runtime/executor/llm_litert_compiled_model_cache_utils.h"
+#include "runtime/executor/speculative_decoding_util.h"
 
 namespace litert::lm {
 
@@ -103,11 +110,38 @@ class LlmLiteRtCompiledModelExecutorBase : public LlmExecutor {
   // Resets all of the internal states.
   absl::Status Reset() override;
 
+  // Creates a new KV cache context. The first context created reuses the KV
+  // cache buffers allocated along with the executor, the following ones
+  // allocate their own KV cache buffers.
+  absl::StatusOr<std::unique_ptr<LlmExecutorContext>> CreateContext() override;
+
+  absl::Status SwitchContext(LlmExecutorContext* context) override;
+
+  // Copies the processed tokens and the live KV cache buffers of the given
+  // context into a new context.
+  absl::StatusOr<std::unique_ptr<LlmExecutorContext>> CloneContext(
+      LlmExecutorContext* context) override;
+
+  absl::Status ReleaseContext(
+      std::unique_ptr<LlmExecutorContext> context) override;
+
   absl::StatusOr<int> GetVocabSize() override;
 
+  // Fails if the model has no LoRA inputs.
+  absl::Status LoadLoRA(uint32_t lora_id,
+                        const ModelAssets& model_assets) override;
+
+  // The contexts using the same LoRA share its weights. When a context of a
+  // different LoRA becomes active, its weights are bound as the inputs of the
+  // model on the next Prefill or Decode.
+  absl::Status UseLoRA(std::optional<uint32_t> lora_id) override;
+
   // Initializes the sampler.
   absl::Status InitializeSampler();
 
+  // Returns the prefix KV cache, or null if the executor does not have one.
+  virtual const KvCachePrefixCache* GetPrefixCache() const { return nullptr; }
+
   using LogitsDataType = ActivationDataType;
 
   const ProcessedTokens& processed_tokens_for_testing() const {
@@ -158,6 +192,64 @@ class LlmLiteRtCompiledModelExecutorBase : public LlmExecutor {
         logits_data_type_(logits_data_type) {}
 
  protected:
+  // Identifies which of the KV cache buffers input_kv_cache_buffers_ or
+  // output_kv_cache_buffers_ points to, so that the pointers can be restored
+  // when the context becomes active again.
+  enum class KvCacheBuffersSlot {
+    kFirst,
+    kSecond,
+    kDecodeFirst,
+    kDecodeSecond,
+  };
+
+  // The states of a context while it is inactive. The states of the active
+  // context are held by the member variables of the executor, so switching
+  // contexts only moves the buffer handles without copying the KV cache.
+  struct KvCacheContext : public LlmExecutorContext {
+    absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>
+        kv_cache_buffers_1;
+    absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>
+        kv_cache_buffers_2;
+    std::optional<
+        absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>>
+        decode_kv_cache_buffers_1;
+    std::optional<
+        absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>>
+        decode_kv_cache_buffers_2;
+    KvCacheBuffersSlot input_slot = KvCacheBuffersSlot::kFirst;
+    KvCacheBuffersSlot output_slot = KvCacheBuffersSlot::kSecond;
+    bool ran_decode = false;
+    int current_step = 0;
+    ProcessedTokens processed_tokens;
+    std::optional<uint32_t> lora_id;
+    // Whether this context refers to the default context of the executor
+    // instead of holding states on its own.
+    bool is_default = false;
+  };
+
+  // Allocates the KV cache buffers of a newly created context. The KV cache
+  // buffers are left empty by default, i.e. allocated lazily on prefill.
+  virtual absl::Status CreateContextKvCacheBuffers(KvCacheContext& context) {
+    return absl::OkStatus();
+  }
+
+  // Called after a different context became active.
+  virtual absl::Status OnContextSwitched() { return absl::OkStatus(); }
+
+  // Moves the states of the active context into the given context.
+  void SaveActiveContext(KvCacheContext& context);
+
+  // Moves the states of the given context into the active context.
+  void LoadActiveContext(KvCacheContext& context);
+
+  // Creates the LoRA manager if the model has LoRA inputs. Must be called once
+  // the executor is created, since the LoRAs refer to the compiled model.
+  absl::Status InitializeLoRA();
+
+  // Makes lora_input_buffers_ hold the weights of the given LoRA, or zeros if
+  // `lora_id` is not set.
+  absl::Status BindLoRA(std::optional<uint32_t> lora_id);
+
   // Samples output logits and write to ids_tensor.
   absl::Status SampleLogits(const TensorBuffer& logits,
                             TensorBuffer& ids_tensor);
@@ -178,6 +270,11 @@ class LlmLiteRtCompiledModelExecutorBase : public LlmExecutor {
       int step, const std::vector<std::shared_ptr<TokenData>>& token,
       TensorBuffer& output_logits);
 
+  // Updates the decode attention mask for the given step. Only the positions
+  // between the previous step and `step` are touched, unless the mask has to be
+  // initialized.
+  absl::Status UpdateDecodeAttentionMask(int step);
+
   // Create Prefill input buffers for a given signature.
   absl::Status CreatePrefillInputBuffers(
       absl::string_view prefill_signature, int sequence_length,
@@ -208,6 +305,11 @@ class LlmLiteRtCompiledModelExecutorBase : public LlmExecutor {
   absl::Status ConsumePendingOrAddProcessedToken(
       const std::vector<std::shared_ptr<TokenData>>& token);
 
+  // If context shifting is enabled, makes room in the KV cache for
+  // `num_tokens` tokens after the processed tokens and the pending input token
+  // by evicting the oldest tokens after the attention sink tokens.
+  absl::Status ShiftContextIfNeeded(int num_tokens);
+
   LlmExecutorSettings executor_settings_;
   ::litert::Environment& env_;
   const ::litert::Model& model_;
@@ -236,6 +338,11 @@ class LlmLiteRtCompiledModelExecutorBase : public LlmExecutor {
   // The signatures of the model.
   ModelSignatures signatures_;
 
+  // The step the decode attention mask is filled for, so that it can be
+  // extended incrementally. -1 if the mask needs to be initialized, e.g. after
+  // the mask buffer is re-created.
+  int decode_attn_mask_step_ = -1;
+
   // The sampled ids to use for external sampling.
   // The layout is batch-major.
   // e.g. for output_batch_size=2, the layout is:
@@ -257,6 +364,19 @@ class LlmLiteRtCompiledModelExecutorBase : public LlmExecutor {
   // track of the pending input token, if any.
   ProcessedTokens processed_tokens_;
 
+  // The length of the KV cache the context is shifted within, or 0 if context
+  // shifting is disabled.
+  int context_shift_kv_cache_length_ = 0;
+  // The number of tokens at the beginning of the context never evicted by
+  // context shifting.
+  int num_attention_sink_tokens_ = 0;
+  // The number of tokens evicted at once by context shifting, or 0 to evict
+  // half of the tokens after the attention sink tokens.
+  int num_context_shift_tokens_ = 0;
+  // The rotary position embedding of each layer of the model, or a single
+  // entry for all of them.
+  std::vector<RopeParams> context_shift_layer_rope_params_;
+
   // The path to the weight cache directory. Executor will take the ownership of
   // this path to maintain the path lifecycle.
   std::string weight_cache_path_;
@@ -270,6 +390,36 @@ class LlmLiteRtCompiledModelExecutorBase : public LlmExecutor {
   // The logits data type of the model, used to determine the data type of the
   // logits tensor for gpu sampling.
   LogitsDataType logits_data_type_;
+
+  // The LoRA manager, or null if the model has no LoRA inputs.
+  std::unique_ptr<LoraManager> lora_manager_;
+
+  // The LoRA with all-zero weights, bound when no LoRA is used.
+  std::unique_ptr<LoRA> zero_lora_;
+
+  // The LoRA inputs of the model bound on every Prefill and Decode, and the
+  // LoRA they hold the weights of.
+  absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>
+      lora_input_buffers_;
+  std::optional<uint32_t> bound_lora_id_;
+
+  // The LoRA used by the active context.
+  std::optional<uint32_t> lora_id_;
+
+  // The context whose states are held by the member variables, or null if the
+  // default context is active.
+  KvCacheContext* active_context_ = nullptr;
+
+  // Incremented whenever the active context changes or a context is released,
+  // so that the states derived from the active context can be told apart from
+  // those of a later context, even one allocated at the same address.
+  uint64_t context_generation_ = 0;
+
+  // The states of the default context while another context is active.
+  KvCacheContext default_context_;
+
+  // Whether the default context has been handed out by CreateContext().
+  bool default_context_in_use_ = false;
 };
 
 // The static executor for the prefill-decode compiled model.
@@ -281,11 +431,51 @@ class LlmLiteRtCompiledModelExecutorStatic
   Create(LlmExecutorSettings executor_settings, Environment& lrt_env,
          ModelResources& resources);
 
+  using LlmLiteRtCompiledModelExecutorBase::Decode;
   using LlmLiteRtCompiledModelExecutorBase::Prefill;
 
   absl::Status Prefill(const ExecutorInputs& inputs,
                        const ExecutorPrefillParams& params) override;
 
+  // Decodes speculatively if the model has a verify signature, i.e. draft
+  // tokens are proposed by the draft model or looked up in the processed
+  // tokens, depending on the speculative decoding mode of `decode_params`, and
+  // the main model verifies them in a single pass. The tokens accepted by a
+  // verification pass are returned by this and the following calls one at a
+  // time, as long as the caller does not change the context in between. Falls
+  // back to the regular decode with constrained decoding or more than one
+  // output candidate.
+  absl::Status Decode(::litert::TensorBuffer& output_tokens,
+                      const ExecutorDecodeParams& decode_params) override;
+
+  // Also resets the draft model.
+  absl::Status Reset() override;
+
+  const KvCachePrefixCache* GetPrefixCache() const override {
+    return prefix_cache_.get();
+  }
+
+  const SpeculativeDecodingStats* GetSpeculativeDecodingStats() const override {
+    return num_draft_tokens_ > 0 ? &speculative_decoding_stats_ : nullptr;
+  }
+
+  // Runs the verification pass of speculative decoding in place of the verify
+  // signature: returns the logits of shape [tokens.size(), vocab_size] of the
+  // `tokens` at the positions starting at `step`.
+  using VerifyFunction = absl::AnyInvocable<absl::StatusOr<std::vector<float>>(
+      int step, absl::Span<const int> tokens)>;
+
+  // Makes the executor decode speculatively with up to `num_draft_tokens`
+  // draft tokens verified by `verify`, for testing with models without a
+  // verify signature.
+  void SetVerifyFunctionForTesting(VerifyFunction verify,
+                                   int num_draft_tokens);
+
+ protected:
+  // Allocates KV cache buffers of the same signatures as the ones allocated in
+  // Create().
+  absl::Status CreateContextKvCacheBuffers(KvCacheContext& context) override;
+
  private:
   LlmLiteRtCompiledModelExecutorStatic(
       LlmExecutorSettings executor_settings, ::litert::Environment& env,
@@ -324,6 +514,39 @@ class LlmLiteRtCompiledModelExecutorStatic
             logits_data_type),
         prefill_signature_map_(std::move(prefill_signature_map)) {}
 
+  // Creates the executor of the given model, i.e. the main model or the draft
+  // model of speculative decoding.
+  static absl::StatusOr<std::unique_ptr<LlmLiteRtCompiledModelExecutorStatic>>
+  CreateFromModel(LlmExecutorSettings executor_settings, Environment& lrt_env,
+                  ModelResources& resources, ModelType model_type);
+
+  // Creates the draft model executor and the buffers of the verification pass
+  // if speculative decoding is enabled. Speculative decoding is left disabled
+  // with a warning if the model does not support it.
+  absl::Status InitializeSpeculativeDecoding(Environment& lrt_env,
+                                             ModelResources& resources);
+
+  // Prefills the given token ids with the prefill signatures covering them.
+  absl::Status PrefillIds(absl::Span<const int> ids);
+
+  // Enables context shifting within the KV cache with the given settings.
+  absl::Status InitializeContextShifting(const AdvancedSettings& settings);
+
+  // Makes the processed tokens of this draft model executor the given tokens,
+  // rolling back the ones which diverge from them and prefilling the rest. The
+  // last token is left pending, so that the next decode proposes the token
+  // following it.
+  absl::Status SyncDraftTokens(absl::Span<const int> tokens);
+
+  // Runs the draft model from the tokens of the active context and returns the
+  // `num_tokens` tokens it proposes after the pending input token.
+  absl::StatusOr<std::vector<int>> ProposeDraftTokens(int num_tokens);
+
+  // Runs the verification pass of the main model on the pending input token at
+  // `step` followed by the draft tokens, and returns the accepted tokens.
+  absl::StatusOr<std::vector<int>> VerifyDraftTokens(
+      int step, int pending_token, absl::Span<const int> draft_tokens);
+
   SortedPrefillSignatureMap prefill_signature_map_;
   // Signature names are unique across all signatures in a model so it is safe
   // to refer to them by just their unique name.
@@ -331,6 +554,33 @@ class LlmLiteRtCompiledModelExecutorStatic
                       absl::flat_hash_map<absl::string_view /*input_name*/,
                                           ::litert::TensorBuffer>>
       prefill_input_buffers_;
+
+  // The prefix KV cache shared by all the contexts. Null if disabled.
+  std::unique_ptr<KvCachePrefixCache> prefix_cache_;
+
+  // The draft model executor of speculative decoding. Null if disabled.
+  std::unique_ptr<LlmLiteRtCompiledModelExecutorStatic> draft_executor_;
+  // The maximum number of draft tokens verified at once. 0 if the model can
+  // not decode speculatively.
+  int num_draft_tokens_ = 0;
+  // The output tokens buffer of the draft model decode.
+  ::litert::TensorBuffer draft_output_tokens_;
+  // The input and output logits buffers of the verify signature.
+  absl::flat_hash_map<absl::string_view, ::litert::TensorBuffer>
+      verify_input_buffers_;
+  ::litert::TensorBuffer verify_output_logits_;
+  // Replaces the verify signature if set. See SetVerifyFunctionForTesting().
+  VerifyFunction verify_for_testing_;
+  // The number of KV cache entries the verification pass can attend to.
+  int verify_kv_cache_length_ = 0;
+  // The tokens accepted by the last verification pass which are not returned
+  // by Decode() yet, and the state they were accepted in: the step and id of
+  // the pending input token, and the generation of the active context.
+  std::deque<int> speculated_tokens_;
+  int speculated_step_ = 0;
+  int speculated_pending_token_ = 0;
+  uint64_t speculated_context_generation_ = 0;
+  SpeculativeDecodingStats speculative_decoding_stats_;
 };
 
 // The dynamic executor for the prefill-decode compiled model.
@@ -348,6 +598,10 @@ class LlmLiteRtCompiledModelExecutorDynamic
   absl::Status Prefill(const ExecutorInputs& inputs,
                        const ExecutorPrefillParams& params) override;
 
+  // Also returns the KV cache buffers to the pool, so that the next prefill
+  // starts with a short KV cache again.
+  absl::Status Reset() override;
+
  private:
   LlmLiteRtCompiledModelExecutorDynamic(
       LlmExecutorSettings executor_settings, ::litert::Environment& env,
@@ -387,11 +641,32 @@ class LlmLiteRtCompiledModelExecutorDynamic
       int step, const std::vector<std::shared_ptr<TokenData>>& token,
       TensorBuffer& output_logits) override;
 
+  // Resolves the dynamic KV cache shapes of the compiled model to the length
+  // of the KV cache buffers of the newly active context.
+  absl::Status OnContextSwitched() override;
+
+  // Returns the length of the active KV cache buffers, or 0 if they are not
+  // allocated yet.
+  absl::StatusOr<int> GetKvCacheLength();
+
+  // Grows the active KV cache buffers to hold at least `num_entries` entries,
+  // or allocates them if not allocated yet, and resolves the dynamic KV cache
+  // shapes of the compiled model accordingly. The length is rounded up by
+  // GetKvCacheCapacity() so that the buffers are reallocated only O(log n)
+  // times over a long generation. Returns the resulting length.
+  absl::StatusOr<int> ReserveKvCacheBuffers(int num_entries);
+
   int key_dynamic_dim_index_;
   int value_dynamic_dim_index_;
+  // The KV cache allocation granularity in entries.
   uint32_t kv_increament_size_;
   std::vector<std::string> key_cache_input_names_;
   std::vector<std::string> value_cache_input_names_;
+  // The KV cache length the decode attention mask buffer is created for.
+  int decode_attn_mask_kv_len_ = 0;
+  // The KV cache buffers released by growing or resetting the KV cache. The
+  // byte budget follows the largest KV cache allocated so far.
+  KvCacheBufferPool kv_cache_buffer_pool_{/*max_bytes=*/0};
 };
 
 }  // namespace litert::lm
@@ -46,8 +46,10 @@
 #include "runtime/components/model_resources_task.h"
 #include "runtime/components/tokenizer.h"
 #include "runtime/executor/executor_settings_base.h"
+#include "runtime/executor/kv_cache_prefix_cache.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/llm_executor_settings.h"
+#include "runtime/executor/speculative_decoding_util.h"
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/litert_lm_loader.h"
 #include "runtime/util/model_asset_bundle_resources.h"
@@ -58,6 +60,8 @@
 namespace litert::lm {
 namespace {
 
+using ::testing::ElementsAre;
+using ::testing::status::IsOkAndHolds;
 using ::testing::status::StatusIs;
 
 constexpr char kTestStaticModelPath[] =
@@ -271,6 +275,304 @@ TEST(LlmLiteRtCompiledModelExecutorStaticTest, ConstrainedDecodeTest) {
   }
 }
 
+TEST(LlmLiteRtCompiledModelExecutorStaticTest, SwitchContextTest) {
+  auto model_path =
+      std::filesystem::path(::testing::SrcDir()) / kTestStaticModelPath;
+  ASSERT_OK_AND_ASSIGN(auto model_resources,
+                       CreateExecutorModelResourcesTask(model_path.string()));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(model_path.string()));
+  auto executor_settings =
+      LlmExecutorSettings::CreateDefault(model_assets, Backend::CPU);
+  executor_settings->SetCacheDir(":nocache");
+  executor_settings->SetMaxNumTokens(kMaxNumTokens);
+  ::litert::lm::CpuConfig config;
+  config.number_of_threads = kNumThreads;
+  executor_settings->SetBackendConfig(config);
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto env, Environment::Create(std::vector<Environment::Option>()));
+  ASSERT_OK_AND_ASSIGN(auto executor,
+                       LlmLiteRtCompiledModelExecutorStatic::Create(
+                           *executor_settings, env, *model_resources));
+  ASSERT_NE(executor, nullptr);
+
+  ASSERT_OK_AND_ASSIGN(auto context_1, executor->CreateContext());
+  ASSERT_OK_AND_ASSIGN(auto context_2, executor->CreateContext());
+
+  const std::vector<int> input_tokens = {1, 2, 0};
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto input_tokens_buffer,
+      CopyToTensorBuffer<int>(absl::MakeSpan(input_tokens), {1, 3}));
+  ExecutorInputs inputs;
+  inputs.SetTextData(ExecutorTextData(std::move(input_tokens_buffer)));
+
+  // Prefill the same prompt in both contexts.
+  EXPECT_OK(executor->SwitchContext(context_1.get()));
+  EXPECT_OK(executor->Prefill(inputs));
+  EXPECT_OK(executor->SwitchContext(context_2.get()));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 0);
+  }
+  EXPECT_OK(executor->Prefill(inputs));
+
+  // Decoding in the first context must not affect the second context.
+  LITERT_ASSERT_OK_AND_ASSIGN(auto output_tokens,
+                              CreateTensorBuffer<int>({1, 1}));
+  EXPECT_OK(executor->SwitchContext(context_1.get()));
+  EXPECT_OK(executor->Decode(output_tokens));
+  EXPECT_OK(executor->Decode(output_tokens));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 5);
+  }
+
+  EXPECT_OK(executor->SwitchContext(context_2.get()));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 3);
+  }
+  EXPECT_OK(executor->Decode(output_tokens));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 4);
+    auto output_tokens_span = ReferTensorBufferAsSpan<int>(output_tokens);
+    EXPECT_EQ((*output_tokens_span)[0], 8005);
+  }
+
+  EXPECT_OK(executor->ReleaseContext(std::move(context_2)));
+  EXPECT_OK(executor->ReleaseContext(std::move(context_1)));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 0);
+  }
+}
+
+TEST(LlmLiteRtCompiledModelExecutorStaticTest, CloneContextTest) {
+  auto model_path =
+      std::filesystem::path(::testing::SrcDir()) / kTestStaticModelPath;
+  ASSERT_OK_AND_ASSIGN(auto model_resources,
+                       CreateExecutorModelResourcesTask(model_path.string()));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(model_path.string()));
+  auto executor_settings =
+      LlmExecutorSettings::CreateDefault(model_assets, Backend::CPU);
+  executor_settings->SetCacheDir(":nocache");
+  executor_settings->SetMaxNumTokens(kMaxNumTokens);
+  ::litert::lm::CpuConfig config;
+  config.number_of_threads = kNumThreads;
+  executor_settings->SetBackendConfig(config);
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto env, Environment::Create(std::vector<Environment::Option>()));
+  ASSERT_OK_AND_ASSIGN(auto executor,
+                       LlmLiteRtCompiledModelExecutorStatic::Create(
+                           *executor_settings, env, *model_resources));
+  ASSERT_NE(executor, nullptr);
+
+  ASSERT_OK_AND_ASSIGN(auto context, executor->CreateContext());
+  EXPECT_OK(executor->SwitchContext(context.get()));
+
+  const std::vector<int> input_tokens = {1, 2, 0};
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto input_tokens_buffer,
+      CopyToTensorBuffer<int>(absl::MakeSpan(input_tokens), {1, 3}));
+  ExecutorInputs inputs;
+  inputs.SetTextData(ExecutorTextData(std::move(input_tokens_buffer)));
+  EXPECT_OK(executor->Prefill(inputs));
+
+  // Clone the active context, and decode in the clone.
+  ASSERT_OK_AND_ASSIGN(auto clone, executor->CloneContext(context.get()));
+  LITERT_ASSERT_OK_AND_ASSIGN(auto output_tokens,
+                              CreateTensorBuffer<int>({1, 1}));
+  EXPECT_OK(executor->SwitchContext(clone.get()));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 3);
+  }
+  EXPECT_OK(executor->Decode(output_tokens));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 4);
+    auto output_tokens_span = ReferTensorBufferAsSpan<int>(output_tokens);
+    EXPECT_EQ((*output_tokens_span)[0], 8005);
+  }
+
+  // The original context is not affected by decoding in the clone.
+  EXPECT_OK(executor->SwitchContext(context.get()));
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 3);
+  }
+  EXPECT_OK(executor->Decode(output_tokens));
+  {
+    auto output_tokens_span = ReferTensorBufferAsSpan<int>(output_tokens);
+    EXPECT_EQ((*output_tokens_span)[0], 8005);
+  }
+
+  EXPECT_OK(executor->ReleaseContext(std::move(clone)));
+  EXPECT_OK(executor->ReleaseContext(std::move(context)));
+}
+
+TEST(LlmLiteRtCompiledModelExecutorStaticTest, PrefixCacheTest) {
+  auto model_path =
+      std::filesystem::path(::testing::SrcDir()) / kTestStaticModelPath;
+  ASSERT_OK_AND_ASSIGN(auto model_resources,
+                       CreateExecutorModelResourcesTask(model_path.string()));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(model_path.string()));
+  auto executor_settings =
+      LlmExecutorSettings::CreateDefault(model_assets, Backend::CPU);
+  executor_settings->SetCacheDir(":nocache");
+  executor_settings->SetMaxNumTokens(kMaxNumTokens);
+  ::litert::lm::CpuConfig config;
+  config.number_of_threads = kNumThreads;
+  executor_settings->SetBackendConfig(config);
+  executor_settings->SetAdvancedSettings(
+      AdvancedSettings{.prefix_cache_max_bytes = 1 << 30});
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto env, Environment::Create(std::vector<Environment::Option>()));
+  ASSERT_OK_AND_ASSIGN(auto executor,
+                       LlmLiteRtCompiledModelExecutorStatic::Create(
+                           *executor_settings, env, *model_resources));
+  ASSERT_NE(executor, nullptr);
+  const KvCachePrefixCache* prefix_cache = executor->GetPrefixCache();
+  ASSERT_NE(prefix_cache, nullptr);
+
+  const std::vector<int> input_tokens = {1, 2, 0};
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto input_tokens_buffer,
+      CopyToTensorBuffer<int>(absl::MakeSpan(input_tokens), {1, 3}));
+  ExecutorInputs inputs;
+  inputs.SetTextData(ExecutorTextData(std::move(input_tokens_buffer)));
+  LITERT_ASSERT_OK_AND_ASSIGN(auto output_tokens,
+                              CreateTensorBuffer<int>({1, 1}));
+
+  // The first prefill misses and caches the KV cache of {1, 2}.
+  EXPECT_OK(executor->Prefill(inputs));
+  EXPECT_EQ(prefix_cache->stats().misses, 1);
+  EXPECT_EQ(prefix_cache->num_entries(), 1);
+  EXPECT_OK(executor->Decode(output_tokens));
+  {
+    auto output_tokens_span = ReferTensorBufferAsSpan<int>(output_tokens);
+    EXPECT_EQ((*output_tokens_span)[0], 8005);
+  }
+
+  // The same prompt after a reset restores the cached prefix and decodes the
+  // same token.
+  EXPECT_OK(executor->Reset());
+  EXPECT_OK(executor->Prefill(inputs));
+  EXPECT_EQ(prefix_cache->stats().hits, 1);
+  EXPECT_EQ(prefix_cache->stats().reused_tokens, 2);
+  {
+    ASSERT_OK_AND_ASSIGN(auto current_step, executor->GetCurrentStep());
+    EXPECT_EQ(current_step, 3);
+  }
+  EXPECT_OK(executor->Decode(output_tokens));
+  {
+    auto output_tokens_span = ReferTensorBufferAsSpan<int>(output_tokens);
+    EXPECT_EQ((*output_tokens_span)[0], 8005);
+  }
+
+  // A snapshot holds only the KV cache entries of its prefix tokens, so the
+  // snapshot of a twice as long prefix takes twice the memory.
+  const size_t two_token_snapshot_bytes = prefix_cache->size_bytes();
+  EXPECT_GT(two_token_snapshot_bytes, 0);
+  const std::vector<int> longer_input_tokens = {3, 4, 5, 6, 0};
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto longer_input_tokens_buffer,
+      CopyToTensorBuffer<int>(absl::MakeSpan(longer_input_tokens), {1, 5}));
+  ExecutorInputs longer_inputs;
+  longer_inputs.SetTextData(
+      ExecutorTextData(std::move(longer_input_tokens_buffer)));
+  EXPECT_OK(executor->Reset());
+  EXPECT_OK(executor->Prefill(longer_inputs));
+  EXPECT_EQ(prefix_cache->num_entries(), 2);
+  EXPECT_EQ(prefix_cache->size_bytes(), 3 * two_token_snapshot_bytes);
+}
+
+TEST(LlmLiteRtCompiledModelExecutorStaticTest,
+     ContextShiftingMatchesPrefillOfKeptTokens) {
+  auto model_path =
+      std::filesystem::path(::testing::SrcDir()) / kTestStaticModelPath;
+  ASSERT_OK_AND_ASSIGN(auto model_resources,
+                       CreateExecutorModelResourcesTask(model_path.string()));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(model_path.string()));
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto env, Environment::Create(std::vector<Environment::Option>()));
+  auto create_executor = [&](bool enable_context_shifting)
+      -> absl::StatusOr<std::unique_ptr<LlmLiteRtCompiledModelExecutorStatic>> {
+    auto executor_settings =
+        LlmExecutorSettings::CreateDefault(model_assets, Backend::CPU);
+    executor_settings->SetCacheDir(":nocache");
+    executor_settings->SetMaxNumTokens(kMaxNumTokens);
+    ::litert::lm::CpuConfig config;
+    config.number_of_threads = kNumThreads;
+    executor_settings->SetBackendConfig(config);
+    executor_settings->SetAdvancedSettings(
+        AdvancedSettings{.enable_context_shifting = enable_context_shifting,
+                         .num_attention_sink_tokens = 2});
+    return LlmLiteRtCompiledModelExecutorStatic::Create(*executor_settings,
+                                                        env, *model_resources);
+  };
+  auto prefill = [](LlmLiteRtCompiledModelExecutorStatic& executor,
+                    std::vector<int> tokens) -> absl::Status {
+    LITERT_ASSIGN_OR_RETURN(
+        auto tokens_buffer,
+        CopyToTensorBuffer<int>(absl::MakeSpan(tokens),
+                                {1, static_cast<int>(tokens.size())}));
+    ExecutorInputs inputs;
+    inputs.SetTextData(ExecutorTextData(std::move(tokens_buffer)));
+    return executor.Prefill(inputs);
+  };
+
+  ASSERT_OK_AND_ASSIGN(auto executor,
+                       create_executor(/*enable_context_shifting=*/true));
+  // The max number of tokens is the real KV cache length with shifting.
+  ASSERT_OK_AND_ASSIGN(auto settings, executor->GetExecutorSettings());
+  const int kv_cache_length = settings.GetMaxNumTokens();
+  ASSERT_GT(kv_cache_length, 16);
+
+  // Fill the KV cache to almost full, then prefill past its capacity.
+  std::vector<int> tokens(kv_cache_length + 8);
+  for (int i = 0; i < static_cast<int>(tokens.size()); ++i) {
+    tokens[i] = 10 + (i * 37) % 1000;
+  }
+  const int num_first_tokens = kv_cache_length - 4;
+  ASSERT_OK(prefill(*executor, std::vector<int>(
+                                   tokens.begin(),
+                                   tokens.begin() + num_first_tokens)));
+  ASSERT_OK(prefill(*executor, std::vector<int>(
+                                   tokens.begin() + num_first_tokens,
+                                   tokens.end())));
+  ASSERT_OK_AND_ASSIGN(int current_step, executor->GetCurrentStep());
+  ASSERT_LT(current_step, static_cast<int>(tokens.size()))
+      << "The context was not shifted.";
+
+  // The reference prefills only the kept tokens, i.e. the attention sinks and
+  // the most recent tokens, at their new positions.
+  std::vector<int> kept_tokens(tokens.begin(), tokens.begin() + 2);
+  kept_tokens.insert(kept_tokens.end(), tokens.end() - (current_step - 2),
+                     tokens.end());
+  ASSERT_OK_AND_ASSIGN(auto reference,
+                       create_executor(/*enable_context_shifting=*/false));
+  ASSERT_OK(prefill(*reference, kept_tokens));
+
+  LITERT_ASSERT_OK_AND_ASSIGN(auto output_tokens,
+                              CreateTensorBuffer<int>({1, 1}));
+  LITERT_ASSERT_OK_AND_ASSIGN(auto reference_output_tokens,
+                              CreateTensorBuffer<int>({1, 1}));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_OK(executor->Decode(output_tokens));
+    ASSERT_OK(reference->Decode(reference_output_tokens));
+    auto output_tokens_span = ReferTensorBufferAsSpan<int>(output_tokens);
+    auto reference_output_tokens_span =
+        ReferTensorBufferAsSpan<int>(reference_output_tokens);
+    EXPECT_EQ((*output_tokens_span)[0], (*reference_output_tokens_span)[0])
+        << "decode step " << i;
+  }
+}
+
 TEST(LlmLiteRtCompiledModelExecutorStaticTest, DecodeLogitsTest) {
   auto model_path =
       std::filesystem::path(::testing::SrcDir()) / kTestStaticModelPath;
@@ -322,6 +624,169 @@ TEST(LlmLiteRtCompiledModelExecutorStaticTest, DecodeLogitsTest) {
   }
 }
 
+TEST(LlmLiteRtCompiledModelExecutorStaticTest,
+     PromptLookupDecodeReturnsOnlyAcceptedTokens) {
+  auto model_path =
+      std::filesystem::path(::testing::SrcDir()) / kTestStaticModelPath;
+  ASSERT_OK_AND_ASSIGN(auto model_resources,
+                       CreateExecutorModelResourcesTask(model_path.string()));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(model_path.string()));
+  auto executor_settings =
+      LlmExecutorSettings::CreateDefault(model_assets, Backend::CPU);
+  executor_settings->SetCacheDir(":nocache");
+  executor_settings->SetMaxNumTokens(kMaxNumTokens);
+  ::litert::lm::CpuConfig config;
+  config.number_of_threads = kNumThreads;
+  executor_settings->SetBackendConfig(config);
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto env, Environment::Create(std::vector<Environment::Option>()));
+  ASSERT_OK_AND_ASSIGN(auto executor,
+                       LlmLiteRtCompiledModelExecutorStatic::Create(
+                           *executor_settings, env, *model_resources));
+  ASSERT_NE(executor, nullptr);
+  ASSERT_OK_AND_ASSIGN(const int vocab_size, executor->GetVocabSize());
+
+  // The fake main model predicts `token + 1` after every token but 13, which
+  // it follows with 99.
+  std::vector<int> verify_steps;
+  std::vector<std::vector<int>> verify_tokens;
+  executor->SetVerifyFunctionForTesting(
+      [&](int step,
+          absl::Span<const int> tokens) -> absl::StatusOr<std::vector<float>> {
+        verify_steps.push_back(step);
+        verify_tokens.emplace_back(tokens.begin(), tokens.end());
+        std::vector<float> logits(tokens.size() * vocab_size, 0.0f);
+        for (size_t i = 0; i < tokens.size(); ++i) {
+          const int next_token = tokens[i] == 13 ? 99 : tokens[i] + 1;
+          logits[i * vocab_size + next_token] = 1.0f;
+        }
+        return logits;
+      },
+      /*num_draft_tokens=*/3);
+
+  auto prefill = [&](const std::vector<int>& ids) -> absl::Status {
+    LITERT_ASSIGN_OR_RETURN(
+        auto ids_buffer,
+        CopyToTensorBuffer<int>(absl::MakeConstSpan(ids),
+                                {1, static_cast<int>(ids.size())}));
+    ExecutorInputs inputs;
+    inputs.SetTextData(ExecutorTextData(std::move(ids_buffer)));
+    return executor->Prefill(inputs);
+  };
+  ExecutorDecodeParams decode_params;
+  decode_params.SetSpeculativeDecodingMode(
+      SpeculativeDecodingMode::kPromptLookup);
+  LITERT_ASSERT_OK_AND_ASSIGN(auto output_tokens,
+                              CreateTensorBuffer<int>({1, 1}));
+  auto decode = [&]() -> absl::StatusOr<int> {
+    RETURN_IF_ERROR(executor->Decode(output_tokens, decode_params));
+    LITERT_ASSIGN_OR_RETURN(auto token,
+                            CopyFromTensorBuffer<int32_t>(output_tokens));
+    return token[0];
+  };
+
+  // The bigram (10, 11) drafts 12, 13, 14 from the prompt, and the main model
+  // rejects 14 in favor of 99.
+  EXPECT_OK(prefill({10, 11, 12, 13, 14, 10, 11}));
+  EXPECT_THAT(decode(), IsOkAndHolds(12));
+  EXPECT_THAT(decode(), IsOkAndHolds(13));
+  EXPECT_THAT(decode(), IsOkAndHolds(99));
+  EXPECT_THAT(verify_steps, ElementsAre(6));
+  EXPECT_THAT(verify_tokens, ElementsAre(ElementsAre(11, 12, 13, 14)));
+  EXPECT_THAT(
+      executor->processed_tokens_for_testing().GetProcessedTokenIds(0),
+      ElementsAre(10, 11, 12, 13, 14, 10, 11, 12, 13));
+  ASSERT_OK_AND_ASSIGN(int current_step, executor->GetCurrentStep());
+  EXPECT_EQ(current_step, 10);
+
+  const SpeculativeDecodingStats* stats =
+      executor->GetSpeculativeDecodingStats();
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->num_verify_steps, 1);
+  EXPECT_EQ(stats->num_draft_tokens, 3);
+  EXPECT_EQ(stats->num_accepted_tokens, 2);
+}
+
+TEST(LlmLiteRtCompiledModelExecutorStaticTest,
+     PrefillDiscardsUnconsumedSpeculatedTokens) {
+  auto model_path =
+      std::filesystem::path(::testing::SrcDir()) / kTestStaticModelPath;
+  ASSERT_OK_AND_ASSIGN(auto model_resources,
+                       CreateExecutorModelResourcesTask(model_path.string()));
+  ASSERT_OK_AND_ASSIGN(auto model_assets,
+                       ModelAssets::Create(model_path.string()));
+  auto executor_settings =
+      LlmExecutorSettings::CreateDefault(model_assets, Backend::CPU);
+  executor_settings->SetCacheDir(":nocache");
+  executor_settings->SetMaxNumTokens(kMaxNumTokens);
+  ::litert::lm::CpuConfig config;
+  config.number_of_threads = kNumThreads;
+  executor_settings->SetBackendConfig(config);
+  LITERT_ASSERT_OK_AND_ASSIGN(
+      auto env, Environment::Create(std::vector<Environment::Option>()));
+  ASSERT_OK_AND_ASSIGN(auto executor,
+                       LlmLiteRtCompiledModelExecutorStatic::Create(
+                           *executor_settings, env, *model_resources));
+  ASSERT_NE(executor, nullptr);
+  ASSERT_OK_AND_ASSIGN(const int vocab_size, executor->GetVocabSize());
+
+  std::vector<int> verify_steps;
+  executor->SetVerifyFunctionForTesting(
+      [&](int step,
+          absl::Span<const int> tokens) -> absl::StatusOr<std::vector<float>> {
+        verify_steps.push_back(step);
+        std::vector<float> logits(tokens.size() * vocab_size, 0.0f);
+        for (size_t i = 0; i < tokens.size(); ++i) {
+          const int next_token = tokens[i] == 13 ? 99 : tokens[i] + 1;
+          logits[i * vocab_size + next_token] = 1.0f;
+        }
+        return logits;
+      },
+      /*num_draft_tokens=*/3);
+
+  auto prefill = [&](const std::vector<int>& ids) -> absl::Status {
+    LITERT_ASSIGN_OR_RETURN(
+        auto ids_buffer,
+        CopyToTensorBuffer<int>(absl::MakeConstSpan(ids),
+                                {1, static_cast<int>(ids.size())}));
+    ExecutorInputs inputs;
+    inputs.SetTextData(ExecutorTextData(std::move(ids_buffer)));
+    return executor->Prefill(inputs);
+  };
+  ExecutorDecodeParams decode_params;
+  decode_params.SetSpeculativeDecodingMode(
+      SpeculativeDecodingMode::kPromptLookup);
+  LITERT_ASSERT_OK_AND_ASSIGN(auto output_tokens,
+                              CreateTensorBuffer<int>({1, 1}));
+  auto decode = [&]() -> absl::StatusOr<int> {
+    RETURN_IF_ERROR(executor->Decode(output_tokens, decode_params));
+    LITERT_ASSIGN_OR_RETURN(auto token,
+                            CopyFromTensorBuffer<int32_t>(output_tokens));
+    return token[0];
+  };
+
+  EXPECT_OK(prefill({10, 11, 12, 13, 14, 10, 11}));
+  EXPECT_THAT(decode(), IsOkAndHolds(12));
+
+  // 13 and 99 are still speculated, but the prefill moves the pending input
+  // token, so the next decode verifies a new draft 11, 12, 13 found by the
+  // trigram (13, 14, 10).
+  EXPECT_OK(prefill({13, 14, 10}));
+  EXPECT_THAT(decode(), IsOkAndHolds(11));
+  EXPECT_THAT(verify_steps, ElementsAre(6, 10));
+  EXPECT_THAT(
+      executor->processed_tokens_for_testing().GetProcessedTokenIds(0),
+      ElementsAre(10, 11, 12, 13, 14, 10, 11, 12, 13, 14, 10));
+
+  const SpeculativeDecodingStats* stats =
+      executor->GetSpeculativeDecodingStats();
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->num_verify_steps, 2);
+  EXPECT_EQ(stats->num_draft_tokens, 6);
+  EXPECT_EQ(stats->num_accepted_tokens, 5);
+}
+
 TEST(LlmLiteRtCompiledModelExecutorStaticTest, CreateExecutorTest_WithCache) {
   auto cache_path = std::filesystem::path(::testing::TempDir()) /
                     absl::StrCat("cache-", std::rand());
@@ -0,0 +1,117 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/executor/speculative_decoding_util.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/strings/str_cat.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+std::ostream& operator<<(std::ostream& os, SpeculativeDecodingMode mode) {
+  switch (mode) {
+    case SpeculativeDecodingMode::kDraftModel:
+      return os << "DRAFT_MODEL";
+    case SpeculativeDecodingMode::kPromptLookup:
+      return os << "PROMPT_LOOKUP";
+    case SpeculativeDecodingMode::kDisabled:
+      return os << "DISABLED";
+  }
+  return os << "UNKNOWN";
+}
+
+absl::StatusOr<std::vector<int>> AcceptDraftTokensGreedily(
+    absl::Span<const int> draft_tokens, absl::Span<const float> logits,
+    int vocab_size) {
+  if (vocab_size <= 0) {
+    return absl::InvalidArgumentError("The vocabulary size must be positive.");
+  }
+  const size_t num_positions = draft_tokens.size() + 1;
+  if (logits.size() < num_positions * vocab_size) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Expected the logits of at least ", num_positions,
+        " positions, but got ", logits.size() / vocab_size, "."));
+  }
+
+  std::vector<int> tokens;
+  tokens.reserve(num_positions);
+  for (size_t i = 0; i < num_positions; ++i) {
+    const absl::Span<const float> position_logits =
+        logits.subspan(i * vocab_size, vocab_size);
+    const int token =
+        std::max_element(position_logits.begin(), position_logits.end()) -
+        position_logits.begin();
+    tokens.push_back(token);
+    if (i == draft_tokens.size() || draft_tokens[i] != token) {
+      break;
+    }
+  }
+  return tokens;
+}
+
+std::vector<int> ProposePromptLookupTokens(absl::Span<const int> tokens,
+                                           int min_ngram_size,
+                                           int max_ngram_size, int num_tokens) {
+  if (tokens.empty()) {
+    return {};
+  }
+  return ProposePromptLookupTokens(tokens.first(tokens.size() - 1),
+                                   tokens.back(), min_ngram_size,
+                                   max_ngram_size, num_tokens);
+}
+
+std::vector<int> ProposePromptLookupTokens(absl::Span<const int> tokens,
+                                           int last_token, int min_ngram_size,
+                                           int max_ngram_size, int num_tokens) {
+  const int num_input_tokens = tokens.size() + 1;
+  auto token_at = [tokens, last_token](int i) {
+    return i < static_cast<int>(tokens.size()) ? tokens[i] : last_token;
+  };
+  min_ngram_size = std::max(min_ngram_size, 1);
+  max_ngram_size = std::min(max_ngram_size, num_input_tokens - 1);
+  for (int ngram_size = max_ngram_size; ngram_size >= min_ngram_size;
+       --ngram_size) {
+    const int ngram_start = num_input_tokens - ngram_size;
+    // The most recent occurrence is the most likely to be continued the same
+    // way.
+    for (int start = ngram_start - 1; start >= 0; --start) {
+      int num_matched = 0;
+      while (num_matched < ngram_size &&
+             token_at(start + num_matched) ==
+                 token_at(ngram_start + num_matched)) {
+        ++num_matched;
+      }
+      if (num_matched == ngram_size) {
+        const int begin = start + ngram_size;
+        const int end = std::min(begin + num_tokens, num_input_tokens);
+        std::vector<int> draft_tokens;
+        draft_tokens.reserve(end - begin);
+        for (int i = begin; i < end; ++i) {
+          draft_tokens.push_back(token_at(i));
+        }
+        return draft_tokens;
+      }
+    }
+  }
+  return {};
+}
+
+}  // namespace litert::lm
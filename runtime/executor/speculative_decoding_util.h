@@ -0,0 +1,82 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_SPECULATIVE_DECODING_UTIL_H_
+#define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_SPECULATIVE_DECODING_UTIL_H_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+// The source of the draft tokens of speculative decoding.
+enum class SpeculativeDecodingMode {
+  // The draft tokens are proposed by the draft model, if the model has one.
+  kDraftModel,
+  // The draft tokens are looked up in the processed tokens, i.e. they are the
+  // tokens following the last earlier occurrence of the most recent n-gram.
+  // Needs no draft model, and pays off when the output copies spans of the
+  // prompt.
+  kPromptLookup,
+  // Speculative decoding is disabled.
+  kDisabled,
+};
+std::ostream& operator<<(std::ostream& os, SpeculativeDecodingMode mode);
+
+// Cumulative statistics of speculative decoding.
+struct SpeculativeDecodingStats {
+  // The number of verification passes run by the main model.
+  uint64_t num_verify_steps = 0;
+  // The number of tokens proposed by the draft model.
+  uint64_t num_draft_tokens = 0;
+  // The number of proposed tokens accepted by the main model.
+  uint64_t num_accepted_tokens = 0;
+};
+
+// Returns the tokens produced by a greedy speculative decoding step.
+//
+// `draft_tokens` are the tokens proposed by the draft model after the last
+// token, and `logits` are the logits the main model computed at the last token
+// and at each draft token, i.e. of shape `[draft_tokens.size() + 1,
+// vocab_size]` or longer. The draft tokens are accepted as long as they are the
+// argmax of the logits before them, and are followed by the argmax of the
+// logits at the last accepted token. The 1 to `draft_tokens.size() + 1`
+// returned tokens are thus the ones greedy decoding with the main model alone
+// would produce.
+absl::StatusOr<std::vector<int>> AcceptDraftTokensGreedily(
+    absl::Span<const int> draft_tokens, absl::Span<const float> logits,
+    int vocab_size);
+
+// Returns the draft tokens of prompt lookup decoding, i.e. at most `num_tokens`
+// tokens following the last earlier occurrence of the longest n-gram ending
+// `tokens`, with n between `min_ngram_size` and `max_ngram_size`. Returns no
+// tokens if none of the n-grams occurred before.
+std::vector<int> ProposePromptLookupTokens(absl::Span<const int> tokens,
+                                           int min_ngram_size,
+                                           int max_ngram_size, int num_tokens);
+
+// Same as above for the tokens `tokens` followed by `last_token`, so that the
+// caller can search its token buffer in place instead of copying it with the
+// last token appended on every decode step.
+std::vector<int> ProposePromptLookupTokens(absl::Span<const int> tokens,
+                                           int last_token, int min_ngram_size,
+                                           int max_ngram_size, int num_tokens);
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_SPECULATIVE_DECODING_UTIL_H_
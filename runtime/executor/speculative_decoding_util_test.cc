@@ -0,0 +1,126 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/executor/speculative_decoding_util.h"
+
+#include <sstream>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"  // from @com_google_absl
+#include "runtime/util/test_utils.h"  // IWYU pragma: keep
+
+namespace litert::lm {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::status::StatusIs;
+
+constexpr int kVocabSize = 4;
+
+// Returns the logits of positions whose argmax are the given tokens.
+std::vector<float> MakeLogits(const std::vector<int>& argmax_tokens) {
+  std::vector<float> logits(argmax_tokens.size() * kVocabSize, 0.0f);
+  for (int i = 0; i < argmax_tokens.size(); ++i) {
+    logits[i * kVocabSize + argmax_tokens[i]] = 1.0f;
+  }
+  return logits;
+}
+
+TEST(AcceptDraftTokensGreedilyTest, AcceptsAllDraftTokens) {
+  std::vector<int> draft_tokens = {1, 2, 3};
+  std::vector<float> logits = MakeLogits({1, 2, 3, 0});
+  ASSERT_OK_AND_ASSIGN(
+      auto tokens, AcceptDraftTokensGreedily(draft_tokens, logits, kVocabSize));
+  EXPECT_THAT(tokens, ElementsAre(1, 2, 3, 0));
+}
+
+TEST(AcceptDraftTokensGreedilyTest, StopsAtFirstMismatch) {
+  std::vector<int> draft_tokens = {1, 2, 3};
+  std::vector<float> logits = MakeLogits({1, 0, 3, 0});
+  ASSERT_OK_AND_ASSIGN(
+      auto tokens, AcceptDraftTokensGreedily(draft_tokens, logits, kVocabSize));
+  EXPECT_THAT(tokens, ElementsAre(1, 0));
+}
+
+TEST(AcceptDraftTokensGreedilyTest, RejectsAllDraftTokens) {
+  std::vector<int> draft_tokens = {1, 2};
+  std::vector<float> logits = MakeLogits({3, 2, 0});
+  ASSERT_OK_AND_ASSIGN(
+      auto tokens, AcceptDraftTokensGreedily(draft_tokens, logits, kVocabSize));
+  EXPECT_THAT(tokens, ElementsAre(3));
+}
+
+TEST(AcceptDraftTokensGreedilyTest, FailsWithTooFewLogits) {
+  std::vector<int> draft_tokens = {1, 2};
+  std::vector<float> logits = MakeLogits({1, 2});
+  EXPECT_THAT(AcceptDraftTokensGreedily(draft_tokens, logits, kVocabSize),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ProposePromptLookupTokensTest, ProposesContinuationOfLongestNgram) {
+  // The bigram {2, 3} occurred at the start, while the unigram {3} occurred
+  // more recently.
+  std::vector<int> tokens = {2, 3, 4, 5, 6, 3, 7, 2, 3};
+  EXPECT_THAT(ProposePromptLookupTokens(tokens, /*min_ngram_size=*/1,
+                                        /*max_ngram_size=*/3,
+                                        /*num_tokens=*/3),
+              ElementsAre(4, 5, 6));
+}
+
+TEST(ProposePromptLookupTokensTest, ProposesContinuationOfLastOccurrence) {
+  std::vector<int> tokens = {1, 2, 3, 1, 2, 4, 1, 2};
+  EXPECT_THAT(ProposePromptLookupTokens(tokens, /*min_ngram_size=*/2,
+                                        /*max_ngram_size=*/2,
+                                        /*num_tokens=*/4),
+              ElementsAre(4, 1, 2));
+}
+
+TEST(ProposePromptLookupTokensTest, ProposesNothingWithoutMatch) {
+  std::vector<int> tokens = {1, 2, 3, 4, 2};
+  EXPECT_THAT(ProposePromptLookupTokens(tokens, /*min_ngram_size=*/2,
+                                        /*max_ngram_size=*/3,
+                                        /*num_tokens=*/4),
+              IsEmpty());
+  EXPECT_THAT(ProposePromptLookupTokens({1}, /*min_ngram_size=*/1,
+                                        /*max_ngram_size=*/3,
+                                        /*num_tokens=*/4),
+              IsEmpty());
+}
+
+TEST(ProposePromptLookupTokensTest, ProposesFromTokensFollowedByLastToken) {
+  const std::vector<int> tokens = {1, 2, 3, 1, 2, 4, 1};
+  // The last token is proposed if it follows the matched n-gram.
+  EXPECT_THAT(ProposePromptLookupTokens(tokens, /*last_token=*/2,
+                                        /*min_ngram_size=*/2,
+                                        /*max_ngram_size=*/2,
+                                        /*num_tokens=*/4),
+              ElementsAre(4, 1, 2));
+  EXPECT_THAT(ProposePromptLookupTokens({}, /*last_token=*/1,
+                                        /*min_ngram_size=*/1,
+                                        /*max_ngram_size=*/3,
+                                        /*num_tokens=*/4),
+              IsEmpty());
+}
+
+TEST(SpeculativeDecodingModeTest, Print) {
+  std::stringstream oss;
+  oss << SpeculativeDecodingMode::kPromptLookup;
+  EXPECT_EQ(oss.str(), "PROMPT_LOOKUP");
+}
+
+}  // namespace
+}  // namespace litert::lm
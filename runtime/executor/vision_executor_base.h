@@ -15,9 +15,11 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_VISION_EXECUTOR_BASE_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_VISION_EXECUTOR_BASE_H_
 
+#include <utility>
 #include <vector>
 
 #include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/executor/llm_executor_io_types.h"
 
@@ -37,6 +39,24 @@ class VisionExecutorBase {
   virtual absl::StatusOr<ExecutorVisionData> Encode(
       const litert::TensorBuffer& input_image_tensor) = 0;
 
+  // Encodes multiple images, each with the input shape of the API above, into
+  // the vision data of each image. Executors which can encode several images
+  // at once override this. By default, the images are encoded one by one.
+  virtual absl::StatusOr<std::vector<ExecutorVisionData>> Encode(
+      absl::Span<const litert::TensorBuffer* const> input_image_tensors) {
+    std::vector<ExecutorVisionData> vision_data;
+    vision_data.reserve(input_image_tensors.size());
+    for (const litert::TensorBuffer* input_image_tensor : input_image_tensors) {
+      absl::StatusOr<ExecutorVisionData> single_vision_data =
+          Encode(*input_image_tensor);
+      if (!single_vision_data.ok()) {
+        return single_vision_data.status();
+      }
+      vision_data.push_back(*std::move(single_vision_data));
+    }
+    return vision_data;
+  }
+
   // Get the expected input dimension of the vision executor.
   // [batch, height, width, channels]
   virtual absl::StatusOr<std::vector<int>> GetExpectedInputDimension()
@@ -67,6 +67,8 @@ std::ostream& operator<<(std::ostream& os,
   os << "  ModelAssets: " << settings.GetModelAssets() << std::endl;
   os << "  EncoderBackend: " << settings.GetEncoderBackend() << std::endl;
   os << "  AdapterBackend: " << settings.GetAdapterBackend() << std::endl;
+  os << "  EncodedImageCacheMaxBytes: "
+     << settings.GetEncodedImageCacheMaxBytes() << std::endl;
   return os;
 }
 
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_VISION_EXECUTOR_SETTINGS_H_
 #define THIRD_PARTY_ODML_LITERT_LM_RUNTIME_EXECUTOR_VISION_EXECUTOR_SETTINGS_H_
 
+#include <cstdint>
 #include <ostream>
 
 #include "absl/status/status.h"  // from @com_google_absl
@@ -46,6 +47,15 @@ class VisionExecutorSettings : public ExecutorSettingsBase {
   // Setter for adapter_backend.
   absl::Status SetAdapterBackend(Backend backend);
 
+  // Getter for encoded_image_cache_max_bytes.
+  uint64_t GetEncodedImageCacheMaxBytes() const {
+    return encoded_image_cache_max_bytes_;
+  }
+  // Setter for encoded_image_cache_max_bytes.
+  void SetEncodedImageCacheMaxBytes(uint64_t max_bytes) {
+    encoded_image_cache_max_bytes_ = max_bytes;
+  }
+
  private:
   explicit VisionExecutorSettings(const ModelAssets& model_assets)
       : ExecutorSettingsBase(model_assets) {}
@@ -55,6 +65,12 @@ class VisionExecutorSettings : public ExecutorSettingsBase {
 
   // The backend to use for the vision adapter model.
   Backend adapter_backend_;
+
+  // The byte budget of the embeddings of the encoded images kept in memory, so
+  // that an image sent again is not encoded again, including the copies of the
+  // images kept to verify the cache hits. If 0, the encoded images are not
+  // cached.
+  uint64_t encoded_image_cache_max_bytes_ = 0;
 };
 
 std::ostream& operator<<(std::ostream& os,
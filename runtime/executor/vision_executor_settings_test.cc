@@ -61,6 +61,18 @@ TEST(VisionExecutorSettingsTest, GetAndSetAdapterBackend) {
   EXPECT_EQ(settings.GetAdapterBackend(), Backend::CPU);
 }
 
+TEST(VisionExecutorSettingsTest, GetAndSetEncodedImageCacheMaxBytes) {
+  ASSERT_OK_AND_ASSIGN(ModelAssets model_assets, ModelAssets::Create(""));
+  ASSERT_OK_AND_ASSIGN(
+      VisionExecutorSettings settings,
+      VisionExecutorSettings::CreateDefault(model_assets,
+                                            /*encoder_backend=*/Backend::GPU,
+                                            /*adapter_backend=*/Backend::GPU));
+  EXPECT_EQ(settings.GetEncodedImageCacheMaxBytes(), 0);
+  settings.SetEncodedImageCacheMaxBytes(1024);
+  EXPECT_EQ(settings.GetEncodedImageCacheMaxBytes(), 1024);
+}
+
 TEST(VisionExecutorSettingsTest, CreateDefaultWithInvalidBackend) {
   ASSERT_OK_AND_ASSIGN(ModelAssets model_assets, ModelAssets::Create(""));
   // Vision encoder supports GPU, CPU and NPU backends.
@@ -14,6 +14,9 @@
 
 #include "runtime/executor/vision_litert_compiled_model_executor.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <memory>
 #include <optional>
 #include <string>
@@ -33,6 +36,7 @@
 #endif  // !defined(LITERT_DISABLE_NPU)
 #include "litert/cc/litert_compiled_model.h"  // from @litert
 #include "litert/cc/litert_environment.h"  // from @litert
+#include "litert/cc/litert_layout.h"  // from @litert
 #include "litert/cc/litert_macros.h"  // from @litert
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_options.h"  // from @litert
@@ -41,6 +45,7 @@
 #include "litert/cc/options/litert_gpu_options.h"  // from @litert
 #include "litert/cc/options/litert_runtime_options.h"  // from @litert
 #include "runtime/components/model_resources.h"
+#include "runtime/executor/encoded_image_cache.h"
 #include "runtime/executor/executor_settings_base.h"
 #include "runtime/executor/litert_compiled_model_executor_utils.h"
 #include "runtime/executor/llm_executor_io_types.h"
@@ -48,6 +53,7 @@
 #include "runtime/util/convert_tensor_buffer.h"
 #include "runtime/util/file_util.h"
 #include "runtime/util/status_macros.h"  // NOLINT
+#include "runtime/util/tensor_buffer_util.h"
 
 namespace litert::lm {
 
@@ -255,16 +261,97 @@ litert::lm::VisionLiteRtCompiledModelExecutor::Create(
   auto expected_input_dimension =
       std::vector<int>(dimensions.begin(), dimensions.end());
 
-  return absl::WrapUnique(new VisionLiteRtCompiledModelExecutor(
+  auto executor = absl::WrapUnique(new VisionLiteRtCompiledModelExecutor(
       vision_executor_settings, env, std::move(resources),
       std::move(vision_encoder), std::move(vision_adapter),
       expected_input_dimension));
+  if (vision_executor_settings.GetEncodedImageCacheMaxBytes() > 0) {
+    executor->encoded_image_cache_ = std::make_unique<EncodedImageCache>(
+        vision_executor_settings.GetEncodedImageCacheMaxBytes());
+  }
+  return executor;
 }
 
 absl::StatusOr<ExecutorVisionData> VisionLiteRtCompiledModelExecutor::Encode(
     const litert::TensorBuffer& input_image_tensor) {
-  LITERT_ASSIGN_OR_RETURN(auto input_image_tensor_ref,
-                               input_image_tensor.Duplicate());
+  const litert::TensorBuffer* input_image_tensors[] = {&input_image_tensor};
+  ASSIGN_OR_RETURN(std::vector<ExecutorVisionData> vision_data,
+                   Encode(absl::MakeConstSpan(input_image_tensors)));
+  return std::move(vision_data[0]);
+}
+
+absl::StatusOr<std::vector<ExecutorVisionData>>
+VisionLiteRtCompiledModelExecutor::Encode(
+    absl::Span<const litert::TensorBuffer* const> input_image_tensors) {
+  const int num_images = input_image_tensors.size();
+  std::vector<std::optional<ExecutorVisionData>> vision_data(num_images);
+  // The contents and dimensions of the images, to look up the cache with.
+  std::vector<absl::Span<const float>> images(num_images);
+  std::vector<std::vector<int>> image_dimensions(num_images);
+  // The indices of the images which are not cached.
+  std::vector<int> images_to_encode;
+  for (int i = 0; i < num_images; ++i) {
+    if (encoded_image_cache_ != nullptr) {
+      LITERT_ASSIGN_OR_RETURN(
+          images[i], ReferTensorBufferAsSpan<float>(*input_image_tensors[i]));
+      image_dimensions[i] = TensorBufferDims(*input_image_tensors[i]);
+      if (const EncodedImageCache::Embeddings* embeddings =
+              encoded_image_cache_->Lookup(images[i], image_dimensions[i]);
+          embeddings != nullptr) {
+        LITERT_ASSIGN_OR_RETURN(
+            auto embeddings_buffer,
+            CopyToTensorBuffer<float>(
+                embeddings->values,
+                Dimensions(embeddings->dimensions.begin(),
+                           embeddings->dimensions.end())));
+        vision_data[i].emplace(std::move(embeddings_buffer),
+                               /*per_layer_embeddings=*/std::nullopt);
+        continue;
+      }
+    }
+    images_to_encode.push_back(i);
+  }
+
+  const int batch_size = expected_input_dimension_[0];
+  for (int begin = 0; begin < images_to_encode.size(); begin += batch_size) {
+    const int end =
+        std::min<int>(begin + batch_size, images_to_encode.size());
+    std::vector<const litert::TensorBuffer*> batch;
+    for (int j = begin; j < end; ++j) {
+      batch.push_back(input_image_tensors[images_to_encode[j]]);
+    }
+    ASSIGN_OR_RETURN(std::vector<ExecutorVisionData> batch_vision_data,
+                     EncodeBatch(batch));
+    for (int j = begin; j < end; ++j) {
+      const int i = images_to_encode[j];
+      vision_data[i] = std::move(batch_vision_data[j - begin]);
+      if (encoded_image_cache_ != nullptr) {
+        ASSIGN_OR_RETURN(const auto* embeddings_ptr,
+                         vision_data[i]->GetEmbeddingsPtr());
+        LITERT_ASSIGN_OR_RETURN(auto values,
+                                CopyFromTensorBuffer<float>(*embeddings_ptr));
+        encoded_image_cache_->Insert(
+            images[i], image_dimensions[i],
+            EncodedImageCache::Embeddings{
+                .dimensions = TensorBufferDims(*embeddings_ptr),
+                .values = std::move(values)});
+      }
+    }
+  }
+
+  std::vector<ExecutorVisionData> result;
+  result.reserve(num_images);
+  for (auto& single_vision_data : vision_data) {
+    result.push_back(*std::move(single_vision_data));
+  }
+  return result;
+}
+
+absl::StatusOr<std::vector<ExecutorVisionData>>
+VisionLiteRtCompiledModelExecutor::EncodeBatch(
+    absl::Span<const litert::TensorBuffer* const> input_image_tensors) {
+  const int batch_size = expected_input_dimension_[0];
+  RET_CHECK_LE(input_image_tensors.size(), batch_size);
   LITERT_ASSIGN_OR_RETURN(
       auto output_tensor_buffers,
       vision_adapter_->GetCompiledModel().CreateOutputBuffers(
@@ -276,11 +363,31 @@ absl::StatusOr<ExecutorVisionData> VisionLiteRtCompiledModelExecutor::Encode(
                      output_tensor_buffers.size()));
   }
 
-  LITERT_ASSIGN_OR_RETURN(auto input_image_data,
-                          ReferTensorBufferAsSpan<float>(input_image_tensor));
-  LITERT_RETURN_IF_ERROR(
-      vision_encoder_->GetMutableInputBuffers()[0].Write<float>(
-          input_image_data));
+  {
+    // The images are laid out one after another in the batch, and the unused
+    // images of the batch are zeros.
+    TensorBuffer& encoder_input = vision_encoder_->GetMutableInputBuffers()[0];
+    LITERT_ASSIGN_OR_RETURN(size_t encoder_input_size,
+                            encoder_input.PackedSize());
+    const size_t image_size = encoder_input_size / batch_size;
+    LITERT_ASSIGN_OR_RETURN(
+        auto encoder_input_lock_and_addr,
+        TensorBufferScopedLock::Create(encoder_input,
+                                       TensorBuffer::LockMode::kWrite));
+    auto* encoder_input_ptr =
+        static_cast<uint8_t*>(encoder_input_lock_and_addr.second);
+    memset(encoder_input_ptr, 0, encoder_input_size);
+    for (const litert::TensorBuffer* input_image_tensor : input_image_tensors) {
+      LITERT_ASSIGN_OR_RETURN(
+          auto input_image_data,
+          ReferTensorBufferAsSpan<float>(*input_image_tensor));
+      const size_t input_image_size = input_image_data.size() * sizeof(float);
+      RET_CHECK_LE(input_image_size, image_size)
+          << "The input image is larger than the vision encoder input.";
+      memcpy(encoder_input_ptr, input_image_data.data(), input_image_size);
+      encoder_input_ptr += image_size;
+    }
+  }
   auto& encoder_outputs = vision_encoder_->GetMutableOutputBuffers();
   if (encoder_outputs[0].IsWebGpuMemory()) {
     // For WebGPU memory, we need to create a new output buffer to hold the
@@ -300,8 +407,33 @@ absl::StatusOr<ExecutorVisionData> VisionLiteRtCompiledModelExecutor::Encode(
       /*input_buffers=*/encoder_outputs,
       /*output_buffers=*/output_tensor_buffers));
 
-  return ExecutorVisionData(std::move(output_tensor_buffers[0]),
-                            /*per_layer_embeddings=*/std::nullopt);
+  std::vector<ExecutorVisionData> vision_data;
+  vision_data.reserve(input_image_tensors.size());
+  if (batch_size == 1) {
+    vision_data.emplace_back(std::move(output_tensor_buffers[0]),
+                             /*per_layer_embeddings=*/std::nullopt);
+    return vision_data;
+  }
+
+  // Split the embeddings of the batch into the embeddings of each image.
+  std::vector<int> dimensions = TensorBufferDims(output_tensor_buffers[0]);
+  RET_CHECK_EQ(dimensions[0], batch_size)
+      << "The Vision Adapter output must have the batch size of the input.";
+  dimensions[0] = 1;
+  LITERT_ASSIGN_OR_RETURN(
+      auto embeddings, CopyFromTensorBuffer<float>(output_tensor_buffers[0]));
+  const size_t image_embeddings_size = embeddings.size() / batch_size;
+  for (int i = 0; i < input_image_tensors.size(); ++i) {
+    LITERT_ASSIGN_OR_RETURN(
+        auto image_embeddings,
+        CopyToTensorBuffer<float>(
+            absl::MakeConstSpan(embeddings).subspan(i * image_embeddings_size,
+                                                    image_embeddings_size),
+            Dimensions(dimensions.begin(), dimensions.end())));
+    vision_data.emplace_back(std::move(image_embeddings),
+                             /*per_layer_embeddings=*/std::nullopt);
+  }
+  return vision_data;
 }
 
 absl::StatusOr<std::vector<int>>
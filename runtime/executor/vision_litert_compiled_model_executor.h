@@ -22,11 +22,13 @@
 #include "absl/base/nullability.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
+#include "absl/types/span.h"  // from @com_google_absl
 #include "litert/cc/litert_compiled_model.h"  // from @litert
 #include "litert/cc/litert_environment.h"  // from @litert
 #include "litert/cc/litert_model.h"  // from @litert
 #include "litert/cc/litert_tensor_buffer.h"  // from @litert
 #include "runtime/components/model_resources.h"
+#include "runtime/executor/encoded_image_cache.h"
 #include "runtime/executor/executor_settings_base.h"
 #include "runtime/executor/llm_executor_io_types.h"
 #include "runtime/executor/vision_executor.h"
@@ -54,6 +56,14 @@ class VisionLiteRtCompiledModelExecutor : public VisionExecutor {
   absl::StatusOr<ExecutorVisionData> Encode(
       const litert::TensorBuffer& input_image_tensor) override;
 
+  // Encodes the input image tensors into the vision embeddings of each image.
+  // The images are encoded as many at once as the batch size of the vision
+  // encoder model, and the embeddings of the images encoded before are taken
+  // from the encoded image cache if it is enabled.
+  absl::StatusOr<std::vector<ExecutorVisionData>> Encode(
+      absl::Span<const litert::TensorBuffer* const> input_image_tensors)
+      override;
+
   // Returns the expected input dimension of the vision encoder model.
   absl::StatusOr<std::vector<int>> GetExpectedInputDimension() const override;
 
@@ -184,6 +194,12 @@ class VisionLiteRtCompiledModelExecutor : public VisionExecutor {
     CompiledModel compiled_model_;
   };
 
+  // Runs the vision encoder and vision adapter models once on the input image
+  // tensors, which must not outnumber the batch size of the vision encoder
+  // model.
+  absl::StatusOr<std::vector<ExecutorVisionData>> EncodeBatch(
+      absl::Span<const litert::TensorBuffer* const> input_image_tensors);
+
   explicit VisionLiteRtCompiledModelExecutor(
       const VisionExecutorSettings& vision_executor_settings, Environment& env,
       std::unique_ptr<ModelResources> resources,
@@ -215,6 +231,9 @@ class VisionLiteRtCompiledModelExecutor : public VisionExecutor {
 
   // The expected input dimension of the vision encoder model.
   std::vector<int> expected_input_dimension_;
+
+  // The embeddings of the encoded images, or null if they are not cached.
+  std::unique_ptr<EncodedImageCache> encoded_image_cache_;
 };
 
 }  // namespace litert::lm
@@ -0,0 +1,200 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_LOCK_FREE_QUEUE_H_
+#define THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_LOCK_FREE_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/log/absl_check.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+// A fixed-capacity Chase-Lev work-stealing deque of pointers. The owner thread
+// pushes and pops at the bottom, while any other thread steals from the top.
+// The memory orders follow "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (Le et al., PPoPP 2013). The deque doesn't own the pointees.
+template <typename T>
+class WorkStealingDeque {
+ public:
+  // capacity must be a power of 2.
+  explicit WorkStealingDeque(size_t capacity)
+      : mask_(capacity - 1),
+        buffer_(std::make_unique<std::atomic<T*>[]>(capacity)) {
+    ABSL_CHECK(capacity > 0 && (capacity & mask_) == 0)
+        << "Capacity must be a power of 2: " << capacity;
+  }
+
+  // Pushes the item at the bottom. Returns false if the deque is full. Must be
+  // called by the owner thread only.
+  bool Push(T* item) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+    if (bottom - top > static_cast<int64_t>(mask_)) {
+      return false;
+    }
+    buffer_[bottom & mask_].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Pops the item at the bottom, i.e. the last pushed one. Returns null if the
+  // deque is empty. Must be called by the owner thread only.
+  T* Pop() {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      // Empty.
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* item = buffer_[bottom & mask_].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // The last item, which a thief may be stealing at the same time.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Steals the item at the top, i.e. the first pushed one. Returns null if the
+  // deque is empty or another thread took the item first. Thread-safe.
+  T* Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    T* item = buffer_[top & mask_].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  // Whether the deque looks empty. It may be stale by the time it returns.
+  bool Empty() const {
+    return top_.load(std::memory_order_seq_cst) >=
+           bottom_.load(std::memory_order_seq_cst);
+  }
+
+ private:
+  const size_t mask_;
+  std::unique_ptr<std::atomic<T*>[]> buffer_;
+  // Kept on separate cache lines, since the owner writes bottom_ while the
+  // thieves write top_.
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+};
+
+// A fixed-capacity multi-producer multi-consumer FIFO queue of pointers, after
+// Dmitry Vyukov's bounded MPMC queue. Every operation takes a single
+// compare-and-swap when uncontended. The queue doesn't own the pointees.
+template <typename T>
+class BoundedMpmcQueue {
+ public:
+  // capacity must be a power of 2.
+  explicit BoundedMpmcQueue(size_t capacity)
+      : mask_(capacity - 1), cells_(std::make_unique<Cell[]>(capacity)) {
+    ABSL_CHECK(capacity > 0 && (capacity & mask_) == 0)
+        << "Capacity must be a power of 2: " << capacity;
+    for (size_t i = 0; i < capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Pushes the item at the back. Returns false if the queue is full.
+  bool Push(T* item) {
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (diff == 0) {
+        if (enqueue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->item = item;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pops the item at the front. Returns null if the queue is empty.
+  T* Pop() {
+    size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(sequence) -
+                            static_cast<intptr_t>(position + 1);
+      if (diff == 0) {
+        if (dequeue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        position = dequeue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    T* item = cell->item;
+    cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return item;
+  }
+
+  // Whether the queue looks empty. It may be stale by the time it returns.
+  bool Empty() const {
+    return dequeue_position_.load(std::memory_order_seq_cst) >=
+           enqueue_position_.load(std::memory_order_seq_cst);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T* item;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<size_t> enqueue_position_{0};
+  alignas(64) std::atomic<size_t> dequeue_position_{0};
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_LOCK_FREE_QUEUE_H_
@@ -0,0 +1,169 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "runtime/framework/lock_free_queue.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace litert::lm {
+namespace {
+
+TEST(WorkStealingDequeTest, PopsLastPushed) {
+  WorkStealingDeque<int> deque(4);
+  int items[] = {0, 1, 2};
+  EXPECT_EQ(deque.Pop(), nullptr);
+  for (int& item : items) {
+    EXPECT_TRUE(deque.Push(&item));
+  }
+  EXPECT_EQ(deque.Pop(), &items[2]);
+  EXPECT_EQ(deque.Pop(), &items[1]);
+  EXPECT_EQ(deque.Pop(), &items[0]);
+  EXPECT_EQ(deque.Pop(), nullptr);
+  EXPECT_TRUE(deque.Empty());
+}
+
+TEST(WorkStealingDequeTest, StealsFirstPushed) {
+  WorkStealingDeque<int> deque(4);
+  int items[] = {0, 1, 2};
+  for (int& item : items) {
+    EXPECT_TRUE(deque.Push(&item));
+  }
+  EXPECT_EQ(deque.Steal(), &items[0]);
+  EXPECT_EQ(deque.Pop(), &items[2]);
+  EXPECT_EQ(deque.Steal(), &items[1]);
+  EXPECT_EQ(deque.Steal(), nullptr);
+}
+
+TEST(WorkStealingDequeTest, PushFailsWhenFull) {
+  WorkStealingDeque<int> deque(2);
+  int items[] = {0, 1, 2};
+  EXPECT_TRUE(deque.Push(&items[0]));
+  EXPECT_TRUE(deque.Push(&items[1]));
+  EXPECT_FALSE(deque.Push(&items[2]));
+  EXPECT_EQ(deque.Steal(), &items[0]);
+  EXPECT_TRUE(deque.Push(&items[2]));
+}
+
+TEST(WorkStealingDequeTest, EveryItemIsTakenOnce) {
+  constexpr int kNumItems = 100000;
+  constexpr int kNumThieves = 3;
+  WorkStealingDeque<int> deque(64);
+  std::vector<int> items(kNumItems);
+  std::vector<std::atomic<int>> taken(kNumItems);
+  std::atomic<int> num_taken = 0;
+  auto take = [&](int* item) {
+    ++taken[item - items.data()];
+    ++num_taken;
+  };
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kNumThieves; ++i) {
+    thieves.emplace_back([&]() {
+      while (num_taken < kNumItems) {
+        if (int* item = deque.Steal(); item != nullptr) {
+          take(item);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kNumItems; ++i) {
+    while (!deque.Push(&items[i])) {
+      if (int* item = deque.Pop(); item != nullptr) {
+        take(item);
+      }
+    }
+    if (i % 3 == 0) {
+      if (int* item = deque.Pop(); item != nullptr) {
+        take(item);
+      }
+    }
+  }
+  while (num_taken < kNumItems) {
+    if (int* item = deque.Pop(); item != nullptr) {
+      take(item);
+    }
+  }
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+  for (int i = 0; i < kNumItems; ++i) {
+    EXPECT_EQ(taken[i], 1) << "item " << i;
+  }
+}
+
+TEST(BoundedMpmcQueueTest, PopsInOrder) {
+  BoundedMpmcQueue<int> queue(4);
+  int items[] = {0, 1, 2, 3, 4};
+  EXPECT_EQ(queue.Pop(), nullptr);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.Push(&items[i]));
+  }
+  EXPECT_FALSE(queue.Push(&items[4]));
+  EXPECT_EQ(queue.Pop(), &items[0]);
+  EXPECT_TRUE(queue.Push(&items[4]));
+  for (int i = 1; i < 5; ++i) {
+    EXPECT_EQ(queue.Pop(), &items[i]);
+  }
+  EXPECT_EQ(queue.Pop(), nullptr);
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(BoundedMpmcQueueTest, EveryItemIsTakenOnce) {
+  constexpr int kNumItemsPerProducer = 50000;
+  constexpr int kNumProducers = 2;
+  constexpr int kNumConsumers = 2;
+  constexpr int kNumItems = kNumItemsPerProducer * kNumProducers;
+  BoundedMpmcQueue<int> queue(64);
+  std::vector<int> items(kNumItems);
+  std::vector<std::atomic<int>> taken(kNumItems);
+  std::atomic<int> num_taken = 0;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kNumProducers; ++p) {
+    threads.emplace_back([&, p]() {
+      for (int i = 0; i < kNumItemsPerProducer; ++i) {
+        while (!queue.Push(&items[p * kNumItemsPerProducer + i])) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < kNumConsumers; ++c) {
+    threads.emplace_back([&]() {
+      while (num_taken < kNumItems) {
+        if (int* item = queue.Pop(); item != nullptr) {
+          ++taken[item - items.data()];
+          ++num_taken;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < kNumItems; ++i) {
+    EXPECT_EQ(taken[i], 1) << "item " << i;
+  }
+}
+
+}  // namespace
+}  // namespace litert::lm
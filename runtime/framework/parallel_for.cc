@@ -0,0 +1,43 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/framework/parallel_for.h"
+
+#include "absl/functional/function_ref.h"  // from @com_google_absl
+#include "absl/synchronization/blocking_counter.h"  // from @com_google_absl
+#include "runtime/framework/threadpool.h"
+
+namespace litert::lm {
+
+void ParallelFor(ThreadPool& thread_pool, int n,
+                 absl::FunctionRef<void(int)> fn) {
+  if (n <= 0) {
+    return;
+  }
+  absl::BlockingCounter counter(n - 1);
+  for (int i = 1; i < n; ++i) {
+    auto status = thread_pool.Schedule([fn, i, &counter]() {
+      fn(i);
+      counter.DecrementCount();
+    });
+    if (!status.ok()) {  // Run it inline if the pool cannot take it.
+      fn(i);
+      counter.DecrementCount();
+    }
+  }
+  fn(0);
+  counter.Wait();
+}
+
+}  // namespace litert::lm
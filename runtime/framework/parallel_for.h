@@ -0,0 +1,34 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_PARALLEL_FOR_H_
+#define THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_PARALLEL_FOR_H_
+
+#include "absl/functional/function_ref.h"  // from @com_google_absl
+#include "runtime/framework/threadpool.h"
+
+namespace litert::lm {
+
+// Runs fn(0), ..., fn(n - 1) on `thread_pool` and the calling thread, and
+// returns when all of them are done. fn(0) runs on the calling thread, and the
+// calls the pool can not take are run inline as well.
+//
+// The calls must not wait for each other, since they may run one after another
+// on the same thread.
+void ParallelFor(ThreadPool& thread_pool, int n,
+                 absl::FunctionRef<void(int)> fn);
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_PARALLEL_FOR_H_
@@ -0,0 +1,57 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/framework/parallel_for.h"
+
+#include <atomic>
+#include <thread>  // NOLINT: Required for std::this_thread::get_id().
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "runtime/framework/threadpool.h"
+
+namespace litert::lm {
+namespace {
+
+TEST(ParallelForTest, RunsEachIndexOnce) {
+  ThreadPool thread_pool("testpool", 4);
+  std::vector<std::atomic<int>> num_calls(100);
+  ParallelFor(thread_pool, num_calls.size(), [&num_calls](int i) {
+    num_calls[i].fetch_add(1);
+  });
+  for (const auto& n : num_calls) {
+    EXPECT_EQ(n.load(), 1);
+  }
+}
+
+TEST(ParallelForTest, RunsFirstIndexOnCallingThread) {
+  ThreadPool thread_pool("testpool", 4);
+  std::thread::id first_thread_id;
+  ParallelFor(thread_pool, 4, [&first_thread_id](int i) {
+    if (i == 0) {
+      first_thread_id = std::this_thread::get_id();
+    }
+  });
+  EXPECT_EQ(first_thread_id, std::this_thread::get_id());
+}
+
+TEST(ParallelForTest, RunsNothingForNoIndices) {
+  ThreadPool thread_pool("testpool", 4);
+  std::vector<int> called;
+  ParallelFor(thread_pool, 0, [&called](int i) { called.push_back(i); });
+  EXPECT_TRUE(called.empty());
+}
+
+}  // namespace
+}  // namespace litert::lm
@@ -0,0 +1,96 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "runtime/framework/serial_executor.h"
+
+#include <utility>
+
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
+#include "absl/log/absl_log.h"  // from @com_google_absl
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/strings/str_cat.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/time/clock.h"  // from @com_google_absl
+#include "absl/time/time.h"  // from @com_google_absl
+
+namespace litert::lm {
+
+SerialExecutor::~SerialExecutor() {
+  absl::MutexLock lock(mutex_);
+  auto is_done = [this]() {
+    mutex_.AssertHeld();
+    return !running_;
+  };
+  mutex_.Await(absl::Condition(&is_done));
+}
+
+absl::Status SerialExecutor::Schedule(absl::AnyInvocable<void() &&> callback) {
+  absl::MutexLock lock(mutex_);
+  tasks_.push_back(std::move(callback));
+  if (running_) {
+    // The running RunNext() picks the callback up.
+    return absl::OkStatus();
+  }
+  if (auto status = pool_.Schedule([this]() { RunNext(); }); !status.ok()) {
+    tasks_.pop_back();
+    return status;
+  }
+  running_ = true;
+  return absl::OkStatus();
+}
+
+absl::Status SerialExecutor::WaitUntilDone(absl::Duration timeout) {
+  absl::MutexLock lock(mutex_);
+  absl::Time deadline = absl::Now() + timeout;
+  auto is_done = [this]() {
+    mutex_.AssertHeld();
+    return !running_;
+  };
+  if (mutex_.AwaitWithDeadline(absl::Condition(&is_done), deadline)) {
+    return absl::OkStatus();
+  }
+  return absl::DeadlineExceededError(
+      absl::StrCat("Timeout waiting for all tasks to be done in serial "
+                   "executor. Tasks still in queue: ",
+                   tasks_.size()));
+}
+
+void SerialExecutor::RunNext() {
+  absl::MutexLock lock(mutex_);
+  while (true) {
+    auto task_to_run = std::move(tasks_.front());
+    tasks_.pop_front();
+
+    // Execute the task with mutex released.
+    mutex_.unlock();
+    std::move(task_to_run)();
+    mutex_.lock();
+
+    if (tasks_.empty()) {
+      running_ = false;
+      return;
+    }
+    // Yield the thread to the other tasks on the pool.
+    auto status = pool_.Schedule([this]() { RunNext(); });
+    if (status.ok()) {
+      return;
+    }
+    // The pool no longer accepts tasks, e.g. it is shutting down. Run the
+    // remaining tasks in place.
+    ABSL_LOG(WARNING) << "Failed to yield the serial executor: " << status;
+  }
+}
+
+}  // namespace litert::lm
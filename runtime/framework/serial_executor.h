@@ -0,0 +1,87 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_SERIAL_EXECUTOR_H_
+#define THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_SERIAL_EXECUTOR_H_
+
+#include <deque>
+
+#include "absl/base/nullability.h"  // from @com_google_absl
+#include "absl/base/thread_annotations.h"  // from @com_google_absl
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/time/time.h"  // from @com_google_absl
+#include "runtime/framework/threadpool.h"
+
+namespace litert::lm {
+
+// A serial executor (a.k.a. strand) runs the scheduled callbacks one at a time
+// in the order they were scheduled, on the threads of a shared thread pool.
+// Callbacks of different serial executors on the same pool run in parallel.
+//
+// Only one callback of the serial executor is queued on the pool at any time,
+// and the serial executor yields the thread after each callback, so that the
+// callbacks of all the serial executors on the pool are interleaved.
+//
+// Sample usage:
+//
+// {
+//   ThreadPool pool("testpool", max_num_workers);
+//   SerialExecutor serial_executor(&pool);
+//   for (int i = 0; i < N; ++i) {
+//     serial_executor.Schedule([i]() { DoWorkInOrder(i); });
+//   }
+// }
+//
+class SerialExecutor {
+ public:
+  // The pool must outlive the serial executor.
+  explicit SerialExecutor(ThreadPool* absl_nonnull pool) : pool_(*pool) {}
+
+  // Waits for the scheduled callbacks to finish.
+  ~SerialExecutor();
+
+  SerialExecutor(const SerialExecutor&) = delete;
+  SerialExecutor& operator=(const SerialExecutor&) = delete;
+
+  // Adds the callback to the queue of pending callbacks. It runs after all the
+  // callbacks scheduled before it are finished. Callbacks may schedule more
+  // callbacks on the same serial executor.
+  absl::Status Schedule(absl::AnyInvocable<void() &&> callback);
+
+  // Waits until all the scheduled callbacks are executed and finished. The
+  // function will return an error if the timeout is reached before all the
+  // callbacks are finished. It must not be called from a callback of this
+  // serial executor.
+  absl::Status WaitUntilDone(absl::Duration timeout);
+
+ private:
+  // Runs the first pending callback on the pool, and schedules itself again if
+  // there are more pending callbacks.
+  void RunNext();
+
+  ThreadPool& pool_;
+
+  absl::Mutex mutex_;
+  // The callbacks waiting for their turn.
+  std::deque<absl::AnyInvocable<void() &&>> tasks_ ABSL_GUARDED_BY(mutex_);
+  // Whether RunNext() is queued on or running on the pool.
+  bool running_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_SERIAL_EXECUTOR_H_
@@ -0,0 +1,132 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "runtime/framework/serial_executor.h"
+
+#include <atomic>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/synchronization/notification.h"  // from @com_google_absl
+#include "absl/time/clock.h"  // from @com_google_absl
+#include "absl/time/time.h"  // from @com_google_absl
+#include "runtime/framework/threadpool.h"
+#include "runtime/util/test_utils.h"  // NOLINT
+
+namespace litert::lm {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::status::StatusIs;
+
+TEST(SerialExecutorTest, RunsTasksInOrder) {
+  ThreadPool thread_pool("testpool", 4);
+  SerialExecutor serial_executor(&thread_pool);
+  absl::Mutex mutex;
+  std::vector<int> order;
+  std::vector<int> expected_order;
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_OK(serial_executor.Schedule([i, &mutex, &order]() {
+      absl::MutexLock lock(mutex);
+      order.push_back(i);
+    }));
+    expected_order.push_back(i);
+  }
+  EXPECT_OK(serial_executor.WaitUntilDone(absl::Seconds(10)));
+  absl::MutexLock lock(mutex);
+  EXPECT_THAT(order, ElementsAreArray(expected_order));
+}
+
+TEST(SerialExecutorTest, RunsTasksOneAtATime) {
+  ThreadPool thread_pool("testpool", 4);
+  SerialExecutor serial_executor(&thread_pool);
+  std::atomic<int> num_running_tasks = 0;
+  std::atomic<int> max_num_running_tasks = 0;
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_OK(serial_executor.Schedule(
+        [&num_running_tasks, &max_num_running_tasks]() {
+          int num_running = ++num_running_tasks;
+          if (num_running > max_num_running_tasks) {
+            max_num_running_tasks = num_running;
+          }
+          absl::SleepFor(absl::Microseconds(100));
+          --num_running_tasks;
+        }));
+  }
+  EXPECT_OK(serial_executor.WaitUntilDone(absl::Seconds(10)));
+  EXPECT_EQ(max_num_running_tasks, 1);
+}
+
+TEST(SerialExecutorTest, RunsTasksOfDifferentSerialExecutorsInParallel) {
+  ThreadPool thread_pool("testpool", 2);
+  SerialExecutor serial_executor1(&thread_pool);
+  SerialExecutor serial_executor2(&thread_pool);
+  absl::Notification started;
+  absl::Notification finished;
+  // The first task blocks until the task of the other serial executor runs.
+  EXPECT_OK(serial_executor1.Schedule([&started, &finished]() {
+    started.Notify();
+    finished.WaitForNotification();
+  }));
+  started.WaitForNotification();
+  EXPECT_OK(serial_executor2.Schedule([&finished]() { finished.Notify(); }));
+  EXPECT_OK(serial_executor2.WaitUntilDone(absl::Seconds(10)));
+  EXPECT_OK(serial_executor1.WaitUntilDone(absl::Seconds(10)));
+}
+
+TEST(SerialExecutorTest, TasksScheduleMoreTasks) {
+  ThreadPool thread_pool("testpool", 2);
+  SerialExecutor serial_executor(&thread_pool);
+  std::atomic<int> n = 0;
+  EXPECT_OK(serial_executor.Schedule([&serial_executor, &n]() {
+    ++n;
+    EXPECT_OK(serial_executor.Schedule([&n]() { ++n; }));
+  }));
+  EXPECT_OK(serial_executor.WaitUntilDone(absl::Seconds(10)));
+  EXPECT_EQ(n, 2);
+}
+
+TEST(SerialExecutorTest, WaitUntilDoneTimeout) {
+  ThreadPool thread_pool("testpool", 1);
+  SerialExecutor serial_executor(&thread_pool);
+  absl::Notification finished;
+  EXPECT_OK(serial_executor.Schedule(
+      [&finished]() { finished.WaitForNotification(); }));
+  EXPECT_THAT(serial_executor.WaitUntilDone(absl::Milliseconds(10)),
+              StatusIs(absl::StatusCode::kDeadlineExceeded));
+  finished.Notify();
+  EXPECT_OK(serial_executor.WaitUntilDone(absl::Seconds(10)));
+}
+
+TEST(SerialExecutorTest, DestructorWaitsForTasks) {
+  ThreadPool thread_pool("testpool", 2);
+  std::atomic<int> n = 0;
+  {
+    SerialExecutor serial_executor(&thread_pool);
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_OK(serial_executor.Schedule([&n]() {
+        absl::SleepFor(absl::Milliseconds(1));
+        ++n;
+      }));
+    }
+  }
+  EXPECT_EQ(n, 10);
+}
+
+}  // namespace
+}  // namespace litert::lm
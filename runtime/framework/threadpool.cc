@@ -80,7 +80,8 @@ absl::Status ThreadPool::Schedule(absl::AnyInvocable<void() &&> callback) {
   if (num_threads < max_num_threads_) {
     size_t num_tasks = num_active_tasks_ + tasks_.size();
     if (num_threads <= num_tasks) {
-      auto thread = WorkerThread::Create(this, name_prefix_);
+      auto thread = WorkerThread::Create(thread_options_, name_prefix_,
+                                         [this]() { RunWorker(); });
       if (thread.ok()) {
         threads_.push_back(std::move(*thread));
         ABSL_LOG(INFO) << "ThreadPool '" << name_prefix_
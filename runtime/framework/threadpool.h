@@ -30,7 +30,7 @@
 
 namespace litert::lm {
 
-// Forward declaration of WorkerThread to avoid circular dependency.
+// Forward declaration of WorkerThread to keep the header light.
 class WorkerThread;
 
 // A thread pool consists of a set of threads that sit around waiting
@@ -93,8 +93,6 @@ class ThreadPool {
   const ThreadOptions& thread_options() const { return thread_options_; }
 
  private:
-  friend class WorkerThread;
-
   const std::string name_prefix_;
   // The number of threads in the pool.
   const size_t max_num_threads_;
@@ -0,0 +1,136 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Compares ThreadPool and WorkStealingThreadPool on workloads of many small
+// tasks, e.g.
+//   threadpool_benchmark --num_threads=8 --num_tasks=100000
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "absl/flags/flag.h"  // from @com_google_absl
+#include "absl/flags/parse.h"  // from @com_google_absl
+#include "absl/log/absl_check.h"  // from @com_google_absl
+#include "absl/strings/string_view.h"  // from @com_google_absl
+#include "absl/time/clock.h"  // from @com_google_absl
+#include "absl/time/time.h"  // from @com_google_absl
+#include "runtime/framework/threadpool.h"
+#include "runtime/framework/work_stealing_threadpool.h"
+
+ABSL_FLAG(int, num_threads, 8, "Max number of threads of the pools.");
+ABSL_FLAG(int, num_tasks, 100000,
+          "Number of tasks scheduled from outside the pool.");
+ABSL_FLAG(int, nested_depth, 14,
+          "Depth of the binary tree of tasks scheduled from within the pool.");
+ABSL_FLAG(int, task_work, 100,
+          "Number of iterations of busy work each task does.");
+ABSL_FLAG(int, num_runs, 5, "Number of runs of each workload per pool.");
+
+namespace litert::lm {
+namespace {
+
+// Burns a few cycles so that tasks are small but not empty.
+void DoWork(int iterations) {
+  volatile int sink = 0;
+  for (int i = 0; i < iterations; ++i) {
+    sink = sink + i;
+  }
+}
+
+// Schedules all tasks from the main thread, i.e. through the shared queue.
+template <typename Pool>
+absl::Duration RunFanOut(Pool& pool, int num_tasks, int task_work) {
+  std::atomic<int> num_done = 0;
+  const absl::Time start = absl::Now();
+  for (int i = 0; i < num_tasks; ++i) {
+    ABSL_CHECK_OK(pool.Schedule([&num_done, task_work]() {
+      DoWork(task_work);
+      ++num_done;
+    }));
+  }
+  ABSL_CHECK_OK(pool.WaitUntilDone(absl::InfiniteDuration()));
+  const absl::Duration elapsed = absl::Now() - start;
+  ABSL_CHECK_EQ(num_done.load(), num_tasks);
+  return elapsed;
+}
+
+// Schedules a binary tree of tasks, each spawning its children from within
+// the pool, like recursive fork-join code.
+template <typename Pool>
+absl::Duration RunNested(Pool& pool, int depth, int task_work) {
+  std::atomic<int> num_done = 0;
+  std::function<void(int)> spawn = [&](int remaining_depth) {
+    DoWork(task_work);
+    ++num_done;
+    if (remaining_depth == 0) {
+      return;
+    }
+    for (int i = 0; i < 2; ++i) {
+      ABSL_CHECK_OK(pool.Schedule(
+          [&spawn, remaining_depth]() { spawn(remaining_depth - 1); }));
+    }
+  };
+  const absl::Time start = absl::Now();
+  ABSL_CHECK_OK(pool.Schedule([&spawn, depth]() { spawn(depth); }));
+  ABSL_CHECK_OK(pool.WaitUntilDone(absl::InfiniteDuration()));
+  const absl::Duration elapsed = absl::Now() - start;
+  ABSL_CHECK_EQ(num_done.load(), (2 << depth) - 1);
+  return elapsed;
+}
+
+template <typename Pool>
+void Report(absl::string_view pool_name, absl::string_view workload,
+            int num_tasks, absl::Duration (*run)(Pool&, int, int), int arg) {
+  const int num_threads = absl::GetFlag(FLAGS_num_threads);
+  const int task_work = absl::GetFlag(FLAGS_task_work);
+  absl::Duration best = absl::InfiniteDuration();
+  for (int i = 0; i < absl::GetFlag(FLAGS_num_runs); ++i) {
+    // A fresh pool per run so that thread creation is measured consistently.
+    Pool pool("benchmark", num_threads);
+    best = std::min(best, run(pool, arg, task_work));
+  }
+  std::cout << pool_name << "/" << workload << ": best of "
+            << absl::GetFlag(FLAGS_num_runs) << " runs " << best << ", "
+            << absl::ToDoubleNanoseconds(best) / num_tasks << " ns/task"
+            << std::endl;
+}
+
+void RunBenchmarks() {
+  const int num_tasks = absl::GetFlag(FLAGS_num_tasks);
+  const int depth = absl::GetFlag(FLAGS_nested_depth);
+  const int num_nested_tasks = (2 << depth) - 1;
+  Report<ThreadPool>("ThreadPool", "fan_out", num_tasks,
+                     &RunFanOut<ThreadPool>, num_tasks);
+  Report<WorkStealingThreadPool>("WorkStealingThreadPool", "fan_out",
+                                 num_tasks, &RunFanOut<WorkStealingThreadPool>,
+                                 num_tasks);
+  Report<ThreadPool>("ThreadPool", "nested", num_nested_tasks,
+                     &RunNested<ThreadPool>, depth);
+  Report<WorkStealingThreadPool>("WorkStealingThreadPool", "nested",
+                                 num_nested_tasks,
+                                 &RunNested<WorkStealingThreadPool>, depth);
+}
+
+}  // namespace
+}  // namespace litert::lm
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  litert::lm::RunBenchmarks();
+  return 0;
+}
@@ -0,0 +1,317 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "runtime/framework/work_stealing_threadpool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11): For yield().
+#include <utility>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
+#include "absl/log/absl_check.h"  // from @com_google_absl
+#include "absl/log/absl_log.h"  // from @com_google_absl
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/strings/str_cat.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/time/clock.h"  // from @com_google_absl
+#include "absl/time/time.h"  // from @com_google_absl
+#include "runtime/framework/lock_free_queue.h"
+#include "runtime/framework/thread_options.h"
+#include "runtime/framework/worker_thread.h"
+
+namespace litert::lm {
+namespace {
+
+// The number of tasks each worker deque holds before spilling over to the
+// shared queues.
+constexpr size_t kWorkerDequeCapacity = 1024;
+// The number of tasks the lock-free injection queue holds before spilling over
+// to the overflow queue.
+constexpr size_t kInjectionQueueCapacity = 4096;
+// The number of times an idle worker looks for a task before parking.
+constexpr int kNumSpinsBeforeParking = 64;
+
+// The pool and the index of the worker the calling thread runs, if any.
+thread_local const WorkStealingThreadPool* current_pool = nullptr;
+thread_local int current_worker_index = -1;
+
+}  // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(const std::string& name_prefix,
+                                               size_t max_num_threads,
+                                               ThreadOptions thread_options)
+    : name_prefix_(name_prefix),
+      max_num_threads_(max_num_threads == 0 ? 1 : max_num_threads),
+      thread_options_(std::move(thread_options)),
+      injection_queue_(kInjectionQueueCapacity) {
+  worker_deques_.reserve(max_num_threads_);
+  for (size_t i = 0; i < max_num_threads_; ++i) {
+    worker_deques_.push_back(
+        std::make_unique<WorkStealingDeque<Task>>(kWorkerDequeCapacity));
+  }
+  ABSL_LOG(INFO) << "WorkStealingThreadPool '" << name_prefix_
+                 << "': Running up to " << max_num_threads_ << " threads.";
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  ABSL_LOG(INFO) << "WorkStealingThreadPool '" << name_prefix_
+                 << "': Shutting down...";
+  {
+    absl::MutexLock lock(park_mutex_);
+    stopped_ = true;
+    park_cond_var_.SignalAll();
+  }
+
+  // The workers exit once all the scheduled tasks are finished. Repeat since a
+  // task scheduled right before stopping may have spawned another worker.
+  while (true) {
+    std::vector<std::unique_ptr<WorkerThread>> threads_to_join;
+    {
+      absl::MutexLock lock(threads_mutex_);
+      threads_to_join.swap(threads_);
+    }
+    if (threads_to_join.empty()) {
+      break;
+    }
+    for (auto& thread_ptr : threads_to_join) {
+      // Wait for each worker thread to finish.
+      ABSL_CHECK_OK(thread_ptr->Join());
+    }
+  }
+
+  ABSL_CHECK_EQ(num_pending_tasks_.load(), 0);
+  ABSL_LOG(INFO) << "WorkStealingThreadPool '" << name_prefix_
+                 << "': Shutdown complete.";
+}
+
+absl::Status WorkStealingThreadPool::Schedule(
+    absl::AnyInvocable<void() &&> callback) {
+  // Counted before checking stopped_, so that the workers don't exit while the
+  // task is being queued.
+  ++num_pending_tasks_;
+  if (stopped_) {
+    DecrementAndNotify(num_pending_tasks_);
+    ABSL_LOG(WARNING) << "WorkStealingThreadPool '" << name_prefix_
+                      << "': Schedule called on a stopped pool.";
+    return absl::FailedPreconditionError(absl::StrCat(
+        "WorkStealingThreadPool '", name_prefix_, "' is stopped."));
+  }
+  if (auto status = MaybeSpawnWorker(); !status.ok()) {
+    DecrementAndNotify(num_pending_tasks_);
+    return status;
+  }
+
+  ++num_queued_tasks_;
+  Enqueue(new Task(std::move(callback)));
+  WakeUpWorker();
+  return absl::OkStatus();
+}
+
+absl::Status WorkStealingThreadPool::MaybeSpawnWorker() {
+  // Spawn only if all the worker threads are (supposed to be) busy.
+  const size_t num_threads = num_threads_.load(std::memory_order_acquire);
+  const size_t num_pending_tasks = num_pending_tasks_;
+  if (num_threads >= max_num_threads_ ||
+      (num_threads > 0 &&
+       (num_parked_workers_ > 0 || num_threads >= num_pending_tasks))) {
+    return absl::OkStatus();
+  }
+
+  absl::MutexLock lock(threads_mutex_);
+  const size_t worker_index = threads_.size();
+  if (worker_index >= max_num_threads_) {
+    return absl::OkStatus();
+  }
+  auto thread =
+      WorkerThread::Create(thread_options_, name_prefix_,
+                           [this, worker_index]() { RunWorker(worker_index); });
+  if (!thread.ok()) {
+    if (worker_index == 0) {
+      ABSL_LOG(ERROR) << "WorkStealingThreadPool '" << name_prefix_
+                      << "': Failed to create the first worker thread: "
+                      << thread.status();
+      // Return the error to the caller since it would be fatal.
+      return thread.status();
+    }
+    ABSL_LOG(WARNING) << "WorkStealingThreadPool '" << name_prefix_
+                      << "': Failed to create a worker thread when all "
+                      << worker_index
+                      << " worker threads are (supposed to be) busy: "
+                      << thread.status();
+    // Ignore the error since tasks can still be run by existing worker
+    // threads.
+    return absl::OkStatus();
+  }
+  threads_.push_back(std::move(*thread));
+  num_threads_.store(threads_.size(), std::memory_order_release);
+  return absl::OkStatus();
+}
+
+void WorkStealingThreadPool::Enqueue(Task* task) {
+  if (current_pool == this &&
+      worker_deques_[current_worker_index]->Push(task)) {
+    return;
+  }
+  if (injection_queue_.Push(task)) {
+    return;
+  }
+  absl::MutexLock lock(overflow_mutex_);
+  overflow_queue_.push_back(task);
+  ++overflow_queue_size_;
+}
+
+WorkStealingThreadPool::Task* WorkStealingThreadPool::FindTask(
+    int worker_index) {
+  if (Task* task = worker_deques_[worker_index]->Pop(); task != nullptr) {
+    return task;
+  }
+  if (Task* task = injection_queue_.Pop(); task != nullptr) {
+    return task;
+  }
+  if (overflow_queue_size_ > 0) {
+    absl::MutexLock lock(overflow_mutex_);
+    if (!overflow_queue_.empty()) {
+      Task* task = overflow_queue_.front();
+      overflow_queue_.pop_front();
+      --overflow_queue_size_;
+      return task;
+    }
+  }
+  // Steal from the other workers, starting from the next one so that the
+  // thieves spread over the victims.
+  const size_t num_threads = num_threads_.load(std::memory_order_acquire);
+  for (size_t i = 1; i < num_threads; ++i) {
+    Task* task = worker_deques_[(worker_index + i) % num_threads]->Steal();
+    if (task != nullptr) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+bool WorkStealingThreadPool::HasQueuedTasks() const {
+  return num_queued_tasks_ > 0;
+}
+
+void WorkStealingThreadPool::RunWorker(int worker_index) {
+  current_pool = this;
+  current_worker_index = worker_index;
+  int num_spins = 0;
+  while (true) {
+    std::unique_ptr<Task> task(FindTask(worker_index));
+    if (task != nullptr) {
+      DecrementAndNotify(num_queued_tasks_);
+      std::move(*task)();
+      task.reset();
+      DecrementAndNotify(num_pending_tasks_);
+      num_spins = 0;
+      continue;
+    }
+    // A task may be on its way, e.g. being queued or stolen by another worker.
+    // Spin a little before parking, which costs the scheduler a lock.
+    if (num_spins < kNumSpinsBeforeParking) {
+      ++num_spins;
+      std::this_thread::yield();
+      continue;
+    }
+    num_spins = 0;
+    if (!Park()) {
+      break;
+    }
+  }
+  current_pool = nullptr;
+  current_worker_index = -1;
+  ABSL_LOG(INFO) << "WorkStealingThreadPool '" << name_prefix_
+                 << "': Worker thread stopped.";
+}
+
+bool WorkStealingThreadPool::Park() {
+  absl::MutexLock lock(park_mutex_);
+  // Counted before checking for the tasks. Paired with the check in
+  // WakeUpWorker(), either this worker sees a newly queued task, or the
+  // scheduler sees this worker parked.
+  ++num_parked_workers_;
+  bool keep_running = true;
+  while (!HasQueuedTasks()) {
+    if (stopped_ && num_pending_tasks_ == 0) {
+      keep_running = false;
+      break;
+    }
+    park_cond_var_.Wait(&park_mutex_);
+  }
+  --num_parked_workers_;
+  return keep_running;
+}
+
+void WorkStealingThreadPool::WakeUpWorker() {
+  if (num_parked_workers_ == 0) {
+    return;
+  }
+  absl::MutexLock lock(park_mutex_);
+  park_cond_var_.Signal();
+}
+
+void WorkStealingThreadPool::DecrementAndNotify(std::atomic<int>& counter) {
+  if (--counter > 0) {
+    return;
+  }
+  if (num_waiters_ > 0) {
+    // The waiters' conditions are evaluated when the mutex is released.
+    absl::MutexLock lock(wait_mutex_);
+  }
+  if (&counter == &num_pending_tasks_ && stopped_) {
+    // The parked workers exit once all the tasks are finished.
+    absl::MutexLock lock(park_mutex_);
+    park_cond_var_.SignalAll();
+  }
+}
+
+absl::Status WorkStealingThreadPool::WaitUntilIdle(absl::Duration timeout) {
+  absl::MutexLock lock(wait_mutex_);
+  absl::Time deadline = absl::Now() + timeout;
+  ++num_waiters_;
+  auto is_tasks_empty = [this]() { return num_queued_tasks_ == 0; };
+  const bool idle =
+      wait_mutex_.AwaitWithDeadline(absl::Condition(&is_tasks_empty), deadline);
+  --num_waiters_;
+  if (idle) {
+    return absl::OkStatus();
+  }
+  return absl::DeadlineExceededError(absl::StrCat(
+      "Timeout waiting for task queue to become idle in pool '", name_prefix_,
+      "'. Tasks still in queue: ", num_queued_tasks_.load()));
+}
+
+absl::Status WorkStealingThreadPool::WaitUntilDone(absl::Duration timeout) {
+  absl::MutexLock lock(wait_mutex_);
+  absl::Time deadline = absl::Now() + timeout;
+  ++num_waiters_;
+  auto is_done = [this]() { return num_pending_tasks_ == 0; };
+  const bool done =
+      wait_mutex_.AwaitWithDeadline(absl::Condition(&is_done), deadline);
+  --num_waiters_;
+  if (done) {
+    return absl::OkStatus();
+  }
+  return absl::DeadlineExceededError(absl::StrCat(
+      "Timeout waiting for all tasks to be done in pool '", name_prefix_,
+      "'. Tasks not finished: ", num_pending_tasks_.load()));
+}
+
+}  // namespace litert::lm
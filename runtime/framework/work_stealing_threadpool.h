@@ -0,0 +1,168 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_WORK_STEALING_THREADPOOL_H_
+#define THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_WORK_STEALING_THREADPOOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"  // from @com_google_absl
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/synchronization/mutex.h"  // from @com_google_absl
+#include "absl/time/time.h"  // from @com_google_absl
+#include "runtime/framework/lock_free_queue.h"
+#include "runtime/framework/thread_options.h"
+
+namespace litert::lm {
+
+// Forward declaration of WorkerThread to keep the header light.
+class WorkerThread;
+
+// A thread pool with the same interface as ThreadPool, whose task queues don't
+// take a lock in the common case. It suits many small tasks, e.g. per-row
+// sampling or per-chunk preprocessing, where the single mutex-guarded queue of
+// ThreadPool gets contended.
+//
+// - Each worker thread has a Chase-Lev deque. The tasks scheduled by a task
+//   running on a worker go to the deque of the worker, which runs them
+//   last-in-first-out, while the idle workers steal from the other end.
+// - The tasks scheduled by other threads go to a global lock-free injection
+//   queue, or to a mutex-guarded overflow queue when it is full.
+// - Idle workers spin a little, then park on a condition variable. Scheduling
+//   takes the parking lock only when a worker is parked.
+//
+// Like ThreadPool, the order the tasks run in is not guaranteed, and the pool
+// waits for the scheduled tasks to finish when destroyed.
+class WorkStealingThreadPool {
+ public:
+  // Creates a thread pool that creates and can use up to "max_num_threads"
+  // threads. Any standard thread options, such as stack size, should be passed
+  // via "thread_options". "name_prefix" specifies the thread name prefix.
+  WorkStealingThreadPool(const std::string& name_prefix,
+                         size_t max_num_threads,
+                         ThreadOptions thread_options = ThreadOptions());
+
+  // Waits for the scheduled tasks to finish, then stops the threads.
+  ~WorkStealingThreadPool();
+
+  WorkStealingThreadPool(const WorkStealingThreadPool&) = delete;
+  WorkStealingThreadPool& operator=(const WorkStealingThreadPool&) = delete;
+
+  // Adds specified callback to the pool. Eventually a thread will run it. Note
+  // that this does not guarantee that the callback is executed in the order it
+  // was scheduled.
+  absl::Status Schedule(absl::AnyInvocable<void() &&> callback);
+
+  // Waits until no callback is waiting to run. The function will return an
+  // error if the timeout is reached before. Like ThreadPool::WaitUntilIdle(),
+  // the scheduled callbacks may still be running.
+  absl::Status WaitUntilIdle(absl::Duration timeout);
+
+  // Waits until all the scheduled callbacks are executed and finished. The
+  // function will return an error if the timeout is reached before all the
+  // callbacks are finished.
+  absl::Status WaitUntilDone(absl::Duration timeout);
+
+  // Maximum number of threads in the pool.
+  size_t max_num_threads() const { return max_num_threads_; }
+
+  // Number of threads in the pool spawned actually.
+  size_t num_threads() const {
+    return num_threads_.load(std::memory_order_acquire);
+  }
+
+  // Standard thread options. Use this accessor to get them.
+  const ThreadOptions& thread_options() const { return thread_options_; }
+
+ private:
+  using Task = absl::AnyInvocable<void() &&>;
+
+  // The main function of the worker thread of the given index.
+  void RunWorker(int worker_index);
+
+  // Spawns a worker thread if all the spawned ones are (supposed to be) busy.
+  // Returns an error only if the pool has no worker thread at all.
+  absl::Status MaybeSpawnWorker();
+
+  // Queues the task on the deque of the calling worker, or on the injection
+  // queue if the caller is not a worker of this pool.
+  void Enqueue(Task* task);
+
+  // Finds a task for the worker to run: from its own deque, the injection
+  // queue, the overflow queue, then from the deques of the other workers.
+  Task* FindTask(int worker_index);
+
+  // Whether any task is waiting to run.
+  bool HasQueuedTasks() const;
+
+  // Parks the worker until a task is scheduled. Returns false if the worker
+  // should exit since the pool is stopped and all the tasks are finished.
+  bool Park();
+
+  // Wakes up a parked worker, if any, to run a newly scheduled task.
+  void WakeUpWorker();
+
+  // Decrements the counter, and wakes up the WaitUntil*() callers if it drops
+  // to zero.
+  void DecrementAndNotify(std::atomic<int>& counter);
+
+  const std::string name_prefix_;
+  // The number of threads in the pool.
+  const size_t max_num_threads_;
+  // Thread options.
+  const ThreadOptions thread_options_;
+
+  // The deques of the worker threads, one for each potential worker, so that
+  // they never move.
+  std::vector<std::unique_ptr<WorkStealingDeque<Task>>> worker_deques_;
+  // The tasks scheduled by the threads not in the pool.
+  BoundedMpmcQueue<Task> injection_queue_;
+  // The tasks not fitting in the injection queue or a worker deque.
+  absl::Mutex overflow_mutex_;
+  std::deque<Task*> overflow_queue_ ABSL_GUARDED_BY(overflow_mutex_);
+  std::atomic<int> overflow_queue_size_ = 0;
+
+  // Spawning the worker threads.
+  mutable absl::Mutex threads_mutex_;
+  std::vector<std::unique_ptr<WorkerThread>> threads_
+      ABSL_GUARDED_BY(threads_mutex_);
+  std::atomic<size_t> num_threads_ = 0;
+
+  // Parking the idle worker threads.
+  absl::Mutex park_mutex_;
+  absl::CondVar park_cond_var_;
+  std::atomic<int> num_parked_workers_ = 0;
+
+  // Whether the pool is stopped.
+  std::atomic<bool> stopped_ = false;
+  // The number of tasks waiting to run.
+  std::atomic<int> num_queued_tasks_ = 0;
+  // The number of tasks scheduled and not finished yet.
+  std::atomic<int> num_pending_tasks_ = 0;
+
+  // Waiting for the counters above to drop to zero.
+  absl::Mutex wait_mutex_;
+  std::atomic<int> num_waiters_ = 0;
+};
+
+}  // namespace litert::lm
+
+#endif  // THIRD_PARTY_LITERT_LM_RUNTIME_FRAMEWORK_WORK_STEALING_THREADPOOL_H_
@@ -0,0 +1,135 @@
+// Copyright 2025 The ODML Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "runtime/framework/work_stealing_threadpool.h"
+
+#include <atomic>
+#include <functional>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"  // from @com_google_absl
+#include "absl/synchronization/notification.h"  // from @com_google_absl
+#include "absl/time/clock.h"  // from @com_google_absl
+#include "absl/time/time.h"  // from @com_google_absl
+#include "runtime/util/test_utils.h"  // NOLINT
+
+namespace litert::lm {
+namespace {
+
+using ::testing::status::StatusIs;
+
+TEST(WorkStealingThreadPoolTest, DestroyWithoutStart) {
+  WorkStealingThreadPool thread_pool("testpool", 10);
+  EXPECT_EQ(thread_pool.max_num_threads(), 10);
+  EXPECT_EQ(thread_pool.num_threads(), 0);
+}
+
+TEST(WorkStealingThreadPoolTest, EmptyThread) {
+  WorkStealingThreadPool thread_pool("testpool", 0);
+  EXPECT_EQ(thread_pool.max_num_threads(), 1);
+  EXPECT_EQ(thread_pool.num_threads(), 0);
+}
+
+TEST(WorkStealingThreadPoolTest, SingleThread) {
+  std::atomic<int> n = 100;
+  {
+    WorkStealingThreadPool thread_pool("testpool", 1);
+    for (int i = 0; i < 100; ++i) {
+      EXPECT_OK(thread_pool.Schedule([&n]() { --n; }));
+    }
+    EXPECT_EQ(thread_pool.num_threads(), 1);
+  }
+  EXPECT_EQ(n, 0);
+}
+
+TEST(WorkStealingThreadPoolTest, MultiThreads) {
+  std::atomic<int> n = 10000;
+  {
+    WorkStealingThreadPool thread_pool("testpool", 8);
+    // More tasks than the injection queue holds, so that some overflow.
+    for (int i = 0; i < 10000; ++i) {
+      EXPECT_OK(thread_pool.Schedule([&n]() { --n; }));
+    }
+    EXPECT_LE(thread_pool.num_threads(), 8);
+  }
+  EXPECT_EQ(n, 0);
+}
+
+TEST(WorkStealingThreadPoolTest, NestedTasksAreStolen) {
+  WorkStealingThreadPool thread_pool("testpool", 4);
+  std::atomic<int> n = 0;
+  // Each task fans out to two more tasks until the given depth, which go to
+  // the deque of the worker running it.
+  std::function<void(int)> fan_out = [&](int depth) {
+    ++n;
+    if (depth == 0) {
+      return;
+    }
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_OK(thread_pool.Schedule([&fan_out, depth]() {
+        fan_out(depth - 1);
+      }));
+    }
+  };
+  EXPECT_OK(thread_pool.Schedule([&fan_out]() { fan_out(12); }));
+  EXPECT_OK(thread_pool.WaitUntilDone(absl::Seconds(30)));
+  EXPECT_EQ(n, (1 << 13) - 1);
+}
+
+TEST(WorkStealingThreadPoolTest, WaitUntilIdleAndDone) {
+  WorkStealingThreadPool thread_pool("testpool", 1);
+  absl::Notification started;
+  absl::Notification finished;
+  EXPECT_OK(thread_pool.Schedule([&started, &finished]() {
+    started.Notify();
+    finished.WaitForNotification();
+  }));
+  started.WaitForNotification();
+  // The task is running, so the queue is empty but the pool is not done.
+  EXPECT_OK(thread_pool.WaitUntilIdle(absl::Seconds(10)));
+  EXPECT_THAT(thread_pool.WaitUntilDone(absl::Milliseconds(10)),
+              StatusIs(absl::StatusCode::kDeadlineExceeded));
+  finished.Notify();
+  EXPECT_OK(thread_pool.WaitUntilDone(absl::Seconds(10)));
+}
+
+TEST(WorkStealingThreadPoolTest, WaitUntilIdleTimeout) {
+  WorkStealingThreadPool thread_pool("testpool", 1);
+  absl::Notification finished;
+  EXPECT_OK(thread_pool.Schedule(
+      [&finished]() { finished.WaitForNotification(); }));
+  EXPECT_OK(thread_pool.Schedule([]() {}));
+  // The second task can't run until the first one finishes.
+  EXPECT_THAT(thread_pool.WaitUntilIdle(absl::Milliseconds(10)),
+              StatusIs(absl::StatusCode::kDeadlineExceeded));
+  finished.Notify();
+  EXPECT_OK(thread_pool.WaitUntilIdle(absl::Seconds(10)));
+}
+
+TEST(WorkStealingThreadPoolTest, WorkersParkAndWakeUp) {
+  WorkStealingThreadPool thread_pool("testpool", 4);
+  std::atomic<int> n = 0;
+  for (int round = 0; round < 10; ++round) {
+    EXPECT_OK(thread_pool.Schedule([&n]() { ++n; }));
+    EXPECT_OK(thread_pool.WaitUntilDone(absl::Seconds(10)));
+    // Let the workers spin out and park.
+    absl::SleepFor(absl::Milliseconds(5));
+  }
+  EXPECT_EQ(n, 10);
+}
+
+}  // namespace
+}  // namespace litert::lm
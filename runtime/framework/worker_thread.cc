@@ -15,17 +15,22 @@
 #include "runtime/framework/worker_thread.h"
 
 #include <string>
+#include <utility>
 
-#include "absl/base/nullability.h"  // from @com_google_absl
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
 #include "absl/log/absl_check.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
-#include "runtime/framework/threadpool.h"
+#include "runtime/framework/thread_options.h"
 
 namespace litert::lm {
 
-WorkerThread::WorkerThread(ThreadPool* absl_nonnull pool,
-                           const std::string& name_prefix)
-    : pool_(*pool), name_prefix_(name_prefix), joined_(false) {}
+WorkerThread::WorkerThread(const ThreadOptions& thread_options,
+                           const std::string& name_prefix,
+                           absl::AnyInvocable<void()> run_worker)
+    : thread_options_(thread_options),
+      name_prefix_(name_prefix),
+      run_worker_(std::move(run_worker)),
+      joined_(false) {}
 
 WorkerThread::~WorkerThread() { ABSL_CHECK(joined_); }
 
@@ -38,6 +43,6 @@ absl::Status WorkerThread::Join() {
   return JoinImpl();
 }
 
-void WorkerThread::RunWorker() { pool_.RunWorker(); }
+void WorkerThread::RunWorker() { run_worker_(); }
 
 }  // namespace litert::lm
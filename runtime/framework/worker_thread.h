@@ -19,18 +19,20 @@
 #include <memory>
 #include <string>
 
-#include "absl/base/nullability.h"  // from @com_google_absl
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
-#include "runtime/framework/threadpool.h"
+#include "runtime/framework/thread_options.h"
 
 namespace litert::lm {
 
 class WorkerThread {
  public:
-  // Creates and starts a thread that runs pool->RunWorker().
+  // Creates and starts a thread that runs run_worker(), the main function of
+  // the worker thread of a pool.
   static absl::StatusOr<std::unique_ptr<WorkerThread>> Create(
-      ThreadPool* absl_nonnull pool, const std::string& name_prefix);
+      const ThreadOptions& thread_options, const std::string& name_prefix,
+      absl::AnyInvocable<void()> run_worker);
 
   // REQUIRES: Join() must have been called.
   virtual ~WorkerThread();
@@ -39,7 +41,9 @@ class WorkerThread {
   absl::Status Join();
 
  protected:
-  WorkerThread(ThreadPool* absl_nonnull pool, const std::string& name_prefix);
+  WorkerThread(const ThreadOptions& thread_options,
+               const std::string& name_prefix,
+               absl::AnyInvocable<void()> run_worker);
 
   // The implementation of Join().
   virtual absl::Status JoinImpl() = 0;
@@ -47,8 +51,9 @@ class WorkerThread {
   // For the visibility from WorkerThread subclasses.
   void RunWorker();
 
-  ThreadPool& pool_;
+  const ThreadOptions thread_options_;
   const std::string name_prefix_;
+  absl::AnyInvocable<void()> run_worker_;
 
   // Track if this thread is joined.
   std::atomic<bool> joined_;
@@ -25,14 +25,13 @@
 #include <string>
 #include <utility>
 
-#include "absl/base/nullability.h"  // from @com_google_absl
+#include "absl/functional/any_invocable.h"  // from @com_google_absl
 #include "absl/log/absl_log.h"  // from @com_google_absl
 #include "absl/status/status.h"  // from @com_google_absl
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "absl/strings/str_cat.h"  // from @com_google_absl
 #include "absl/strings/str_join.h"  // from @com_google_absl
 #include "runtime/framework/thread_options.h"
-#include "runtime/framework/threadpool.h"
 #include "runtime/framework/worker_thread.h"
 
 namespace litert::lm {
@@ -55,8 +54,9 @@ std::string CreateThreadName(const std::string& prefix, int thread_id) {
 
 class WorkerThreadPthread : public WorkerThread {
  public:
-  WorkerThreadPthread(ThreadPool* absl_nonnull pool,
-                      const std::string& name_prefix);
+  WorkerThreadPthread(const ThreadOptions& thread_options,
+                      const std::string& name_prefix,
+                      absl::AnyInvocable<void()> run_worker);
 
   // Starts the thread and reports the status.
   absl::Status Start();
@@ -69,9 +69,10 @@ class WorkerThreadPthread : public WorkerThread {
   pthread_t thread_;
 };
 
-WorkerThreadPthread::WorkerThreadPthread(ThreadPool* absl_nonnull pool,
-                                         const std::string& name_prefix)
-    : WorkerThread(pool, name_prefix) {}
+WorkerThreadPthread::WorkerThreadPthread(
+    const ThreadOptions& thread_options, const std::string& name_prefix,
+    absl::AnyInvocable<void()> run_worker)
+    : WorkerThread(thread_options, name_prefix, std::move(run_worker)) {}
 
 absl::Status WorkerThreadPthread::Start() {
   int res = pthread_create(&thread_, nullptr, ThreadBody, this);
@@ -97,9 +98,8 @@ absl::Status WorkerThreadPthread::JoinImpl() {
 
 void* WorkerThreadPthread::ThreadBody(void* arg) {
   auto thread = reinterpret_cast<WorkerThreadPthread*>(arg);
-  int nice_priority_level =
-      thread->pool_.thread_options().nice_priority_level();
-  const std::set<int> selected_cpus = thread->pool_.thread_options().cpu_set();
+  int nice_priority_level = thread->thread_options_.nice_priority_level();
+  const std::set<int> selected_cpus = thread->thread_options_.cpu_set();
 #if defined(__linux__)
   const std::string name =
       CreateThreadName(thread->name_prefix_, syscall(SYS_gettid));
@@ -157,8 +157,10 @@ void* WorkerThreadPthread::ThreadBody(void* arg) {
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<WorkerThread>> WorkerThread::Create(
-    ThreadPool* absl_nonnull pool, const std::string& name_prefix) {
-  auto worker = std::make_unique<WorkerThreadPthread>(pool, name_prefix);
+    const ThreadOptions& thread_options, const std::string& name_prefix,
+    absl::AnyInvocable<void()> run_worker) {
+  auto worker = std::make_unique<WorkerThreadPthread>(
+      thread_options, name_prefix, std::move(run_worker));
   auto status = worker->Start();
   if (!status.ok()) {
     return status;
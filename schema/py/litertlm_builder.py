@@ -94,6 +94,7 @@ class TfLiteModelType(enum.Enum):
   """
 
   PREFILL_DECODE = "tf_lite_prefill_decode"
+  DRAFT_PREFILL_DECODE = "tf_lite_draft_prefill_decode"
 
   EMBEDDER = "tf_lite_embedder"
   PER_LAYER_EMBEDDER = "tf_lite_per_layer_embedder"